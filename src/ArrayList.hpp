@@ -4,11 +4,17 @@
 
 #include "Main.hpp"
 
+#include <new>
+#include <utility>
+#include <type_traits>
+
 #include <luajit-2.0/lua.hpp>
 #include <LuaBridge/LuaBridge.h>
 
 // templated ArrayList (similar to std::vector)
 // adding or removing elements can unsort the list.
+// storage beyond getSize() is left unconstructed, so reserving space never default-constructs
+// elements that may never be used. trivially copyable types are moved with memcpy/realloc.
 // @param T generic type that the list will contain
 template <typename T>
 class ArrayList {
@@ -26,7 +32,8 @@ public:
 
 	virtual ~ArrayList() {
 		if( arr ) {
-			delete[] arr;
+			destroy(0, size);
+			free(arr);
 			arr = nullptr;
 		}
 	}
@@ -108,26 +115,41 @@ public:
 	// @param len number of elements to size the list for
 	// @return *this
 	ArrayList& alloc(Uint32 len) {
-		maxSize = len;
-		Uint32 newSize = std::min( maxSize, size );
-		T* newArr = nullptr;
-		if( len ) {
-			newArr = new T[len];
-			assert(newArr);
-			Uint32 copyLen = min(size, len);
-			for( Uint32 c = 0; c < copyLen; ++c ) {
-				newArr[c] = std::move(arr[c]);
+		if( len == maxSize ) {
+			return *this;
+		}
+		if( len < size ) {
+			destroy(len, size);
+			size = len;
+		}
+		if( len == 0 ) {
+			if( arr ) {
+				free(arr);
+				arr = nullptr;
 			}
+		} else {
+			arr = relocate(arr, size, len, std::integral_constant<bool, trivial>());
 		}
-		if( arr ) {
-			delete[] arr;
-			arr = nullptr;
+		maxSize = len;
+		return *this;
+	}
+
+	// make sure the list can hold at least the given number of elements without reallocating
+	// @param len number of elements to reserve space for
+	// @return *this
+	ArrayList& reserve(Uint32 len) {
+		if( len > maxSize ) {
+			alloc(len);
 		}
-		size = newSize;
-		arr = newArr;
 		return *this;
 	}
 
+	// release any capacity beyond the current size
+	// @return *this
+	ArrayList& shrink_to_fit() {
+		return alloc(size);
+	}
+
 	// fill the internal list, resizing if necessary
 	// @param len number of elements to size the list for
 	// @return *this
@@ -137,8 +159,10 @@ public:
 		}
 		if( len > size ) {
 			for( Uint32 c = size; c < len; ++c ) {
-				arr[c] = T();
+				new (&arr[c]) T();
 			}
+		} else {
+			destroy(len, size);
 		}
 		size = len;
 		return *this;
@@ -151,15 +175,24 @@ public:
 		return *this;
 	}
 
+	// empty the list but hold on to its storage, for lists that are refilled every frame
+	// @return *this
+	ArrayList& clearKeepCapacity() {
+		destroy(0, size);
+		size = 0;
+		return *this;
+	}
+
 	// replace list contents with those of another list
 	// @param src the list to copy into our list
 	// @return *this;
 	ArrayList& copy(const ArrayList& src) {
-		alloc(src.getSize());
-		size = src.getSize();
-		for( Uint32 c = 0; c < src.getSize(); ++c ) {
-			arr[c] = src[c];
+		if( &src == this ) {
+			return *this;
 		}
+		clearKeepCapacity();
+		reserve(src.getSize());
+		construct(src.getArray(), src.getSize(), std::integral_constant<bool, trivial>());
 		return *this;
 	}
 
@@ -167,13 +200,9 @@ public:
 	// @param src the array to copy into our list
 	// @return *this;
 	ArrayList& copy(const std::initializer_list<T>& src) {
-		alloc(static_cast<Uint32>(src.size()));
-		size = static_cast<Uint32>(src.size());
-		const T* it;
-		Uint32 c;
-		for( c = 0, it = std::begin(src); it != std::end(src); ++it, ++c ) {
-			arr[c] = *it;
-		}
+		clearKeepCapacity();
+		reserve(static_cast<Uint32>(src.size()));
+		construct(src.begin(), static_cast<Uint32>(src.size()), std::integral_constant<bool, trivial>());
 		return *this;
 	}
 
@@ -197,10 +226,26 @@ public:
 	// @param val the value to push
 	void push(const T& val) {
 		if( size==maxSize ) {
-			alloc(std::max((unsigned int)size*2U, 4U));
+			Uint32 index = indexOf(val); // val may live in storage that is about to move
+			grow();
+			duplicate(&arr[size], index != UINT32_MAX ? arr[index] : val);
+		} else {
+			duplicate(&arr[size], val);
 		}
 		++size;
-		arr[size-1] = std::move(val);
+	}
+
+	// construct a value in place at the end of the list
+	// @param args arguments for the value's constructor
+	// @return the new value
+	template <typename... Args>
+	T& emplace(Args&&... args) {
+		if( size==maxSize ) {
+			grow();
+		}
+		new (&arr[size]) T(std::forward<Args>(args)...);
+		++size;
+		return arr[size-1];
 	}
 
 	// insert a value into the list
@@ -208,12 +253,22 @@ public:
 	// @param pos the index to displace (move to the end of the list)
 	void insert(const T& val, Uint32 pos) {
 		assert(pos <= size);
+		if( indexOf(val) != UINT32_MAX ) {
+			T temp; // val lives in storage that is about to be shuffled
+			temp = val;
+			insert(temp, pos);
+			return;
+		}
 		if( size==maxSize ) {
-			alloc(std::max((unsigned int)size*2U, 4U));
+			grow();
+		}
+		if( pos == size ) {
+			duplicate(&arr[size], val);
+		} else {
+			transfer(&arr[size], arr[pos]);
+			arr[pos] = val;
 		}
 		++size;
-		arr[size-1] = arr[pos];
-		arr[pos] = val;
 	}
 
 	// insert a value into the list, rearranging all elements after it
@@ -221,14 +276,25 @@ public:
 	// @param pos the index to displace (move all elements starting here 1 index forward)
 	void insertAndRearrange(const T& val, Uint32 pos) {
 		assert(pos <= size);
+		if( indexOf(val) != UINT32_MAX ) {
+			T temp; // val lives in storage that is about to be shuffled
+			temp = val;
+			insertAndRearrange(temp, pos);
+			return;
+		}
 		if( size==maxSize ) {
-			alloc(std::max((unsigned int)size*2U, 4U));
+			grow();
 		}
-		++size;
-		for( Uint32 c = size-1; c > pos; --c ) {
-			arr[c] = arr[c-1];
+		if( pos == size ) {
+			duplicate(&arr[size], val);
+		} else {
+			transfer(&arr[size], arr[size-1]);
+			for( Uint32 c = size-1; c > pos; --c ) {
+				arr[c] = std::move(arr[c-1]);
+			}
+			arr[pos] = val;
 		}
-		arr[pos] = val;
+		++size;
 	}
 
 	// removes and returns the last element from the list
@@ -236,7 +302,9 @@ public:
 	T pop() {
 		assert(size > 0);
 		--size;
-		return arr[size];
+		T result = arr[size];
+		arr[size].~T();
+		return result;
 	}
 
 	// returns the last element in the list without removing it
@@ -260,7 +328,10 @@ public:
 		assert(size > pos);
 		T result = arr[pos];
 		--size;
-		arr[pos] = arr[size];
+		if( pos != size ) {
+			arr[pos] = std::move(arr[size]);
+		}
+		arr[size].~T();
 		return result;
 	}
 
@@ -273,8 +344,9 @@ public:
 
 		Uint32 newSize = size - 1;
 		for( Uint32 c = pos; c < newSize; ++c ) {
-			arr[c] = arr[c+1];
+			arr[c] = std::move(arr[c+1]);
 		}
+		arr[newSize].~T();
 
 		--size;
 		return result;
@@ -394,8 +466,11 @@ public:
 			.addFunction("getMaxSize", &ArrayList<T>::getMaxSize)
 			.addFunction("empty", &ArrayList<T>::empty)
 			.addFunction("alloc", &ArrayList<T>::alloc)
+			.addFunction("reserve", &ArrayList<T>::reserve)
+			.addFunction("shrink_to_fit", &ArrayList<T>::shrink_to_fit)
 			.addFunction("resize", &ArrayList<T>::resize)
 			.addFunction("clear", &ArrayList<T>::clear)
+			.addFunction("clearKeepCapacity", &ArrayList<T>::clearKeepCapacity)
 			.addFunction("copy", copy)
 			.addFunction("push", &ArrayList<T>::push)
 			.addFunction("insert", &ArrayList<T>::insert)
@@ -414,6 +489,77 @@ protected:
 	T* arr = nullptr;		// array data
 	Uint32 size = 0;		// current array capacity
 	Uint32 maxSize = 0;		// maximum array capacity
+
+private:
+	// types that can be moved around as raw bytes
+	static const bool trivial = std::is_trivially_copyable<T>::value;
+
+	// double the capacity of the list
+	void grow() {
+		alloc(std::max((unsigned int)size*2U, 4U));
+	}
+
+	// destroy the elements in the given range
+	void destroy(Uint32 start, Uint32 end) {
+		if( !std::is_trivially_destructible<T>::value ) {
+			for( Uint32 c = start; c < end; ++c ) {
+				arr[c].~T();
+			}
+		}
+	}
+
+	// move the first count elements of old storage into storage with the given capacity
+	static T* relocate(T* oldArr, Uint32 count, Uint32 len, std::true_type) {
+		T* newArr = static_cast<T*>(realloc(oldArr, sizeof(T) * len));
+		assert(newArr);
+		return newArr;
+	}
+	static T* relocate(T* oldArr, Uint32 count, Uint32 len, std::false_type) {
+		T* newArr = static_cast<T*>(malloc(sizeof(T) * len));
+		assert(newArr);
+		for( Uint32 c = 0; c < count; ++c ) {
+			transfer(&newArr[c], oldArr[c]);
+			oldArr[c].~T();
+		}
+		if( oldArr ) {
+			free(oldArr);
+		}
+		return newArr;
+	}
+
+	// copy-construct count elements from src onto the end of the (empty) list
+	void construct(const T* src, Uint32 count, std::true_type) {
+		if( count ) {
+			memcpy(arr, src, sizeof(T) * count);
+		}
+		size = count;
+	}
+	void construct(const T* src, Uint32 count, std::false_type) {
+		for( Uint32 c = 0; c < count; ++c ) {
+			duplicate(&arr[c], src[c]);
+		}
+		size = count;
+	}
+
+	// build an element in raw storage from another one. elements are default-constructed
+	// and then assigned, because some of our types (eg Tile) deliberately copy only part
+	// of themselves through operator= and must never be copy-constructed
+	static void duplicate(T* dest, const T& src) {
+		new (dest) T();
+		*dest = src;
+	}
+	static void transfer(T* dest, T& src) {
+		new (dest) T();
+		*dest = std::move(src);
+	}
+
+	// @return the index of the given value if it lives in our storage, otherwise UINT32_MAX
+	Uint32 indexOf(const T& val) const {
+		if( size && &val >= arr && &val < arr + size ) {
+			return static_cast<Uint32>(&val - arr);
+		}
+		return UINT32_MAX;
+	}
 };
 
 template <typename T, Uint32 defaultSize>
@@ -619,9 +619,13 @@ void BBox::draw(Camera& camera, const ArrayList<Light*>& lights) {
 }
 
 void BBox::update() {
-	Vector oldGScale = gScale;
+	lastGScale = gScale;
 	Component::update();
-	updateRigidBody(oldGScale);
+	queueUpdateShared();
+}
+
+void BBox::updateShared() {
+	updateRigidBody(lastGScale);
 }
 
 void BBox::load(FILE* fp) {
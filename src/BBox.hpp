@@ -101,6 +101,9 @@ public:
 
 	// updates matrices and rigid body
 	virtual void update() override;
+
+	// updates the rigid body
+	virtual void updateShared() override;
 		
 	// draws the component
 	// @param camera the camera through which to draw the component
@@ -143,6 +146,7 @@ private:
 	String meshName;
 
 	bool dirty = false;
+	Vector lastGScale;	// global scale before the last update()
 
 	// bullet physics objects
 	btDiscreteDynamicsWorld* dynamicsWorld = nullptr;
@@ -0,0 +1,155 @@
+// BitStream.hpp
+// Reads and writes values a few bits at a time
+
+#pragma once
+
+#include "Main.hpp"
+
+// packs values into a byte buffer using only as many bits as each one needs, lowest bit first.
+// writing past the end of the buffer sets an overflow flag instead, so a caller can try to fit
+// something, check, and rewind if it didn't.
+class BitWriter {
+public:
+	BitWriter(Uint8* _data, Uint32 _capacity) :
+		data(_data),
+		capacity(_capacity)
+	{}
+
+	// getters & setters
+	Uint32			getBits() const				{ return bits; }
+	Uint32			getBytes() const			{ return (bits + 7) / 8; }
+	bool			isOverflowed() const		{ return overflowed; }
+
+	// goes back to an earlier position, forgetting everything written after it
+	// @param _bits the position to go back to (from getBits())
+	void rewind(Uint32 _bits) {
+		bits = _bits;
+		overflowed = false;
+		if( bits & 7 ) {
+			data[bits >> 3] &= (1 << (bits & 7)) - 1;
+		}
+	}
+
+	// writes the low bits of a value
+	// @param value the value to write
+	// @param count the number of bits to write (up to 32)
+	void write(Uint32 value, Uint32 count) {
+		if( overflowed || bits + count > capacity * 8 ) {
+			overflowed = true;
+			return;
+		}
+		while( count > 0 ) {
+			Uint32 shift = bits & 7;
+			Uint32 chunk = count < 8 - shift ? count : 8 - shift;
+			if( shift == 0 ) {
+				data[bits >> 3] = 0;
+			}
+			data[bits >> 3] |= (Uint8)((value & ((1 << chunk) - 1)) << shift);
+			value >>= chunk;
+			bits += chunk;
+			count -= chunk;
+		}
+	}
+
+	// writes a single bit
+	void writeBool(bool value) {
+		write(value ? 1 : 0, 1);
+	}
+
+	// writes an unsigned value four bits at a time, each group followed by a bit saying whether
+	// another follows (small values take 5 bits)
+	void writeVar(Uint64 value) {
+		do {
+			write((Uint32)(value & 15), 4);
+			value >>= 4;
+			writeBool(value != 0);
+		} while( value != 0 && !overflowed );
+	}
+
+	// writes a signed value that is usually near zero: two bits pick a width of 4, 8, 16, or 32
+	// bits, and the value is folded so small negatives are small too
+	void writeSigned(Sint32 value) {
+		Uint32 folded = ((Uint32)value << 1) ^ (Uint32)(value >> 31);
+		if( folded < (1u << 4) ) {
+			write(0, 2);
+			write(folded, 4);
+		} else if( folded < (1u << 8) ) {
+			write(1, 2);
+			write(folded, 8);
+		} else if( folded < (1u << 16) ) {
+			write(2, 2);
+			write(folded, 16);
+		} else {
+			write(3, 2);
+			write(folded, 32);
+		}
+	}
+
+private:
+	Uint8* data = nullptr;
+	Uint32 capacity = 0;		// in bytes
+	Uint32 bits = 0;
+	bool overflowed = false;
+};
+
+// reads back what a BitWriter wrote. reading past the end sets an overflow flag and returns zeroes.
+class BitReader {
+public:
+	BitReader(const Uint8* _data, Uint32 _size) :
+		data(_data),
+		size(_size)
+	{}
+
+	// getters & setters
+	bool			isOverflowed() const		{ return overflowed; }
+
+	// reads a value
+	// @param count the number of bits to read (up to 32)
+	// @return the value read
+	Uint32 read(Uint32 count) {
+		if( overflowed || bits + count > size * 8 ) {
+			overflowed = true;
+			return 0;
+		}
+		Uint32 value = 0;
+		Uint32 done = 0;
+		while( done < count ) {
+			Uint32 shift = bits & 7;
+			Uint32 chunk = count - done < 8 - shift ? count - done : 8 - shift;
+			value |= (Uint32)((data[bits >> 3] >> shift) & ((1 << chunk) - 1)) << done;
+			bits += chunk;
+			done += chunk;
+		}
+		return value;
+	}
+
+	// reads a single bit
+	bool readBool() {
+		return read(1) != 0;
+	}
+
+	// reads a value written by BitWriter::writeVar()
+	Uint64 readVar() {
+		Uint64 value = 0;
+		for( Uint32 shift = 0; shift < 64 && !overflowed; shift += 4 ) {
+			value |= (Uint64)read(4) << shift;
+			if( !readBool() ) {
+				break;
+			}
+		}
+		return value;
+	}
+
+	// reads a value written by BitWriter::writeSigned()
+	Sint32 readSigned() {
+		static const Uint32 widths[4] = { 4, 8, 16, 32 };
+		Uint32 folded = read(widths[read(2)]);
+		return (Sint32)(folded >> 1) ^ -(Sint32)(folded & 1);
+	}
+
+private:
+	const Uint8* data = nullptr;
+	Uint32 size = 0;			// in bytes
+	Uint32 bits = 0;
+	bool overflowed = false;
+};
@@ -63,33 +63,33 @@ Uint32 Chunk::calculateVertices() const {
 	return result;
 }
 
-Node<Entity*>* Chunk::addEPopulation(Entity* entity) {
-	return ePopulation.addNodeLast(entity);
+void Chunk::addEPopulation(Node<Entity*>& hook) {
+	ePopulation.linkNodeLast(&hook);
 }
 
-Node<Component*>* Chunk::addCPopulation(Component* component) {
-	return cPopulation.addNodeLast(component);
+void Chunk::addCPopulation(Node<Component*>& hook) {
+	cPopulation.linkNodeLast(&hook);
 }
 
 void Chunk::buildBuffers() {
 	numVertices = calculateVertices();
 	numIndices = numVertices * 2;
 
-	// clear buffers
-	vertexBuffer.clear();
-	diffuseMapBuffer.clear();
-	normalMapBuffer.clear();
-	effectsMapBuffer.clear();
-	normalBuffer.clear();
-	tangentBuffer.clear();
-	indexBuffer.clear();
-	vertexBuffer.alloc(numVertices);
-	diffuseMapBuffer.alloc(numVertices);
-	normalMapBuffer.alloc(numVertices);
-	effectsMapBuffer.alloc(numVertices);
-	normalBuffer.alloc(numVertices);
-	tangentBuffer.alloc(numVertices);
-	indexBuffer.alloc(numIndices);
+	// clear buffers (keeping their storage for the next rebuild)
+	vertexBuffer.clearKeepCapacity();
+	diffuseMapBuffer.clearKeepCapacity();
+	normalMapBuffer.clearKeepCapacity();
+	effectsMapBuffer.clearKeepCapacity();
+	normalBuffer.clearKeepCapacity();
+	tangentBuffer.clearKeepCapacity();
+	indexBuffer.clearKeepCapacity();
+	vertexBuffer.reserve(numVertices);
+	diffuseMapBuffer.reserve(numVertices);
+	normalMapBuffer.reserve(numVertices);
+	effectsMapBuffer.reserve(numVertices);
+	normalBuffer.reserve(numVertices);
+	tangentBuffer.reserve(numVertices);
+	indexBuffer.reserve(numIndices);
 
 	// fill buffers
 	GLuint index=0;
@@ -37,13 +37,13 @@ public:
 	// @return the number of vertices for all surfaces in the chunk
 	Uint32 calculateVertices() const;
 
-	// adds an entity component to our population list
-	// @param component the entity component to add to our list
-	Node<Component*>* addCPopulation(Component* component);
+	// adds an entity component to our population list (moving it from any other chunk's list)
+	// @param hook the component's chunk node
+	void addCPopulation(Node<Component*>& hook);
 
-	// adds an entity to our population list
-	// @param entity the entity to add to our list
-	Node<Entity*>* addEPopulation(Entity* entity);
+	// adds an entity to our population list (moving it from any other chunk's list)
+	// @param hook the entity's chunk node
+	void addEPopulation(Node<Entity*>& hook);
 
 	// getters & setters
 	bool							isChanged() const			{ return changed; }
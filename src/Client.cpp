@@ -99,526 +99,470 @@ void Client::handleNetMessages() {
 						}
 					}
 
-					// chat message
-					else if( strncmp( (const char*)packetType, "CMSG", 4) == 0 ) {
-						Uint32 msgLen;
-						if( packet.read32(msgLen) ) {
-							char* msg = new char[msgLen+1];
-							if( msg ) {
-								msg[msgLen] = 0;
-								packet.read(msg,msgLen);
-								mainEngine->fmsg(Engine::MSG_CHAT, msg);
-								delete[] msg;
-							}
-						}
-
-						continue;
-					}
-
-					// server map list
-					else if( strncmp( (const char*)packetType, "MAPS", 4) == 0 ) {
-						closeAllWorlds();
-
-						Uint32 numWorlds;
-						packet.read32(numWorlds);
-						for( Uint32 c=0; c<numWorlds; ++c ) {
-							Uint8 worldType;
-							packet.read8(worldType);
-							if( worldType == 'g' ) {
-								Uint32 pathLen;
-								packet.read32(pathLen);
-								char* path = new char[pathLen+1];
-								if( path ) {
-									packet.read(path,pathLen);
-									path[pathLen] = '\0';
-									genTileWorld(path);
-									delete[] path;
-								}
-							} else if( worldType == 'f' ) {
-								Uint32 filenameLen;
-								packet.read32(filenameLen);
-								char* filename = new char[filenameLen+1];
-								if( filename ) {
-									packet.read(filename,filenameLen);
-									filename[filenameLen] = '\0';
-									loadWorld(filename,true);
-									delete[] filename;
-								}
-							}
-						}
+					getMessages().dispatch(*this, fourcc(packetType), packet, id);
+				}
+			}
+		}
 
-						// for playtesting
-						if( mainEngine->isPlayTest() && net->getLocalID() != Net::invalidID ) {
-							spawn(0);
-						}
+		// unlock packet receiving thread
+		net->unlockThread();
+	}
+}
 
-						continue;
-					}
+MessageRegistry<Client>& Client::getMessages() {
+	static MessageRegistry<Client> messages;
+	if( messages.empty() ) {
+		messages.add("CMSG", &Client::handleChat, &msg_cmsg_t::readMessage, &msg_cmsg_t::readChain);
+		messages.add("MAPS", &Client::handleMapList);
+		messages.add("CENS", &Client::handlePlayerInfo);
+		messages.add("PLVL", &Client::handlePlayerLevel);
+		messages.add("SPWN", &Client::handleSpawn);
+		messages.add("ENTF", &Client::handleEntityCall);
+		messages.add("SNAP", &Client::handleSnapshot);
+		messages.add("ENTD", &Client::handleEntityDelete, &msg_entd_t::readMessage, &msg_entd_t::readChain);
+		messages.add("PINT", &Client::handlePlayerInteract, &msg_pint_t::readMessage, &msg_pint_t::readChain);
+	}
+	return messages;
+}
 
-					// server telling us about a player
-					else if( strncmp( (const char*)packetType, "CENS", 4) == 0 ) {
-						Player::colors_t colors;
-
-						Uint32 localID, clientID, serverID;
-						packet.read32(clientID);
-						packet.read32(localID);
-						packet.read32(serverID);
-
-						// read name
-						Uint8 nameLen;
-						StringBuf<64> nameStr = "";
-						if( packet.read8(nameLen) ) {
-							char* name = new char[nameLen+1];
-							if( name ) {
-								packet.read(name, nameLen);
-								name[nameLen] = '\0';
-								nameStr = name;
-								delete[] name;
-							}
-						}
+void Client::handleChat(Packet& packet, Uint32 remoteID) {
+	msg_cmsg_t header;
+	if( header.read(packet) ) {
+		const Uint32 msgLen = header.length;
+		char* msg = new char[msgLen+1];
+		if( msg ) {
+			msg[msgLen] = 0;
+			packet.read(msg,msgLen);
+			mainEngine->fmsg(Engine::MSG_CHAT, msg);
+			delete[] msg;
+		}
+	}
+}
 
-						// read head colors
-						Uint8 headR[3], headG[3], headB[3];
-						packet.read8(headR[0]); packet.read8(headR[1]); packet.read8(headR[2]);
-						packet.read8(headG[0]); packet.read8(headG[1]); packet.read8(headG[2]);
-						packet.read8(headB[0]); packet.read8(headB[1]); packet.read8(headB[2]);
-						colors.headRChannel = { headR[0] / 255.f, headR[1] / 255.f, headR[2] / 255.f, 1.f };
-						colors.headGChannel = { headG[0] / 255.f, headG[1] / 255.f, headG[2] / 255.f, 1.f };
-						colors.headBChannel = { headB[0] / 255.f, headB[1] / 255.f, headB[2] / 255.f, 1.f };
-
-						// read torso colors
-						Uint8 torsoR[3], torsoG[3], torsoB[3];
-						packet.read8(torsoR[0]); packet.read8(torsoR[1]); packet.read8(torsoR[2]);
-						packet.read8(torsoG[0]); packet.read8(torsoG[1]); packet.read8(torsoG[2]);
-						packet.read8(torsoB[0]); packet.read8(torsoB[1]); packet.read8(torsoB[2]);
-						colors.torsoRChannel = { torsoR[0] / 255.f, torsoR[1] / 255.f, torsoR[2] / 255.f, 1.f };
-						colors.torsoGChannel = { torsoG[0] / 255.f, torsoG[1] / 255.f, torsoG[2] / 255.f, 1.f };
-						colors.torsoBChannel = { torsoB[0] / 255.f, torsoB[1] / 255.f, torsoB[2] / 255.f, 1.f };
-
-						// read arms colors
-						Uint8 armsR[3], armsG[3], armsB[3];
-						packet.read8(armsR[0]); packet.read8(armsR[1]); packet.read8(armsR[2]);
-						packet.read8(armsG[0]); packet.read8(armsG[1]); packet.read8(armsG[2]);
-						packet.read8(armsB[0]); packet.read8(armsB[1]); packet.read8(armsB[2]);
-						colors.armsRChannel = { armsR[0] / 255.f, armsR[1] / 255.f, armsR[2] / 255.f, 1.f };
-						colors.armsGChannel = { armsG[0] / 255.f, armsG[1] / 255.f, armsG[2] / 255.f, 1.f };
-						colors.armsBChannel = { armsB[0] / 255.f, armsB[1] / 255.f, armsB[2] / 255.f, 1.f };
-
-						// read feet colors
-						Uint8 feetR[3], feetG[3], feetB[3];
-						packet.read8(feetR[0]); packet.read8(feetR[1]); packet.read8(feetR[2]);
-						packet.read8(feetG[0]); packet.read8(feetG[1]); packet.read8(feetG[2]);
-						packet.read8(feetB[0]); packet.read8(feetB[1]); packet.read8(feetB[2]);
-						colors.feetRChannel = { feetR[0] / 255.f, feetR[1] / 255.f, feetR[2] / 255.f, 1.f };
-						colors.feetGChannel = { feetG[0] / 255.f, feetG[1] / 255.f, feetG[2] / 255.f, 1.f };
-						colors.feetBChannel = { feetB[0] / 255.f, feetB[1] / 255.f, feetB[2] / 255.f, 1.f };
-
-						Player* player = findPlayer(clientID, localID);
-						if( player == nullptr ) {
-							player = &players.addNodeLast(Player(nameStr.get(), colors))->getData();
-							player->setLocalID(localID);
-							player->setClientID(clientID);
-						} else {
-							player->setName(nameStr.get());
-							if( player->getEntity() ) {
-								player->updateColors(colors);
-							}
-						}
-						player->setServerID(serverID);
+void Client::handleMapList(Packet& packet, Uint32 remoteID) {
+	closeAllWorlds();
+	snapshots.reset();
+	snapshotEntities.clear();
+
+	Uint32 numWorlds;
+	packet.read32(numWorlds);
+	for( Uint32 c=0; c<numWorlds; ++c ) {
+		Uint8 worldType;
+		packet.read8(worldType);
+		if( worldType == 'g' ) {
+			Uint32 pathLen;
+			packet.read32(pathLen);
+			char* path = new char[pathLen+1];
+			if( path ) {
+				packet.read(path,pathLen);
+				path[pathLen] = '\0';
+				genTileWorld(path);
+				delete[] path;
+			}
+		} else if( worldType == 'f' ) {
+			Uint32 filenameLen;
+			packet.read32(filenameLen);
+			char* filename = new char[filenameLen+1];
+			if( filename ) {
+				packet.read(filename,filenameLen);
+				filename[filenameLen] = '\0';
+				loadWorld(filename,true);
+				delete[] filename;
+			}
+		}
+	}
 
-						continue;
-					}
+	// for playtesting
+	if( mainEngine->isPlayTest() && net->getLocalID() != Net::invalidID ) {
+		spawn(0);
+	}
+}
 
-					// server has relocated a player to another level
-					else if (strncmp((const char*)packetType, "PLVL", 4) == 0) {
-						Uint32 localID, clientID, serverID;
-						packet.read32(clientID);
-						packet.read32(localID);
-						packet.read32(serverID);
-
-						// read world filename
-						Uint32 worldFilenameLen;
-						packet.read32(worldFilenameLen);
-						String worldFilename;
-						worldFilename.alloc(worldFilenameLen + 1);
-						worldFilename[worldFilenameLen] = '\0';
-						packet.read(&worldFilename[0], worldFilenameLen);
-						World* world = worldForName(worldFilename.get());
-						if (!world) {
-							world = loadWorld(worldFilename.get(), true);
-						}
-						assert(world);
+void Client::handlePlayerInfo(Packet& packet, Uint32 remoteID) {
+	Player::colors_t colors;
+
+	Uint32 localID, clientID, serverID;
+	packet.read32(clientID);
+	packet.read32(localID);
+	packet.read32(serverID);
+
+	// read name
+	Uint8 nameLen;
+	StringBuf<64> nameStr = "";
+	if( packet.read8(nameLen) ) {
+		char* name = new char[nameLen+1];
+		if( name ) {
+			packet.read(name, nameLen);
+			name[nameLen] = '\0';
+			nameStr = name;
+			delete[] name;
+		}
+	}
 
-						// get player
-						if (clientID != net->getLocalID()) {
-							continue;
-						} else {
-							clientID = Player::invalidID;
-						}
-						Player* player = findPlayer(clientID, localID);
-						assert(player);
-						player->setServerID(serverID);
-
-						// read anchor uid
-						Uint32 anchorUID = World::nuid;
-						packet.read32(anchorUID);
-						Entity* anchor = world->uidToEntity(anchorUID);
-						if (!anchor) {
-							mainEngine->fmsg(Engine::MSG_WARN, "Client got PLVL packet, but anchor is missing");
-							continue;
-						}
+	// read head colors
+	Uint8 headR[3], headG[3], headB[3];
+	packet.read8(headR[0]); packet.read8(headR[1]); packet.read8(headR[2]);
+	packet.read8(headG[0]); packet.read8(headG[1]); packet.read8(headG[2]);
+	packet.read8(headB[0]); packet.read8(headB[1]); packet.read8(headB[2]);
+	colors.headRChannel = { headR[0] / 255.f, headR[1] / 255.f, headR[2] / 255.f, 1.f };
+	colors.headGChannel = { headG[0] / 255.f, headG[1] / 255.f, headG[2] / 255.f, 1.f };
+	colors.headBChannel = { headB[0] / 255.f, headB[1] / 255.f, headB[2] / 255.f, 1.f };
+
+	// read torso colors
+	Uint8 torsoR[3], torsoG[3], torsoB[3];
+	packet.read8(torsoR[0]); packet.read8(torsoR[1]); packet.read8(torsoR[2]);
+	packet.read8(torsoG[0]); packet.read8(torsoG[1]); packet.read8(torsoG[2]);
+	packet.read8(torsoB[0]); packet.read8(torsoB[1]); packet.read8(torsoB[2]);
+	colors.torsoRChannel = { torsoR[0] / 255.f, torsoR[1] / 255.f, torsoR[2] / 255.f, 1.f };
+	colors.torsoGChannel = { torsoG[0] / 255.f, torsoG[1] / 255.f, torsoG[2] / 255.f, 1.f };
+	colors.torsoBChannel = { torsoB[0] / 255.f, torsoB[1] / 255.f, torsoB[2] / 255.f, 1.f };
+
+	// read arms colors
+	Uint8 armsR[3], armsG[3], armsB[3];
+	packet.read8(armsR[0]); packet.read8(armsR[1]); packet.read8(armsR[2]);
+	packet.read8(armsG[0]); packet.read8(armsG[1]); packet.read8(armsG[2]);
+	packet.read8(armsB[0]); packet.read8(armsB[1]); packet.read8(armsB[2]);
+	colors.armsRChannel = { armsR[0] / 255.f, armsR[1] / 255.f, armsR[2] / 255.f, 1.f };
+	colors.armsGChannel = { armsG[0] / 255.f, armsG[1] / 255.f, armsG[2] / 255.f, 1.f };
+	colors.armsBChannel = { armsB[0] / 255.f, armsB[1] / 255.f, armsB[2] / 255.f, 1.f };
+
+	// read feet colors
+	Uint8 feetR[3], feetG[3], feetB[3];
+	packet.read8(feetR[0]); packet.read8(feetR[1]); packet.read8(feetR[2]);
+	packet.read8(feetG[0]); packet.read8(feetG[1]); packet.read8(feetG[2]);
+	packet.read8(feetB[0]); packet.read8(feetB[1]); packet.read8(feetB[2]);
+	colors.feetRChannel = { feetR[0] / 255.f, feetR[1] / 255.f, feetR[2] / 255.f, 1.f };
+	colors.feetGChannel = { feetG[0] / 255.f, feetG[1] / 255.f, feetG[2] / 255.f, 1.f };
+	colors.feetBChannel = { feetB[0] / 255.f, feetB[1] / 255.f, feetB[2] / 255.f, 1.f };
+
+	Player* player = findPlayer(clientID, localID);
+	if( player == nullptr ) {
+		player = &players.addNodeLast(Player(nameStr.get(), colors))->getData();
+		player->setLocalID(localID);
+		player->setClientID(clientID);
+	} else {
+		player->setName(nameStr.get());
+		if( player->getEntity() ) {
+			player->updateColors(colors);
+		}
+	}
+	player->setServerID(serverID);
+}
 
-						// read offset
-						Uint32 posInt[3];
-						packet.read32(posInt[0]);
-						packet.read32(posInt[1]);
-						packet.read32(posInt[2]);
-						Vector pos((Sint32)posInt[0], (Sint32)posInt[1], (Sint32)posInt[2]);
-
-						Angle ang = player->getEntity()->getAng();
-						Vector vel = player->getEntity()->getVel();
-
-						// move to new level
-						if (clientID == Player::invalidID) {
-							player->despawn();
-							player->spawn(*world, anchor->getPos() + pos, ang);
-							player->getEntity()->setVel(vel);
-						}
-						continue;
-					}
+void Client::handlePlayerLevel(Packet& packet, Uint32 remoteID) {
+	Uint32 localID, clientID, serverID;
+	packet.read32(clientID);
+	packet.read32(localID);
+	packet.read32(serverID);
+
+	// read world filename
+	Uint32 worldFilenameLen;
+	packet.read32(worldFilenameLen);
+	String worldFilename;
+	worldFilename.alloc(worldFilenameLen + 1);
+	worldFilename[worldFilenameLen] = '\0';
+	packet.read(&worldFilename[0], worldFilenameLen);
+	World* world = worldForName(worldFilename.get());
+	if (!world) {
+		world = loadWorld(worldFilename.get(), true);
+	}
+	assert(world);
 
-					// server has spawned a player
-					else if (strncmp((const char*)packetType, "SPWN", 4) == 0) {
-						Uint32 localID, clientID, serverID;
-						packet.read32(clientID);
-						packet.read32(localID);
-						packet.read32(serverID);
-
-						// read world filename
-						Uint32 worldFilenameLen;
-						packet.read32(worldFilenameLen);
-						String worldFilename;
-						worldFilename.alloc(worldFilenameLen + 1);
-						worldFilename[worldFilenameLen] = '\0';
-						packet.read(&worldFilename[0], worldFilenameLen);
-						World* world = worldForName(worldFilename.get());
-						if (!world) {
-							world = loadWorld(worldFilename.get(), true);
-						}
-						assert(world);
+	// get player
+	if (clientID != net->getLocalID()) {
+		return;
+	} else {
+		clientID = Player::invalidID;
+	}
+	Player* player = findPlayer(clientID, localID);
+	assert(player);
+	player->setServerID(serverID);
+
+	// read anchor uid
+	Uint32 anchorUID = World::nuid;
+	packet.read32(anchorUID);
+	Entity* anchor = world->uidToEntity(anchorUID);
+	if (!anchor) {
+		mainEngine->fmsg(Engine::MSG_WARN, "Client got PLVL packet, but anchor is missing");
+		return;
+	}
 
-						// get player
-						if( clientID == net->getLocalID() ) {
-							clientID = Player::invalidID;
-						}
-						Player* player = findPlayer(clientID, localID);
-						assert(player);
-						player->setServerID(serverID);
-
-						// read pos
-						Uint32 posInt[3];
-						packet.read32(posInt[0]);
-						packet.read32(posInt[1]);
-						packet.read32(posInt[2]);
-						Vector pos((Sint32)posInt[0], (Sint32)posInt[1], (Sint32)posInt[2]);
-
-						// read ang
-						Uint32 angInt[3];
-						packet.read32(angInt[0]);
-						packet.read32(angInt[1]);
-						packet.read32(angInt[2]);
-						Angle ang((Sint32)angInt[0] * PI / 180.f, (Sint32)angInt[1] * PI / 180.f, (Sint32)angInt[2] * PI / 180.f);
-
-						// only actually spawn the player if they belong to us
-						if (clientID == Player::invalidID) {
-							player->despawn();
-							player->spawn(*world, pos, ang);
-						}
-						continue;
-					}
+	// read offset
+	Uint32 posInt[3];
+	packet.read32(posInt[0]);
+	packet.read32(posInt[1]);
+	packet.read32(posInt[2]);
+	Vector pos((Sint32)posInt[0], (Sint32)posInt[1], (Sint32)posInt[2]);
+
+	Angle ang = player->getEntity()->getAng();
+	Vector vel = player->getEntity()->getVel();
+
+	// move to new level
+	if (clientID == Player::invalidID) {
+		player->despawn();
+		player->spawn(*world, anchor->getPos() + pos, ang);
+		player->getEntity()->setVel(vel);
+	}
+}
 
-					// entity remote function call
-					else if (strncmp((const char*)packetType, "ENTF", 4) == 0) {
-						// read world
-						Uint32 worldID;
-						packet.read32(worldID);
-						Node<World*>* node = worlds[worldID];
-						if (node) {
-							World& world = *node->getData();
-
-							// get uid
-							Uint32 uid;
-							packet.read32(uid);
-							Entity* entity = world.uidToEntity(uid);
-							if (!entity) {
-								continue;
-							}
+void Client::handleSpawn(Packet& packet, Uint32 remoteID) {
+	Uint32 localID, clientID, serverID;
+	packet.read32(clientID);
+	packet.read32(localID);
+	packet.read32(serverID);
+
+	// read world filename
+	Uint32 worldFilenameLen;
+	packet.read32(worldFilenameLen);
+	String worldFilename;
+	worldFilename.alloc(worldFilenameLen + 1);
+	worldFilename[worldFilenameLen] = '\0';
+	packet.read(&worldFilename[0], worldFilenameLen);
+	World* world = worldForName(worldFilename.get());
+	if (!world) {
+		world = loadWorld(worldFilename.get(), true);
+	}
+	assert(world);
 
-							// read func name
-							Uint32 funcNameLen;
-							packet.read32(funcNameLen);
-							char funcName[128];
-							funcName[127] = '\0';
-							packet.read(funcName, funcNameLen);
-							funcName[funcNameLen] = '\0';
-
-							// read args
-							Uint32 argsLen;
-							packet.read32(argsLen);
-							Script::Args args;
-							for (Uint32 c = 0; c < argsLen; ++c) {
-								char argType;
-								packet.read8((Uint8&)argType);
-								switch (argType) {
-								case 'b': {
-									char value;
-									packet.read8((Uint8&)value);
-									if (value == 't') {
-										args.addBool(true);
-									} else if (value == 'f') {
-										args.addBool(false);
-									}
-									break;
-								}
-								case 'i': {
-									Uint32 value;
-									packet.read32(value);
-									args.addInt((int)value);
-									break;
-								}
-								case 'f': {
-									float value;
-									packet.read32((Uint32&)value);
-									args.addFloat(value);
-									break;
-								}
-								case 's': {
-									Uint32 len;
-									packet.read32(len);
-									String value;
-									value.alloc(len + 1);
-									value[len] = '\0';
-									packet.read(&value[0], len);
-									args.addString(value);
-									break;
-								}
-								case 'p': {
-									mainEngine->fmsg(Engine::MSG_ERROR, "Client got RFC with a pointer, will be nullptr");
-									args.addPointer(nullptr);
-									break;
-								}
-								case 'n': {
-									args.addNil();
-									break;
-								}
-								default: {
-									mainEngine->fmsg(Engine::MSG_ERROR, "Unknown arg type for remote function call!");
-									args.addNil();
-									break;
-								}
-								}
-							}
+	// get player
+	if( clientID == net->getLocalID() ) {
+		clientID = Player::invalidID;
+	}
+	Player* player = findPlayer(clientID, localID);
+	assert(player);
+	player->setServerID(serverID);
+
+	// read pos
+	Uint32 posInt[3];
+	packet.read32(posInt[0]);
+	packet.read32(posInt[1]);
+	packet.read32(posInt[2]);
+	Vector pos((Sint32)posInt[0], (Sint32)posInt[1], (Sint32)posInt[2]);
+
+	// read ang
+	Uint32 angInt[3];
+	packet.read32(angInt[0]);
+	packet.read32(angInt[1]);
+	packet.read32(angInt[2]);
+	Angle ang((Sint32)angInt[0] * PI / 180.f, (Sint32)angInt[1] * PI / 180.f, (Sint32)angInt[2] * PI / 180.f);
+
+	// only actually spawn the player if they belong to us
+	if (clientID == Player::invalidID) {
+		player->despawn();
+		player->spawn(*world, pos, ang);
+	}
+}
 
-							// run function
-							entity->dispatch(funcName, args);
-						}
+void Client::handleEntityCall(Packet& packet, Uint32 remoteID) {
+	// read world
+	Uint32 worldID;
+	packet.read32(worldID);
+	Node<World*>* node = worlds[worldID];
+	if (node) {
+		World& world = *node->getData();
+
+		// get uid
+		Uint32 uid;
+		packet.read32(uid);
+		Entity* entity = world.uidToEntity(uid);
+		if (!entity) {
+			return;
+		}
 
-						continue;
-					}
+		// read func name
+		Uint32 funcNameLen;
+		packet.read32(funcNameLen);
+		char funcName[128];
+		funcName[127] = '\0';
+		packet.read(funcName, funcNameLen);
+		funcName[funcNameLen] = '\0';
+
+		// read args
+		Uint32 argsLen;
+		packet.read32(argsLen);
+		Script::Args args;
+		for (Uint32 c = 0; c < argsLen; ++c) {
+			char argType;
+			packet.read8((Uint8&)argType);
+			switch (argType) {
+			case 'b': {
+				char value;
+				packet.read8((Uint8&)value);
+				if (value == 't') {
+					args.addBool(true);
+				} else if (value == 'f') {
+					args.addBool(false);
+				}
+				break;
+			}
+			case 'i': {
+				Uint32 value;
+				packet.read32(value);
+				args.addInt((int)value);
+				break;
+			}
+			case 'f': {
+				float value;
+				packet.read32((Uint32&)value);
+				args.addFloat(value);
+				break;
+			}
+			case 's': {
+				Uint32 len;
+				packet.read32(len);
+				String value;
+				value.alloc(len + 1);
+				value[len] = '\0';
+				packet.read(&value[0], len);
+				args.addString(value);
+				break;
+			}
+			case 'p': {
+				mainEngine->fmsg(Engine::MSG_ERROR, "Client got RFC with a pointer, will be nullptr");
+				args.addPointer(nullptr);
+				break;
+			}
+			case 'n': {
+				args.addNil();
+				break;
+			}
+			default: {
+				mainEngine->fmsg(Engine::MSG_ERROR, "Unknown arg type for remote function call!");
+				args.addNil();
+				break;
+			}
+			}
+		}
 
-					// entity update
-					else if( strncmp( (const char*)packetType, "ENTU", 4) == 0 ) {
-						// read world
-						Uint32 worldID;
-						packet.read32(worldID);
-						Node<World*>* node = worlds[worldID];
-						if( node ) {
-							World& world = *node->getData();
-
-							// get uid
-							Uint32 uid;
-							packet.read32(uid);
-
-							// get entity type
-							Uint32 type;
-							packet.read32(type);
-
-							// read pos
-							Uint32 posInt[3];
-							packet.read32(posInt[0]);
-							packet.read32(posInt[1]);
-							packet.read32(posInt[2]);
-							Vector pos( ((Sint32)posInt[0]) / 32.f, ((Sint32)posInt[1]) / 32.f, ((Sint32)posInt[2]) / 32.f );
-
-							// read vel
-							Uint32 velInt[3];
-							packet.read32(velInt[0]);
-							packet.read32(velInt[1]);
-							packet.read32(velInt[2]);
-							Vector vel( ((Sint32)velInt[0]) / 128.f, ((Sint32)velInt[1]) / 128.f, ((Sint32)velInt[2]) / 128.f );
-
-							// read ang
-							Uint32 angInt[3];
-							packet.read32(angInt[0]);
-							packet.read32(angInt[1]);
-							packet.read32(angInt[2]);
-							Angle ang( (((Sint32)angInt[0]) * PI / 180.f) / 32.f, (((Sint32)angInt[1]) * PI / 180.f) / 32.f, (((Sint32)angInt[2]) * PI / 180.f) / 32.f );
-
-							// read isFalling
-							Uint8 isFalling;
-							packet.read8(isFalling);
-
-							// read player properties
-							Player* player = nullptr;
-							Uint8 isPlayer;
-							packet.read8(isPlayer);
-							if (isPlayer) {
-								Uint32 serverID;
-								packet.read32(serverID);
-								player = findPlayer(serverID);
-								if (player && player->getClientID() != Player::invalidID) {
-									// read crouch status
-									Uint8 isCrouching;
-									packet.read8(isCrouching);
-									if (isCrouching) {
-										player->putInCrouch(true);
-									}
-									else {
-										player->putInCrouch(false);
-									}
-
-									// read moving status
-									Uint8 isMoving;
-									packet.read8(isMoving);
-									if (isMoving) {
-										player->setMoving(true);
-									}
-									else {
-										player->setMoving(false);
-									}
-
-									// read jumped status
-									Uint8 hasJumped;
-									packet.read8(hasJumped);
-									if (hasJumped) {
-										player->setJumped(true);
-									}
-									else {
-										player->setJumped(false);
-									}
-
-									// read look direction
-									Uint32 lookDirInt[3];
-									packet.read32(lookDirInt[0]);
-									packet.read32(lookDirInt[1]);
-									packet.read32(lookDirInt[2]);
-									Angle lookDir((((Sint32)lookDirInt[0]) * PI / 180.f) / 32.f, (((Sint32)lookDirInt[1]) * PI / 180.f) / 32.f, (((Sint32)lookDirInt[2]) * PI / 180.f) / 32.f);
-									player->setLookDir(lookDir);
-								}
-							}
+		// run function
+		entity->dispatch(funcName, args);
+	}
+}
 
-							// update the entity
-							Entity* entity = player && player->getEntity() ? player->getEntity() : world.uidToEntity(uid);
-							if( !entity ) {
-								// we need to spawn the entity
-								if( type != UINT32_MAX ) {
-									const Entity::def_t* def = Entity::findDef(type);
-									entity = Entity::spawnFromDef(&world, *def, pos, ang, uid);
-									if( entity ) {
-										entity->setVel(vel);
-										entity->setLastUpdate(ticks);
-									}
-								} else {
-									// we have no idea what the entity is!
-									// this could be real bad!
-									// we don't want to spam the log with messages though, so...
-									// if you're in a debugger and you see this, I'm sorry :(
-									continue;
-								}
-							} else {
-								// the entity already exists. update it
-								entity->setNewPos(pos);
-								entity->setNewAng(ang);
-								entity->setVel(vel);
-								entity->setLastUpdate(entity->getTicks());
-								/*if (player && player->getClientID() == Player::invalidID) {
-									// this is fairly serious: we're in an invalid spot! update immediately
-									entity->setPos(pos);
-									entity->setAng(ang);
-									entity->setVel(vel);
-									entity->warp();
-									//entity->setLastUpdate(entity->getTicks());
-								} else {
-									entity->setNewPos(pos);
-									entity->setNewAng(ang);
-									entity->setVel(vel);
-									entity->setLastUpdate(entity->getTicks());
-								}*/
-							}
-							if (entity) {
-								entity->setFalling((isFalling == 1) ? true : false);
-								if (player && entity->getPlayer() == nullptr) {
-									entity->setPlayer(player);
-									player->setEntity(entity);
-									player->updateColors(player->getColors());
-								}
-							}
-						}
+void Client::handleSnapshot(Packet& packet, Uint32 remoteID) {
+	ArrayList<Snapshot::state_t> states;
+	ArrayList<Uint64> removed;
+	Uint32 sequence = Snapshot::noBaseline;
+	SnapshotReceiver::result_t result = snapshots.read(packet, states, removed, sequence);
+	for( auto& state : states ) {
+		applySnapshotState(state);
+	}
+	for( auto key : removed ) {
+		despawnSnapshotEntity(key);
+	}
 
-						continue;
-					}
+	// acknowledge whole snapshots, or ask for full states if we lost the baseline
+	if( result == SnapshotReceiver::COMPLETE || result == SnapshotReceiver::NEED_BASELINE ) {
+		Packet ack;
+		ack.write32(result == SnapshotReceiver::COMPLETE ? sequence : Snapshot::noBaseline);
+		ack.write("SACK");
+		net->signPacket(ack);
+		net->sendPacket(0, ack);
+	}
+}
 
-					// entity deleted
-					else if( strncmp( (const char*)packetType, "ENTD", 4) == 0 ) {
-						// read world
-						Uint32 worldID;
-						packet.read32(worldID);
-						Node<World*>* node = worlds[worldID];
-						if( node ) {
-							World& world = *node->getData();
-
-							// get uid
-							Uint32 uid;
-							packet.read32(uid);
-
-							// find entity
-							Entity* entity = world.uidToEntity(uid);
-							if( entity ) {
-								entity->remove();
-							}
-						}
+void Client::handleEntityDelete(Packet& packet, Uint32 remoteID) {
+	msg_entd_t msg;
+	if( !msg.read(packet) ) {
+		return;
+	}
+	Node<World*>* node = worlds[msg.world];
+	if( node ) {
+		World& world = *node->getData();
+
+		// find entity
+		Entity* entity = world.uidToEntity(msg.uid);
+		if( entity ) {
+			entity->remove();
+		}
+	}
+}
 
-						continue;
-					}
+void Client::handlePlayerInteract(Packet& packet, Uint32 remoteID) {
+	msg_pint_t msg;
+	if( !msg.read(packet) ) {
+		return;
+	}
+	Node<World*>* node = worlds.nodeForIndex(msg.world);
+	if ( node ) {
+		mainEngine->fmsg(Engine::MSG_DEBUG, "CLIENT received broadcast that Player %d interacted with entity %d", msg.player, msg.entity);
+	}
 
-					// player interaction broadcast message
-					else if( strncmp( (const char*)packetType, "PINT", 4) == 0 ) {
-						// read world
-						Uint32 playerID;
-						packet.read32(playerID);
-						Uint32 worldID;
-						packet.read32(worldID);
-						Uint32 selectedEntityID;
-						packet.read32(selectedEntityID);
-						Node<World*>* node = worlds.nodeForIndex(worldID);
-						if ( node ) {
-							World* world = node->getData();
-
-							Player* player = findPlayer(playerID);
-
-							mainEngine->fmsg(Engine::MSG_DEBUG, "CLIENT received broadcast that Player %d interacted with entity %d", playerID, selectedEntityID);
-						}
+	//TODO: Play interact animation.
+}
 
-						//TODO: Play interact animation.
+void Client::applySnapshotState(const Snapshot::state_t& state) {
+	Node<World*>* node = worlds[state.world];
+	if( !node ) {
+		return;
+	}
+	World& world = *node->getData();
+
+	Vector pos = state.getPos();
+	Vector vel = state.getVel();
+	Angle ang = state.getAng();
+
+	// update player properties
+	Player* player = nullptr;
+	if( state.flags & Snapshot::FLAG_PLAYER ) {
+		player = findPlayer(state.serverID);
+		if( player && player->getClientID() != Player::invalidID ) {
+			player->putInCrouch((state.flags & Snapshot::FLAG_CROUCHING) ? true : false);
+			player->setMoving((state.flags & Snapshot::FLAG_MOVING) ? true : false);
+			player->setJumped((state.flags & Snapshot::FLAG_JUMPED) ? true : false);
+			player->setLookDir(state.getLookDir());
+		}
+	}
 
-						continue;
-					}
-				}
+	// update the entity
+	Entity* entity = player && player->getEntity() ? player->getEntity() : world.uidToEntity(state.uid);
+	if( !entity ) {
+		// we need to spawn the entity
+		if( state.def != UINT32_MAX ) {
+			const Entity::def_t* def = Entity::findDef(state.def);
+			entity = Entity::spawnFromDef(&world, *def, pos, ang, state.uid);
+			if( entity ) {
+				entity->setVel(vel);
+				entity->setLastUpdate(ticks);
+				snapshotEntities.insert(state.getKey(), true);
 			}
+		} else {
+			// we have no idea what the entity is!
+			// this could be real bad!
+			// we don't want to spam the log with messages though, so...
+			// if you're in a debugger and you see this, I'm sorry :(
+			return;
+		}
+	} else {
+		// the entity already exists. update it
+		entity->setNewPos(pos);
+		entity->setNewAng(ang);
+		entity->setVel(vel);
+		entity->setLastUpdate(entity->getTicks());
+	}
+	if( entity ) {
+		entity->setFalling((state.flags & Snapshot::FLAG_FALLING) ? true : false);
+		if( player && entity->getPlayer() == nullptr ) {
+			entity->setPlayer(player);
+			player->setEntity(entity);
+			player->updateColors(player->getColors());
 		}
+	}
+}
 
-		// unlock packet receiving thread
-		net->unlockThread();
+void Client::despawnSnapshotEntity(Uint64 key) {
+	// entities that came with the world file stay where they were last seen
+	if( !snapshotEntities.find(key) ) {
+		return;
+	}
+	snapshotEntities.remove(key);
+
+	Node<World*>* node = worlds[(Uint32)(key >> 32)];
+	if( node ) {
+		Entity* entity = node->getData()->uidToEntity((Uint32)key);
+		if( entity ) {
+			entity->remove();
+		}
 	}
 }
 
@@ -640,6 +584,8 @@ void Client::onDisconnect(Uint32 remoteID) {
 			players.removeNode(node);
 		}
 	}
+	snapshots.reset();
+	snapshotEntities.clear();
 }
 
 void Client::spawn(Uint32 localID) {
@@ -1220,19 +1166,37 @@ static int console_clientCountEntities(int argc, const char** argv) {
 	Uint32 count = 0;
 	for (Uint32 i = 0; i < client->getNumWorlds(); ++i) {
 		World* world = client->getWorld(i);
-		for (Uint32 c = 0; c < World::numBuckets; ++c) {
-			count += world->getEntities(c).getSize();
-		}
+		count += world->getNumEntities();
 	}
 	mainEngine->fmsg(Engine::MSG_INFO, "Client has %u entities", count);
 	return 0;
 }
 
+static int console_clientBenchMessages(int argc, const char** argv) {
+	Uint32 rounds = 1000;
+	if( argc >= 1 ) {
+		rounds = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+
+	const MessageRegistry<Client>& messages = Client::getMessages();
+	double chainNs, tableNs;
+	if( !messages.benchmark(rounds, chainNs, tableNs) ) {
+		mainEngine->fmsg(Engine::MSG_INFO,"No packets received by the client yet.");
+		return 0;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO,"replayed the last %u packets %u times against %u handlers (handlers not called):",
+		messages.getNumRecent(), rounds, messages.getSize());
+	mainEngine->fmsg(Engine::MSG_INFO,"  strncmp chain + read32:     %.1f ns per packet", chainNs);
+	mainEngine->fmsg(Engine::MSG_INFO,"  table lookup + schema read: %.1f ns per packet", tableNs);
+	return 0;
+}
+
 static Ccmd ccmd_clientReset("client.reset","restarts the local client",&console_clientReset);
 static Ccmd ccmd_clientDisconnect("client.disconnect","disconnects the client from the remote host",&console_clientDisconnect);
 static Ccmd ccmd_clientMap("client.map","loads a world file on the local client",&console_clientMap);
 static Ccmd ccmd_clientSpawn("client.spawn","spawns a new player into the world we are connected to",&console_clientSpawn);
 static Ccmd ccmd_clientCountEntities("client.countentities", "count the number of entities in all worlds on the client", &console_clientCountEntities);
+static Ccmd ccmd_clientBenchMessages("client.benchmessages","replays recently received packets, payloads included, timing table lookup and schema reads against the old strncmp chain and read32 calls; handlers aren't called (arg: rounds)",&console_clientBenchMessages);
 
 Cvar cvar_showFPS("showfps","displays an FPS counter","0");
 Cvar cvar_showSpeed("showspeed","displays player speedometer","0");
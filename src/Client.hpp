@@ -3,10 +3,13 @@
 #pragma once
 
 #include "Game.hpp"
+#include "HashMap.hpp"
+#include "Message.hpp"
 #include "Tile.hpp"
 #include "Vector.hpp"
 #include "Angle.hpp"
 #include "Console.hpp"
+#include "Snapshot.hpp"
 
 class Renderer;
 class Mixer;
@@ -51,6 +54,9 @@ public:
 	// @param localID the local number of player to spawn
 	void spawn(Uint32 localID);
 
+	// @return the handler for each packet type the client understands
+	static MessageRegistry<Client>& getMessages();
+
 	// starts up the level editor
 	// @param path optional path to a level to startup
 	void startEditor(const char* path = "");
@@ -89,8 +95,33 @@ private:
 	Node<String>* cuCommand = nullptr;
 	Node<Engine::logmsg_t>* logStart = nullptr;
 
+	// entity snapshots from the server
+	SnapshotReceiver snapshots;
+	HashMap<Uint64, bool> snapshotEntities;		// entities spawned from snapshots (world and uid)
+
 	// process console input
 	void runConsole();
+
+	// brings an entity up to date with the server, spawning it if it's new
+	// @param state the entity's state from a snapshot
+	void applySnapshotState(const Snapshot::state_t& state);
+
+	// removes an entity the server stopped telling us about, if a snapshot spawned it
+	// @param key the entity's world and uid
+	void despawnSnapshotEntity(Uint64 key);
+
+	// handlers for each packet type (see getMessages())
+	// @param packet the packet, with its signature and type already read
+	// @param remoteID the remote host that sent it
+	void handleChat(Packet& packet, Uint32 remoteID);	// CMSG: a chat message
+	void handleMapList(Packet& packet, Uint32 remoteID);	// MAPS: the server's worlds
+	void handlePlayerInfo(Packet& packet, Uint32 remoteID);	// CENS: the server telling us about a player
+	void handlePlayerLevel(Packet& packet, Uint32 remoteID);	// PLVL: the server moved a player to another world
+	void handleSpawn(Packet& packet, Uint32 remoteID);	// SPWN: the server spawned a player
+	void handleEntityCall(Packet& packet, Uint32 remoteID);	// ENTF: a remote function call on an entity
+	void handleSnapshot(Packet& packet, Uint32 remoteID);	// SNAP: part of an entity snapshot
+	void handleEntityDelete(Packet& packet, Uint32 remoteID);	// ENTD: an entity was deleted
+	void handlePlayerInteract(Packet& packet, Uint32 remoteID);	// PINT: a player interacted with an entity
 };
 
 extern Cvar cvar_showFPS;
@@ -0,0 +1,96 @@
+// CommandBuffer.cpp
+
+#include "Main.hpp"
+#include "CommandBuffer.hpp"
+#include "Entity.hpp"
+#include "Component.hpp"
+#include "Chunk.hpp"
+#include "World.hpp"
+
+static thread_local CommandBuffer* currentBuffer = nullptr;
+
+CommandBuffer* CommandBuffer::getCurrent() {
+	return currentBuffer;
+}
+
+void CommandBuffer::setCurrent(CommandBuffer* buffer) {
+	currentBuffer = buffer;
+}
+
+void CommandBuffer::push(cmd_t type, Entity* entity, Component* component, Chunk* chunk) {
+	command_t command;
+	command.type = type;
+	command.entity = entity;
+	command.component = component;
+	command.chunk = chunk;
+	commands.push(command);
+}
+
+void CommandBuffer::linkEntity(Entity* entity, Chunk* chunk) {
+	push(CMD_LINK_ENTITY, entity, nullptr, chunk);
+}
+
+void CommandBuffer::linkComponent(Component* component, Chunk* chunk) {
+	push(CMD_LINK_COMPONENT, nullptr, component, chunk);
+}
+
+void CommandBuffer::updateSpatial(Entity* entity) {
+	push(CMD_UPDATE_SPATIAL, entity, nullptr, nullptr);
+}
+
+void CommandBuffer::purgeComponents(Entity* entity) {
+	push(CMD_PURGE_ENTITY, entity, nullptr, nullptr);
+}
+
+void CommandBuffer::purgeComponents(Component* component) {
+	push(CMD_PURGE_COMPONENT, nullptr, component, nullptr);
+}
+
+void CommandBuffer::updateShared(Component* component) {
+	push(CMD_UPDATE_SHARED, nullptr, component, nullptr);
+}
+
+void CommandBuffer::processShared(Component* component) {
+	push(CMD_PROCESS_SHARED, nullptr, component, nullptr);
+}
+
+void CommandBuffer::apply() {
+	assert(currentBuffer != this);
+
+	// purges go last, so no other command can reach a component they delete
+	for( Uint32 c = 0; c < commands.getSize(); ++c ) {
+		const command_t& command = commands[c];
+		switch( command.type ) {
+		case CMD_LINK_ENTITY:
+			command.chunk->addEPopulation(command.entity->getChunkNode());
+			break;
+		case CMD_LINK_COMPONENT:
+			if( command.chunk ) {
+				command.chunk->addCPopulation(command.component->getChunkNode());
+			} else {
+				command.component->clearChunkNode();
+			}
+			break;
+		case CMD_UPDATE_SPATIAL:
+			command.entity->getWorld()->getSpatialHash().update(command.entity);
+			break;
+		case CMD_UPDATE_SHARED:
+			command.component->updateShared();
+			break;
+		case CMD_PROCESS_SHARED:
+			command.component->processShared();
+			break;
+		default:
+			break;
+		}
+	}
+	for( Uint32 c = 0; c < commands.getSize(); ++c ) {
+		const command_t& command = commands[c];
+		if( command.type == CMD_PURGE_ENTITY ) {
+			command.entity->purgeComponents();
+		} else if( command.type == CMD_PURGE_COMPONENT ) {
+			command.component->purgeComponents();
+		}
+	}
+	commands.clearKeepCapacity();
+}
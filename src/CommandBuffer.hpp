@@ -0,0 +1,88 @@
+// CommandBuffer.hpp
+// Work deferred from worker threads until the next phase barrier
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+
+class Entity;
+class Component;
+class Chunk;
+
+// while entities are processed on worker threads, anything that would touch state shared
+// between entities (chunk populations, component deletion, physics, audio, resources) is
+// recorded here instead. each slice of work gets its own buffer, and the owning thread
+// applies the buffers in slice order at the barrier, so the result matches a serial run.
+class CommandBuffer {
+public:
+	CommandBuffer() {}
+	~CommandBuffer() {}
+
+	// getters & setters
+	Uint32		getSize() const		{ return commands.getSize(); }
+
+	// moves an entity into a chunk's population
+	// @param entity the entity to move
+	// @param chunk the chunk to move into
+	void linkEntity(Entity* entity, Chunk* chunk);
+
+	// moves a component into a chunk's population, or out of any chunk
+	// @param component the component to move
+	// @param chunk the chunk to move into, or nullptr to leave the current chunk
+	void linkComponent(Component* component, Chunk* chunk);
+
+	// moves an entity to its current position in its world's spatial hash
+	// @param entity the entity to move
+	void updateSpatial(Entity* entity);
+
+	// deletes components marked for removal from an entity
+	// @param entity the entity to purge
+	void purgeComponents(Entity* entity);
+
+	// deletes sub-components marked for removal from a component
+	// @param component the component to purge
+	void purgeComponents(Component* component);
+
+	// runs a component's updateShared()
+	// @param component the component to call
+	void updateShared(Component* component);
+
+	// runs a component's processShared()
+	// @param component the component to call
+	void processShared(Component* component);
+
+	// runs every command in the order it was recorded, except that purges all run after
+	// the rest, then empties the buffer
+	void apply();
+
+	// @return the buffer for the work running on this thread, or nullptr if commands
+	// should be carried out immediately
+	static CommandBuffer* getCurrent();
+
+	// sets the buffer for the work running on this thread
+	// @param buffer the buffer to record to, or nullptr to carry out commands immediately
+	static void setCurrent(CommandBuffer* buffer);
+
+private:
+	enum cmd_t {
+		CMD_LINK_ENTITY,
+		CMD_LINK_COMPONENT,
+		CMD_UPDATE_SPATIAL,
+		CMD_PURGE_ENTITY,
+		CMD_PURGE_COMPONENT,
+		CMD_UPDATE_SHARED,
+		CMD_PROCESS_SHARED
+	};
+
+	struct command_t {
+		cmd_t type;
+		Entity* entity;
+		Component* component;
+		Chunk* chunk;
+	};
+
+	ArrayList<command_t> commands;
+
+	void push(cmd_t type, Entity* entity, Component* component, Chunk* chunk);
+};
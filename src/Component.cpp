@@ -8,6 +8,8 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "Chunk.hpp"
+#include "CommandBuffer.hpp"
+#include "TransformStore.hpp"
 #include "Component.hpp"
 #include "Entity.hpp"
 #include "TileWorld.hpp"
@@ -494,6 +496,9 @@ Component::Component(Entity& _entity, Component* _parent) {
 }
 
 Component::~Component() {
+	// leave the world registry
+	unregisterFromWorld();
+
 	for( Uint32 c = 0; c < components.getSize(); ++c ) {
 		if( components[c] ) {
 			delete components[c];
@@ -505,7 +510,10 @@ Component::~Component() {
 	// delete occlusion data
 	deleteVisMaps();
 
-	// remove chunk node
+	// remove chunk node (a linked node means we occlude, and our chunks still exist)
+	if( chunkNode.getList() ) {
+		static_cast<TileWorld*>(entity->getWorld())->getVis().invalidateOccluders();
+	}
 	clearChunkNode();
 
 	// delete attributes
@@ -525,7 +533,7 @@ void Component::clearAllChunkNodes() {
 }
 
 bool Component::seesEntity(const Entity& target, float range, int accuracy) {
-	if( !chunksVisible ) {
+	if( !visValid ) {
 		occlusionTest(range, accuracy);
 	}
 	
@@ -536,7 +544,7 @@ bool Component::seesEntity(const Entity& target, float range, int accuracy) {
 		Sint32 chunkH = tileworld->calcChunksHeight();
 		Sint32 chunkX = min( max( 0, target.getCurrentCX() ), chunkW - 1 );
 		Sint32 chunkY = min( max( 0, target.getCurrentCY() ), chunkH - 1 );
-		if( chunksVisible[chunkY + chunkX * chunkH] ) {
+		if( visValid && vis.isChunkVisible(chunkY + chunkX * chunkH) ) {
 			return true;
 		} else {
 			return false;
@@ -575,281 +583,26 @@ void Component::occlusionTestTiles(float range, int accuracy) {
 
 	Sint32 tWidth = (Sint32)world->getWidth();
 	Sint32 tHeight = (Sint32)world->getHeight();
-	Sint32 cWidth = (Sint32)world->calcChunksWidth();
-	Sint32 cHeight = (Sint32)world->calcChunksHeight();
-
-	// clear old visible tile/chunk data
-	visibleChunks.resize(0);
-	if( tilesWidth != tWidth || tilesHeight != tHeight ) {
-		tilesWidth = tWidth;
-		tilesHeight = tHeight;
-		if( tilesVisible ) {
-			delete[] tilesVisible;
-		}
-		tilesVisible = new bool[tWidth*tHeight];
-		if( chunksVisible ) {
-			delete[] chunksVisible;
-		}
-		chunksVisible = new bool[cWidth*cHeight];
-	}
-
-	Sint32 tX = min( max( 0, (Sint32)floor(fX) ), (Sint32)world->getWidth() - 1 );
-	Sint32 tY = min( max( 0, (Sint32)floor(fY) ), (Sint32)world->getHeight() - 1 );
-	Sint32 cX = min( max( 0, (Sint32)floor(fX / Chunk::size) ), cWidth - 1 );
-	Sint32 cY = min( max( 0, (Sint32)floor(fY / Chunk::size) ), cHeight - 1 );
+	Sint32 tX = min( max( 0, (Sint32)floor(fX) ), tWidth - 1 );
+	Sint32 tY = min( max( 0, (Sint32)floor(fY) ), tHeight - 1 );
 
 	// don't do occlusion culling under these conditions
 	if( fX < 0.f || fX >= tWidth || fY < 0.f || fY >= tHeight ||
 		!world->getTiles()[tY+tX*tHeight].hasVolume() ||
 		( world->isShowTools() && getType() == COMPONENT_CAMERA ) ) {
-		for( Sint32 x = 0; x < tWidth; ++x ) {
-			for( Sint32 y = 0; y< tHeight; ++y ) {
-				tilesVisible[y+x*tHeight] = true;
-			}
-		}
-		for( Sint32 x = 0; x < cWidth; ++x ) {
-			for( Sint32 y = 0; y < cHeight; ++y ) {
-				chunksVisible[y+x*cHeight] = true;
-				visibleChunks.push(&world->getChunks()[y+x*cHeight]);
-			}
-		}
-		return;
-	}
-
-	// initial conditions
-	memset(tilesVisible, 0, sizeof(bool) * tWidth * tHeight);
-	memset(chunksVisible, 0, sizeof(bool) * cWidth * cHeight);
-	if( world->getTiles()[tY + tX * tHeight].hasVolume() ) {
-		tilesVisible[tY + tX * tHeight] = true;
-	}
-
-	// find visible tiles (line tests)
-	occlusionTestTilesStep(range, tX, tY, accuracy);
-	if( accuracy&1 ) {
-		if( tX > 0 ) {
-			occlusionTestTilesStep(range, tX-1, tY, accuracy);
-		}
-		if( tX < tWidth-1 ) {
-			occlusionTestTilesStep(range, tX+1, tY, accuracy);
-		}
-		if( tY > 0 ) {
-			occlusionTestTilesStep(range, tX, tY-1, accuracy);
-		}
-		if( tY < tHeight-1 ) {
-			occlusionTestTilesStep(range, tX, tY+1, accuracy);
-		}
-	}
-
-	// neighbor tiles are always visible
-	if( accuracy&2 ) {
-		bool* visibleByExtension = new bool[tWidth * tHeight];
-		memset(visibleByExtension, 0, sizeof(bool) * tWidth * tHeight);
-		for( Sint32 u = 1; u < tWidth-1; ++u ) {
-			for( Sint32 v = 1; v < tHeight-1; ++v ) {
-				Uint32 index = v + u * tHeight;
-				if( !tilesVisible[index] && world->getTiles()[index].hasVolume() ) {
-					if( accuracy&8 ) {
-						for( Sint32 u2 = u-1; u2 <= u+1; ++u2 ) {
-							for( Sint32 v2 = v-1; v2 <= v+1; ++v2 ) {
-								Uint32 index2 = v2 + u2 * tHeight;
-								if( tilesVisible[index2] && !visibleByExtension[index2] ) {
-									tilesVisible[index] = true;
-									visibleByExtension[index] = true;
-									goto next;
-								}
-							}
-						}
-					} else {
-						Uint32 index2;
-						index2 = (v + 1) + u * tHeight;
-						if( tilesVisible[index2] && !visibleByExtension[index2] ) {
-							tilesVisible[index] = true;
-							visibleByExtension[index] = true;
-							goto next;
-						}
-						index2 = (v - 1) + u * tHeight;
-						if( tilesVisible[index2] && !visibleByExtension[index2] ) {
-							tilesVisible[index] = true;
-							visibleByExtension[index] = true;
-							goto next;
-						}
-						index2 = v + (u + 1) * tHeight;
-						if( tilesVisible[index2] && !visibleByExtension[index2] ) {
-							tilesVisible[index] = true;
-							visibleByExtension[index] = true;
-							goto next;
-						}
-						index2 = v + (u - 1) * tHeight;
-						if( tilesVisible[index2] && !visibleByExtension[index2] ) {
-							tilesVisible[index] = true;
-							visibleByExtension[index] = true;
-							goto next;
-						}
-					}
-				}
-			next:;
-			}
-		}
-		delete[] visibleByExtension;
-	}
-
-	Sint32 cRange = (range / Tile::size) / Chunk::size;
-	Uint32 chunkDim = Chunk::size * Chunk::size;
-
-	// find visible chunks
-	for( Sint32 u = cX - cRange; u <= cX + cRange; ++u ) {
-		for( Sint32 v = cY - cRange; v <= cY + cRange; ++v ) {
-			if( u < 0 || v < 0 || u >= cWidth || v >= cHeight ) {
-				continue;
-			}
-			Uint32 index = v + u * cHeight;
-
-			// try to find a visible tile in the chunk
-			for( Uint32 c = 0; c < chunkDim; ++c ) {
-				Tile* tile = world->getChunks()[index].getTile(c);
-				if( tile ) {
-					Uint32 tX = tile->getX() / Tile::size;
-					Uint32 tY = tile->getY() / Tile::size;
-					if( tilesVisible[tY + tX * tHeight] ) {
-						visibleChunks.push(&world->getChunks()[index]);
-						chunksVisible[index] = true;
-						break;
-					}
-				}
-			}
-		}
-	}
-}
-
-void Component::occlusionTestTilesStep(float range, Sint32 tX, Sint32 tY, int accuracy) {
-	TileWorld* world = static_cast<TileWorld*>(entity->getWorld());
-
-	Sint32 tRange = range / Tile::size;
-	Sint32 tWidth = (Sint32)world->getWidth();
-	Sint32 tHeight = (Sint32)world->getHeight();
-
-	if( !world->getTiles()[tY + tX * tHeight].hasVolume() ) {
-		return;
-	}
-
-	for( Sint32 u = tX - tRange; u <= tX + tRange; ++u ) {
-		for( Sint32 v = tY - tRange; v <= tY + tRange; ++v ) {
-			if( u < 0 || v < 0 || u >= tWidth || v >= tHeight ) {
-				continue;
-			}
-
-			Uint32 index = v + u * tHeight;
-
-			// skip tracing solid tiles
-			if( !world->getTiles()[index].hasVolume() ) {
-				continue;
-			}
-			if( accuracy&4 ) {
-				Chunk* chunk = world->getTiles()[index].getChunk();
-				if( chunk ) {
-					for( Component* component : chunk->getCPopulation() ) {
-						Entity* entity = component->getEntity();
-						if( entity->isFlag(Entity::FLAG_OCCLUDE) ) {
-							continue;
-						}
-					}
-				}
-			}
-
-			// trace both ways
-			if( occlusionTestTilesLine(tX, tY, u, v, (accuracy&4) != 0) ||
-				occlusionTestTilesLine(u, v, tX, tY, (accuracy&4) != 0) ) {
-				tilesVisible[index] = true;
-			}
-		}
-	}
-}
-
-bool Component::occlusionTestTilesLine(Sint32 sX, Sint32 sY, Sint32 eX, Sint32 eY, bool entities)
-{
-	TileWorld* world = static_cast<TileWorld*>(entity->getWorld());
-
-	Sint32 tWidth = (Sint32)world->getWidth();
-	Sint32 tHeight = (Sint32)world->getHeight();
-
-	Sint32 dx = eX - sX;
-	Sint32 dy = eY - sY;
-	Sint32 dxabs = abs(dx);
-	Sint32 dyabs = abs(dy);
-	Sint32 a = static_cast<Sint32>(floor(dyabs * .5f));
-	Sint32 b = static_cast<Sint32>(floor(dxabs * .5f));
-	Sint32 u2 = sX;
-	Sint32 v2 = sY;
-
-	if( dxabs > dyabs ) { // the line is more horizontal than vertical
-		for( Sint32 i = 0; i < dxabs; ++i ) {
-			u2 += sgn(dx);
-			b += dyabs;
-			if( b >= dxabs ) {
-				b -= dxabs;
-				v2 += sgn(dy);
-			}
-			if( u2 >= 0 && u2 < tWidth && v2 >= 0 && v2 < tHeight ) {
-				Uint32 index = v2 + u2 * tHeight;
-				if( entities ) {
-					Chunk* chunk = world->getTiles()[index].getChunk();
-					if( chunk ) {
-						for( Component* component : chunk->getCPopulation() ) {
-							Entity* entity = component->getEntity();
-							if( entity->isFlag(Entity::FLAG_OCCLUDE) ) {
-								return false;
-							}
-						}
-					}
-				}
-				if( !world->getTiles()[index].hasVolume() ) {
-					return false;
-				}
-			}
-		}
-	} else { // the line is more vertical than horizontal
-		for( Sint32 i = 0; i < dyabs; ++i ) {
-			v2 += sgn(dy);
-			a += dxabs;
-			if( a >= dyabs ) {
-				a -= dyabs;
-				u2 += sgn(dx);
-			}
-			if( u2 >= 0 && u2 < tWidth && v2 >= 0 && v2 < tHeight ) {
-				Uint32 index = v2 + u2 * tHeight;
-				if( entities ) {
-					Chunk* chunk = world->getTiles()[index].getChunk();
-					if( chunk ) {
-						for( Component* component : chunk->getCPopulation() ) {
-							Entity* entity = component->getEntity();
-							if( entity->isFlag(Entity::FLAG_OCCLUDE) ) {
-								return false;
-							}
-						}
-					}
-				}
-				if( !world->getTiles()[index].hasVolume() ) {
-					return false;
-				}
-			}
-		}
+		tX = -1;
+		tY = -1;
 	}
 
-	return true;
+	world->getVis().test(*world, tX, tY, range, accuracy, vis);
+	visValid = true;
 }
 
 void Component::deleteVisMaps() {
-	tilesWidth = 0;
-	tilesHeight = 0;
-	if( tilesVisible ) {
-		delete[] tilesVisible;
-		tilesVisible = nullptr;
-	}
-	if( chunksVisible ) {
-		delete[] chunksVisible;
-		chunksVisible = nullptr;
-	}
-	visibleChunks.clear();
+	visValid = false;
+	vis.tiles.clear();
+	vis.chunks.clear();
+	vis.visibleChunks.clear();
 }
 
 void Component::deleteAllVisMaps() {
@@ -865,17 +618,23 @@ void Component::process() {
 	}
 
 	for( Uint32 c = 0; c < components.getSize(); ++c ) {
-		components[c]->process();
+		if( !components[c]->isToBeDeleted() ) {
+			components[c]->process();
+		}
 	}
 }
 
 void Component::beforeWorldInsertion(const World* world) {
+	unregisterFromWorld();
 	for( Uint32 c = 0; c < components.getSize(); ++c ) {
 		components[c]->beforeWorldInsertion(world);
 	}
 }
 
 void Component::afterWorldInsertion(const World* world) {
+	if( !toBeDeleted ) {
+		registerWithWorld();
+	}
 	for( Uint32 c = 0; c < components.getSize(); ++c ) {
 		components[c]->afterWorldInsertion(world);
 	}
@@ -946,37 +705,64 @@ void Component::revertToIdentity() {
 	lMat = glm::mat4();
 }
 
-void Component::update() {
-	updateNeeded = false;
-	
-	deleteVisMaps();
+void Component::gatherTransforms(TransformStore& store, Uint32 parentIndex) {
+	if( !lMatSet && lMatDirty ) {
+		lMat = TransformStore::compose(lPos, lAng, lScale);
+	}
+	lMatDirty = false;
 
-	if (!lMatSet) {
-		glm::mat4 translationM = glm::translate(glm::mat4(1.f),glm::vec3(lPos.x,-lPos.z,lPos.y));
-		glm::mat4 rotationM = glm::mat4( 1.f );
-		rotationM = glm::rotate(rotationM, (float)(lAng.radiansYaw()), glm::vec3(0.f, -1.f, 0.f));
-		rotationM = glm::rotate(rotationM, (float)(lAng.radiansPitch()), glm::vec3(0.f, 0.f, -1.f));
-		rotationM = glm::rotate(rotationM, (float)(lAng.radiansRoll()), glm::vec3(1.f, 0.f, 0.f));
-		glm::mat4 scaleM = glm::scale(glm::mat4(1.f),glm::vec3(lScale.x, lScale.z, lScale.y));
-		lMat = translationM * rotationM * scaleM;
-	}
-
-	if( parent ) {
-		gMat = parent->getGlobalMat() * lMat;
-		gAng.yaw = lAng.yaw + parent->getGlobalAng().yaw;
-		gAng.pitch = lAng.pitch + parent->getGlobalAng().pitch;
-		gAng.roll = lAng.roll + parent->getGlobalAng().roll;
-		gAng.wrapAngles();
-	} else {
-		gMat = entity->getMat() * lMat;
-		gAng.yaw = lAng.yaw + entity->getAng().yaw;
-		gAng.pitch = lAng.pitch + entity->getAng().pitch;
-		gAng.roll = lAng.roll + entity->getAng().roll;
-		gAng.wrapAngles();
+	Uint32 index = store.addNode(parentIndex, lMat);
+	for( Uint32 c = 0; c < components.getSize(); ++c ) {
+		if( !components[c]->isToBeDeleted() ) {
+			components[c]->gatherTransforms(store, index);
+		}
 	}
+}
+
+void Component::scatterTransforms(const TransformStore& store, Uint32& index, const Angle& parentAng) {
+	gMat = store.getGlobal(index++);
+	gMatCurrent = true;
+	gAng.yaw = lAng.yaw + parentAng.yaw;
+	gAng.pitch = lAng.pitch + parentAng.pitch;
+	gAng.roll = lAng.roll + parentAng.roll;
+	gAng.wrapAngles();
 	gPos = Vector( gMat[3][0], gMat[3][2], -gMat[3][1] );
 	gScale = Vector( glm::length( gMat[0] ), glm::length( gMat[2] ), glm::length( gMat[1] ) );
 
+	for( Uint32 c = 0; c < components.getSize(); ++c ) {
+		if( !components[c]->isToBeDeleted() ) {
+			components[c]->scatterTransforms(store, index, gAng);
+		}
+	}
+}
+
+void Component::updateTransforms() {
+	TransformStore& store = TransformStore::getScratch();
+	Uint32 first = store.getSize();
+	Uint32 root = store.addRoot(parent ? parent->getGlobalMat() : entity->getMat());
+	gatherTransforms(store, root);
+	store.compute();
+
+	Uint32 index = root + 1;
+	scatterTransforms(store, index, parent ? parent->getGlobalAng() : entity->getAng());
+	if( first == 0 ) {
+		store.clear();
+	}
+}
+
+void Component::update() {
+	updateNeeded = false;
+	CommandBuffer* commands = CommandBuffer::getCurrent();
+
+	// the arrays are kept for the next test; only the results go stale
+	invalidateVisMaps();
+
+	// an entity or ancestor update may already have batched our transform
+	if( !gMatCurrent ) {
+		updateTransforms();
+	}
+	gMatCurrent = false;
+
 	// update the chunk node
 	World* world = entity->getWorld();
 	if( world && world->getType() == World::WORLD_TILES ) {
@@ -989,30 +775,73 @@ void Component::update() {
 				Sint32 cY = std::min(std::max(0, (Sint32)floor((gPos.y / Tile::size) / Chunk::size)), cH - 1);
 
 				if (cX != currentCX || cY != currentCY) {
-					clearChunkNode();
-
 					currentCX = cX;
 					currentCY = cY;
 
+					Chunk* chunk = nullptr;
 					if (entity->isFlag(Entity::FLAG_OCCLUDE)) {
-						chunkNode = tileworld->getChunks()[cY + cX * cH].addCPopulation(this);
+						chunk = &tileworld->getChunks()[cY + cX * cH];
+					}
+					if (chunk || chunkNode.getList()) {
+						tileworld->getVis().invalidateOccluders();
+					}
+					if (commands) {
+						commands->linkComponent(this, chunk);
+					} else if (chunk) {
+						chunk->addCPopulation(chunkNode);
+					} else {
+						clearChunkNode();
 					}
 				}
 			}
 		}
 	}
 
+	bool purge = false;
+	for( Uint32 c = 0; c < components.getSize(); ++c ) {
+		if( components[c]->isToBeDeleted() ) {
+			purge = true;
+		} else {
+			components[c]->update();
+		}
+	}
+	if( purge ) {
+		if( commands ) {
+			commands->purgeComponents(this);
+		} else {
+			purgeComponents();
+		}
+	}
+}
+
+void Component::purgeComponents() {
 	for( Uint32 c = 0; c < components.getSize(); ++c ) {
 		if( components[c]->isToBeDeleted() ) {
 			delete components[c];
 			components.remove(c);
 			--c;
-		} else {
-			components[c]->update();
 		}
 	}
 }
 
+void Component::queueUpdateShared() {
+	CommandBuffer* commands = CommandBuffer::getCurrent();
+	if( commands ) {
+		commands->updateShared(this);
+	} else {
+		updateShared();
+	}
+}
+
+void Component::queueProcessShared() {
+	CommandBuffer* commands = CommandBuffer::getCurrent();
+	if( commands ) {
+		commands->processShared(this);
+	} else {
+		processShared();
+	}
+}
+
 void Component::copy(Component& dest) {
 	Component* component = nullptr;
 	switch (getType()) {
@@ -1197,6 +1026,31 @@ bool Component::removeComponentByUID(const Uint32 uid) {
 
 void Component::remove() {
 	toBeDeleted = true;
+
+	// systems iterating the world registries should stop seeing us right away
+	unregisterFromWorld();
+	for( Uint32 c = 0; c < components.getSize(); ++c ) {
+		components[c]->remove();
+	}
+}
+
+void Component::registerWithWorld() {
+	unregisterFromWorld();
+	World* world = entity->getWorld();
+	if( world ) {
+		registry = world;
+		registryType = getType();
+		registryHandle = world->registerComponent(this);
+	}
+}
+
+void Component::unregisterFromWorld() {
+	if( registry ) {
+		// getType() is not usable here when called from the destructor
+		registry->unregisterComponent(registryType, registryHandle);
+		registry = nullptr;
+		registryHandle = SlotMap<Component*>::nhandle;
+	}
 }
 
 void Component::load(FILE* fp) {
@@ -1228,6 +1082,7 @@ void Component::load(FILE* fp) {
 	lPos = pos;
 	lAng = ang;
 	lScale = scale;
+	lMatDirty = true;
 
 	free(nameStr);
 
@@ -1284,6 +1139,9 @@ void Component::serialize(FileInterface * file) {
 	file->property("lPos", lPos);
 	file->property("lAng", lAng);
 	file->property("lScale", lScale);
+	if( file->isReading() ) {
+		lMatDirty = true;
+	}
 	serializeComponents(file);
 }
 
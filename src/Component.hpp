@@ -8,10 +8,12 @@
 #include "ArrayList.hpp"
 #include "String.hpp"
 #include "LinkedList.hpp"
+#include "SlotMap.hpp"
 #include "Rect.hpp"
 #include "WideVector.hpp"
 #include "Script.hpp"
 #include "Frame.hpp"
+#include "TileVis.hpp"
 
 class Chunk;
 class Entity;
@@ -19,6 +21,7 @@ class Camera;
 class Light;
 class World;
 class Field;
+class TransformStore;
 
 class Component {
 public:
@@ -422,12 +425,28 @@ public:
 	// delete occlusion data
 	void deleteVisMaps();
 
+	// marks occlusion data out of date without freeing it
+	void invalidateVisMaps() { visValid = false; }
+
 	// delete occlusion data for self and children
 	void deleteAllVisMaps();
 
 	// updates matrices
 	virtual void update();
 
+	// part of update() that touches state shared with other entities (physics, resources).
+	// it runs straight after update(), or at the next phase barrier if update() ran on a
+	// worker thread. call queueUpdateShared() to schedule it
+	virtual void updateShared() {}
+
+	// part of process() that touches state shared with other entities (audio, animation
+	// events). it runs straight after process(), or at the next phase barrier if process()
+	// ran on a worker thread. call queueProcessShared() to schedule it
+	virtual void processShared() {}
+
+	// deletes sub-components that are marked for removal
+	void purgeComponents();
+
 	// checks the component for any components with the given type
 	// @param type the type to look for
 	// @return true if the component was found, false otherwise
@@ -508,6 +527,12 @@ public:
 	// mark the component to be deleted on the next update
 	void remove();
 
+	// adds the component to the registry for its type in the entity's current world
+	void registerWithWorld();
+
+	// removes the component from the world registry it is in, if any
+	void unregisterFromWorld();
+
 	Component* addComponent(Component::type_t type);
 
 	// adds a new component to our list of components
@@ -516,6 +541,7 @@ public:
 	T* addComponent() {
 		T* component = new T(*entity, this);
 		components.push(component);
+		component->registerWithWorld();
 		return component;
 	}
 
@@ -532,11 +558,24 @@ public:
 	void copyComponents(Component& dest);
 
 	// clears the node pointing to us in the chunk we are occupying
-	void clearChunkNode() { if( chunkNode ) { chunkNode->getList()->removeNode(chunkNode); chunkNode = nullptr; } }
+	void clearChunkNode() { if( chunkNode.getList() ) { chunkNode.getList()->removeNode(&chunkNode); } }
 
 	// clears the chunk nodes of all components
 	void clearAllChunkNodes();
 
+	// adds this component and its sub-components to a transform batch, rebuilding any
+	// local matrices that went stale
+	// @param store the batch to add to
+	// @param parentIndex the index of our parent's node in the batch
+	void gatherTransforms(TransformStore& store, Uint32 parentIndex);
+
+	// copies the results of a transform batch back into this component and its sub-components,
+	// in the same order they were gathered. each component's next update() won't recompute them
+	// @param store the batch that was computed
+	// @param index the index of our node in the batch, advanced past our subtree
+	// @param parentAng the global angle of our parent
+	void scatterTransforms(const TransformStore& store, Uint32& index, const Angle& parentAng);
+
 	// load the component from a file
 	// @param fp the file to read from
 	virtual void load(FILE* fp);
@@ -590,17 +629,19 @@ public:
 	const Vector&					getGlobalScale() const				{ return gScale; }
 	const glm::mat4&				getGlobalMat() const				{ return gMat; }
 	bool							isCollapsed() const					{ return collapsed; }
-	const bool*						getTilesVisible() const				{ return tilesVisible; }
-	const bool*						getChunksVisible() const			{ return chunksVisible; }
-	const ArrayList<Chunk*>&		getVisibleChunks() const			{ return visibleChunks; }
+	bool							hasVisMaps() const					{ return visValid; }
+	bool							isTileVisible(Uint32 index) const	{ return vis.isTileVisible(index); }
+	bool							isChunkVisible(Uint32 index) const	{ return vis.isChunkVisible(index); }
+	Node<Component*>&				getChunkNode()						{ return chunkNode; }
+	const ArrayList<Chunk*>&		getVisibleChunks() const			{ return vis.visibleChunks; }
 	bool							isLocalMatSet() const				{ return lMatSet; }
 	const ArrayList<Attribute*>&	getAttributes() const				{ return attributes; }
 
 	void				setEditorOnly(bool _editorOnly)			{ editorOnly = _editorOnly; }
 	void				setName(const char* _name)				{ name = _name; }
-	void				setLocalPos(const Vector& _pos)			{ lPos = _pos; updateNeeded = true; lMatSet = false; }
-	void				setLocalAng(const Angle& _ang)			{ lAng = _ang; updateNeeded = true; lMatSet = false; }
-	void				setLocalScale(const Vector& _scale)		{ lScale = _scale; updateNeeded = true; lMatSet = false; }
+	void				setLocalPos(const Vector& _pos)			{ lPos = _pos; updateNeeded = true; lMatSet = false; lMatDirty = true; }
+	void				setLocalAng(const Angle& _ang)			{ lAng = _ang; updateNeeded = true; lMatSet = false; lMatDirty = true; }
+	void				setLocalScale(const Vector& _scale)		{ lScale = _scale; updateNeeded = true; lMatSet = false; lMatDirty = true; }
 	void				setLocalMat(const glm::mat4& _mat)		{ lMat = _mat; updateNeeded = true; lMatSet = true; }
 	void				setCollapsed(bool _collapsed)			{ collapsed = _collapsed; }
 
@@ -612,6 +653,7 @@ public:
 		lAng = src.lAng;
 		lScale = src.lScale;
 		lMat = src.lMat;
+		lMatDirty = true;
 		updateNeeded = true;
 		return *this;
 	}
@@ -619,7 +661,17 @@ public:
 protected:
 	Entity* entity = nullptr;
 	Component* parent = nullptr;
-	Node<Component*>* chunkNode = nullptr; // pointer to our node in the chunk we are occupying (if any)
+	Node<Component*> chunkNode { this }; // our node in the population of the chunk we are occupying (if any)
+
+	// runs updateShared() now, or at the next phase barrier when on a worker thread
+	void queueUpdateShared();
+
+	// runs processShared() now, or at the next phase barrier when on a worker thread
+	void queueProcessShared();
+
+	World* registry = nullptr;						// world whose component registry we are in (if any)
+	SlotMap<Component*>::handle_t registryHandle;	// our slot in that registry
+	type_t registryType = COMPONENT_BASIC;			// the type we are registered under
 
 	bool toBeDeleted = false;
 	bool editorOnly = false;
@@ -645,25 +697,25 @@ protected:
 	Vector		lScale;		// scale
 	glm::mat4	lMat;		// matrix (position * angle * scale)
 	bool		lMatSet = false;
+	bool		lMatDirty = true;	// lPos/lAng/lScale changed since lMat was built
 
 	// global space
 	Vector		gPos;		// position
 	Angle		gAng;		// angle
 	Vector		gScale;		// scale
 	glm::mat4	gMat;		// matrix (position * angle * scale)
+	bool		gMatCurrent = false;	// set by a transform batch that already covered our next update()
+
+	// works out the global transforms of this component and its sub-components in one batch
+	void updateTransforms();
 
 	Sint32 currentCX = INT32_MAX;	// X coord of the chunk we are currently occupying
 	Sint32 currentCY = INT32_MAX;	// Y coord of the chunk we are currently occupying
 
 	// occlusion test tile world
-	Uint32 tilesWidth = 0;
-	Uint32 tilesHeight = 0;
-	bool* tilesVisible = nullptr;
-	bool* chunksVisible = nullptr;
-	ArrayList<Chunk*> visibleChunks;
+	TileVis::result_t vis;
+	bool visValid = false;			// false until the next occlusion test after a move
 	void occlusionTestTiles(float range, int accuracy);
-	void occlusionTestTilesStep(float range, Sint32 tX, Sint32 tY, int accuracy);
-	bool occlusionTestTilesLine(Sint32 sX, Sint32 sY, Sint32 eX, Sint32 eY, bool entities);
 
 	// attributes available for reflection
 	ArrayList<Attribute*> attributes;
@@ -7,11 +7,11 @@
 #pragma warning(disable: 4073) // initializers put in library initialization area
 #endif
 #pragma init_seg(lib)
-static Map<String, Cvar*> cvars;
-static Map<String, Ccmd*> ccmds;
+static HashMap<String, Cvar*> cvars;
+static HashMap<String, Ccmd*> ccmds;
 #else
-static Map<String, Cvar*> cvars __attribute__ ((init_priority (101)));
-static Map<String, Ccmd*> ccmds __attribute__ ((init_priority (102)));
+static HashMap<String, Cvar*> cvars __attribute__ ((init_priority (101)));
+static HashMap<String, Ccmd*> ccmds __attribute__ ((init_priority (102)));
 #endif
 
 Cvar::Cvar(const char* _name, const char* _desc, const char* _value) {
@@ -21,7 +21,7 @@ Cvar::Cvar(const char* _name, const char* _desc, const char* _value) {
 	cvars.insert(_name, this);
 }
 
-Map<String, Cvar*>& Cvar::getMap() {
+HashMap<String, Cvar*>& Cvar::getMap() {
 	return cvars;
 }
 
@@ -32,6 +32,6 @@ Ccmd::Ccmd(const char* _name, const char* _desc, int (*_func)(int, const char**)
 	ccmds.insert(_name, this);
 }
 
-Map<String, Ccmd*>& Ccmd::getMap() {
+HashMap<String, Ccmd*>& Ccmd::getMap() {
 	return ccmds;
 }
\ No newline at end of file
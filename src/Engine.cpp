@@ -9,6 +9,10 @@
 #include "World.hpp"
 #include "TileWorld.hpp"
 #include "Console.hpp"
+#include "Map.hpp"
+#include "HashMap.hpp"
+
+#include <chrono>
 
 std::atomic_bool Engine::paused(false);
 
@@ -219,6 +223,131 @@ static int console_printDir(int argc, const char** argv) {
 	return 0;
 }
 
+static int console_tickStats(int argc, const char** argv) {
+	Scheduler& scheduler = mainEngine->getScheduler();
+	mainEngine->fmsg(Engine::MSG_INFO, "%u ticks per second, %llu ticks run, %llu dropped by catch-up cap (%u)",
+		scheduler.getRate(), (unsigned long long)scheduler.getTicks(), (unsigned long long)scheduler.getDroppedTicks(), scheduler.getMaxCatchUp());
+	mainEngine->fmsg(Engine::MSG_INFO, "wake-up jitter over %llu waits: avg %.1f us, max %.1f us (sleep margin %.1f us)",
+		(unsigned long long)scheduler.getWaits(), scheduler.getJitterAvg(), scheduler.getJitterMax(), scheduler.getSleepMargin());
+	if( argc >= 1 && !strcmp(argv[0], "reset") ) {
+		scheduler.resetStats();
+	}
+	return 0;
+}
+
+// times inserts, const char* hits and misses, and removals on one map type
+// @param label name to print for the map type
+// @param keys keys that will be inserted
+// @param misses keys that will never be found
+// @param rounds number of times to repeat each pass
+template <typename M>
+static void benchmarkMap(const char* label, const ArrayList<String>& keys, const ArrayList<String>& misses, Uint32 rounds) {
+	M map;
+	volatile Uint32 sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < rounds; ++round ) {
+		map.clear();
+		for( Uint32 c = 0; c < keys.getSize(); ++c ) {
+			map.insert(keys[c], c);
+		}
+	}
+	std::chrono::duration<double, std::nano> insertTime = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < rounds; ++round ) {
+		for( auto& key : keys ) {
+			const Uint32* value = map.find(key.get());
+			sink += value ? *value : 0;
+		}
+	}
+	std::chrono::duration<double, std::nano> hitTime = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < rounds; ++round ) {
+		for( auto& key : misses ) {
+			sink += map.find(key.get()) ? 1 : 0;
+		}
+	}
+	std::chrono::duration<double, std::nano> missTime = std::chrono::steady_clock::now() - start;
+
+	std::chrono::duration<double, std::nano> removeTime(0.0);
+	for( Uint32 round = 0; round < rounds; ++round ) {
+		for( Uint32 c = 0; c < keys.getSize(); ++c ) {
+			map.insert(keys[c], c);
+		}
+		start = std::chrono::steady_clock::now();
+		for( auto& key : keys ) {
+			sink += map.remove(key) ? 1 : 0;
+		}
+		removeTime += std::chrono::steady_clock::now() - start;
+	}
+
+	double ops = (double)keys.getSize() * rounds;
+	mainEngine->fmsg(Engine::MSG_INFO,"%s: insert %.1f ns, hit %.1f ns, miss %.1f ns, remove %.1f ns",
+		label, insertTime.count() / ops, hitTime.count() / ops, missTime.count() / ops, removeTime.count() / ops);
+}
+
+static int console_mapBenchmark(int argc, const char** argv) {
+	Uint32 rounds = 100;
+	if( argc >= 1 ) {
+		rounds = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+
+	// gather the names we really look up: console commands, cached resources, and shader uniforms
+	ArrayList<String> keys;
+	for( auto& pair : Cvar::getMap() ) {
+		keys.push(pair.a);
+	}
+	for( auto& pair : Ccmd::getMap() ) {
+		keys.push(pair.a);
+	}
+	for( auto& pair : mainEngine->getMeshResource().getCache() ) {
+		keys.push(pair.a);
+	}
+	for( auto& pair : mainEngine->getMaterialResource().getCache() ) {
+		keys.push(pair.a);
+	}
+	for( auto& pair : mainEngine->getTextureResource().getCache() ) {
+		keys.push(pair.a);
+	}
+	for( auto& pair : mainEngine->getImageResource().getCache() ) {
+		keys.push(pair.a);
+	}
+	for( auto& pair : mainEngine->getSoundResource().getCache() ) {
+		keys.push(pair.a);
+	}
+	static const char* uniforms[] = {
+		"gActiveLight", "gAnimated", "gCameraPos", "gColor", "gCubemap", "gCustomColorA",
+		"gCustomColorB", "gCustomColorEnabled", "gCustomColorG", "gCustomColorR", "gDiffuseMap",
+		"gEffectsMap", "gHighlightColor", "gModel", "gModelView", "gNormalMap", "gNormalTransform",
+		"gNumLights", "gResolution", "gTexture", "gTileColors", "gView", "gViewProj", "gWidth"
+	};
+	static const char* uniformArrays[] = {
+		"gLightPos", "gLightColor", "gLightIntensity", "gLightRadius", "gLightArc",
+		"gLightScale", "gLightDirection", "gLightShape", "gShadowmap", "gLightProj"
+	};
+	for( auto uniform : uniforms ) {
+		keys.push(uniform);
+	}
+	for( auto uniform : uniformArrays ) {
+		for( int index = 0; index < 32; ++index ) {
+			keys.push(StringBuf<32>("%s[%d]", 2, uniform, index));
+		}
+	}
+
+	ArrayList<String> misses;
+	misses.alloc(keys.getSize());
+	for( auto& key : keys ) {
+		misses.push(StringBuf<128>("%s.missing", 1, key.get()));
+	}
+
+	mainEngine->fmsg(Engine::MSG_INFO,"benchmarking %u keys, %u rounds", keys.getSize(), rounds);
+	benchmarkMap<Map<String, Uint32>>("Map", keys, misses, rounds);
+	benchmarkMap<HashMap<String, Uint32>>("HashMap", keys, misses, rounds);
+	return 0;
+}
+
 static Ccmd ccmd_help("help","lists all console commands and variables",&console_help);
 static Ccmd ccmd_shutdown("exit","kill engine immediately",&console_shutdown);
 static Ccmd ccmd_windowed("windowed","set the engine to windowed mode",&console_windowed);
@@ -234,7 +363,11 @@ static Ccmd ccmd_loadconfig("loadconfig","loads the given config file",&console_
 static Ccmd ccmd_sleep("sleep","waits X seconds before running the next command, useful for configs",&console_sleep);
 static Ccmd ccmd_cachesize("cachesize", "prints the size of all resource caches in bytes", &console_cacheSize);
 static Ccmd ccmd_printDir("printdir", "shows the directory that the engine is running from", &console_printDir);
+static Ccmd ccmd_tickStats("tickstats", "prints tick scheduler jitter and dropped ticks (arg: reset)", &console_tickStats);
+static Ccmd ccmd_mapBenchmark("map.benchmark", "compares Map and HashMap on cvar, resource, and uniform names (arg: rounds)", &console_mapBenchmark);
 static Cvar cvar_tickrate("tickrate","number of frames processed in a second","60");
+static Cvar cvar_tickCatchUp("tickrate.catchup","most frames run at once after a hitch; the rest are dropped","4");
+static Cvar cvar_tickWait("tickrate.wait","how to wait between frames (0 = spin, 1 = yield, 2 = sleep)","2");
 
 void Engine::printCacheSize() const {
 	Uint32 total = 0;
@@ -507,16 +640,21 @@ void Engine::init() {
 	fmsg(Engine::MSG_INFO,"game version:");
 	fmsg(Engine::MSG_INFO,"%s",version());
 
+	// a dedicated server has no window or input devices
+	headless = runningServer && !runningClient;
+
 	// init sdl
 	fmsg(Engine::MSG_INFO,"initializing SDL...");
 	Uint32 initFlags = 0;
 	initFlags |= SDL_INIT_TIMER;
 	initFlags |= SDL_INIT_AUDIO;
-	initFlags |= SDL_INIT_VIDEO;
-	initFlags |= SDL_INIT_JOYSTICK;
-	initFlags |= SDL_INIT_HAPTIC;
-	initFlags |= SDL_INIT_GAMECONTROLLER;
-	initFlags |= SDL_INIT_EVENTS;
+	if( !headless ) {
+		initFlags |= SDL_INIT_VIDEO;
+		initFlags |= SDL_INIT_JOYSTICK;
+		initFlags |= SDL_INIT_HAPTIC;
+		initFlags |= SDL_INIT_GAMECONTROLLER;
+		initFlags |= SDL_INIT_EVENTS;
+	}
 	if( SDL_Init( initFlags ) == -1 ) {
 		fmsg(Engine::MSG_CRITICAL,"failed to initialize SDL: %s",SDL_GetError());
 		initialized = false;
@@ -557,16 +695,19 @@ void Engine::init() {
 	}
 
 	// open game controllers
-	fmsg(Engine::MSG_INFO,"opening game controllers...");
-	for( int c=0; c<SDL_NumJoysticks(); ++c ) {
-		SDL_GameController* pad = SDL_GameControllerOpen(c);
-		if( pad ) {
-			controllers.addNodeLast(pad);
+	if( !headless ) {
+		fmsg(Engine::MSG_INFO,"opening game controllers...");
+		for( int c=0; c<SDL_NumJoysticks(); ++c ) {
+			SDL_GameController* pad = SDL_GameControllerOpen(c);
+			if( pad ) {
+				controllers.addNodeLast(pad);
+			}
 		}
 	}
 
 	// instantiate a timer
-	lastTick = std::chrono::steady_clock::now();
+	scheduler.setRate(ticksPerSecond);
+	scheduler.reset();
 	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
 
 	// instantiate local server
@@ -1129,40 +1270,36 @@ void Engine::preProcess() {
 	anykeystatus = false;
 
 	// lock mouse to window?
-	SDL_SetRelativeMouseMode((SDL_bool)mainEngine->isMouseRelative());
+	if( !headless ) {
+		SDL_SetRelativeMouseMode((SDL_bool)mainEngine->isMouseRelative());
+	}
 
 	// restart timer
 	unsigned int newTicksPerSecond = cvar_tickrate.toInt();
-	if( newTicksPerSecond != ticksPerSecond ) {
+	if( newTicksPerSecond != ticksPerSecond && newTicksPerSecond > 0 ) {
 		ticksPerSecond = newTicksPerSecond;
 	}
+	scheduler.setRate(ticksPerSecond);
+	scheduler.setMaxCatchUp(std::max(1, cvar_tickCatchUp.toInt()));
+	scheduler.setWait((Scheduler::wait_t)std::min(std::max(0, cvar_tickWait.toInt()), (int)Scheduler::WAIT_MAX - 1));
 
 	// do timer
-	std::chrono::duration<double> msInterval(1.0 / ticksPerSecond);
-	auto now = std::chrono::steady_clock::now();
-	int framesToDo = (now - lastTick) / msInterval;
-	if (framesToDo) {
-		lastTick = now;
-		if (!paused) {
-			for (int c = 0; c < framesToDo; ++c) {
-				SDL_Event event;
-				SDL_UserEvent userevent;
-
-				userevent.type = SDL_USEREVENT;
-				userevent.code = 0;
-				userevent.data1 = nullptr;
-				userevent.data2 = nullptr;
-
-				event.type = SDL_USEREVENT;
-				event.user = userevent;
-
-				SDL_PushEvent(&event);
-			}
+	Uint32 framesToDo = scheduler.advance(paused);
+	for( Uint32 c = 0; c < framesToDo; ++c ) {
+		executedFrames = true;
+
+		++ticks;
+		pathQueue.tick();
+		if( localServer ) {
+			localServer->incrementFrame();
+		}
+		if( localClient ) {
+			localClient->incrementFrame();
 		}
 	}
 
 	SDL_GameController* pad = nullptr;
-	while( SDL_PollEvent(&event) ) {
+	while( !headless && SDL_PollEvent(&event) ) {
 		switch (event.type) {
 		case SDL_QUIT: // if SDL receives the shutdown signal
 		{
@@ -1303,18 +1440,6 @@ void Engine::preProcess() {
 				strncpy(inputstr, droppedFile.get(), std::min(inputlen - 1, (int)droppedFile.length()));
 			}
 			SDL_free(event.drop.file);
-		}
-		case SDL_USEREVENT: // if the game timer has elapsed
-		{
-			executedFrames = true;
-
-			++ticks;
-			if (localServer) {
-				localServer->incrementFrame();
-			}
-			if (localClient) {
-				localClient->incrementFrame();
-			}
 			break;
 		}
 		}
@@ -1325,8 +1450,10 @@ void Engine::preProcess() {
 	}
 
 	// update input maps
-	for( int c=0; c<4; ++c ) {
-		inputs[c].update();
+	if( !headless ) {
+		for( int c=0; c<4; ++c ) {
+			inputs[c].update();
+		}
 	}
 
 	if( executedFrames ) {
@@ -1431,6 +1558,9 @@ void Engine::postProcess() {
 	}
 
 	++cycles;
+
+	// sleep off the rest of the frame
+	scheduler.waitForTick();
 }
 
 String Engine::shortenPath(const char* path) const {
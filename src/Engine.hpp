@@ -19,6 +19,9 @@
 #include "Animation.hpp"
 #include "Dictionary.hpp"
 #include "Cubemap.hpp"
+#include "ThreadPool.hpp"
+#include "PathQueue.hpp"
+#include "Scheduler.hpp"
 
 class Server;
 class Client;
@@ -78,6 +81,7 @@ public:
 	const bool							isFullscreen() const							{ return fullscreen; }
 	const bool							isRunningClient() const							{ return runningClient; }
 	const bool							isRunningServer() const							{ return runningServer; }
+	const bool							isHeadless() const								{ return headless; }
 	const char*							getGameTitle() const							{ return game.name.get(); }
 	Client*&							getLocalClient()								{ return localClient; }
 	Server*&							getLocalServer()								{ return localServer; }
@@ -119,6 +123,9 @@ public:
 	const bool							isMouseRelative() const							{ return mouseRelative; }
 	const bool							isKillSignal() const							{ return killSignal; }
 	Random&								getRandom()										{ return rand; }
+	ThreadPool&							getThreadPool()									{ return threadPool; }
+	PathQueue&							getPathQueue()									{ return pathQueue; }
+	Scheduler&							getScheduler()									{ return scheduler; }
 	const char*							getLastInput() const							{ return lastInput; }
 	LinkedList<SDL_GameController*>&	getControllers()								{ return controllers; }
 	Input&								getInput(int index)								{ return inputs[index]; }
@@ -386,6 +393,7 @@ private:
 	// local client and server data
 	bool runningClient = true;
 	bool runningServer = false;
+	bool headless = false;
 	Client* localClient = nullptr;
 	Server* localServer = nullptr;
 
@@ -411,6 +419,12 @@ private:
 	// random number generator
 	Random rand;
 
+	// worker threads for parallel jobs
+	ThreadPool threadPool;
+
+	// worker threads for path searches
+	PathQueue pathQueue;
+
 	// video data (startup settings)
 	bool fullscreen = false;
 	Sint32 xres = 1280;
@@ -422,7 +436,7 @@ private:
 	double frameval[fpsAverage];
 	Uint32 ticks=0, cycles=0, lastfpscount=0;
 	bool executedFrames=false;
-	std::chrono::time_point<std::chrono::steady_clock> lastTick;
+	Scheduler scheduler;
 
 	// console data
 	Uint32 consoleSleep = 0;
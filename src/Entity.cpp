@@ -19,6 +19,8 @@
 #include "Tile.hpp"
 #include "Entity.hpp"
 #include "Chunk.hpp"
+#include "CommandBuffer.hpp"
+#include "TransformStore.hpp"
 #include "Script.hpp"
 #include "Frame.hpp"
 
@@ -87,7 +89,7 @@ Entity::Entity(World* _world, Uint32 _uid) {
 			uid = _uid;
 			world->setMaxUID(_uid);
 		}
-		node = world->getEntities(uid&(World::numBuckets-1)).addNodeLast(this);
+		handle = world->insertEntity(this);
 	}
 
 	item.InitInventory();
@@ -126,6 +128,11 @@ Entity::~Entity() {
 	// remove chunk node
 	clearChunkNode();
 
+	// leave the spatial hash
+	if( world ) {
+		world->getSpatialHash().remove(this);
+	}
+
 	// delete script engine
 	if( script )
 	{
@@ -221,18 +228,16 @@ void Entity::finishInsertIntoWorld() {
 	}
 
 	// insert to new world
-	if( node ) {
-		if( world ) {
-			world->getEntities(uid&(World::numBuckets-1)).removeNode(node);
-		}
+	if( world ) {
+		world->removeEntity(this);
 	}
 	world = newWorld;
 	if( world ) {
 		uid = world->getNewUID();
-		node = world->getEntities(uid&(World::numBuckets-1)).addNodeLast(this);
+		handle = world->insertEntity(this);
 	} else {
 		uid = World::nuid;
-		node = nullptr;
+		handle = SlotMap<Entity*>::nhandle;
 	}
 
 	// signal components again
@@ -285,10 +290,13 @@ void Entity::deleteAllVisMaps() {
 }
 
 bool Entity::isNearCharacter(float radius) const {
-	LinkedList<Entity*> list;
-	findEntitiesInRadius(radius, list);
-	for( Node<Entity*>* node = list.getFirst(); node != nullptr; node = node->getNext() ) {
-		Entity* entity = node->getData();
+	if( !world ) {
+		return false;
+	}
+	static thread_local ArrayList<Entity*> list;
+	list.clearKeepCapacity();
+	world->findEntitiesInRadius(pos, radius, list);
+	for( auto entity : list ) {
 		if( entity->getPlayer() || entity->hasComponent(Component::COMPONENT_CHARACTER) ) {
 			return true;
 		}
@@ -341,6 +349,7 @@ void Entity::findEntitiesInRadius(float radius, LinkedList<Entity*>& outList) co
 
 void Entity::update() {
 	updateNeeded = false;
+	CommandBuffer* commands = CommandBuffer::getCurrent();
 
 	// static entities never update
 	if (ticks && isFlag(Entity::FLAG_STATIC) && !mainEngine->isEditorRunning()) {
@@ -348,13 +357,7 @@ void Entity::update() {
 	}
 
 	if (!matSet) {
-		glm::mat4 translationM = glm::translate(glm::mat4(1.f),glm::vec3(pos.x,-pos.z,pos.y));
-		glm::mat4 rotationM = glm::mat4( 1.f );
-		rotationM = glm::rotate(rotationM, (float)(ang.radiansYaw()), glm::vec3(0.f, -1.f, 0.f));
-		rotationM = glm::rotate(rotationM, (float)(ang.radiansPitch()), glm::vec3(0.f, 0.f, -1.f));
-		rotationM = glm::rotate(rotationM, (float)(ang.radiansRoll()), glm::vec3(1.f, 0.f, 0.f));
-		glm::mat4 scaleM = glm::scale(glm::mat4(1.f),glm::vec3(scale.x, scale.z, scale.y));
-		mat = translationM * rotationM * scaleM;
+		mat = TransformStore::compose(pos, ang, scale);
 	} else {
 		pos = Vector( mat[3][0], mat[3][2], -mat[3][1] );
 		scale = Vector( glm::length( mat[0] ), glm::length( mat[2] ), glm::length( mat[1] ) );
@@ -380,56 +383,73 @@ void Entity::update() {
 				Sint32 cY = std::min(std::max(0, (Sint32)floor((pos.y / Tile::size) / Chunk::size)), cH - 1);
 
 				if (cX != currentCX || cY != currentCY) {
-					clearChunkNode();
-
 					currentCX = cX;
 					currentCY = cY;
 
-					chunkNode = tileworld->getChunks()[cY + cX * cH].addEPopulation(this);
+					Chunk& chunk = tileworld->getChunks()[cY + cX * cH];
+					if (commands) {
+						commands->linkEntity(this, &chunk);
+					} else {
+						chunk.addEPopulation(chunkNode);
+					}
 				}
 			}
 		}
 	}
 
+	// update the spatial hash
+	if( world ) {
+		if( commands ) {
+			commands->updateSpatial(this);
+		} else {
+			world->getSpatialHash().update(this);
+		}
+	}
+
+	// work out every component's global transform in one batch before updating them
+	TransformStore& store = TransformStore::getScratch();
+	Uint32 root = store.addRoot(mat);
+	for( Uint32 c = 0; c < components.getSize(); ++c ) {
+		if( !components[c]->isToBeDeleted() ) {
+			components[c]->gatherTransforms(store, root);
+		}
+	}
+	store.compute();
+	Uint32 index = root + 1;
+	for( Uint32 c = 0; c < components.getSize(); ++c ) {
+		if( !components[c]->isToBeDeleted() ) {
+			components[c]->scatterTransforms(store, index, ang);
+		}
+	}
+	if( root == 0 ) {
+		store.clear();
+	}
+
+	bool purge = false;
 	for( Uint32 c = 0; c < components.getSize(); ++c ) {
 		if( components[c]->isToBeDeleted() ) {
-			delete components[c];
-			components.remove(c);
-			--c;
+			purge = true;
 		} else {
 			components[c]->update();
 		}
 	}
+	if( purge ) {
+		if( commands ) {
+			commands->purgeComponents(this);
+		} else {
+			purgeComponents();
+		}
+	}
 }
 
-void Entity::updatePacket(Packet& packet) const {
-	if (player) {
-		packet.write32((Sint32)(getLookDir().degreesRoll() * 32));
-		packet.write32((Sint32)(getLookDir().degreesPitch() * 32));
-		packet.write32((Sint32)(getLookDir().degreesYaw() * 32));
-		packet.write8(player->hasJumped() ? 1 : 0);
-		packet.write8(player->isMoving() ? 1 : 0);
-		packet.write8(player->isCrouching() ? 1 : 0);
-		packet.write32(player->getServerID());
-		packet.write8(1); // signifies this is a player
+void Entity::purgeComponents() {
+	for( Uint32 c = 0; c < components.getSize(); ++c ) {
+		if( components[c]->isToBeDeleted() ) {
+			delete components[c];
+			components.remove(c);
+			--c;
+		}
 	}
-	else {
-		packet.write8(0); // signifies this is not a player, stop here
-	}
-	packet.write8(falling ? 1U : 0U);
-	packet.write32((Sint32)(ang.degreesRoll() * 32));
-	packet.write32((Sint32)(ang.degreesPitch() * 32));
-	packet.write32((Sint32)(ang.degreesYaw() * 32));
-	packet.write32((Sint32)(vel.z * 128));
-	packet.write32((Sint32)(vel.y * 128));
-	packet.write32((Sint32)(vel.x * 128));
-	packet.write32((Sint32)(pos.z * 32));
-	packet.write32((Sint32)(pos.y * 32));
-	packet.write32((Sint32)(pos.x * 32));
-	packet.write32(defIndex);
-	packet.write32(uid);
-	packet.write32(world->getID());
-	packet.write("ENTU");
 }
 
 void Entity::remoteExecute(const char* funcName, const Script::Args& args) {
@@ -451,8 +471,7 @@ void Entity::remoteExecute(const char* funcName, const Script::Args& args) {
 	packet.write32(uid);
 	packet.write32(world->getID());
 	packet.write("ENTF");
-	game->getNet()->signPacket(packet);
-	game->getNet()->broadcastSafe(packet);
+	world->broadcast(packet);
 }
 
 void Entity::dispatch(const char* funcName, Script::Args& args) {
@@ -470,6 +489,11 @@ void Entity::preProcess() {
 }
 
 void Entity::process() {
+	processScript();
+	processMotion();
+}
+
+void Entity::processScript() {
 	++ticks;
 
 	// correct orientations
@@ -478,42 +502,49 @@ void Entity::process() {
 	// update path request
 	if( path ) {
 		pathRequested = false;
+
+		// hierarchical paths are refined a segment at a time as they are followed
+		if (path->getFirst() && !path->getFirst()->getData().refined && world->getType() == World::WORLD_TILES) {
+			TileWorld* tileWorld = static_cast<TileWorld*>(world);
+			if (!tileWorld->getPathFinder().refinePath(*path, getCurrentTileX(), getCurrentTileY())) {
+				path->removeAll();
+			}
+		}
+
 		if (path->getSize() == 0) {
 			delete path;
 			path = nullptr;
-		} else {
-			const PathFinder::PathWaypoint& node = path->getFirst()->getData();
-
-			if (world->getType() != World::type_t::WORLD_TILES) {
-				TileWorld* tileWorld = static_cast<TileWorld*>(world);
-
-				// place dest coordinates in the middle of the tile
-				pathNode.x = node.x * Tile::size + Tile::size / 2.f; float& x = pathNode.x;
-				pathNode.y = node.y * Tile::size + Tile::size / 2.f; float& y = pathNode.y;
-				pathNode.z = tileWorld->getTiles()[y + x * tileWorld->getHeight()].getFloorHeight(); float& z = pathNode.z;
-				float epsilon = Tile::size / 4.f;
-
-				if (pos.x >= x-epsilon && pos.x <= x-epsilon &&
-					pos.y >= y-epsilon && pos.y <= y-epsilon) {
-					path->removeNode(path->getFirst());
-
-					//Finished pathfinding.
-					if (path->getSize() == 0) {
-						mainEngine->fmsg(Engine::MSG_DEBUG, "Entity '%s' reached goal tile (%d, %d)!", getName().get(), node.x, node.y);
-						pathNode = Vector(0.f);
-						pathDir = Vector(0.f);
-
-						delete path;
-						path = nullptr;
-					}
-				}
-				else {
-					//Move to the target tile.
-					//Stop moving once reached destination.
-					Vector pathDir = (pathNode - pos).normal();
+		} else if (world->getType() == World::type_t::WORLD_TILES) {
+			const PathFinder::PathWaypoint node = path->getFirst()->getData();
+			if (steerToTile(node.x, node.y)) {
+				path->removeNode(path->getFirst());
+
+				//Finished pathfinding.
+				if (path->getSize() == 0) {
+					mainEngine->fmsg(Engine::MSG_DEBUG, "Entity '%s' reached goal tile (%d, %d)!", getName().get(), node.x, node.y);
+					pathNode = Vector(0.f);
+					pathDir = Vector(0.f);
+
+					delete path;
+					path = nullptr;
 				}
 			}
 		}
+	} else if (isFollowingFlow() && world && world->getType() == World::type_t::WORLD_TILES) {
+		// follow a flow field. the next tile comes from the field each tick, so a goal that
+		// moves is picked up straight away
+		TileWorld* tileWorld = static_cast<TileWorld*>(world);
+		Sint32 nextX, nextY;
+		if (tileWorld->getFlowFields().step(tileWorld->getPathFinder(), flowGoalX, flowGoalY,
+			getCurrentTileX(), getCurrentTileY(), world->getTicks(), nextX, nextY)) {
+			steerToTile(nextX, nextY);
+		} else {
+			// at the goal, or it can't be reached from here
+			if (getCurrentTileX() == flowGoalX && getCurrentTileY() == flowGoalY) {
+				mainEngine->fmsg(Engine::MSG_DEBUG, "Entity '%s' reached goal tile (%d, %d)!", getName().get(), flowGoalX, flowGoalY);
+			}
+			stopFlow();
+		}
 	}
 
 	// run entity script
@@ -529,6 +560,10 @@ void Entity::process() {
 			}
 		}
 	}
+}
+
+void Entity::processMotion() {
+	bool editor = mainEngine->isEditorRunning() && !mainEngine->isPlayTest();
 
 	// move entity
 	move();
@@ -557,10 +592,6 @@ void Entity::process() {
 					if (convexShape) {
 						world->convexSweepList(convexShape, bbox->getGlobalPos(), bbox->getGlobalAng(), pos + bbox->getLocalPos(), ang + bbox->getLocalAng(), result);
 						if (result.getSize()) {
-							//Packet packet;
-							//updatePacket(packet);
-							//game->getNet()->signPacket(packet);
-							//game->getNet()->broadcastSafe(packet);
 							illegal = true;
 						}
 					}
@@ -590,9 +621,11 @@ void Entity::process() {
 		update();
 	}
 
-	// process components
+	// process components. ones marked for deletion may still be waiting on a deferred purge
 	for( Uint32 c = 0; c < components.getSize(); ++c ) {
-		components[c]->process();
+		if( !components[c]->isToBeDeleted() ) {
+			components[c]->process();
+		}
 	}
 }
 
@@ -1067,6 +1100,44 @@ void Entity::findRandomPath() {
 	}
 }
 
+void Entity::followFlow(int goalX, int goalY) {
+	if (!world || world->getType() != World::WORLD_TILES) {
+		mainEngine->fmsg(Engine::MSG_WARN, "Entity '%s' can only follow a flow field in a tile world.", getName().get());
+		return;
+	}
+	flowGoalX = goalX;
+	flowGoalY = goalY;
+}
+
+void Entity::stopFlow() {
+	flowGoalX = -1;
+	flowGoalY = -1;
+	pathNode = Vector(0.f);
+	pathDir = Vector(0.f);
+}
+
+bool Entity::steerToTile(Sint32 x, Sint32 y) {
+	TileWorld* tileWorld = static_cast<TileWorld*>(world);
+	if (x < 0 || y < 0 || x >= (Sint32)tileWorld->getWidth() || y >= (Sint32)tileWorld->getHeight()) {
+		return true;
+	}
+
+	// place dest coordinates in the middle of the tile
+	pathNode.x = x * Tile::size + Tile::size / 2.f;
+	pathNode.y = y * Tile::size + Tile::size / 2.f;
+	pathNode.z = tileWorld->getTiles()[y + x * tileWorld->getHeight()].getFloorHeight();
+
+	const float epsilon = Tile::size / 4.f;
+	if (pos.x >= pathNode.x - epsilon && pos.x <= pathNode.x + epsilon &&
+		pos.y >= pathNode.y - epsilon && pos.y <= pathNode.y + epsilon) {
+		return true;
+	}
+
+	//Move to the target tile.
+	pathDir = (pathNode - pos).normal();
+	return false;
+}
+
 bool Entity::pathFinished() {
 	if (!pathRequested)
 	{
@@ -79,6 +79,7 @@ public:
 	// getters & setters
 	const String&						getName() const						{ return name; }
 	const Uint32&						getUID() const						{ return uid; }
+	const SlotMap<Entity*>::handle_t&	getHandle() const					{ return handle; }
 	const Uint32&						getTicks() const					{ return ticks; }
 	const Vector&						getOldPos() const					{ return oldPos; }
 	const Vector&						getPos() const						{ return pos; }
@@ -107,6 +108,9 @@ public:
 	const sort_t&						getSort() const						{ return sort; }
 	Sint32								getCurrentCX() const				{ return currentCX; }
 	Sint32								getCurrentCY() const				{ return currentCY; }
+	Node<Entity*>&						getChunkNode()						{ return chunkNode; }
+	SpatialHash::proxy_t&				getSpatialProxy()					{ return spatialProxy; }
+	const Node<Entity*>&				getChunkNode() const				{ return chunkNode; }
 	int									getCurrentTileX() const				{ return static_cast<int>(getPos().x) / Tile::size; }
 	int									getCurrentTileY() const				{ return static_cast<int>(getPos().y) / Tile::size; }
 	int									getCurrentTileZ() const				{ return static_cast<int>(getPos().z) / Tile::size; }
@@ -114,7 +118,9 @@ public:
 	const Vector&						getPathNodePosition() const			{ return pathNode; }
 	const Vector&						getPathNodeDir() const				{ return pathDir; }
 	bool								hasPath() const						{ return path != nullptr; }
+	bool								isFollowingFlow() const				{ return flowGoalX >= 0; }
 	const Entity*						getAnchor() const					{ return anchor; }
+	World*								getNewWorld() const					{ return newWorld; }
 	const Vector&						getOffset() const					{ return offset; }
 	bool								isPickupable() const				{ return canBePickedUp; }
 
@@ -161,10 +167,6 @@ public:
 	// @param funcName the name of the function to remote execute
 	void remoteExecute(const char* funcName, const Script::Args& args);
 
-	// fill out an update packet for this entity
-	// @param packet the packet to fill out
-	void updatePacket(Packet& packet) const;
-
 	// run a script function with the given name
 	// @param funcName the name of the function to execute
 	void dispatch(const char* funcName, Script::Args& args);
@@ -220,6 +222,15 @@ public:
 	// updates the entity and runs the entity script
 	void process();
 
+	// first half of process(): follows the path and runs the entity script.
+	// always runs on the thread that owns the world
+	void processScript();
+
+	// second half of process(): moves, interpolates, and updates the entity and its
+	// components. may run on a worker thread, in which case anything touching state
+	// outside the entity goes to the thread's CommandBuffer
+	void processMotion();
+
 	// runs the entity's post-process script
 	void postProcess();
 
@@ -315,8 +326,11 @@ public:
 	// updates matrices
 	void update();
 
+	// deletes components that are marked for removal
+	void purgeComponents();
+
 	// clears the node pointing to us in the chunk we are occupying
-	void clearChunkNode() { if( chunkNode ) { chunkNode->getList()->removeNode(chunkNode); chunkNode = nullptr; } }
+	void clearChunkNode() { if( chunkNode.getList() ) { chunkNode.getList()->removeNode(&chunkNode); } }
 
 	// clears the chunk nodes of all components
 	void clearAllChunkNodes();
@@ -390,6 +404,7 @@ public:
 	T* addComponent() {
 		T* component = new T(*this, nullptr);
 		components.push(component);
+		component->registerWithWorld();
 		return component;
 	}
 
@@ -434,6 +449,16 @@ public:
 	// @return true if the async pathfinding task has finished yet, false if the pathfinding task has not finished yet
 	bool pathFinished();
 
+	// follows the world's shared flow field to a tile instead of a path of its own. many
+	// entities can head to the same tile for the cost of one search, and the goal can be
+	// moved every tick
+	// @param goalX target x coordinate
+	// @param goalY target y coordinate
+	void followFlow(int goalX, int goalY);
+
+	// stops following a flow field
+	void stopFlow();
+
 	// check if this entity is a player owned by this client
 	// @return true if the entity is a player from this client, otherwise false
 	bool isLocalPlayer() const;
@@ -459,11 +484,12 @@ public:
 	void setInventoryVisibility(bool visible);
 
 protected:
-	Node<Entity*>* node			= nullptr;	// node to the world entity list
+	SlotMap<Entity*>::handle_t handle;		// handle to our slot in the world entity table
 	World* world				= nullptr;	// parent world object
 	Script* script				= nullptr;	// scripting engine
 	Player* player				= nullptr;	// player associated with this entity, if any
-	Node<Entity*>* chunkNode	= nullptr;	// pointer to our node in the chunk we are occupying (if any)
+	Node<Entity*> chunkNode		{ this };	// our node in the population of the chunk we are occupying (if any)
+	SpatialHash::proxy_t spatialProxy;		// our place in the world's spatial hash (if any)
 
 	World* newWorld				= nullptr;  // world we are moving to, if any
 	const Entity* anchor		= nullptr;	// entity we are attached to for the transition
@@ -517,6 +543,12 @@ protected:
 	std::future<PathFinder::Path*> pathTask;
 	PathFinder::Path* path = nullptr;
 	bool pathRequested = false;
+	Sint32 flowGoalX = -1;					// tile being headed for by flow field (or -1)
+	Sint32 flowGoalY = -1;
+
+	// points pathNode and pathDir at the middle of a tile in a tile world
+	// @return true if the entity is already there
+	bool steerToTile(Sint32 x, Sint32 y);
 };
  
 struct Entity::def_t {
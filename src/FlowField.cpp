@@ -0,0 +1,386 @@
+// FlowField.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "FlowField.hpp"
+#include "Path.hpp"
+#include "TileWorld.hpp"
+#include "Server.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+static Cvar cvar_flowCache("flow.cache", "number of flow fields kept before the least recently used is thrown out", "16");
+static Cvar cvar_flowReuse("flow.reuse", "how many tiles a goal can move and still have a cached flow field shifted to it instead of rebuilt", "4");
+
+const Sint32 FlowFields::dirX[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+const Sint32 FlowFields::dirY[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+FlowFields::~FlowFields() {
+	clear();
+}
+
+Uint32 FlowFields::getMemoryUsage() const {
+	Uint32 result = 0;
+	for( auto& pair : fields ) {
+		const field_t* field = pair.b;
+		result += sizeof(field_t) + field->cost.getMaxSize() * sizeof(Uint32) + field->dir.getMaxSize() * sizeof(Uint8);
+	}
+	return result;
+}
+
+void FlowFields::clear() {
+	for( auto& pair : fields ) {
+		delete pair.b;
+	}
+	fields.clear();
+}
+
+void FlowFields::evict() {
+	field_t* oldest = nullptr;
+	for( auto& pair : fields ) {
+		if( oldest == nullptr || pair.b->lastUsed < oldest->lastUsed ) {
+			oldest = pair.b;
+		}
+	}
+	if( oldest ) {
+		fields.remove(oldest->goal);
+		delete oldest;
+	}
+}
+
+const FlowFields::field_t* FlowFields::find(PathFinder& pathFinder, Sint32 goalX, Sint32 goalY, Uint32 tick) {
+	NavSnapshot grid = pathFinder.getSnapshot();
+	const NavGrid& map = *grid;
+	const Sint32 width = (Sint32)map.getWidth();
+	const Sint32 height = (Sint32)map.getHeight();
+	if( map.getVersion() != version ) {
+		clear();
+		version = map.getVersion();
+	}
+	if( goalX < 0 || goalY < 0 || goalX >= width || goalY >= height ) {
+		return nullptr;
+	}
+	const Uint32 goal = goalY + goalX * height;
+	if( !map.isWalkable(goal) ) {
+		return nullptr;
+	}
+
+	field_t** found = fields.find(goal);
+	if( found ) {
+		++numHits;
+		(*found)->lastUsed = tick;
+		return *found;
+	}
+
+	// shift the nearest field that already reaches the new goal
+	const Sint32 reuse = std::max(0, cvar_flowReuse.toInt());
+	field_t* nearest = nullptr;
+	Sint32 nearestDist = reuse + 1;
+	for( auto& pair : fields ) {
+		field_t* candidate = pair.b;
+		if( candidate->width != width || candidate->height != height || candidate->cost[goal] == noCost ) {
+			continue;
+		}
+		Sint32 dist = std::max(
+			std::abs((Sint32)candidate->goal / height - goalX),
+			std::abs((Sint32)candidate->goal % height - goalY));
+		if( dist < nearestDist ) {
+			nearest = candidate;
+			nearestDist = dist;
+		}
+	}
+
+	const Uint32 capacity = (Uint32)std::max(1, cvar_flowCache.toInt());
+	field_t* field = nullptr;
+	if( nearest ) {
+		if( nearest->lastUsed == tick ) {
+			// something is still following the old goal this tick, so shift a copy
+			field = new field_t(*nearest);
+		} else {
+			fields.remove(nearest->goal);
+			field = nearest;
+		}
+		while( fields.getSize() >= capacity ) {
+			evict();
+		}
+		rebase(map, goal, *field);
+		++numRebases;
+	} else {
+		while( fields.getSize() >= capacity ) {
+			evict();
+		}
+		field = new field_t;
+		build(map, goal, *field);
+		++numBuilds;
+	}
+	field->lastUsed = tick;
+	field->version = version;
+	fields.insert(goal, field);
+	return field;
+}
+
+bool FlowFields::step(PathFinder& pathFinder, Sint32 goalX, Sint32 goalY, Sint32 x, Sint32 y, Uint32 tick, Sint32& outX, Sint32& outY) {
+	const field_t* field = find(pathFinder, goalX, goalY, tick);
+	if( field == nullptr ) {
+		return false;
+	}
+	Uint8 dir = field->getDirection(x, y);
+	if( dir == noDirection ) {
+		return false;
+	}
+	outX = x + dirX[dir];
+	outY = y + dirY[dir];
+	return true;
+}
+
+Uint32 FlowFields::propagate(const NavGrid& map, field_t& field, ArrayList<Uint64>& heap) {
+	// the direction that leads back from each step
+	static const Uint8 back[8] = { 2, 3, 0, 1, 6, 7, 4, 5 };
+
+	const Sint32 w = field.width;
+	const Sint32 h = field.height;
+	Uint32 lowered = 0;
+	while( heap.getSize() > 0 ) {
+		std::pop_heap(heap.getArray(), heap.getArray() + heap.getSize(), std::greater<Uint64>());
+		const Uint64 top = heap.pop();
+		const Uint32 node = (Uint32)top;
+		const Uint32 cost = (Uint32)(top >> 32);
+		if( cost > field.cost[node] ) {
+			continue; // lowered again since it was pushed
+		}
+
+		const Sint32 x = (Sint32)node / h;
+		const Sint32 y = (Sint32)node % h;
+		for( Uint32 dir = 0; dir < 8; ++dir ) {
+			const Sint32 nx = x + dirX[dir];
+			const Sint32 ny = y + dirY[dir];
+			if( nx < 0 || ny < 0 || nx >= w || ny >= h ) {
+				continue;
+			}
+			const Uint32 next = ny + nx * h;
+			if( !map.isWalkable(next) ) {
+				continue;
+			}
+
+			// diagonal moves can't cut the corner of an obstacle
+			const bool diagonal = dir >= 4;
+			if( diagonal && (!map.isWalkable(y + nx * h) || !map.isWalkable(ny + x * h)) ) {
+				continue;
+			}
+
+			// a popped node's cost is final, so the last node to lower a tile is the one
+			// it should step to
+			const Uint32 nextCost = cost + (diagonal ? PathFinder::AStarTask::COST_DIAGONAL : PathFinder::AStarTask::COST_STRAIGHT);
+			if( nextCost < field.cost[next] ) {
+				field.cost[next] = nextCost;
+				field.dir[next] = back[dir];
+				heap.push(((Uint64)nextCost << 32) | next);
+				std::push_heap(heap.getArray(), heap.getArray() + heap.getSize(), std::greater<Uint64>());
+				++lowered;
+			}
+		}
+	}
+	return lowered;
+}
+
+void FlowFields::updateDirection(const NavGrid& map, field_t& field, Uint32 tile) {
+	const Sint32 w = field.width;
+	const Sint32 h = field.height;
+	field.dir[tile] = noDirection;
+	if( field.cost[tile] == noCost || tile == field.goal ) {
+		return;
+	}
+
+	// step to the neighbor the goal is cheapest through
+	const Sint32 x = (Sint32)tile / h;
+	const Sint32 y = (Sint32)tile % h;
+	Uint32 best = noCost;
+	for( Uint32 dir = 0; dir < 8; ++dir ) {
+		const Sint32 nx = x + dirX[dir];
+		const Sint32 ny = y + dirY[dir];
+		if( nx < 0 || ny < 0 || nx >= w || ny >= h ) {
+			continue;
+		}
+		const Uint32 next = ny + nx * h;
+		if( field.cost[next] == noCost ) {
+			continue;
+		}
+		const bool diagonal = dir >= 4;
+		if( diagonal && (!map.isWalkable(y + nx * h) || !map.isWalkable(ny + x * h)) ) {
+			continue;
+		}
+		const Uint32 cost = field.cost[next] + (diagonal ? PathFinder::AStarTask::COST_DIAGONAL : PathFinder::AStarTask::COST_STRAIGHT);
+		if( cost < best ) {
+			best = cost;
+			field.dir[tile] = (Uint8)dir;
+		}
+	}
+}
+
+void FlowFields::build(const NavGrid& map, Uint32 goal, field_t& field) {
+	field.goal = goal;
+	field.width = (Sint32)map.getWidth();
+	field.height = (Sint32)map.getHeight();
+	field.cost.resize(map.getSize());
+	field.dir.resize(map.getSize());
+	for( auto& cost : field.cost ) {
+		cost = noCost;
+	}
+	memset(field.dir.getArray(), noDirection, field.dir.getSize());
+
+	static thread_local ArrayList<Uint64> heap;
+	heap.clearKeepCapacity();
+	field.cost[goal] = 0;
+	heap.push(goal);
+	propagate(map, field, heap);
+}
+
+Uint32 FlowFields::rebase(const NavGrid& map, Uint32 goal, field_t& field) {
+	// the old cost through the old goal is a fair upper bound on the cost to the new one,
+	// so from here Dijkstra only ever needs to lower costs. a tile that isn't lowered still
+	// points at a neighbor that wasn't either (or it would have been lowered through it), so
+	// its direction holds
+	const Uint32 offset = field.cost[goal];
+	for( auto& cost : field.cost ) {
+		if( cost != noCost ) {
+			cost += offset;
+		}
+	}
+
+	static thread_local ArrayList<Uint64> heap;
+	heap.clearKeepCapacity();
+	const Uint32 oldGoal = field.goal;
+	field.goal = goal;
+	field.cost[goal] = 0;
+	field.dir[goal] = noDirection;
+	heap.push(goal);
+	Uint32 lowered = propagate(map, field, heap);
+
+	// the old goal has nowhere to point yet unless it was lowered
+	if( field.dir[oldGoal] == noDirection ) {
+		updateDirection(map, field, oldGoal);
+	}
+	return lowered;
+}
+
+static int console_flowBenchmark(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"flow.benchmark needs a running server.");
+		return 1;
+	}
+
+	Uint32 numFollowers = 1000;
+	Uint32 numMoves = 32;
+	const char* genPath = "maps/tilesets/template.json";
+	if( argc >= 1 ) {
+		numFollowers = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		numMoves = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+	if( argc >= 3 ) {
+		genPath = argv[2];
+	}
+
+	// generate a scratch dungeon that isn't part of the game
+	ArrayList<Uint32> open;
+	TileWorld* world = TileWorld::generateScratch(server, genPath, 0, true, open);
+	if( world == nullptr ) {
+		return 1;
+	}
+
+	NavSnapshot grid = world->getPathFinder().getSnapshot();
+	const NavGrid& map = *grid;
+	const Sint32 w = (Sint32)map.getWidth();
+	const Sint32 h = (Sint32)map.getHeight();
+
+	Random rand;
+	rand.seedValue(1234);
+	const Uint32 goal = open[rand.getUint32() % open.getSize()];
+	ArrayList<Uint32> starts;
+	for( Uint32 c = 0; c < numFollowers; ++c ) {
+		starts.push(open[rand.getUint32() % open.getSize()]);
+	}
+
+	// every follower searching its own path
+	Uint64 searchSteps = 0;
+	auto start = std::chrono::steady_clock::now();
+	for( auto tile : starts ) {
+		PathFinder::Path* path = PathFinder::AStarTask::search(map, tile / h, tile % h, goal / h, goal % h);
+		searchSteps += path->getSize();
+		delete path;
+	}
+	std::chrono::duration<double, std::milli> searchTime = std::chrono::steady_clock::now() - start;
+
+	// one field, every follower walking it to the end
+	FlowFields::field_t field;
+	start = std::chrono::steady_clock::now();
+	FlowFields::build(map, goal, field);
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+	Uint64 flowSteps = 0;
+	Uint32 stuck = 0;
+	start = std::chrono::steady_clock::now();
+	for( auto tile : starts ) {
+		Sint32 x = tile / h, y = tile % h;
+		Uint32 steps = 0;
+		for( Uint8 dir; (dir = field.getDirection(x, y)) != FlowFields::noDirection; ++steps ) {
+			x += FlowFields::dirX[dir];
+			y += FlowFields::dirY[dir];
+			if( steps > map.getSize() ) {
+				++stuck;
+				break;
+			}
+		}
+		flowSteps += steps;
+	}
+	std::chrono::duration<double, std::milli> followTime = std::chrono::steady_clock::now() - start;
+
+	// a wandering goal: shifting the field each move against building it again
+	FlowFields::field_t fresh;
+	Uint32 moved = 0, mismatched = 0;
+	Uint64 lowered = 0;
+	double rebaseTime = 0.0, rebuildTime = 0.0;
+	Uint32 current = goal;
+	for( Uint32 c = 0; c < numMoves; ++c ) {
+		Sint32 x = current / h + (Sint32)(rand.getUint32() % 5) - 2;
+		Sint32 y = current % h + (Sint32)(rand.getUint32() % 5) - 2;
+		if( x < 0 || y < 0 || x >= w || y >= h ) {
+			continue;
+		}
+		Uint32 next = y + x * h;
+		if( !map.isWalkable(next) || next == current || field.cost[next] == FlowFields::noCost ) {
+			continue;
+		}
+		start = std::chrono::steady_clock::now();
+		lowered += FlowFields::rebase(map, next, field);
+		rebaseTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		FlowFields::build(map, next, fresh);
+		rebuildTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		// ties can point a tile different ways, but the costs must agree exactly
+		for( Uint32 tile = 0; tile < fresh.cost.getSize(); ++tile ) {
+			if( fresh.cost[tile] != field.cost[tile] || (fresh.dir[tile] == FlowFields::noDirection) != (field.dir[tile] == FlowFields::noDirection) ) {
+				++mismatched;
+				break;
+			}
+		}
+		current = next;
+		++moved;
+	}
+
+	mainEngine->fmsg(Engine::MSG_INFO,"%u followers to one goal on %u x %u (%u open tiles):", numFollowers, w, h, open.getSize());
+	mainEngine->fmsg(Engine::MSG_INFO,"  A* per follower: %.2f ms (%.1f steps each)", searchTime.count(), (double)searchSteps / numFollowers);
+	mainEngine->fmsg(Engine::MSG_INFO,"  flow field: %.2f ms to build, %.2f ms for everyone to walk it (%.1f steps each, %u stuck)",
+		buildTime.count(), followTime.count(), (double)flowSteps / numFollowers, stuck);
+	mainEngine->fmsg(Engine::MSG_INFO,"  goal moved %u times: %.3f ms per shift (%.0f tiles lowered) vs %.3f ms per rebuild, %u mismatched",
+		moved, moved ? rebaseTime / moved : 0.0, moved ? (double)lowered / moved : 0.0, moved ? rebuildTime / moved : 0.0, mismatched);
+
+	delete world;
+	return stuck || mismatched ? 1 : 0;
+}
+
+static Ccmd ccmd_flowBenchmark("flow.benchmark","times flow fields against per-follower A* on a generated dungeon (args: follower count, goal moves, generator path)",&console_flowBenchmark);
@@ -0,0 +1,115 @@
+// FlowField.hpp
+// Per-goal direction fields that crowds follow instead of each searching a path
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+#include "NavGrid.hpp"
+
+class PathFinder;
+
+// one Dijkstra pass outward from a goal tile gives every tile its cost to the goal and the
+// neighbor to step to, so any number of entities heading to the same place can look up their
+// next tile instead of each searching for a path. fields are cached by goal tile and the
+// least recently used is thrown out when the cache is full. when a goal moves a few tiles,
+// the nearest cached field is shifted to the new goal (every cost grows by the cost of the
+// move, which can only be too high) and only the tiles that get cheaper are redone.
+//
+// moves follow the same rules as PathFinder (walkable tiles, no cutting corners) and fields
+// are thrown out whenever the pathfinder's map changes. fields are only built and read from
+// the thread that runs entity scripts.
+class FlowFields {
+public:
+	FlowFields() {}
+	~FlowFields();
+
+	static const Uint32 noCost = UINT32_MAX;
+	static const Uint8 noDirection = 8;
+
+	// steps for each direction (east, south, west, north, then the diagonals)
+	static const Sint32 dirX[8];
+	static const Sint32 dirY[8];
+
+	// a direction field leading to one goal tile (indexed y + x * height)
+	struct field_t {
+		Uint32 goal = 0;
+		Sint32 width = 0;
+		Sint32 height = 0;
+		ArrayList<Uint32> cost;		// cost to the goal (or noCost)
+		ArrayList<Uint8> dir;		// direction of the next step (or noDirection)
+		Uint32 lastUsed = 0;		// tick the field was last asked for
+		Uint32 version = 0;			// version of the NavGrid the field was built from
+
+		// @return the direction to step from the given tile (noDirection at the goal, or if
+		// the goal can't be reached)
+		Uint8 getDirection(Sint32 x, Sint32 y) const {
+			if( x < 0 || y < 0 || x >= width || y >= height ) {
+				return noDirection;
+			}
+			return dir[y + x * height];
+		}
+	};
+
+	// getters & setters
+	Uint32		getNumFields() const			{ return fields.getSize(); }
+	Uint32		getNumBuilds() const			{ return numBuilds; }
+	Uint32		getNumRebases() const			{ return numRebases; }
+	Uint32		getNumHits() const				{ return numHits; }
+	Uint32		getMemoryUsage() const;
+
+	// finds the field leading to a goal, building it (or shifting a nearby one) if needed
+	// @param pathFinder the pathfinder whose map is followed
+	// @param goalX the goal x coordinate (in tiles)
+	// @param goalY the goal y coordinate (in tiles)
+	// @param tick the current world tick, used to pick which field to throw out
+	// @return the field, or nullptr if the goal is out of bounds or solid
+	const field_t* find(PathFinder& pathFinder, Sint32 goalX, Sint32 goalY, Uint32 tick);
+
+	// finds the next tile to step to on the way to a goal
+	// @param pathFinder the pathfinder whose map is followed
+	// @param goalX the goal x coordinate (in tiles)
+	// @param goalY the goal y coordinate (in tiles)
+	// @param x the current x coordinate (in tiles)
+	// @param y the current y coordinate (in tiles)
+	// @param tick the current world tick
+	// @param outX receives the x coordinate of the next tile
+	// @param outY receives the y coordinate of the next tile
+	// @return false if already at the goal, or the goal can't be reached from here
+	bool step(PathFinder& pathFinder, Sint32 goalX, Sint32 goalY, Sint32 x, Sint32 y, Uint32 tick, Sint32& outX, Sint32& outY);
+
+	// throws away every field
+	void clear();
+
+	// fills a field from scratch
+	// @param map the walkable tiles
+	// @param goal the goal tile
+	// @param field the field to fill
+	static void build(const NavGrid& map, Uint32 goal, field_t& field);
+
+	// moves a field to a new goal it already reaches, redoing only the tiles that get cheaper
+	// @param map the walkable tiles
+	// @param goal the new goal tile
+	// @param field the field to move
+	// @return the number of times a tile was lowered
+	static Uint32 rebase(const NavGrid& map, Uint32 goal, field_t& field);
+
+private:
+	HashMap<Uint32, field_t*> fields;
+	Uint32 version = 0;
+	Uint32 numBuilds = 0;
+	Uint32 numRebases = 0;
+	Uint32 numHits = 0;
+
+	// runs Dijkstra from the tiles in the heap, lowering costs and pointing each tile lowered
+	// at the tile that lowered it
+	// @return the number of times a tile was lowered
+	static Uint32 propagate(const NavGrid& map, field_t& field, ArrayList<Uint64>& heap);
+
+	// points a tile at its cheapest neighbor
+	static void updateDirection(const NavGrid& map, field_t& field, Uint32 tile);
+
+	// throws out the least recently used field
+	void evict();
+};
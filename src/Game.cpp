@@ -9,6 +9,11 @@
 #include "Game.hpp"
 #include "Tile.hpp"
 #include "Generator.hpp"
+#include "Server.hpp"
+
+#include <chrono>
+
+static Cvar cvar_concurrentWorlds("game.concurrentworlds", "process each world on its own worker thread", "0");
 
 Game::Game() {
 }
@@ -35,9 +40,8 @@ void Game::init() {
 }
 
 void Game::incrementFrame() {
-	if( framesToRun < 4 ) {
-		++framesToRun;
-	}
+	// the engine's scheduler already caps how many frames come due at once
+	++framesToRun;
 }
 
 World* Game::loadWorld(const char* filename, bool buildPath) {
@@ -152,10 +156,45 @@ void Game::preProcess() {
 void Game::process() {
 	for( Uint32 frame=0; frame<framesToRun; ++frame ) {
 		// process worlds
-		for( Node<World*>* node=worlds.getFirst(); node!=nullptr; node=node->getNext() ) {
-			World* world = node->getData();
+		if( cvar_concurrentWorlds.toInt() && worlds.getSize() > 1 ) {
+			worldList.clearKeepCapacity();
+			for( auto world : worlds ) {
+				worldList.push(world);
+			}
+			processWorlds(worldList, true);
+		} else {
+			for( Node<World*>* node=worlds.getFirst(); node!=nullptr; node=node->getNext() ) {
+				World* world = node->getData();
+				world->process();
+			}
+		}
+	}
+}
+
+void Game::processWorlds(ArrayList<World*>& list, bool concurrent) {
+	if( !concurrent ) {
+		for( auto world : list ) {
 			world->process();
 		}
+		return;
+	}
+
+	// step every world on its own thread
+	for( auto world : list ) {
+		world->setConcurrent(true);
+	}
+	mainEngine->getThreadPool().run(list.getSize(), list.getSize(), [&list](Uint32 slice, Uint32 begin, Uint32 end) {
+		for( Uint32 c = begin; c < end; ++c ) {
+			list[c]->process();
+		}
+	});
+
+	// merge phase
+	for( auto world : list ) {
+		world->setConcurrent(false);
+	}
+	for( auto world : list ) {
+		world->merge();
 	}
 }
 
@@ -199,4 +238,169 @@ int Game::numLocalPlayers() const {
 		}
 	}
 	return result;
-}
\ No newline at end of file
+}
+
+static int console_worldScaling(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"world.scaling needs a running server.");
+		return 1;
+	}
+
+	Uint32 numEntities = 2000;
+	Uint32 numTicks = 60;
+	if( argc >= 1 ) {
+		numEntities = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		numTicks = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+
+	// concurrent worlds run inline without workers, so both timings would be the same
+	Uint32 numWorkers = mainEngine->getThreadPool().getNumWorkers();
+	mainEngine->fmsg(Engine::MSG_INFO,"%u ticks per run, %u worker threads:", numTicks, numWorkers);
+	if( numWorkers == 0 ) {
+		mainEngine->fmsg(Engine::MSG_WARN,"world.scaling: the thread pool has no workers, so concurrent stepping can't be faster here.");
+	}
+
+	const Uint32 counts[] = { 1, 4, 16 };
+	double baseline = 0.0;
+	for( auto count : counts ) {
+		// build scratch worlds that the server itself doesn't know about
+		ArrayList<World*> list;
+		for( Uint32 c = 0; c < count; ++c ) {
+			TileWorld* world = new TileWorld(server, true, UINT32_MAX - c, Tile::SIDE_EAST, "", 64, 64, "Scaling Test");
+			world->initialize(true);
+			Random& rand = mainEngine->getRandom();
+			for( Uint32 i = 0; i < numEntities; ++i ) {
+				Entity* entity = new Entity(world);
+				entity->setPos(Vector(rand.getFloat() * 64.f * Tile::size, rand.getFloat() * 64.f * Tile::size, 0.f));
+				entity->setVel(Vector(rand.getFloat() * 8.f - 4.f, rand.getFloat() * 8.f - 4.f, 0.f));
+				entity->setFlag(static_cast<Uint32>(Entity::FLAG_LOCAL));
+				entity->addComponent<Component>();
+			}
+			list.push(world);
+		}
+
+		// time both ways
+		double times[2];
+		for( int concurrent = 0; concurrent < 2; ++concurrent ) {
+			auto start = std::chrono::steady_clock::now();
+			for( Uint32 tick = 0; tick < numTicks; ++tick ) {
+				Game::processWorlds(list, concurrent != 0);
+			}
+			std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+			times[concurrent] = time.count() / numTicks;
+		}
+		if( count == 1 ) {
+			baseline = times[0];
+		}
+
+		mainEngine->fmsg(Engine::MSG_INFO,"%u world(s) x %u entities: serial %.3f ms/tick, concurrent %.3f ms/tick (%.2fx speedup, %.2fx the cost of one world)",
+			count, numEntities, times[0], times[1], times[1] > 0.0 ? times[0] / times[1] : 0.0, baseline > 0.0 ? times[1] / baseline : 0.0);
+
+		for( auto world : list ) {
+			delete world;
+		}
+	}
+
+	return 0;
+}
+
+static Ccmd ccmd_worldScaling("world.scaling","times serial vs concurrent processing of 1/4/16 worlds on the local server (args: entities per world, tick count)",&console_worldScaling);
+
+static int console_transformBenchmark(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"transform.benchmark needs a running server.");
+		return 1;
+	}
+
+	Uint32 numCharacters = 200;
+	Uint32 numBones = 32;
+	Uint32 numRounds = 60;
+	if( argc >= 1 ) {
+		numCharacters = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		numBones = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+	if( argc >= 3 ) {
+		numRounds = std::max(1, (int)strtol(argv[2], nullptr, 10));
+	}
+
+	// each character is a chain of bones, and every bone holds an attachment
+	TileWorld* world = new TileWorld(server, true, UINT32_MAX, Tile::SIDE_EAST, "", 32, 32, "Transform Test");
+	world->initialize(true);
+	Random& rand = mainEngine->getRandom();
+	ArrayList<Entity*> characters;
+	ArrayList<Component*> bones;
+	for( Uint32 i = 0; i < numCharacters; ++i ) {
+		Entity* entity = new Entity(world);
+		entity->setPos(Vector(rand.getFloat() * 32.f * Tile::size, rand.getFloat() * 32.f * Tile::size, 0.f));
+		entity->setFlag(static_cast<Uint32>(Entity::FLAG_LOCAL));
+		Component* bone = entity->addComponent<Component>();
+		for( Uint32 c = 0; c < numBones; ++c ) {
+			bone->setLocalPos(Vector(0.f, 0.f, 4.f));
+			bone->setLocalAng(Angle(rand.getFloat(), rand.getFloat(), 0.f));
+			Component* attachment = bone->addComponent<Component>();
+			attachment->setLocalPos(Vector(2.f, 0.f, 0.f));
+			bones.push(bone);
+			if( c + 1 < numBones ) {
+				bone = bone->addComponent<Component>();
+			}
+		}
+		entity->update();
+		characters.push(entity);
+	}
+	const Uint32 numNodes = bones.getSize() * 2;
+
+	// 1. every character moves, every local matrix rebuilt (what each update used to cost)
+	auto start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < numRounds; ++round ) {
+		for( auto bone : bones ) {
+			bone->setLocalAng(bone->getLocalAng());
+			bone->getComponents()[0]->setLocalPos(bone->getComponents()[0]->getLocalPos());
+		}
+		for( auto entity : characters ) {
+			entity->setPos(entity->getPos() + Vector((round & 1) ? -1.f : 1.f, 0.f, 0.f));
+			entity->update();
+		}
+	}
+	std::chrono::duration<double, std::milli> rebuildTime = std::chrono::steady_clock::now() - start;
+
+	// 2. every character moves, local matrices reused
+	start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < numRounds; ++round ) {
+		for( auto entity : characters ) {
+			entity->setPos(entity->getPos() + Vector((round & 1) ? -1.f : 1.f, 0.f, 0.f));
+			entity->update();
+		}
+	}
+	std::chrono::duration<double, std::milli> rootTime = std::chrono::steady_clock::now() - start;
+
+	// 3. one bone halfway down each chain moves; only its subtree is recomputed
+	start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < numRounds; ++round ) {
+		for( Uint32 i = 0; i < numCharacters; ++i ) {
+			Component* bone = bones[i * numBones + numBones / 2];
+			Angle ang = bone->getLocalAng();
+			ang.roll += (round & 1) ? -.1f : .1f;
+			bone->setLocalAng(ang);
+			bone->update();
+		}
+	}
+	std::chrono::duration<double, std::milli> boneTime = std::chrono::steady_clock::now() - start;
+
+	mainEngine->fmsg(Engine::MSG_INFO,"%u characters x %u bones (%u nodes), %u rounds:", numCharacters, numBones, numNodes, numRounds);
+	mainEngine->fmsg(Engine::MSG_INFO,"  all moved, locals rebuilt: %.3f ms/round", rebuildTime.count() / numRounds);
+	mainEngine->fmsg(Engine::MSG_INFO,"  all moved, locals reused:  %.3f ms/round (%.2fx)", rootTime.count() / numRounds,
+		rootTime.count() > 0.0 ? rebuildTime.count() / rootTime.count() : 0.0);
+	mainEngine->fmsg(Engine::MSG_INFO,"  one bone moved each:       %.3f ms/round (%.2fx)", boneTime.count() / numRounds,
+		boneTime.count() > 0.0 ? rebuildTime.count() / boneTime.count() : 0.0);
+
+	delete world;
+	return 0;
+}
+
+static Ccmd ccmd_transformBenchmark("transform.benchmark","times transform hierarchy updates on deep component trees (args: characters, bones per character, rounds)",&console_transformBenchmark);
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "LinkedList.hpp"
+#include "ArrayList.hpp"
 #include "Player.hpp"
 #include "Net.hpp"
 
@@ -99,6 +100,13 @@ public:
 	// @return the number of local players
 	int numLocalPlayers() const;
 
+	// processes a set of worlds, either one after another or each on its own worker thread.
+	// concurrent worlds hold back anything that crosses worlds (level transfers, broadcasts)
+	// and finish it afterwards on this thread, in list order
+	// @param list the worlds to process
+	// @param concurrent if true, process the worlds concurrently
+	static void processWorlds(ArrayList<World*>& list, bool concurrent);
+
 protected:
 	// sets up the game
 	virtual void init();
@@ -114,6 +122,7 @@ protected:
 
 	LinkedList<Player> players;
 	LinkedList<World*> worlds;
+	ArrayList<World*> worldList;	// scratch list for processWorlds()
 	Uint32 ticks=0;
 	Uint32 framesToRun=0;
 	bool suicide=false; // if a game wants to end itself, setting this flag is the way to do it.
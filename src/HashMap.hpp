@@ -0,0 +1,443 @@
+// HashMap.hpp
+// Flat key/value hash map (open addressing, Robin Hood probing)
+
+#pragma once
+
+#include "Main.hpp"
+#include "Pair.hpp"
+#include "File.hpp"
+#include "String.hpp"
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include <luajit-2.0/lua.hpp>
+#include <LuaBridge/LuaBridge.h>
+
+// templated HashMap (drop-in for Map where lookups are hot)
+// all pairs live in one flat array. a collision probes forward to the next slot,
+// and entries that are further from home steal slots from entries that are closer
+// (Robin Hood), which keeps probe lengths short and lets misses stop early.
+// String keys can be looked up directly with a const char* without building a String.
+// inserting or removing can move pairs around, so don't hold pointers across those.
+// @param K key type (String, StringBuf, or an integer type)
+// @param T value type
+template <typename K, typename T>
+class HashMap {
+public:
+	HashMap() {
+	}
+
+	HashMap(const HashMap& src) {
+		copy(src);
+	}
+
+	~HashMap() {
+		reset();
+	}
+
+	// getters & setters
+	Uint32		getSize() const				{ return size; }
+	Uint32		getCapacity() const			{ return capacity; }
+	bool		empty() const				{ return size == 0; }
+
+	// clears the map of all key/value pairs, but keeps its storage
+	void clear() {
+		for( Uint32 c = 0; c < capacity; ++c ) {
+			if( slots[c].probe ) {
+				pairs[c].~OrderedPair<K, T>();
+				slots[c].probe = 0;
+			}
+		}
+		size = 0;
+	}
+
+	// not only clears the map, but also frees its storage
+	void reset() {
+		clear();
+		if( slots ) {
+			delete[] slots;
+			slots = nullptr;
+		}
+		if( pairs ) {
+			::operator delete(pairs);
+			pairs = nullptr;
+		}
+		capacity = 0;
+	}
+
+	// makes room for the given number of pairs so that inserting them will not rehash
+	// @param count The number of pairs the map should be able to hold
+	void reserve(Uint32 count) {
+		Uint32 newCapacity = minCapacity;
+		while( count * maxLoadDen > newCapacity * maxLoadNum ) {
+			newCapacity *= 2;
+		}
+		if( newCapacity > capacity ) {
+			rehash(newCapacity);
+		}
+	}
+
+	// inserts a key/value pair into the map
+	// @param key The key
+	// @param value The value associated with the key
+	void insert(const K& key, const T& value) {
+		Uint32 h = hash(key);
+		T* oldValue = findHashed(key, h);
+		if( oldValue ) {
+			*oldValue = value;
+			return;
+		}
+		if( (size + 1) * maxLoadDen > capacity * maxLoadNum ) {
+			rehash(capacity ? capacity * 2 : minCapacity);
+		}
+		place(h, OrderedPair<K, T>(key, value));
+	}
+
+	// resize and rebuild the hash map
+	// @param newCapacity Updated number of slots in the map (must be a power of two)
+	void rehash(Uint32 newCapacity) {
+		assert((newCapacity & (newCapacity - 1)) == 0);
+		if( newCapacity < minCapacity ) {
+			newCapacity = minCapacity;
+		}
+		while( size * maxLoadDen > newCapacity * maxLoadNum ) {
+			newCapacity *= 2;
+		}
+
+		slot_t* oldSlots = slots;
+		OrderedPair<K, T>* oldPairs = pairs;
+		Uint32 oldCapacity = capacity;
+
+		slots = new slot_t[newCapacity];
+		pairs = static_cast<OrderedPair<K, T>*>(::operator new(sizeof(OrderedPair<K, T>) * newCapacity));
+		capacity = newCapacity;
+		size = 0;
+
+		for( Uint32 c = 0; c < oldCapacity; ++c ) {
+			if( oldSlots[c].probe ) {
+				place(oldSlots[c].hash, std::move(oldPairs[c]));
+				oldPairs[c].~OrderedPair<K, T>();
+			}
+		}
+		if( oldSlots ) {
+			delete[] oldSlots;
+		}
+		if( oldPairs ) {
+			::operator delete(oldPairs);
+		}
+	}
+
+	// determine if the key with the given name exists
+	// @return true if key/value pair exists, false otherwise
+	template <typename Q>
+	bool exists(const Q& key) const {
+		return findIndex(key, hash(key)) != npos;
+	}
+
+	// removes a key/value pair from the map
+	// @param key The key
+	// @return true if the key/value pair was removed, otherwise false
+	template <typename Q>
+	bool remove(const Q& key) {
+		Uint32 index = findIndex(key, hash(key));
+		if( index == npos ) {
+			return false;
+		}
+
+		// shift the rest of the cluster back a slot, so no tombstones are needed
+		Uint32 mask = capacity - 1;
+		pairs[index].~OrderedPair<K, T>();
+		Uint32 next = (index + 1) & mask;
+		while( slots[next].probe > 1 ) {
+			new (&pairs[index]) OrderedPair<K, T>(std::move(pairs[next]));
+			pairs[next].~OrderedPair<K, T>();
+			slots[index].hash = slots[next].hash;
+			slots[index].probe = slots[next].probe - 1;
+			index = next;
+			next = (next + 1) & mask;
+		}
+		slots[index].probe = 0;
+		--size;
+		return true;
+	}
+
+	// find the key/value pair with the given name
+	// @param key The name of the pair to find (for String keys, a const char* will do)
+	// @return the value associated with the key, or nullptr if it could not be found
+	template <typename Q>
+	T* find(const Q& key) {
+		return findHashed(key, hash(key));
+	}
+	template <typename Q>
+	const T* find(const Q& key) const {
+		Uint32 index = findIndex(key, hash(key));
+		return index != npos ? &pairs[index].b : nullptr;
+	}
+
+	// replace the contents of this map with those of another
+	// @param src The map to copy
+	void copy(const HashMap<K, T>& src) {
+		if( &src == this ) {
+			return;
+		}
+		clear();
+		reserve(src.getSize());
+		for( auto& pair : src ) {
+			insert(pair.a, pair.b);
+		}
+	}
+
+	// save/load this object to a file
+	// @param file interface to serialize with
+	void serialize(FileInterface * file) {
+		if (file->isReading()) {
+			Uint32 keyCount = 0;
+			file->propertyName("data");
+			file->beginArray(keyCount);
+			reserve(size + keyCount);
+			for( Uint32 c = 0; c < keyCount; ++c ) {
+				K key;
+				T value;
+
+				file->beginObject();
+				file->property("key", key);
+				file->property("value", value);
+				file->endObject();
+
+				insert(key, value);
+			}
+			file->endArray();
+		} else {
+			Uint32 keyCount = size;
+
+			file->propertyName("data");
+			file->beginArray(keyCount);
+			for( auto& pair : *this ) {
+				file->beginObject();
+				file->property("key", pair.a);
+				file->property("value", pair.b);
+				file->endObject();
+			}
+			file->endArray();
+		}
+	}
+
+	// find the key/value pair with the given name
+	// @param key The name of the pair to find
+	// @return the value associated with the key
+	template <typename Q>
+	T* operator[](const Q& key) {
+		return find(key);
+	}
+	template <typename Q>
+	const T* operator[](const Q& key) const {
+		return find(key);
+	}
+
+	// replace the contents of this map with those of another
+	// @param src The map to copy
+	HashMap<K, T>& operator=(const HashMap<K, T>& src) {
+		copy(src);
+		return *this;
+	}
+
+	// Iterator
+	class Iterator {
+	public:
+		Iterator(HashMap<K, T>& _map, Uint32 _position) :
+			map(_map),
+			position(_position) { skip(); }
+
+		OrderedPair<K, T>& operator*() {
+			assert(position < map.capacity);
+			return map.pairs[position];
+		}
+		Iterator& operator++() {
+			++position;
+			skip();
+			return *this;
+		}
+		bool operator!=(const Iterator& it) const {
+			return position != it.position;
+		}
+	private:
+		void skip() {
+			while( position < map.capacity && !map.slots[position].probe ) {
+				++position;
+			}
+		}
+		HashMap<K, T>& map;
+		Uint32 position;
+	};
+
+	// ConstIterator
+	class ConstIterator {
+	public:
+		ConstIterator(const HashMap<K, T>& _map, Uint32 _position) :
+			map(_map),
+			position(_position) { skip(); }
+
+		const OrderedPair<K, T>& operator*() const {
+			assert(position < map.capacity);
+			return map.pairs[position];
+		}
+		ConstIterator& operator++() {
+			++position;
+			skip();
+			return *this;
+		}
+		bool operator!=(const ConstIterator& it) const {
+			return position != it.position;
+		}
+	private:
+		void skip() {
+			while( position < map.capacity && !map.slots[position].probe ) {
+				++position;
+			}
+		}
+		const HashMap<K, T>& map;
+		Uint32 position;
+	};
+
+	// begin()
+	Iterator begin() {
+		return Iterator(*this, 0);
+	}
+	const ConstIterator begin() const {
+		return ConstIterator(*this, 0);
+	}
+
+	// end()
+	Iterator end() {
+		return Iterator(*this, capacity);
+	}
+	const ConstIterator end() const {
+		return ConstIterator(*this, capacity);
+	}
+
+	// exposes this map type to a script
+	// @param lua The script engine to expose to
+	// @param name The type name in lua
+	static void exposeToScript(lua_State* lua, const char* name) {
+		typedef bool (HashMap<K, T>::*ExistsFn)(const K&) const;
+		ExistsFn exists = static_cast<ExistsFn>(&HashMap<K, T>::template exists<K>);
+
+		typedef bool (HashMap<K, T>::*RemoveFn)(const K&);
+		RemoveFn remove = static_cast<RemoveFn>(&HashMap<K, T>::template remove<K>);
+
+		luabridge::getGlobalNamespace(lua)
+			.beginClass<HashMap<K, T>>(name)
+			.addConstructor<void (*)()>()
+			.addFunction("getSize", &HashMap<K, T>::getSize)
+			.addFunction("getCapacity", &HashMap<K, T>::getCapacity)
+			.addFunction("empty", &HashMap<K, T>::empty)
+			.addFunction("clear", &HashMap<K, T>::clear)
+			.addFunction("reserve", &HashMap<K, T>::reserve)
+			.addFunction("insert", &HashMap<K, T>::insert)
+			.addFunction("exists", exists)
+			.addFunction("remove", remove)
+			.endClass()
+		;
+	}
+
+private:
+	static const Uint32 npos = UINT32_MAX;
+	static const Uint32 minCapacity = 8;
+	static const Uint32 maxLoadNum = 7;	// rehash past 7/8 full
+	static const Uint32 maxLoadDen = 8;
+
+	struct slot_t {
+		Uint32 hash = 0;	// cached key hash
+		Uint32 probe = 0;	// distance from home slot + 1, or 0 if the slot is empty
+	};
+
+	slot_t* slots = nullptr;				// slot metadata
+	OrderedPair<K, T>* pairs = nullptr;		// key/value storage, constructed only where slots are in use
+	Uint32 capacity = 0;					// number of slots (zero or a power of two)
+	Uint32 size = 0;						// number of pairs
+
+	// puts a pair that is known not to be in the map into its slot
+	void place(Uint32 h, OrderedPair<K, T>&& pair) {
+		Uint32 mask = capacity - 1;
+		Uint32 index = h & mask;
+		Uint32 probe = 1;
+		OrderedPair<K, T> carried(std::move(pair));
+		for( ;; ) {
+			slot_t& slot = slots[index];
+			if( !slot.probe ) {
+				new (&pairs[index]) OrderedPair<K, T>(std::move(carried));
+				slot.hash = h;
+				slot.probe = probe;
+				++size;
+				return;
+			}
+			if( slot.probe < probe ) {
+				// the resident is closer to home than we are, so it moves on instead
+				std::swap(h, slot.hash);
+				std::swap(probe, slot.probe);
+				std::swap(carried, pairs[index]);
+			}
+			index = (index + 1) & mask;
+			++probe;
+		}
+	}
+
+	template <typename Q>
+	Uint32 findIndex(const Q& key, Uint32 h) const {
+		if( !size ) {
+			return npos;
+		}
+		Uint32 mask = capacity - 1;
+		Uint32 index = h & mask;
+		for( Uint32 probe = 1; ; ++probe ) {
+			const slot_t& slot = slots[index];
+			if( slot.probe < probe ) {
+				// empty, or a richer entry: ours would have been placed before it
+				return npos;
+			}
+			if( slot.hash == h && pairs[index].a == key ) {
+				return index;
+			}
+			index = (index + 1) & mask;
+		}
+	}
+
+	template <typename Q>
+	T* findHashed(const Q& key, Uint32 h) {
+		Uint32 index = findIndex(key, h);
+		return index != npos ? &pairs[index].b : nullptr;
+	}
+
+	template <typename KK>
+	static typename std::enable_if<std::is_class<KK>::value, Uint32>::type
+	hash(const KK& key) {
+		return static_cast<Uint32>(key.hash());
+	}
+	static Uint32 hash(const char* key) {
+		return static_cast<Uint32>(String::hash(key));
+	}
+	static Uint32 hash(Sint32 key) {
+		return mix(static_cast<Uint32>(key));
+	}
+	static Uint32 hash(Uint32 key) {
+		return mix(key);
+	}
+	static Uint32 hash(Uint64 key) {
+		return mix(static_cast<Uint32>(key) ^ mix(static_cast<Uint32>(key >> 32)));
+	}
+	static Uint32 hash(bool key) {
+		return key ? 1 : 0;
+	}
+
+	// spreads sequential integers (eg uids) across the table
+	static Uint32 mix(Uint32 key) {
+		key ^= key >> 16;
+		key *= 0x7feb352d;
+		key ^= key >> 15;
+		key *= 0x846ca68b;
+		key ^= key >> 16;
+		return key;
+	}
+};
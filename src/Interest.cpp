@@ -0,0 +1,96 @@
+// Interest.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Interest.hpp"
+#include "Entity.hpp"
+#include "Player.hpp"
+#include "Camera.hpp"
+#include "World.hpp"
+
+static Cvar cvar_interest("server.interest", "if 0, every client hears about every entity", "1");
+static Cvar cvar_interestRadius("server.interest.radius", "distance from a player inside which entities are always sent", "1024");
+static Cvar cvar_interestAccuracy("server.interest.accuracy", "occlusion accuracy for the chunks a player's camera can see (see render.cull)", "3");
+static Cvar cvar_interestLinger("server.interest.linger", "seconds an entity is still sent after it stops being of interest", "1");
+
+void Interest::begin(Uint32 _tick) {
+	tick = _tick;
+	viewers.clearKeepCapacity();
+}
+
+void Interest::addPlayer(Player& player) {
+	Entity* entity = player.getEntity();
+	if( !entity || !entity->getWorld() ) {
+		return;
+	}
+
+	viewer_t viewer;
+	viewer.world = entity->getWorld();
+	viewer.pos = entity->getPos();
+
+	// the camera's chunks are only worked out when drawing, which a server never does
+	Camera* camera = player.getCamera();
+	if( camera && viewer.world->getType() == World::WORLD_TILES ) {
+		camera->occlusionTest(camera->getClipFar(), cvar_interestAccuracy.toInt());
+		viewer.camera = camera;
+	}
+	viewers.push(viewer);
+}
+
+bool Interest::isRelevant(Entity& entity, float& outDistance) {
+	++numConsidered;
+
+	World* world = entity.getWorld();
+	const float radius = cvar_interestRadius.toFloat();
+	const bool enabled = cvar_interest.toInt() != 0;
+	bool relevant = !enabled;
+	float nearest = -1.f;
+	for( auto& viewer : viewers ) {
+		if( viewer.world != world ) {
+			continue;
+		}
+		const float distSquared = (entity.getPos() - viewer.pos).lengthSquared();
+		if( nearest < 0.f || distSquared < nearest ) {
+			nearest = distSquared;
+		}
+		if( relevant ) {
+			continue;
+		}
+		if( entity.getPlayer() ) {
+			relevant = true;
+		} else if( radius > 0.f && distSquared <= radius * radius ) {
+			relevant = true;
+		} else if( viewer.camera && viewer.camera->seesEntity(entity, viewer.camera->getClipFar(), cvar_interestAccuracy.toInt()) ) {
+			relevant = true;
+		}
+	}
+	outDistance = nearest > 0.f ? sqrtf(nearest) : 0.f;
+	if( !enabled ) {
+		++numRelevant;
+		return true;
+	}
+
+	const Uint64 key = world ? ((Uint64)world->getID() << 32) | entity.getUID() : entity.getUID();
+	if( relevant ) {
+		lastRelevant.insert(key, tick);
+	} else {
+		const Uint32* last = lastRelevant.find(key);
+		const Uint32 linger = (Uint32)(cvar_interestLinger.toFloat() * mainEngine->getTicksPerSecond());
+		relevant = last && tick - *last <= linger;
+	}
+	numRelevant += relevant ? 1 : 0;
+	return relevant;
+}
+
+void Interest::end() {
+	const Uint32 linger = (Uint32)(cvar_interestLinger.toFloat() * mainEngine->getTicksPerSecond());
+	ArrayList<Uint64> expired;
+	for( auto& pair : lastRelevant ) {
+		if( tick - pair.b > linger ) {
+			expired.push(pair.a);
+		}
+	}
+	for( auto key : expired ) {
+		lastRelevant.remove(key);
+	}
+}
@@ -0,0 +1,64 @@
+// Interest.hpp
+// Picks which entities a client needs to hear about
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+#include "Vector.hpp"
+
+class World;
+class Entity;
+class Player;
+class Camera;
+
+// a client only hears about entities in a world where it has a player, and there only about
+// the ones within a radius of one of its players or in a chunk one of their cameras can see
+// (tile worlds only; other worlds go by the radius). entities carrying a player are always of
+// interest to anyone in the same world. entities stay of interest for a moment after they stop
+// qualifying, so something walking along the edge of view doesn't flicker in and out. once an
+// entity leaves the set it drops out of the client's snapshots, which tells the client to
+// despawn it; coming back in sends its full state again.
+class Interest {
+public:
+	Interest() {}
+	~Interest() {}
+
+	// getters & setters
+	Uint32		getNumConsidered() const		{ return numConsidered; }
+	Uint32		getNumRelevant() const			{ return numRelevant; }
+
+	// starts a round of isRelevant() calls
+	// @param tick the current tick
+	void begin(Uint32 tick);
+
+	// adds one of the client's players as a point of view
+	// @param player the player
+	void addPlayer(Player& player);
+
+	// @param entity the entity to test
+	// @param outDistance receives the distance to the nearest of the client's players in the
+	// entity's world (0 if there are none)
+	// @return true if the client should hear about the entity
+	bool isRelevant(Entity& entity, float& outDistance);
+
+	// forgets entities that stopped being of interest long enough ago
+	void end();
+
+	// zeroes the counters
+	void resetStats()					{ numConsidered = 0; numRelevant = 0; }
+
+private:
+	struct viewer_t {
+		World* world = nullptr;
+		Vector pos;
+		Camera* camera = nullptr;			// only set in tile worlds
+	};
+
+	ArrayList<viewer_t> viewers;
+	HashMap<Uint64, Uint32> lastRelevant;	// entity (world and uid) -> tick it last qualified
+	Uint32 tick = 0;
+	Uint32 numConsidered = 0;				// entities tested since the last reset
+	Uint32 numRelevant = 0;					// of those, entities that were of interest
+};
@@ -64,11 +64,14 @@ static Cvar cvar_lightCull("light.cull", "accuracy for lights' occlusion culling
 
 void Light::update() {
 	Component::update();
+	queueUpdateShared();
+}
 
+void Light::updateShared() {
 	// occlusion test
 	World* world = entity->getWorld();
 	if( world && world->isLoaded() ) {
-		if( lastUpdate != entity->getTicks() || !chunksVisible ) {
+		if( lastUpdate != entity->getTicks() || !visValid ) {
 			occlusionTest(radius, cvar_lightCull.toInt());
 			lastUpdate = entity->getTicks();
 		}
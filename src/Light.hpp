@@ -64,6 +64,9 @@ public:
 	// updates matrices
 	virtual void update() override;
 
+	// runs the occlusion test
+	virtual void updateShared() override;
+
 	// draws the light as a bounded cube (generally for editing purposes)
 	// @param camera the camera to draw the light from
 	// @param light the light to light the light with (whew) (unused)
@@ -4,6 +4,7 @@
 
 #include "Main.hpp"
 #include "Node.hpp"
+#include "NodePool.hpp"
 
 #include <luajit-2.0/lua.hpp>
 #include <LuaBridge/LuaBridge.h>
@@ -84,7 +85,7 @@ public:
 	Node<T>* addNode(const Uint32 index, const T& data) {
 		Node<T>* node = nodeForIndex(index);
 		++size;
-		return new Node<T>(*this,node,data);
+		return new (NodePool<Node<T>>::take()) Node<T>(*this,node,data);
 	}
 
 	// adds a node to the beginning of the list
@@ -92,7 +93,7 @@ public:
 	// @return the newly created Node
 	Node<T>* addNodeFirst(const T& data) {
 		++size;
-		return new Node<T>(*this,first,data);
+		return new (NodePool<Node<T>>::take()) Node<T>(*this,first,data);
 	}
 
 	// adds a node to the end of the list
@@ -100,35 +101,38 @@ public:
 	// @return the newly created Node
 	Node<T>* addNodeLast(const T& data) {
 		++size;
-		return new Node<T>(*this,nullptr,data);
+		return new (NodePool<Node<T>>::take()) Node<T>(*this,nullptr,data);
 	}
 
-	// removes a node from the list
+	// links a hook node (see Node(const T&)) into the list. if the node is already in a
+	// list it is unlinked from that one first, so moving a hook between lists is O(1)
+	// and never allocates
+	// @param node the node to link
+	// @param next the node to insert before, or nullptr to insert at the end
+	void linkNode(Node<T>* node, Node<T>* next) {
+		assert(node->isHook());
+		if( node->getList() ) {
+			node->getList()->detachNode(node);
+		}
+		node->link(*this,next);
+		++size;
+	}
+
+	// links a hook node to the end of the list
+	// @param node the node to link
+	void linkNodeLast(Node<T>* node) {
+		linkNode(node,nullptr);
+	}
+
+	// removes a node from the list. hook nodes are only unlinked, everything else is freed
 	// @param node the node to remove from the list
 	void removeNode(Node<T>* node) {
 		if( this != node->getList() )
 		{
 			return;
 		}
-
-		if( node == first ) {
-			if( node == getLast() ) {
-				first = nullptr;
-				last = nullptr;
-			} else {
-				node->getNext()->setPrev(nullptr);
-				first = node->getNext();
-			}
-		} else if( node == last ) {
-			node->getPrev()->setNext(nullptr);
-			last = node->getPrev();
-		} else {
-			node->getPrev()->setNext(node->getNext());
-			node->getNext()->setPrev(node->getPrev());
-		}
-
-		--size;
-		delete node;
+		detachNode(node);
+		freeNode(node);
 	}
 
 	// removes a node from the list
@@ -144,7 +148,13 @@ public:
 
 		for( node=first; node!=nullptr; node=nextnode ) {
 			nextnode = node->getNext();
-			delete node;
+			if( node->isHook() ) {
+				node->next = nullptr;
+				node->prev = nullptr;
+				node->list = nullptr;
+			} else {
+				freeNode(node);
+			}
 		}
 		first = nullptr;
 		last = nullptr;
@@ -310,6 +320,22 @@ private:
 	Node<T>* last	= nullptr;
 	Uint32 size = 0;
 
+	// unlinks a node from the list without freeing it
+	// @param node the node to unlink
+	void detachNode(Node<T>* node) {
+		node->unlink();
+		--size;
+	}
+
+	// returns a node's storage to the pool (hooks belong to someone else and are left alone)
+	// @param node the node to free
+	void freeNode(Node<T>* node) {
+		if( !node->isHook() ) {
+			node->~Node<T>();
+			NodePool<Node<T>>::give(node);
+		}
+	}
+
 	LinkedList<T>& merge(LinkedList<T>& left, LinkedList<T>& right) {
 		LinkedList<T> result;
 
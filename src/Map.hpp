@@ -276,8 +276,9 @@ private:
 	Uint32 numBuckets = 4;
 	Uint32 size = 0;
 	
-	typename std::enable_if<std::is_class<K>::value, unsigned long>::type
-	hash(const K& key) const {
+	template <typename KK = K>
+	typename std::enable_if<std::is_class<KK>::value, unsigned long>::type
+	hash(const KK& key) const {
 		return key.hash();
 	}
 	unsigned long hash(Sint32 key) const {
@@ -0,0 +1,220 @@
+// Message.hpp
+// Packet types as numbers, a table of handlers by type, and readers for fixed-layout messages
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+#include "Packet.hpp"
+
+#include <chrono>
+
+// packs a 4 char packet type into a number, the same way whether it comes from a string
+// literal (at compile time) or from the bytes of a packet
+// @param type the 4 chars
+// @return the packed type
+constexpr Uint32 fourcc(const char* type) {
+	return (Uint32)(Uint8)type[0] |
+		((Uint32)(Uint8)type[1] << 8) |
+		((Uint32)(Uint8)type[2] << 16) |
+		((Uint32)(Uint8)type[3] << 24);
+}
+
+// maps packet types to the member function that handles them. each Game subtype registers
+// its own handlers once, and dispatching a packet is a single hash lookup instead of a
+// strncmp() against every type in turn. the packets most recently dispatched are kept, so a
+// benchmark can replay a real stream of them.
+// @param T the class whose member functions handle the messages
+template <typename T>
+class MessageRegistry {
+public:
+	// @param packet the packet, with its signature and type already read
+	// @param remoteID the remote host that sent it
+	typedef void (T::*handler_t)(Packet& packet, Uint32 remoteID);
+
+	// reads the fixed fields of a message without acting on them (see MESSAGE())
+	// @param packet the packet, with its signature and type already read
+	// @return true if the packet held them
+	typedef bool (*reader_t)(Packet& packet);
+
+	// number of dispatched packets remembered for benchmark()
+	static const Uint32 maxRecent = 1024;
+
+	MessageRegistry() {}
+	~MessageRegistry() {}
+
+	// getters & setters
+	bool				empty() const					{ return handlers.empty(); }
+	Uint32				getSize() const					{ return handlers.getSize(); }
+	Uint32				getNumRecent() const			{ return recentTypes.getSize(); }
+
+	// registers a handler
+	// @param type the packet type (4 chars)
+	// @param handler the member function to call
+	// @param reader reads the message as the handler does now, for benchmark() (nullptr if the
+	// message has no fixed fields)
+	// @param chainReader reads the message as the strncmp() chains used to, for benchmark()
+	void add(const char* type, handler_t handler, reader_t reader = nullptr, reader_t chainReader = nullptr) {
+		entry_t entry;
+		entry.handler = handler;
+		entry.reader = reader;
+		handlers.insert(fourcc(type), entry);
+		order.push(fourcc(type));
+		chainReaders.push(chainReader);
+	}
+
+	// @param type the packed packet type
+	// @return the handler for the type, or nullptr
+	handler_t find(Uint32 type) const {
+		const entry_t* entry = handlers.find(type);
+		return entry ? entry->handler : nullptr;
+	}
+
+	// calls the handler for a packet
+	// @param owner the object to call the handler on
+	// @param type the packed packet type
+	// @param packet the packet, with its signature and type already read
+	// @param remoteID the remote host that sent it
+	// @return false if nothing handles the type
+	bool dispatch(T& owner, Uint32 type, Packet& packet, Uint32 remoteID) {
+		const entry_t* entry = handlers.find(type);
+		if( !entry ) {
+			return false;
+		}
+
+		// only the bytes still to be read are copied
+		if( recentTypes.getSize() < maxRecent ) {
+			recentTypes.push(type);
+			recentPackets.push(packet);
+		} else {
+			recentTypes[nextRecent] = type;
+			recentPackets[nextRecent].copy(packet);
+			nextRecent = (nextRecent + 1) % maxRecent;
+		}
+		(owner.*(entry->handler))(packet, remoteID);
+		return true;
+	}
+
+	// replays the recently dispatched packets, payloads included, two ways: finding the type
+	// in the table and reading the message with its schema reader, as dispatch() and the
+	// handlers do, against comparing the type with every registered one in turn with strncmp()
+	// and reading the fields one read32() at a time, as the old if/else chains did. the
+	// handlers themselves aren't called, and both ways copy each packet back first
+	// @param rounds number of times to replay the stream
+	// @param outChainNs receives the average ns per packet comparing in turn
+	// @param outTableNs receives the average ns per packet with the table
+	// @return false if nothing has been dispatched yet
+	bool benchmark(Uint32 rounds, double& outChainNs, double& outTableNs) const {
+		const Uint32 numRecent = recentTypes.getSize();
+		if( numRecent == 0 ) {
+			return false;
+		}
+		ArrayList<char> stream;
+		stream.resize(numRecent * 4);
+		for( Uint32 c = 0; c < numRecent; ++c ) {
+			for( Uint32 i = 0; i < 4; ++i ) {
+				stream[c * 4 + i] = (char)(recentTypes[c] >> (i * 8));
+			}
+		}
+		ArrayList<char> names;
+		names.resize(order.getSize() * 4);
+		for( Uint32 c = 0; c < order.getSize(); ++c ) {
+			for( Uint32 i = 0; i < 4; ++i ) {
+				names[c * 4 + i] = (char)(order[c] >> (i * 8));
+			}
+		}
+		Packet packet;
+		volatile Uint32 sink = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for( Uint32 round = 0; round < rounds; ++round ) {
+			for( Uint32 c = 0; c < numRecent; ++c ) {
+				packet.copy(recentPackets[c]);
+				const char* type = &stream[c * 4];
+				for( Uint32 i = 0; i < order.getSize(); ++i ) {
+					if( strncmp(type, &names[i * 4], 4) == 0 ) {
+						sink += chainReaders[i] && chainReaders[i](packet) ? 1 : 0;
+						break;
+					}
+				}
+			}
+		}
+		std::chrono::duration<double, std::nano> chainTime = std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		for( Uint32 round = 0; round < rounds; ++round ) {
+			for( Uint32 c = 0; c < numRecent; ++c ) {
+				packet.copy(recentPackets[c]);
+				const entry_t* entry = handlers.find(fourcc(&stream[c * 4]));
+				sink += entry && entry->reader && entry->reader(packet) ? 1 : 0;
+			}
+		}
+		std::chrono::duration<double, std::nano> tableTime = std::chrono::steady_clock::now() - start;
+
+		const double packets = (double)numRecent * rounds;
+		outChainNs = chainTime.count() / packets;
+		outTableNs = tableTime.count() / packets;
+		return true;
+	}
+
+private:
+	struct entry_t {
+		handler_t handler = nullptr;
+		reader_t reader = nullptr;
+	};
+
+	HashMap<Uint32, entry_t> handlers;		// by packed type
+	ArrayList<Uint32> order;				// types in the order they were registered
+	ArrayList<reader_t> chainReaders;		// old-style reader for each type in order
+	ArrayList<Uint32> recentTypes;			// types dispatched, oldest at nextRecent once full
+	ArrayList<Packet> recentPackets;		// what was left to read of each
+	Uint32 nextRecent = 0;
+};
+
+// reads one field of a fixed-layout message
+// @return true if the packet held it
+inline bool readMessageField(Packet& packet, Uint8& value)	{ return packet.read8(value); }
+inline bool readMessageField(Packet& packet, Uint16& value)	{ return packet.read16(value); }
+inline bool readMessageField(Packet& packet, Uint32& value)	{ return packet.read32(value); }
+
+// declares a reader for a message from a schema: a macro taking a field macro, which is applied
+// to each (type, name) in the order the fields are read (the reverse of the order written).
+// e.g. MESSAGE(msg_sack_t, MSG_SACK) with #define MSG_SACK(F) F(Uint32, sequence) declares
+// struct msg_sack_t { Uint32 sequence; bool read(Packet&); }. two static readers go with it
+// for MessageRegistry::add(): readMessage() reads into the struct as the handlers do, and
+// readChain() reads each field into a local, as the old if/else chains did by hand
+#define MESSAGE_FIELD_DECLARE(type, name) type name = 0;
+#define MESSAGE_FIELD_READ(type, name) && readMessageField(packet, name)
+#define MESSAGE_FIELD_READ_LOCAL(type, name) type name; if( !readMessageField(packet, name) ) { return false; }
+#define MESSAGE(name, SCHEMA) \
+	struct name { \
+		SCHEMA(MESSAGE_FIELD_DECLARE) \
+		bool read(Packet& packet) { return true SCHEMA(MESSAGE_FIELD_READ); } \
+		static bool readMessage(Packet& packet) { name msg; return msg.read(packet); } \
+		static bool readChain(Packet& packet) { SCHEMA(MESSAGE_FIELD_READ_LOCAL) return true; } \
+	};
+
+// snapshot acknowledged (client to server)
+#define MSG_SACK(F) F(Uint32, sequence)
+MESSAGE(msg_sack_t, MSG_SACK)
+
+// entity deleted (server to client)
+#define MSG_ENTD(F) F(Uint32, world) F(Uint32, uid)
+MESSAGE(msg_entd_t, MSG_ENTD)
+
+// a player interacted with an entity (server to clients)
+#define MSG_PINT(F) F(Uint32, player) F(Uint32, world) F(Uint32, entity)
+MESSAGE(msg_pint_t, MSG_PINT)
+
+// a player selected an entity (client to server)
+#define MSG_ESEL(F) F(Uint32, localID) F(Uint32, world) F(Uint32, entity) F(Uint32, bbox)
+MESSAGE(msg_esel_t, MSG_ESEL)
+
+// a chat message's length, which the text follows
+#define MSG_CMSG(F) F(Uint32, length)
+MESSAGE(msg_cmsg_t, MSG_CMSG)
+
+// safe packets acknowledged: the newest, and a bit for each of the 32 before it
+#define MSG_ACKN(F) F(Uint32, sequence) F(Uint32, bits)
+MESSAGE(msg_ackn_t, MSG_ACKN)
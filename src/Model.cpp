@@ -81,7 +81,10 @@ bool Model::isAnimDone() const {
 
 void Model::process() {
 	Component::process();
+	queueProcessShared();
+}
 
+void Model::processShared() {
 	// find speaker
 	Speaker* speaker = findComponentByName<Speaker>("animSpeaker");
 
@@ -59,6 +59,9 @@ public:
 	// update the component
 	virtual void process() override;
 
+	// steps animations
+	virtual void processShared() override;
+
 	// finds a bone with the given name
 	// @param name the name of the bone to search for
 	// @return a struct containing bone position, orientation, etc.
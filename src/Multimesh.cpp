@@ -123,6 +123,10 @@ void Multimesh::draw(Camera& camera, const ArrayList<Light*>& lights) {
 
 void Multimesh::update() {
 	Component::update();
+	queueUpdateShared();
+}
+
+void Multimesh::updateShared() {
 	Mesh* mesh = mainEngine->getMeshResource().dataForString(meshStr.get()); assert(mesh);
 	mesh->clear();
 	LinkedList<Model*> models;
@@ -148,6 +152,7 @@ String Multimesh::generateGUID() {
 }
 
 void Multimesh::afterWorldInsertion(const World* world) {
+	Component::afterWorldInsertion(world);
 	if (!meshStr.empty()) {
 		mainEngine->getMeshResource().deleteData(meshStr.get());
 	}
@@ -23,6 +23,9 @@ public:
 	// updates matrices
 	virtual void update() override;
 
+	// rebuilds the combined mesh
+	virtual void updateShared() override;
+
 	// save/load this object to a file
 	// @param file interface to serialize with
 	virtual void serialize(FileInterface * file) override;
@@ -0,0 +1,58 @@
+// NavGrid.hpp
+// Bit-packed walkability map that path searches share between threads
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+
+#include <memory>
+
+// one bit per tile (y + x * height), set if the tile can be walked on. a grid is never changed
+// once it has been published: PathFinder makes a new one whenever the terrain changes and
+// swaps it in atomically, while searches already running keep the one they started with.
+// handing a search a snapshot only bumps a reference count.
+class NavGrid {
+public:
+	NavGrid(Uint32 _width, Uint32 _height, Uint32 _version) :
+		width(_width),
+		height(_height),
+		version(_version)
+	{
+		bits.resize((width * height + 31) / 32);
+		memset(bits.getArray(), 0, bits.getSize() * sizeof(Uint32));
+	}
+
+	// copies another grid's bits under a new version
+	NavGrid(const NavGrid& src, Uint32 _version) :
+		width(src.width),
+		height(src.height),
+		version(_version),
+		bits(src.bits)
+	{}
+
+	// getters & setters
+	Uint32		getWidth() const						{ return width; }
+	Uint32		getHeight() const						{ return height; }
+	Uint32		getSize() const							{ return width * height; }
+	Uint32		getVersion() const						{ return version; }
+	Uint32		getMemoryUsage() const					{ return sizeof(NavGrid) + bits.getMaxSize() * sizeof(Uint32); }
+	bool		isWalkable(Uint32 tile) const			{ return (bits[tile >> 5] >> (tile & 31)) & 1; }
+
+	void setWalkable(Uint32 tile, bool walkable) {
+		if( walkable ) {
+			bits[tile >> 5] |= 1u << (tile & 31);
+		} else {
+			bits[tile >> 5] &= ~(1u << (tile & 31));
+		}
+	}
+
+private:
+	Uint32 width = 0;
+	Uint32 height = 0;
+	Uint32 version = 0;
+	ArrayList<Uint32> bits;
+};
+
+// a shared handle to a published grid
+using NavSnapshot = std::shared_ptr<const NavGrid>;
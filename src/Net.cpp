@@ -3,6 +3,7 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "Net.hpp"
+#include "Message.hpp"
 #include "Random.hpp"
 #include "Game.hpp"
 #include "Console.hpp"
@@ -46,25 +47,311 @@ void Net::unlockThread() {
 }
 
 void Net::update() {
-	for( Uint32 remoteIndex = 0; remoteIndex < remotes.getSize(); ++remoteIndex ) {
+	const Uint32 now = SDL_GetTicks();
+
+	// turn the wheel up to now, collecting the resends that came due. if we've been away for
+	// longer than a whole turn, every slot is due once
+	Uint32 steps = wheelStarted ? (now - wheelTime) / wheelResolution : 0;
+	steps = steps > wheelSlots ? wheelSlots : steps;
+	for( Uint32 step = 0; step < steps; ++step ) {
+		wheelTime += wheelResolution;
+		ArrayList<resend_t>& slot = wheel[(wheelTime / wheelResolution) % wheelSlots];
+		for( Uint32 c = 0; c < slot.getSize(); ++c ) {
+			wheelDue.push(slot[c]);
+		}
+		slot.clearKeepCapacity();
+	}
+	if( steps == wheelSlots ) {
+		wheelTime = now;
+	}
+
+	for( Uint32 c = 0; c < wheelDue.getSize(); ++c ) {
+		const resend_t resend = wheelDue[c];
+		if( (Sint32)(resend.due - now) > 0 ) {
+			// more than a turn away when it was scheduled
+			schedule(resend.remoteID, resend.sequence, resend.due);
+			continue;
+		}
+		Uint32 remoteIndex = getRemoteWithID(resend.remoteID);
+		if( remoteIndex == UINT32_MAX ) {
+			continue;
+		}
 		remote_t* remote = remotes[remoteIndex];
+		safepacket_t* safePacket = remote->resendMap.find(resend.sequence);
+		if( !safePacket ) {
+			continue;
+		}
+		if( safePacket->resends >= maxPacketRetries || remote->safePacketsSent - resend.sequence >= recvWindowSize ) {
+			// give up, also once the host couldn't tell it from a repeat
+			mainEngine->fmsg(Engine::MSG_DEBUG,"gave up on safe packet %u to remote host %u",resend.sequence,remote->id);
+			safePacket->payload->release();
+			remote->resendMap.remove(resend.sequence);
+			continue;
+		}
+
+		// back off while nothing comes back
+		++safePacket->resends;
+		safePacket->lastTimeSent = now;
+		transmitSafe(*remote, resend.sequence, *safePacket->payload);
+		Uint32 timeout = remote->rto << (safePacket->resends < 4 ? safePacket->resends : 4);
+		timeout = timeout > msMaxResend ? msMaxResend : timeout;
+		schedule(remote->id, resend.sequence, now + timeout);
+	}
+	wheelDue.clearKeepCapacity();
+
+	// acknowledge anything no safe packet of ours has carried an acknowledgement for
+	for( auto remote : remotes ) {
+		if( remote->ackPending ) {
+			sendAck(*remote, remote->safeRcvdNewest);
+		}
+	}
+}
+
+bool Net::sendPacketSafe(Uint32 remoteID, const Packet& packet) {
+	Uint32 index = getRemoteWithID(remoteID);
+	if( index == UINT32_MAX ) {
+		mainEngine->fmsg(Engine::MSG_WARN,"tried to send packet to invalid remote host! (%d)",remoteID);
+		return false;
+	}
+
+	if( localID == invalidID ) {
+		mainEngine->fmsg(Engine::MSG_WARN,"tried to send safe packet with an invalid local id!");
+		return false;
+	}
+
+	payload_t* payload = new payload_t();
+	payload->packet.copy(packet);
+	bool result = sendSafe(*remotes[index], payload);
+	payload->release();
+	return result;
+}
+
+bool Net::broadcastSafe(Packet& packet) {
+	if( remotes.getSize() == 0 ) {
+		return true;
+	}
+
+	if( localID == invalidID ) {
+		mainEngine->fmsg(Engine::MSG_WARN,"tried to send safe packet with an invalid local id!");
+		return false;
+	}
+
+	bool result = true;
+	payload_t* payload = new payload_t();
+	payload->packet.copy(packet);
+	for( auto remote : remotes ) {
+		result = sendSafe(*remote, payload) ? result : false;
+	}
+	payload->release();
+	return result;
+}
+
+bool Net::sendSafe(remote_t& remote, payload_t* payload) {
+	const Uint32 now = SDL_GetTicks();
+	const Uint32 sequence = remote.safePacketsSent++;
+
+	safepacket_t safePacket;
+	safePacket.payload = payload;
+	safePacket.firstTimeSent = now;
+	safePacket.lastTimeSent = now;
+	++payload->refs;
+	remote.resendMap.insert(sequence, safePacket);
+	schedule(remote.id, sequence, now + remote.rto);
+
+	return transmitSafe(remote, sequence, *payload);
+}
+
+bool Net::transmitSafe(remote_t& remote, Uint32 sequence, const payload_t& payload) {
+	// the payload is already signed by the sender; the header goes on top of it
+	Packet packet;
+	packet.copy(payload.packet);
+	if( remote.safeRcvdAny ) {
+		packet.write32(getAckBits(remote, remote.safeRcvdNewest));
+		packet.write32(remote.safeRcvdNewest);
+		packet.write8(1);
+	} else {
+		packet.write8(0);
+	}
+	packet.write32(sequence);
+	packet.write("SAFE");
+	signPacket(packet);
+
+	if( sendPacket(remote.id, packet) ) {
+		remote.ackPending = false;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+void Net::sendAck(remote_t& remote, Uint32 sequence) {
+	Packet packet;
+	packet.write32(getAckBits(remote, sequence));
+	packet.write32(sequence);
+	packet.write("ACKN");
+	signPacket(packet);
+	sendPacket(remote.id, packet);
+	if( sequence == remote.safeRcvdNewest ) {
+		remote.ackPending = false;
+	}
+}
 
-		for( Uint32 c = 0; c < remote->resendStack.getSize(); ++c ) {
-			safepacket_t* safepacket = remote->resendStack[c];
-
-			if( SDL_GetTicks() - safepacket->lastTimeSent >= msBeforeResend ) {
-				if( sendPacket(remote->id,safepacket->packet) ) {
-					++safepacket->resends;
-					if( safepacket->resends >= maxPacketRetries ) {
-						remote->resendStack.remove(c);
-						delete safepacket;
-						--c;
-					} else {
-						safepacket->lastTimeSent = SDL_GetTicks();
-					}
-				}
+Uint32 Net::getAckBits(const remote_t& remote, Uint32 sequence) const {
+	Uint32 bits = 0;
+	for( Uint32 c = 0; c < 32; ++c ) {
+		const Uint32 prev = sequence - 1 - c;
+		if( remote.safeRcvdNewest - prev >= recvWindowSize ) {
+			break;
+		}
+		if( remote.safeRcvdBits[(prev % recvWindowSize) / 32] & (1u << (prev % 32)) ) {
+			bits |= 1u << c;
+		}
+	}
+	return bits;
+}
+
+void Net::receiveAcks(remote_t& remote, Uint32 sequence, Uint32 bits) {
+	const Uint32 now = SDL_GetTicks();
+	for( Uint32 c = 0; c <= 32; ++c ) {
+		if( c > 0 && !(bits & (1u << (c - 1))) ) {
+			continue;
+		}
+		const Uint32 acked = sequence - c;
+		safepacket_t* safePacket = remote.resendMap.find(acked);
+		if( !safePacket ) {
+			continue;
+		}
+
+		// only packets sent once say how long a round trip takes
+		if( safePacket->resends == 0 ) {
+			const Uint32 sample = now - safePacket->firstTimeSent;
+			if( remote.rtt == 0 ) {
+				remote.rtt = sample ? sample : 1;
+				remote.rttVar = sample / 2;
+			} else {
+				const Uint32 diff = sample > remote.rtt ? sample - remote.rtt : remote.rtt - sample;
+				remote.rttVar = (remote.rttVar * 3 + diff) / 4;
+				remote.rtt = (remote.rtt * 7 + sample) / 8;
+			}
+			Uint32 rto = remote.rtt + 4 * remote.rttVar;
+			rto = rto < msMinResend ? msMinResend : rto;
+			rto = rto > msMaxResend ? msMaxResend : rto;
+			remote.rto = rto;
+		}
+
+		safePacket->payload->release();
+		remote.resendMap.remove(acked);
+	}
+}
+
+bool Net::receiveSafe(remote_t& remote, Uint32 sequence) {
+	remote.ackPending = true;
+	if( !remote.safeRcvdAny ) {
+		remote.safeRcvdAny = true;
+		remote.safeRcvdNewest = sequence;
+		memset(remote.safeRcvdBits, 0, sizeof(remote.safeRcvdBits));
+		remote.safeRcvdBits[(sequence % recvWindowSize) / 32] |= 1u << (sequence % 32);
+		return true;
+	}
+
+	const Sint32 ahead = (Sint32)(sequence - remote.safeRcvdNewest);
+	if( ahead > 0 ) {
+		// forget what's fallen out of the window
+		if( (Uint32)ahead >= recvWindowSize ) {
+			memset(remote.safeRcvdBits, 0, sizeof(remote.safeRcvdBits));
+		} else {
+			for( Uint32 c = remote.safeRcvdNewest + 1; c != sequence; ++c ) {
+				remote.safeRcvdBits[(c % recvWindowSize) / 32] &= ~(1u << (c % 32));
 			}
 		}
+		remote.safeRcvdNewest = sequence;
+		remote.safeRcvdBits[(sequence % recvWindowSize) / 32] |= 1u << (sequence % 32);
+		return true;
+	}
+
+	// older than the window: it must have been resent long after we got it
+	if( (Uint32)-ahead >= recvWindowSize ) {
+		return false;
+	}
+	Uint32& word = remote.safeRcvdBits[(sequence % recvWindowSize) / 32];
+	const Uint32 bit = 1u << (sequence % 32);
+	if( word & bit ) {
+		return false;
+	}
+	word |= bit;
+	return true;
+}
+
+void Net::schedule(Uint32 remoteID, Uint32 sequence, Uint32 due) {
+	resend_t resend;
+	resend.remoteID = remoteID;
+	resend.sequence = sequence;
+	resend.due = due;
+	if( !wheelStarted ) {
+		wheelTime = SDL_GetTicks();
+		wheelStarted = true;
+	}
+
+	// always at least one slot ahead of the wheel, so it isn't missed
+	Uint32 slot = due / wheelResolution;
+	const Uint32 next = wheelTime / wheelResolution + 1;
+	slot = (Sint32)(slot - next) < 0 ? next : slot;
+	wheel[slot % wheelSlots].push(resend);
+}
+
+int Net::handleSafePacket(Packet& packet, const char* type, Uint32 remoteID) {
+	switch( fourcc(type) ) {
+	// safe message -- queue it and acknowledge it
+	case fourcc("SAFE"): {
+		Uint32 remoteIndex = getRemoteWithID(remoteID);
+		if( remoteIndex == UINT32_MAX ) {
+			mainEngine->fmsg(Engine::MSG_DEBUG, "message received from client with bad id (%d)", remoteID);
+			return 3;
+		}
+		remote_t* remote = remotes[remoteIndex];
+
+		Uint32 sequence;
+		Uint8 hasAcks;
+		if( !packet.read32(sequence) || !packet.read8(hasAcks) ) {
+			return 3;
+		}
+		if( hasAcks ) {
+			Uint32 ack, ackBits;
+			if( !packet.read32(ack) || !packet.read32(ackBits) ) {
+				return 3;
+			}
+			receiveAcks(*remote, ack, ackBits);
+		}
+
+		if( receiveSafe(*remote, sequence) ) {
+			// put the packet back onto the stack
+			Packet* newPacket = new Packet(packet);
+			remote->packetStack.push(newPacket);
+		}
+
+		// the acknowledgement normally rides along with whatever we send next, or goes out on
+		// its own at the end of the frame. one too old for that has to be answered now
+		if( remote->safeRcvdNewest - sequence > 32 ) {
+			sendAck(*remote, sequence);
+		}
+		return 3;
+	}
+
+	// safe message -- acknowledgement
+	case fourcc("ACKN"): {
+		Uint32 remoteIndex = getRemoteWithID(remoteID);
+		if( remoteIndex == UINT32_MAX ) {
+			return 4;
+		}
+		msg_ackn_t msg;
+		if( msg.read(packet) ) {
+			receiveAcks(*remotes[remoteIndex], msg.sequence, msg.bits);
+		}
+		return 4;
+	}
+
+	default:
+		return 0;
 	}
 }
 
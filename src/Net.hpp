@@ -7,6 +7,10 @@
 
 #include "Main.hpp"
 #include "Packet.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+
+#include <atomic>
 
 class Game;
 
@@ -27,9 +31,16 @@ public:
 	// max packet send retries
 	static const Uint16 maxPacketRetries = 10;
 
-	// milliseconds between safe packet retries
+	// milliseconds before a safe packet is first resent, until a round trip has been measured
 	static const Uint32 msBeforeResend = 200;
 
+	// bounds on the resend timeout worked out from the round trip time
+	static const Uint32 msMinResend = 40;
+	static const Uint32 msMaxResend = 2000;
+
+	// safe packets a remote host remembers receiving, to throw away repeats
+	static const Uint32 recvWindowSize = 1024;
+
 	// network connection type
 	enum kind_t {
 		UNKNOWN,
@@ -38,12 +49,31 @@ public:
 		KIND_TYPE_LENGTH
 	};
 
-	// safe packet
-	struct safepacket_t {
+	// a safe packet is the signed packet being sent with a header on top: its sequence number,
+	// then, once anything has come the other way, the newest sequence number we've received
+	// from that host and a bit for each of the 32 before it. that's how safe packets acknowledge
+	// each other; when there's nothing going back, update() sends the same thing as an ACKN.
+	// resends wait a little longer than the measured round trip, doubling each time.
+
+	// the contents of a safe packet, shared by every remote host it's sent to
+	struct payload_t {
 		Packet packet;
+		Uint32 refs = 1;
+
+		// drops a reference, deleting the payload when it was the last
+		void release() {
+			if( --refs == 0 ) {
+				delete this;
+			}
+		}
+	};
+
+	// a safe packet waiting to be acknowledged
+	struct safepacket_t {
+		payload_t* payload = nullptr;
 		Uint32 resends = 0;
+		Uint32 firstTimeSent = 0;
 		Uint32 lastTimeSent = 0;
-		Uint32 id = invalidID;
 	};
 
 	// remote host
@@ -53,14 +83,12 @@ public:
 				Packet* packet = packetStack.pop();
 				delete packet;
 			}
-			while( resendStack.getSize() > 0 ) {
-				safepacket_t* safePacket = resendStack.pop();
-				delete safePacket;
+			for( auto& pair : resendMap ) {
+				pair.b.payload->release();
 			}
 		}
 
 		ArrayList<Packet*> packetStack;			// packets received from the host
-		ArrayList<Uint32> safeRcvdHash[128];	// hash list of safe packets received
 
 		char address[256] = { 0 };				// address (hostname or ip address)
 		Uint16 port = 0;						// port number
@@ -69,10 +97,19 @@ public:
 		Uint32 gid = invalidID;					// client's generated id
 		Uint32 timestamp = 0;					// the latest timestamp from this host; earlier packets might not be read
 
-		Uint32 safePacketsSent = 0;				// total number of safe packets sent TO this host
-		ArrayList<safepacket_t*> resendStack;	// list of packets due for resend
+		// sending
+		Uint32 safePacketsSent = 0;				// total number of safe packets sent TO this host (and the next one's sequence number)
+		HashMap<Uint32, safepacket_t> resendMap;	// packets not yet acknowledged, by sequence number
+		Uint32 rtt = 0;							// smoothed round trip time in ms (0 until measured)
+		Uint32 rttVar = 0;						// smoothed round trip variation in ms
+		Uint32 rto = msBeforeResend;			// ms to wait for an acknowledgement before resending
+
+		// receiving
+		bool safeRcvdAny = false;				// true once any safe packet has arrived
+		Uint32 safeRcvdNewest = 0;				// highest sequence number received
+		Uint32 safeRcvdBits[recvWindowSize / 32] = { 0 };	// bit per sequence number received, recvWindowSize back from the newest
+		bool ackPending = false;				// true if something arrived that we haven't acknowledged yet
 	};
-
 	// connection request
 	struct request_t {
 		Uint32 gid = 0;
@@ -127,24 +164,26 @@ public:
 	// @param packet the packet to send
 	// @param remoteID the id of the recipient
 	// @return true if the send succeeded, false otherwise
-	virtual bool sendPacketSafe(Uint32 remoteID, const Packet& packet) = 0;
+	bool sendPacketSafe(Uint32 remoteID, const Packet& packet);
 
 	// broadcasts a packet to all remote hosts
 	// @param packet the packet to send
 	// @return true if the send succeeded, false otherwise
 	virtual bool broadcast(Packet& packet) = 0;
 
-	// just like broadcast, except guarantees delivery
+	// just like broadcast, except guarantees delivery. the packet is copied once, however many
+	// remote hosts there are
 	// @param packet the packet to send
 	// @return true if the send succeeded, false otherwise
-	virtual bool broadcastSafe(Packet& packet) = 0;
+	bool broadcastSafe(Packet& packet);
 
 	// pops a packet from the stack and returns it
 	// @param remoteIndex the index of the remote host to read a packet from (not the id!)
 	// @return the highest packet on the stack, or nullptr if no packets are left
 	virtual Packet* recvPacket(unsigned int remoteIndex) = 0;
 
-	// detects and completes any active connection requests, resends guaranteed packets
+	// detects and completes any active connection requests, resends guaranteed packets, and
+	// acknowledges safe packets that no outgoing safe packet carried an acknowledgement for
 	virtual void update();
 
 	// @return the number of remote hosts we have connections with
@@ -194,6 +233,13 @@ protected:
 	// @param data the request data
 	virtual void completeConnection(void* data) = 0;
 
+	// handles SAFE and ACKN packets for the subclasses' handleNetworkPacket()
+	// @param packet the packet data
+	// @param type the 4 char packet type string
+	// @param remoteID the remote id that the packet came from
+	// @return 3 for a safe packet, 4 for an acknowledgement, 0 for anything else
+	int handleSafePacket(Packet& packet, const char* type, Uint32 remoteID);
+
 	// threading
 	String threadName;
 	SDL_Thread* thread = nullptr;
@@ -201,7 +247,7 @@ protected:
 	SDL_mutex* execLock = nullptr;
 	SDL_mutex* killLock = nullptr;
 	bool exec = false;
-	bool kill = false;
+	std::atomic_bool kill{false};
 
 	// gets the remote host with the given id
 	// @param remoteID the id of the remote host to get
@@ -212,4 +258,58 @@ protected:
 	// @param remoteID the id of the remote host to get
 	// @return an index to the remote host, or UINT32_MAX if they could not be found
 	Uint32 getRemoteWithID(const Uint32 remoteID) const;
+
+private:
+	// resends are kept on a timer wheel: one slot per wheelResolution ms, so each update only
+	// looks at the packets that came due since the last one. a timer outliving its packet (the
+	// packet was acknowledged, or the host left) is just skipped when its slot comes up
+	static const Uint32 wheelSlots = 256;
+	static const Uint32 wheelResolution = 10;
+
+	struct resend_t {
+		Uint32 remoteID = invalidID;
+		Uint32 sequence = 0;
+		Uint32 due = 0;
+	};
+
+	ArrayList<resend_t> wheel[wheelSlots];
+	ArrayList<resend_t> wheelDue;
+	Uint32 wheelTime = 0;						// ms the wheel has been turned up to
+	bool wheelStarted = false;
+
+	// queues a safe packet for a remote host and sends it
+	// @param remote the remote host
+	// @param payload the packet to send, which gains a reference
+	// @return true if the send succeeded, false otherwise
+	bool sendSafe(remote_t& remote, payload_t* payload);
+
+	// sends one copy of a safe packet, with our latest acknowledgements for the host
+	// @param remote the remote host
+	// @param sequence the safe packet's sequence number
+	// @param payload the packet
+	// @return true if the send succeeded, false otherwise
+	bool transmitSafe(remote_t& remote, Uint32 sequence, const payload_t& payload);
+
+	// sends an acknowledgement on its own
+	// @param remote the remote host
+	// @param sequence the newest sequence number the acknowledgement covers
+	void sendAck(remote_t& remote, Uint32 sequence);
+
+	// @return a bit for each of the 32 sequence numbers before the given one that has arrived
+	Uint32 getAckBits(const remote_t& remote, Uint32 sequence) const;
+
+	// records an acknowledgement from a remote host
+	// @param remote the remote host
+	// @param sequence the newest sequence number acknowledged
+	// @param bits the 32 before it (see getAckBits())
+	void receiveAcks(remote_t& remote, Uint32 sequence, Uint32 bits);
+
+	// notes that a safe packet arrived
+	// @param remote the remote host
+	// @param sequence the packet's sequence number
+	// @return true if it's the first time we've seen it
+	bool receiveSafe(remote_t& remote, Uint32 sequence);
+
+	// schedules a safe packet to be resent if it isn't acknowledged in time
+	void schedule(Uint32 remoteID, Uint32 sequence, Uint32 due);
 };
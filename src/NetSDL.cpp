@@ -4,62 +4,104 @@
 #include "Engine.hpp"
 #include "Net.hpp"
 #include "NetSDL.hpp"
+#include "Message.hpp"
 #include "Game.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+#include "Console.hpp"
 
-NetSDL::NetSDL(Game& _parent) : Net(_parent) {
-	if( (SDLsendPacket = SDLNet_AllocPacket(Packet::maxLen)) == nullptr ) {
-		mainEngine->fmsg(Engine::MSG_CRITICAL, "failed to allocate SDL packet for NetSDL!");
+static Cvar cvar_netThread("net.thread", "sends and receives on a thread of its own (takes effect when a connection opens)", "1");
+
+NetSDL::NetSDL(Game& _parent) : Net(_parent), sendQueue(queueSize), recvQueue(queueSize) {
+	if( (SDLsendPackets = SDLNet_AllocPacketV(batchSize, Packet::maxLen)) == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_CRITICAL, "failed to allocate SDL packets for NetSDL!");
 	}
-	if( (SDLrecvPacket = SDLNet_AllocPacket(Packet::maxLen)) == nullptr ) {
-		mainEngine->fmsg(Engine::MSG_CRITICAL, "failed to allocate SDL packet for NetSDL!");
+	if( (SDLrecvPackets = SDLNet_AllocPacketV(batchSize, Packet::maxLen)) == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_CRITICAL, "failed to allocate SDL packets for NetSDL!");
 	}
 
-	/*execLock = SDL_CreateMutex();
-	killLock = SDL_CreateMutex();
-	connectLock = SDL_CreateMutex();
 	if( _parent.isClient() ) {
 		threadName = "Client Networking";
 	} else if( _parent.isServer() ) {
 		threadName = "Server Networking";
 	}
-	thread = SDL_CreateThread( runThread, threadName.get(), (void *)this );
-	if( thread == nullptr ) {
-		mainEngine->fmsg(Engine::MSG_CRITICAL, "failed to create thread '%s'", threadName.get());
-	}*/
 }
 
 NetSDL::~NetSDL() {
+	stopThread();
 }
 
 void NetSDL::init() {
 }
 
 void NetSDL::term() {
-	// kill network thread
-	/*SDL_LockMutex(killLock);
-	kill = true;
-	SDL_UnlockMutex(killLock);
-	if( thread ) {
-		SDL_WaitThread(thread, nullptr);
-	}
-	SDL_DestroyMutex(execLock); execLock = nullptr;
-	SDL_DestroyMutex(killLock); killLock = nullptr;
-	SDL_DestroyMutex(connectLock); connectLock = nullptr;*/
-
 	// disconnect everyone
 	disconnectAll();
+	if( connected ) {
+		closeSocket();
+	}
 
 	// delete packets
-	if( SDLsendPacket ) {
-		SDLNet_FreePacket(SDLsendPacket);
-		SDLsendPacket = nullptr;
+	if( SDLsendPackets ) {
+		SDLNet_FreePacketV(SDLsendPackets);
+		SDLsendPackets = nullptr;
+	}
+	if( SDLrecvPackets ) {
+		SDLNet_FreePacketV(SDLrecvPackets);
+		SDLrecvPackets = nullptr;
 	}
-	if( SDLrecvPacket ) {
-		SDLNet_FreePacket(SDLrecvPacket);
-		SDLrecvPacket = nullptr;
+}
+
+void NetSDL::startThread() {
+	if( thread || !cvar_netThread.toInt() ) {
+		return;
+	}
+	kill = false;
+	thread = SDL_CreateThread( runThread, threadName.get(), (void *)this );
+	if( thread == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to create thread '%s', networking on the main thread instead", threadName.get());
 	}
 }
 
+void NetSDL::stopThread() {
+	if( !thread ) {
+		return;
+	}
+	kill = true;
+	SDL_WaitThread(thread, nullptr);
+	thread = nullptr;
+}
+
+void NetSDL::openSocket(Uint16 port) {
+	SDLsocket = SDLNet_UDP_Open(port);
+	connected = true;
+
+	// the thread waits on this for datagrams to arrive
+	SDLsocketSet = SDLNet_AllocSocketSet(1);
+	if( SDLsocketSet ) {
+		SDLNet_UDP_AddSocket(SDLsocketSet, SDLsocket);
+	}
+	startThread();
+}
+
+void NetSDL::closeSocket() {
+	stopThread();
+
+	// whatever was received but not read is for a connection that's gone
+	while( recvQueue.front() ) {
+		recvQueue.pop();
+	}
+
+	if( SDLsocketSet ) {
+		SDLNet_FreeSocketSet(SDLsocketSet);
+		SDLsocketSet = nullptr;
+	}
+	SDLNet_UDP_Close(SDLsocket);
+	connected = false;
+	localID = invalidID;
+	numClients = 0;
+}
+
 bool NetSDL::host(Uint16 port) {
 	if( connected ) {
 		return false;
@@ -71,8 +113,7 @@ bool NetSDL::host(Uint16 port) {
 		return false;
 	}
 
-	SDLsocket = SDLNet_UDP_Open(port);
-	connected = true;
+	openSocket(port);
 	hosting = true;
 
 	localID = 0;
@@ -100,8 +141,7 @@ bool NetSDL::connect(const char* address, Uint16 port) {
 	}
 
 	if( !connected ) {
-		SDLsocket = SDLNet_UDP_Open(0);
-		connected = true;
+		openSocket(0);
 	} else if( !hosting ) {
 		mainEngine->fmsg(Engine::MSG_ERROR,"cannot connect to more than one server at once!");
 		SDLremotes.pop();
@@ -216,10 +256,7 @@ bool NetSDL::disconnect(Uint32 remoteID, bool inform) {
 	delete remote;
 
 	if( SDLremotes.getSize()==0 && !hosting ) {
-		SDLNet_UDP_Close(SDLsocket);
-		connected = false;
-		localID = invalidID;
-		numClients = 0;
+		closeSocket();
 	}
 
 	if( parent ) {
@@ -240,10 +277,7 @@ bool NetSDL::disconnectHost() {
 
 	hosting = false;
 	if( SDLremotes.getSize()==0 ) {
-		SDLNet_UDP_Close(SDLsocket);
-		connected = false;
-		localID = invalidID;
-		numClients = 0;
+		closeSocket();
 	}
 
 	mainEngine->fmsg(Engine::MSG_INFO, "closed localhost to inbound connections");
@@ -294,50 +328,26 @@ bool NetSDL::sendPacket(Uint32 remoteID, const Packet& packet) {
 
 	const sdlremote_t* remote = SDLremotes[index];
 
-	SDLsendPacket->channel = -1;
-	SDLsendPacket->len = min((int)packet.offset,SDLsendPacket->maxlen);
-	SDLsendPacket->address = remote->host;
-	memcpy(SDLsendPacket->data, packet.data, packet.offset);
-
-	if( SDLNet_UDP_Send(SDLsocket, -1, SDLsendPacket)!=0 ) {
-		return true;
-	} else {
-		mainEngine->fmsg(Engine::MSG_WARN,"failed to send SDL_Net UDP packet:\n %s", SDLNet_GetError());
-		return false;
-	}
-}
-
-bool NetSDL::sendPacketSafe(Uint32 remoteID, const Packet& packet) {
-	Uint32 index = getRemoteWithID(remoteID);
-	if( index == UINT32_MAX ) {
-		mainEngine->fmsg(Engine::MSG_WARN,"tried to send packet to invalid remote host! (%d)",remoteID);
+	datagram_t* datagram = sendQueue.beginPush();
+	if( !datagram ) {
+		++stats.sendDropped;
 		return false;
 	}
+	datagram->address = remote->host;
+	datagram->len = packet.offset < Packet::maxLen ? packet.offset : Packet::maxLen;
+	memcpy(datagram->data, packet.data, datagram->len);
+	sendQueue.push();
 
-	if( localID == invalidID ) {
-		mainEngine->fmsg(Engine::MSG_WARN,"tried to send safe packet with an invalid local id!");
-		return false;
+	Uint32 waiting = sendQueue.getSize();
+	if( waiting > stats.sendPeak ) {
+		stats.sendPeak = waiting;
 	}
 
-	sdlremote_t* remote = SDLremotes[index];
-
-	safepacket_t* safePacket = new safepacket_t();
-
-	safePacket->id = remote->safePacketsSent;
-	safePacket->lastTimeSent = SDL_GetTicks();
-	safePacket->packet.copy(packet);
-
-	safePacket->packet.write32(safePacket->id);
-	safePacket->packet.write("SAFE");
-	signPacket(safePacket->packet);
-
-	if( sendPacket(remoteID, safePacket->packet) ) {
-		remote->resendStack.push(safePacket);
-		++remote->safePacketsSent;
-		return true;
-	} else {
-		return false;
+	// without a thread, there's no point waiting
+	if( !thread ) {
+		sendQueued();
 	}
+	return true;
 }
 
 bool NetSDL::broadcast(Packet& packet) {
@@ -349,15 +359,6 @@ bool NetSDL::broadcast(Packet& packet) {
 	return result;
 }
 
-bool NetSDL::broadcastSafe(Packet& packet) {
-	bool result = true;
-	for( Uint32 c = 0; c < SDLremotes.getSize(); ++c ) {
-		sdlremote_t* remote = SDLremotes[c];
-		result = sendPacketSafe(remote->id, packet) ? result : false;
-	}
-	return result;
-}
-
 Packet* NetSDL::recvPacket(unsigned int remoteIndex) {
 	if( remoteIndex < 0 || remoteIndex >= (unsigned int)SDLremotes.getSize() ) {
 		mainEngine->fmsg(Engine::MSG_WARN,"tried to recv packet via invalid remote index!");
@@ -378,15 +379,26 @@ void NetSDL::update() {
 		return;
 	}
 
-	runThread(this);
+	if( !thread ) {
+		receiveQueued();
+	}
+
+	// hand what the thread received to the remote hosts
+	while( const datagram_t* datagram = recvQueue.front() ) {
+		route(*datagram);
+		recvQueue.pop();
+	}
+	Uint32 dropped = stats.recvDropped;
+	if( dropped != recvDroppedReported ) {
+		mainEngine->fmsg(Engine::MSG_WARN,"receive queue full, dropped %u datagram(s)", dropped - recvDroppedReported);
+		recvDroppedReported = dropped;
+	}
 
 	// complete connection requests
-	//SDL_LockMutex(connectLock);
 	while( SDLrequests.getSize() > 0 ) {
 		sdlrequest_t SDLrequest = SDLrequests.pop();
 		completeConnection((void*)&SDLrequest);
 	}
-	//SDL_UnlockMutex(connectLock);
 
 	// do resending of safe packets
 	Net::update();
@@ -394,100 +406,150 @@ void NetSDL::update() {
 
 int NetSDL::runThread(void* data) {
 	NetSDL* net = (NetSDL*)data;
-	//SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
-
-	//while( 1 ) {
-	{
-		// check whether we should kill the thread
-		/*SDL_LockMutex(net->killLock);
-		if( net->kill ) {
-			SDL_UnlockMutex(net->killLock);
-			break;
+
+	while( !net->kill ) {
+		net->sendQueued();
+
+		// sleep until something arrives, or it's time to look for more to send
+		if( net->SDLsocketSet ) {
+			if( SDLNet_CheckSockets(net->SDLsocketSet, msThreadWait) > 0 ) {
+				net->receiveQueued();
+			}
 		} else {
-			SDL_UnlockMutex(net->killLock);
-		}*/
-
-		// receive packets
-		int result = 0;
-		do {
-			// check again whether we should kill the thread
-			/*SDL_LockMutex(net->killLock);
-			if( net->kill ) {
-				SDL_UnlockMutex(net->killLock);
+			SDL_Delay(msThreadWait);
+			net->receiveQueued();
+		}
+	}
+
+	// the socket is about to close; send anything still queued (a QUIT, say)
+	net->sendQueued();
+	return 0;
+}
+
+void NetSDL::sendQueued() {
+	if( SDLsendPackets == nullptr ) {
+		return;
+	}
+	while( sendQueue.front() ) {
+		int count = 0;
+		while( count < (int)batchSize ) {
+			const datagram_t* datagram = sendQueue.front();
+			if( !datagram ) {
 				break;
-			} else {
-				SDL_UnlockMutex(net->killLock);
-			}*/
-
-			result = 0;
-			if( net->lockThread() ) {
-				if( net->SDLrecvPacket == nullptr || !net->connected ) {
-					// this probably means we're disconnected!
-					break;
-				}
+			}
+			UDPpacket* SDLpacket = SDLsendPackets[count];
+			SDLpacket->channel = -1;
+			SDLpacket->address = datagram->address;
+			SDLpacket->len = (int)datagram->len;
+			memcpy(SDLpacket->data, datagram->data, datagram->len);
+			sendQueue.pop();
+			++count;
+		}
 
-				Uint32 remoteIndex = UINT32_MAX;
-				Packet* packet = new Packet();
-
-				net->SDLrecvPacket->channel = -1;
-				if( (result = SDLNet_UDP_Recv(net->SDLsocket, net->SDLrecvPacket)) == -1 ) {
-					mainEngine->fmsg(Engine::MSG_WARN,"failed to recv SDL_Net UDP packet:\n %s", SDLNet_GetError());
-				} else if( result==1 ) {
-					memcpy(packet->data, net->SDLrecvPacket->data, net->SDLrecvPacket->len);
-					packet->offset = net->SDLrecvPacket->len;
-					Packet readPacket(*packet);
-
-					Uint32 id;
-					Uint32 timestamp;
-					if( readPacket.read32(id) && readPacket.read32(timestamp) ) {
-						remoteIndex = net->getRemoteWithID(id);
-						if( remoteIndex == UINT32_MAX ) {
-							char type[4];
-							readPacket.read(type, 4);
-							if( strncmp( (const char*)type, "JOIN", 4) == 0 ) {
-								char version[16] = { 0 };
-								if( readPacket.read(version,(Uint32)strlen(versionStr)) ) {
-									if( strcmp(versionStr,version) ) {
-										mainEngine->fmsg(Engine::MSG_WARN, "connection attempted by a client with version %s (mismatch)");
-									} else {
-										Uint32 gid;
-										if( readPacket.read32(gid) ) {
-											if( gid==net->localGID ) {
-												mainEngine->fmsg(Engine::MSG_ERROR, "I tried to connect to myself!");
-											} else {
-												// store off connection request
-												sdlrequest_t request;
-												request.ip = net->SDLrecvPacket->address;
-												request.gid = gid;
-												//SDL_LockMutex(net->connectLock);
-												net->SDLrequests.push(request);
-												//SDL_UnlockMutex(net->connectLock);
-											}
-										}
-									}
-								}
+		int sent = SDLNet_UDP_SendV(SDLsocket, SDLsendPackets, count);
+		++stats.sendCalls;
+		stats.sendDatagrams += (Uint32)sent;
+		stats.sendErrors += (Uint32)(count - sent);
+	}
+}
+
+void NetSDL::receiveQueued() {
+	if( SDLrecvPackets == nullptr ) {
+		return;
+	}
+	int count = 0;
+	do {
+		for( Uint32 c = 0; c < batchSize; ++c ) {
+			SDLrecvPackets[c]->channel = -1;
+		}
+		if( (count = SDLNet_UDP_RecvV(SDLsocket, SDLrecvPackets)) == -1 ) {
+			++stats.recvErrors;
+			return;
+		}
+		if( count == 0 ) {
+			return;
+		}
+		++stats.recvCalls;
+		stats.recvDatagrams += (Uint32)count;
+
+		for( int c = 0; c < count; ++c ) {
+			const UDPpacket* SDLpacket = SDLrecvPackets[c];
+			datagram_t* datagram = recvQueue.beginPush();
+			if( !datagram ) {
+				++stats.recvDropped;
+				continue;
+			}
+			datagram->address = SDLpacket->address;
+			datagram->len = (Uint32)SDLpacket->len < Packet::maxLen ? (Uint32)SDLpacket->len : Packet::maxLen;
+			memcpy(datagram->data, SDLpacket->data, datagram->len);
+			recvQueue.push();
+		}
+
+		Uint32 waiting = recvQueue.getSize();
+		if( waiting > stats.recvPeak ) {
+			stats.recvPeak = waiting;
+		}
+	} while( count == (int)batchSize );
+}
+
+void NetSDL::resetStats() {
+	stats.recvCalls = 0;
+	stats.recvDatagrams = 0;
+	stats.recvDropped = 0;
+	stats.recvErrors = 0;
+	stats.sendCalls = 0;
+	stats.sendDatagrams = 0;
+	stats.sendDropped = 0;
+	stats.sendErrors = 0;
+	stats.recvPeak = 0;
+	stats.sendPeak = 0;
+	recvDroppedReported = 0;
+}
+
+void NetSDL::route(const datagram_t& datagram) {
+	Packet* packet = new Packet();
+	memcpy(packet->data, datagram.data, datagram.len);
+	packet->offset = datagram.len;
+	Packet readPacket(*packet);
+
+	Uint32 id;
+	Uint32 timestamp;
+	if( readPacket.read32(id) && readPacket.read32(timestamp) ) {
+		Uint32 remoteIndex = getRemoteWithID(id);
+		if( remoteIndex == UINT32_MAX ) {
+			char type[4];
+			readPacket.read(type, 4);
+			if( fourcc(type) == fourcc("JOIN") ) {
+				char version[16] = { 0 };
+				if( readPacket.read(version,(Uint32)strlen(versionStr)) ) {
+					if( strcmp(versionStr,version) ) {
+						mainEngine->fmsg(Engine::MSG_WARN, "connection attempted by a client with version %s (mismatch)", version);
+					} else {
+						Uint32 gid;
+						if( readPacket.read32(gid) ) {
+							if( gid==localGID ) {
+								mainEngine->fmsg(Engine::MSG_ERROR, "I tried to connect to myself!");
 							} else {
-								mainEngine->fmsg(Engine::MSG_DEBUG, "message received from client with bad id (%d)", id);
+								// store off connection request
+								sdlrequest_t request;
+								request.ip = datagram.address;
+								request.gid = gid;
+								SDLrequests.push(request);
 							}
-						} else {
-							sdlremote_t* remote = net->SDLremotes[remoteIndex];
-							remote->packetStack.push(packet);
 						}
 					}
 				}
-
-				if( remoteIndex == UINT32_MAX && packet ) {
-					delete packet;
-					packet = nullptr;
-				}
+			} else {
+				mainEngine->fmsg(Engine::MSG_DEBUG, "message received from client with bad id (%d)", id);
 			}
-
-			// mark thread as finished
-			net->unlockThread();
-		} while( result==1 );
+		} else {
+			sdlremote_t* remote = SDLremotes[remoteIndex];
+			remote->packetStack.push(packet);
+			return;
+		}
 	}
 
-	return 0;
+	delete packet;
 }
 
 int NetSDL::handleNetworkPacket(Packet& packet, const char* type, Uint32 remoteID) {
@@ -495,8 +557,9 @@ int NetSDL::handleNetworkPacket(Packet& packet, const char* type, Uint32 remoteI
 		return 0;
 	}
 
+	switch( fourcc(type) ) {
 	// join completion
-	else if( strncmp( type, "JOIN", 4) == 0 ) {
+	case fourcc("JOIN"): {
 		char version[16] = { 0 };
 		if( packet.read(version,(Uint32)strlen(versionStr)) ) {
 			if( strcmp(versionStr,version) ) {
@@ -523,77 +586,47 @@ int NetSDL::handleNetworkPacket(Packet& packet, const char* type, Uint32 remoteI
 	}
 
 	// disconnects
-	else if( strncmp( type, "QUIT", 4) == 0 ) {
+	case fourcc("QUIT"): {
 		disconnect(remoteID, false);
 
 		return 2;
 	}
 
-	// safe message -- queue and respond with ack
-	else if( strncmp( type, "SAFE", 4) == 0 ) {
-		Uint32 remoteIndex = getRemoteWithID(remoteID);
-		if( remoteIndex == UINT32_MAX ) {
-			mainEngine->fmsg(Engine::MSG_DEBUG, "message received from client with bad id (%d)", remoteID);
-		} else {
-			Uint32 packetID;
-			packet.read32(packetID); // get the packet id
-
-			sdlremote_t* remote = SDLremotes[remoteIndex];
-			Uint32 hashIndex = packetID%128;
-
-			bool foundPacket = false;
-			for( Uint32 c = 0; c < remote->safeRcvdHash[hashIndex].getSize(); ++c ) {
-				Uint32 id = remote->safeRcvdHash[hashIndex][c];
-
-				if( id == packetID ) {
-					foundPacket = true;
-					break;
-				}
-			}
-
-			if( !foundPacket ) {
-				// put the packet back onto the stack
-				Packet* newPacket = new Packet(packet);
-				remote->packetStack.push(newPacket);
-				remote->safeRcvdHash[hashIndex].push(packetID);
-			}
-
-			// now ack
-			Packet ack;
-			ack.write32(packetID);
-			ack.write("ACKN");
-			signPacket(ack);
-			sendPacket(remoteID, ack);
-		}
-
-		return 3;
+	// safe messages and their acknowledgements
+	default:
+		return handleSafePacket(packet, type, remoteID);
 	}
+}
 
-	// safe message -- ack
-	else if( strncmp( type, "ACKN", 4) == 0 ) {
-		Uint32 remoteIndex = getRemoteWithID(remoteID);
-
-		Uint32 packetID;
-		if( packet.read32(packetID) ) {
-			sdlremote_t* remote = SDLremotes[remoteIndex];
-
-			for( Uint32 c = 0; c < remote->resendStack.getSize(); ++c ) {
-				safepacket_t* safePacket = remote->resendStack[c];
-
-				if( safePacket->id == packetID ) {
-					remote->resendStack.remove(c);
-					delete safePacket;
-					break;
-				}
-			}
-		}
+Uint32 NetSDL::numRemoteHosts() const {
+	return (Uint32)SDLremotes.getSize();
+}
 
-		return 4;
+static void printNetStats(const char* name, Game* game, bool reset) {
+	if( !game || !game->getNet() || game->getNet()->getKind() != Net::SDL_NET ) {
+		return;
+	}
+	NetSDL* net = static_cast<NetSDL*>(game->getNet());
+	const NetSDL::stats_t& stats = net->getStats();
+	mainEngine->fmsg(Engine::MSG_INFO,"%s: %s", name, net->isThreaded() ? "own thread" : "main thread");
+	mainEngine->fmsg(Engine::MSG_INFO,"  received %u datagrams in %u batches (%.1f each), %u dropped, %u errors, at most %u waiting",
+		(Uint32)stats.recvDatagrams, (Uint32)stats.recvCalls,
+		stats.recvCalls ? (double)stats.recvDatagrams / stats.recvCalls : 0.0,
+		(Uint32)stats.recvDropped, (Uint32)stats.recvErrors, (Uint32)stats.recvPeak);
+	mainEngine->fmsg(Engine::MSG_INFO,"  sent %u datagrams in %u batches (%.1f each), %u dropped, %u errors, at most %u waiting",
+		(Uint32)stats.sendDatagrams, (Uint32)stats.sendCalls,
+		stats.sendCalls ? (double)stats.sendDatagrams / stats.sendCalls : 0.0,
+		(Uint32)stats.sendDropped, (Uint32)stats.sendErrors, (Uint32)stats.sendPeak);
+	if( reset ) {
+		net->resetStats();
 	}
+}
 
+static int console_netStats(int argc, const char** argv) {
+	bool reset = argc >= 1 && strcmp(argv[0], "reset") == 0;
+	printNetStats("server", mainEngine->getLocalServer(), reset);
+	printNetStats("client", mainEngine->getLocalClient(), reset);
 	return 0;
 }
 
-Uint32 NetSDL::numRemoteHosts() const {
-	return (Uint32)SDLremotes.getSize();
-}
+static Ccmd ccmd_netStats("net.stats","prints datagrams sent and received per batch, and how full the net thread's queues got (arg: 'reset' to zero the counters)",&console_netStats);
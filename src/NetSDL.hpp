@@ -5,12 +5,47 @@
 #include "Main.hpp"
 #include "Packet.hpp"
 #include "Net.hpp"
+#include "RingBuffer.hpp"
 
+// while a socket is open, a thread of its own does all the sending and receiving. datagrams
+// pass between it and the game thread through two lock-free queues, so the game thread never
+// makes a socket call or waits on a lock, and a burst of datagrams waits in the queue instead of
+// the socket buffer. the thread sends and receives in batches of up to batchSize datagrams.
 class NetSDL : public Net {
 public:
 	NetSDL(Game& _parent);
 	virtual ~NetSDL();
 
+	// datagrams each queue holds; any more are dropped, as the socket would
+	static const Uint32 queueSize = 1024;
+
+	// most datagrams sent or received by one call
+	static const Uint32 batchSize = 32;
+
+	// ms the thread waits for datagrams to arrive before it checks for some to send
+	static const Uint32 msThreadWait = 1;
+
+	// a datagram on its way to or from the socket
+	struct datagram_t {
+		IPaddress address;
+		Uint32 len = 0;
+		char data[Packet::maxLen];
+	};
+
+	// counters since the last resetStats()
+	struct stats_t {
+		std::atomic<Uint32> recvCalls{0};		// batches received
+		std::atomic<Uint32> recvDatagrams{0};	// datagrams received
+		std::atomic<Uint32> recvDropped{0};		// datagrams received while the queue was full
+		std::atomic<Uint32> recvErrors{0};		// failed receive calls
+		std::atomic<Uint32> sendCalls{0};		// batches sent
+		std::atomic<Uint32> sendDatagrams{0};	// datagrams sent
+		std::atomic<Uint32> sendDropped{0};		// datagrams sent while the queue was full
+		std::atomic<Uint32> sendErrors{0};		// datagrams the socket wouldn't take
+		std::atomic<Uint32> recvPeak{0};		// most datagrams waiting for the game thread
+		std::atomic<Uint32> sendPeak{0};		// most datagrams waiting for the net thread
+	};
+
 	// remote host
 	struct sdlremote_t : remote_t {
 		NetSDL* parent = nullptr;
@@ -76,22 +111,11 @@ public:
 	// @return true if the send succeeded, false otherwise
 	virtual bool sendPacket(Uint32 remoteID, const Packet& packet) override;
 
-	// just like sendPacket, except guarantees delivery
-	// @param packet the packet to send
-	// @param remoteID the id of the recipient
-	// @return true if the send succeeded, false otherwise
-	virtual bool sendPacketSafe(Uint32 remoteID, const Packet& packet) override;
-
 	// broadcasts a packet to all remote hosts
 	// @param packet the packet to send
 	// @return true if the send succeeded, false otherwise
 	virtual bool broadcast(Packet& packet) override;
 
-	// just like broadcast, except guarantees delivery
-	// @param packet the packet to send
-	// @return true if the send succeeded, false otherwise
-	virtual bool broadcastSafe(Packet& packet) override;
-
 	// pops a packet from the stack and returns it
 	// @param remoteIndex the index of the remote host to read a packet from (not the id!)
 	// @return the highest packet on the stack, or nullptr if no packets are left
@@ -112,19 +136,53 @@ public:
 
 	// getters & setters
 	const ArrayList<sdlremote_t*>&	getSDLRemoteHosts() const	{ return SDLremotes; }
+	const stats_t&					getStats() const			{ return stats; }
+	bool							isThreaded() const			{ return thread != nullptr; }
+
+	// zeroes the counters
+	void resetStats();
 
 protected:
-	UDPpacket* SDLsendPacket = nullptr;
-	UDPpacket* SDLrecvPacket = nullptr;
+	UDPpacket** SDLsendPackets = nullptr;
+	UDPpacket** SDLrecvPackets = nullptr;
 	UDPsocket SDLsocket;
+	SDLNet_SocketSet SDLsocketSet = nullptr;
 	ArrayList<sdlremote_t*> SDLremotes;
 	ArrayList<sdlrequest_t> SDLrequests;
 
-	// collects any available packets from the remote hosts and place them on a local stack
+	RingBuffer<datagram_t> sendQueue;		// pushed by the game thread, popped by the net thread
+	RingBuffer<datagram_t> recvQueue;		// pushed by the net thread, popped by the game thread
+	stats_t stats;
+	Uint32 recvDroppedReported = 0;			// recvDropped when we last warned about it
+
+	// sends and receives until the socket is closed
 	// @param data the NetSDL* obj to process
 	// @return 0 on success, non-zero on error
 	static int runThread(void* data);
 
+	// starts the net thread once the socket is open (unless net.thread is off)
+	void startThread();
+
+	// stops the net thread, sending what it still has, before the socket is closed
+	void stopThread();
+
+	// opens the socket and starts the net thread
+	// @param port the port to open, or 0 for any
+	void openSocket(Uint16 port);
+
+	// stops the net thread and closes the socket
+	void closeSocket();
+
+	// sends the datagrams waiting in sendQueue, in batches
+	void sendQueued();
+
+	// receives the datagrams waiting on the socket into recvQueue, in batches
+	void receiveQueued();
+
+	// hands a received datagram to its remote host, or notes a connection request
+	// @param datagram the datagram
+	void route(const datagram_t& datagram);
+
 	// completes a connection to a host
 	// @param data the request data
 	virtual void completeConnection(void* data) override;
@@ -15,33 +15,25 @@ class Node {
 public:
 	// insert node with given data anywhere in list
 	Node(LinkedList<T>& _list, Node<T>* next, const T& _data):
-		list(&_list),
 		data(_data)
 	{
-		if( next==nullptr ) {
-			if( list->getLast()==nullptr ) {
-				list->setFirst(this);
-				list->setLast(this);
-			} else {
-				setPrev(list->getLast());
-				list->getLast()->setNext(this);
-				list->setLast(this);
-			}
-		} else if( next==list->getFirst() ) {
-			setNext(list->getFirst());
-			list->getFirst()->setPrev(this);
-			list->setFirst(this);
-		} else {
-			Node<T>* prev = next->prev;
-			setPrev(prev);
-			setNext(next);
-			next->setPrev(this);
-			prev->setNext(this);
-		}
+		link(_list, next);
 	}
 
-	// will NOT remove node from list
+	// create a node that is not in any list. the node belongs to whatever holds it (usually
+	// as a member) rather than to a list, so lists will link and unlink it without ever
+	// allocating or freeing it
+	explicit Node(const T& _data):
+		data(_data),
+		hook(true)
+	{
+	}
+
+	// will NOT remove node from list, unless it is a hook
 	~Node() {
+		if( hook && list ) {
+			list->removeNode(this);
+		}
 	}
 
 	// getters & setters
@@ -55,6 +47,7 @@ public:
 	const LinkedList<T>*	getList() const						{ return (const LinkedList<T>*)(list); }
 	const T&				getData() const						{ return data; }
 	const Uint32			getSizeOfData() const				{ return (const Uint32)sizeof(data); }
+	bool					isHook() const						{ return hook; }
 
 	void	setNext(Node<T>* node)		{ next = node; }
 	void	setPrev(Node<T>* node)		{ prev = node; }
@@ -103,8 +96,55 @@ public:
 	}
 
 private:
+	friend class LinkedList<T>;
+
 	Node<T>*			next = nullptr;
 	Node<T>*			prev = nullptr;
-	LinkedList<T>*		list;
+	LinkedList<T>*		list = nullptr;
 	T					data;
+	bool				hook = false;	// if true, the node is not owned by its list
+
+	// links the node into a list (it must not already be in one)
+	// @param _list the list to join
+	// @param next the node to insert before, or nullptr to insert at the end
+	void link(LinkedList<T>& _list, Node<T>* next) {
+		list = &_list;
+		if( next==nullptr ) {
+			if( list->getLast()==nullptr ) {
+				list->setFirst(this);
+				list->setLast(this);
+			} else {
+				setPrev(list->getLast());
+				list->getLast()->setNext(this);
+				list->setLast(this);
+			}
+		} else if( next==list->getFirst() ) {
+			setNext(list->getFirst());
+			list->getFirst()->setPrev(this);
+			list->setFirst(this);
+		} else {
+			Node<T>* prev = next->prev;
+			setPrev(prev);
+			setNext(next);
+			next->setPrev(this);
+			prev->setNext(this);
+		}
+	}
+
+	// unlinks the node from its list
+	void unlink() {
+		if( prev ) {
+			prev->setNext(next);
+		} else {
+			list->setFirst(next);
+		}
+		if( next ) {
+			next->setPrev(prev);
+		} else {
+			list->setLast(prev);
+		}
+		next = nullptr;
+		prev = nullptr;
+		list = nullptr;
+	}
 };
\ No newline at end of file
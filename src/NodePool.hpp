@@ -0,0 +1,77 @@
+// NodePool.hpp
+// Recycles list node storage so busy lists don't hammer the heap
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <new>
+
+// templated NodePool
+// every thread keeps its own free list of node-sized blocks for each node type, so taking
+// and giving back storage never locks. blocks are allocated one at a time, which means a
+// block taken on one thread may be given back on another (it just joins that thread's free
+// list). each thread holds on to at most `capacity` spare blocks; extras go back to the heap.
+// @param N the node type whose storage is pooled
+template <typename N>
+class NodePool {
+public:
+	// maximum number of spare blocks kept per thread
+	static const Uint32 capacity = 4096;
+
+	// takes storage for one node (unconstructed)
+	// @return the storage
+	static void* take() {
+		freelist_t& freelist = getFreeList();
+		if( freelist.head ) {
+			block_t* block = freelist.head;
+			freelist.head = block->next;
+			--freelist.size;
+			return block;
+		}
+		return ::operator new(sizeof(N));
+	}
+
+	// gives back storage taken with take() (the node must already be destroyed)
+	// @param storage the storage to give back
+	static void give(void* storage) {
+		freelist_t& freelist = getFreeList();
+		if( freelist.size >= capacity ) {
+			::operator delete(storage);
+			return;
+		}
+		block_t* block = static_cast<block_t*>(storage);
+		block->next = freelist.head;
+		freelist.head = block;
+		++freelist.size;
+	}
+
+	// @return the number of spare blocks held by the calling thread
+	static Uint32 getSpare() {
+		return getFreeList().size;
+	}
+
+private:
+	struct block_t {
+		block_t* next;
+	};
+	static_assert(sizeof(N) >= sizeof(block_t), "node type is too small to pool");
+
+	struct freelist_t {
+		block_t* head = nullptr;
+		Uint32 size = 0;
+
+		~freelist_t() {
+			while( head ) {
+				block_t* next = head->next;
+				::operator delete(head);
+				head = next;
+			}
+		}
+	};
+
+	static freelist_t& getFreeList() {
+		static thread_local freelist_t freelist;
+		return freelist;
+	}
+};
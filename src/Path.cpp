@@ -3,10 +3,15 @@
 #include "Main.hpp"
 #include "TileWorld.hpp"
 
-#include <queue>
+#include <chrono>
 
 #include "Engine.hpp"
 #include "Path.hpp"
+#include "Server.hpp"
+#include "Random.hpp"
+#include "PathQueue.hpp"
+
+#include <atomic>
 
 PathFinder::PathFinder(TileWorld& world) :
 	world(world)
@@ -16,31 +21,67 @@ PathFinder::PathFinder(TileWorld& world) :
 
 PathFinder::~PathFinder()
 {
-	// wait for tasks to finish
-	for (auto& task : tasks) {
-		if (task.valid()) {
-			task.wait();
-		}
-	}
-	tasks.clear();
+	// searches still queued are dropped, and running ones finish before the cluster graph goes
+	mainEngine->getPathQueue().cancel(this);
 }
 
-void PathFinder::generateSimpleMap() {
-	mapWidth = world.getWidth();
-	mapHeight = world.getHeight();
-	map.resize(mapWidth * mapHeight);
+// grid versions are unique across every pathfinder, so results cached by version can't mix
+// up two worlds
+static std::atomic<Uint32> navVersions(0);
 
-	for (Uint32 index = 0; index < map.getSize(); ++index) {
-		map[index] = world.getTiles()[index].hasVolume() ? 1 : 0;
+void PathFinder::generateSimpleMap() {
+	std::shared_ptr<NavGrid> grid = std::make_shared<NavGrid>(world.getWidth(), world.getHeight(), ++navVersions);
+	for (Uint32 index = 0; index < grid->getSize(); ++index) {
+		grid->setWalkable(index, world.getTiles()[index].hasVolume());
 	}
+	publish(grid);
+
+	hierarchy.build(grid);
+}
+
+void PathFinder::publish(const NavSnapshot& grid) {
+	std::atomic_store(&snapshot, grid);
 }
 
-std::future<PathFinder::Path*> PathFinder::generateAStarPath(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY) {
-	if (map.getSize() == 0) {
+NavSnapshot PathFinder::getSnapshot() {
+	NavSnapshot result = std::atomic_load(&snapshot);
+	if (!result) {
 		generateSimpleMap();
+		result = std::atomic_load(&snapshot);
 	}
+	return result;
+}
+
+void PathFinder::invalidate(const Rect<int>& rect) {
+	NavSnapshot current = std::atomic_load(&snapshot);
+	if (!current) {
+		return; // the map is read fresh on the next request
+	}
+
+	// searches still running keep the old grid, so the changes go into a copy
+	std::shared_ptr<NavGrid> grid = std::make_shared<NavGrid>(*current, ++navVersions);
+	Sint32 startX = std::max(0, rect.x);
+	Sint32 startY = std::max(0, rect.y);
+	Sint32 endX = std::min((Sint32)grid->getWidth(), rect.x + rect.w);
+	Sint32 endY = std::min((Sint32)grid->getHeight(), rect.y + rect.h);
+	for (Sint32 x = startX; x < endX; ++x) {
+		for (Sint32 y = startY; y < endY; ++y) {
+			Uint32 index = y + x * grid->getHeight();
+			grid->setWalkable(index, world.getTiles()[index].hasVolume());
+		}
+	}
+	publish(grid);
+	hierarchy.invalidate(rect);
+}
 
-	if (map.getSize() == 0) {
+void PathFinder::reset() {
+	publish(nullptr);
+	hierarchy.clear();
+}
+
+std::future<PathFinder::Path*> PathFinder::generateAStarPath(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, Sint32 priority) {
+	NavSnapshot grid = getSnapshot();
+	if (grid->getSize() == 0) {
 		mainEngine->fmsg(Engine::MSG_WARN, "Pathfinder is returning an invalid path future due to failing to generate simple map!");
 		return std::future<Path*>(); // return invalid future
 	}
@@ -50,157 +91,408 @@ std::future<PathFinder::Path*> PathFinder::generateAStarPath(Sint32 startX, Sint
 		return std::future<Path*>(); // return invalid future
 	}
 	
-	AStarTask task(map, world.getWidth(), world.getHeight(), startX, startY, endX, endY);
-	return std::async(std::launch::async, task);
+	// long trips go over the cluster graph, which picks up edits here on the main thread
+	if (hierarchy.isDirty()) {
+		hierarchy.update(grid);
+	}
+	const PathHierarchy* graph = hierarchy.isWorthUsing(startX, startY, endX, endY) ? &hierarchy : nullptr;
+	return mainEngine->getPathQueue().submit(this, grid, graph, startX, startY, endX, endY, priority);
+}
+
+bool PathFinder::refinePath(Path& path, Sint32 x, Sint32 y) {
+	while (path.getFirst() && !path.getFirst()->getData().refined) {
+		const PathWaypoint waypoint = path.getFirst()->getData();
+		path.removeNode(path.getFirst());
+		if (waypoint.x == x && waypoint.y == y) {
+			continue; // already there
+		}
+
+		// the steps up to the waypoint replace it
+		Path* segment = AStarTask::search(*getSnapshot(), x, y, waypoint.x, waypoint.y);
+		if (segment->getSize() == 0) {
+			delete segment;
+			return false;
+		}
+		for (Node<PathWaypoint>* node = segment->getLast(); node != nullptr; node = node->getPrev()) {
+			path.addNodeFirst(node->getData());
+		}
+		delete segment;
+		break;
+	}
+	return true;
+}
+
+PathFinder::Path* PathFinder::HierarchicalTask::findPath()
+{
+	static thread_local ArrayList<Uint32> tiles;
+	Path* path = new Path;
+	if (hierarchy.findPath(startX, startY, endX, endY, tiles, &expanded)) {
+		for (auto tile : tiles) {
+			path->addNodeLast(PathWaypoint((Sint32)tile / hierarchy.getHeight(), (Sint32)tile % hierarchy.getHeight(), false));
+		}
+	} else {
+		mainEngine->fmsg(Engine::MSG_DEBUG, "Pathfinder could not find path from (%d, %d) to (%d, %d)!", startX, startY, endX, endY);
+	}
+	return path;
 }
 
 PathFinder::Path* PathFinder::AStarTask::findPath()
 {
-	LinkedList<PathFinder::PathNode*> openList, closedList;
+	Path* path = search(*grid, startX, startY, endX, endY, &expanded);
+	if (path->getSize() == 0 && (startX != endX || startY != endY))
+	{
+		mainEngine->fmsg(Engine::MSG_DEBUG, "Pathfinder could not find path from (%d, %d) to (%d, %d)!", startX, startY, endX, endY);
+	}
+	return path;
+}
+
+PathFinder::SearchState& PathFinder::SearchState::get()
+{
+	static thread_local SearchState state;
+	return state;
+}
+
+void PathFinder::SearchState::begin(Uint32 numNodes)
+{
+	if (stamp.getSize() < numNodes) {
+		stamp.resize(numNodes);
+		g.resize(numNodes);
+		f.resize(numNodes);
+		parent.resize(numNodes);
+		heapIndex.resize(numNodes);
+	}
+	if (++search == 0) {
+		memset(stamp.getArray(), 0, stamp.getSize() * sizeof(Uint32));
+		search = 1;
+	}
+
+	// searches that stay small only have a few words of the bitset to clear
+	Uint32 numWords = (numNodes + 31) / 32;
+	if (closed.getSize() != numWords || closedWords.getSize() > numWords / 8) {
+		closed.resize(numWords);
+		memset(closed.getArray(), 0, closed.getSize() * sizeof(Uint32));
+	} else {
+		for (auto word : closedWords) {
+			closed[word] = 0;
+		}
+	}
+	closedWords.clearKeepCapacity();
+	heap.clearKeepCapacity();
+}
+
+bool PathFinder::SearchState::relax(Uint32 node, Uint32 newG, Uint32 h, Uint32 from)
+{
+	if (stamp[node] != search) {
+		stamp[node] = search;
+		g[node] = newG;
+		f[node] = newG + h;
+		parent[node] = from;
+		heap.push(node);
+		siftUp(heap.getSize() - 1);
+		return true;
+	}
+	if (isClosed(node) || newG >= g[node]) {
+		return false;
+	}
+	f[node] -= g[node] - newG;
+	g[node] = newG;
+	parent[node] = from;
+	siftUp(heapIndex[node]);
+	return true;
+}
 
-	PathNode startnode(nullptr, std::min(std::max(0, startX), (Sint32)mapWidth - 1),
-						std::min(std::max(0, startY), (Sint32)mapHeight - 1), nullptr, 1);
-	PathNode endnode(nullptr, std::min(std::max(0, endX), (Sint32)mapWidth - 1),
-						std::min(std::max(0, endY), (Sint32)mapHeight - 1), nullptr, 1);
-	startnode.h = heuristic(startnode.x, startnode.y, endnode.x, endnode.y);
+Uint32 PathFinder::SearchState::pop()
+{
+	Uint32 top = heap[0];
+	Uint32 last = heap.pop();
+	heapIndex[top] = notInHeap;
+	if (heap.getSize() > 0) {
+		place(0, last);
+		siftDown(0);
+	}
+	return top;
+}
+
+void PathFinder::SearchState::siftUp(Uint32 pos)
+{
+	Uint32 node = heap[pos];
+	while (pos > 0) {
+		Uint32 up = (pos - 1) / 2;
+		if (!before(node, heap[up])) {
+			break;
+		}
+		place(pos, heap[up]);
+		pos = up;
+	}
+	place(pos, node);
+}
 
-	// final path
-	std::priority_queue<PathNode*> visitList;
+void PathFinder::SearchState::siftDown(Uint32 pos)
+{
+	Uint32 node = heap[pos];
+	Uint32 size = heap.getSize();
+	for (;;) {
+		Uint32 child = pos * 2 + 1;
+		if (child >= size) {
+			break;
+		}
+		if (child + 1 < size && before(heap[child + 1], heap[child])) {
+			++child;
+		}
+		if (!before(heap[child], node)) {
+			break;
+		}
+		place(pos, heap[child]);
+		pos = child;
+	}
+	place(pos, node);
+}
+
+PathFinder::Path* PathFinder::AStarTask::search(const NavGrid& grid,
+	Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, Uint32* outExpanded)
+{
 	Path* path = new Path;
+	if (outExpanded) {
+		*outExpanded = 0;
+	}
+	if (grid.getSize() == 0) {
+		return path;
+	}
 
-	if (startnode == endnode)
-	{
+	const Sint32 w = (Sint32)grid.getWidth();
+	const Sint32 h = (Sint32)grid.getHeight();
+	startX = std::min(std::max(0, startX), w - 1);
+	startY = std::min(std::max(0, startY), h - 1);
+	endX = std::min(std::max(0, endX), w - 1);
+	endY = std::min(std::max(0, endY), h - 1);
+	if (startX == endX && startY == endY) {
+		return path;
+	}
+	const Uint32 start = startY + startX * h;
+	const Uint32 goal = endY + endX * h;
+	if (!grid.isWalkable(goal)) {
 		return path;
 	}
 
-	// create starting node in list
-	PathNode* currentNode = new PathNode(&openList, startnode.x, startnode.y, nullptr, 0, startnode.h, startnode.g);
-	visitList.push(currentNode);
-	int tries = 0;
+	SearchState& s = SearchState::get();
+	s.begin(grid.getSize());
+	s.relax(start, 0, heuristic(startX, startY, endX, endY), start);
+
+	static const Sint32 dirX[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+	static const Sint32 dirY[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+	Uint32 expanded = 0;
 	bool foundPath = false;
-	while ( openList.getSize() > 0 && tries < MAX_TRIES && visitList.size() > 0 )
-	{
-		currentNode = visitList.top();
-		//mainEngine->fmsg(Engine::MSG_WARN, "Pathfinder current node coords: (%d, %d)!", currentNode->x, currentNode->y);
-		visitList.pop();
-		if ( *currentNode == endnode )
-		{
-			mainEngine->fmsg(Engine::MSG_WARN, "Pathfinder just hit the endnode!");
+	while (s.heap.getSize() > 0) {
+		Uint32 node = s.pop();
+		if (node == goal) {
 			foundPath = true;
 			break;
 		}
+		s.close(node);
+		++expanded;
 
-		// Move the current pathnode from the openList to the close list.
-		PathNode *movedNode = new PathNode(&closedList, currentNode->x, currentNode->y, currentNode->parent, 1, currentNode->h, currentNode->g);
-		openList.removeNode(currentNode->node);
-		delete currentNode;
-		currentNode = movedNode;
+		const Sint32 x = (Sint32)node / h;
+		const Sint32 y = (Sint32)node % h;
+		for (Uint32 dir = 0; dir < 8; ++dir) {
+			const Sint32 nx = x + dirX[dir];
+			const Sint32 ny = y + dirY[dir];
+			if (nx < 0 || ny < 0 || nx >= w || ny >= h) {
+				continue;
+			}
+			const Uint32 next = ny + nx * h;
+			if (!grid.isWalkable(next) || s.isClosed(next)) {
+				continue;
+			}
 
-		// expand search to neighbor tiles
-		for ( Sint32 y = -1; y <= 1; y++ ) {
-			for ( Sint32 x = -1; x <= 1; x++ ) {
-				if ( x == 0 && y == 0 ) {
-					continue; //Don't check yourself :)
-				}
-				if (currentNode->x <= 0 && x < 0)
-				{
-					continue; //Don't look off the left edge of the map.
-				}
-				if (currentNode->x >= (Sint32)mapWidth - 1 && x > 0)
-				{
-					continue; //Don't look off the right edge of the map.
-				}
-				if (currentNode->y <= 0 && y < 0)
-				{
-					continue; //Don't look off the top edge of the map.
-				}
-				if (currentNode->y >= (Sint32)mapHeight - 1 && y > 0)
-				{
-					continue; //Don't look off the bottom edge of the map.
-				}
+			// diagonal moves can't cut the corner of an obstacle
+			const bool diagonal = dir >= 4;
+			if (diagonal && (!grid.isWalkable(y + nx * h) || !grid.isWalkable(ny + x * h))) {
+				continue;
+			}
+
+			const Uint32 g = s.g[node] + (diagonal ? COST_DIAGONAL : COST_STRAIGHT);
+			s.relax(next, g, heuristic(nx, ny, endX, endY), node);
+		}
+	}
+	if (outExpanded) {
+		*outExpanded = expanded;
+	}
 
-                // check neighboring tiles are not obstacles
-                if ( !map[(currentNode->y + y) + (currentNode->x + x)*mapHeight] ) {
-                    continue;
-                } else if ( x && y ) {
-                    if ( !map[(currentNode->y) + (currentNode->x + x)*mapHeight] ) {
-                        continue;
-                    }
-                    if ( !map[(currentNode->y + y) + (currentNode->x)*mapHeight] ) {
-                        continue;
-                    }
-                }
-
-                bool alreadyAdded = false;
-                for ( auto &pathNode : closedList ) {
-                    if ( pathNode->x == currentNode->x + x && pathNode->y == currentNode->y + y ) {
-                        alreadyAdded = true;
-                        break;
-                    }
-                }
-
-				for ( auto &pathNode : openList ) {
-					if ( pathNode->x == currentNode->x + x && pathNode->y == currentNode->y + y ) {
-						alreadyAdded = true;
-						if ( x && y ) {
-							if ( pathNode->g > currentNode->g + COST_DIAGONAL ) {
-								pathNode->parent = currentNode;
-								pathNode->g = currentNode->g + COST_DIAGONAL;
-							}
-						} else {
-							if ( pathNode->g > currentNode->g + COST_STRAIGHT ) {
-								pathNode->parent = currentNode;
-								pathNode->g = currentNode->g + COST_STRAIGHT;
-							}
+	// retrace the path from the goal, then hand it back in walking order
+	if (foundPath) {
+		static thread_local ArrayList<Uint32> nodes;
+		nodes.clearKeepCapacity();
+		for (Uint32 node = goal; node != start; node = s.parent[node]) {
+			nodes.push(node);
+		}
+		for (Uint32 c = nodes.getSize(); c > 0; --c) {
+			Uint32 node = nodes[c - 1];
+			path->addNodeLast(PathWaypoint((Sint32)node / h, (Sint32)node % h));
+		}
+	}
+
+	return path;
+}
+
+static int console_pathBenchmark(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"path.benchmark needs a running server.");
+		return 1;
+	}
+
+	Uint32 numPaths = 1000;
+	Uint32 numDungeons = 4;
+	const char* genPath = "maps/tilesets/template.json";
+	if( argc >= 1 ) {
+		numPaths = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		numDungeons = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+	if( argc >= 3 ) {
+		genPath = argv[2];
+	}
+
+	int result = 0;
+	Uint32 totalPaths = 0, totalReachable = 0, totalFound = 0;
+	double totalTime = 0.0;
+	for( Uint32 dungeon = 0; dungeon < numDungeons; ++dungeon ) {
+		// generate a scratch dungeon that isn't part of the game
+		ArrayList<Uint32> open;
+		TileWorld* world = TileWorld::generateScratch(server, genPath, dungeon + 1, true, open);
+		if( world == nullptr ) {
+			return 1;
+		}
+
+		// the pathfinder's own map, plus connected regions so every failure can be told apart
+		// from a goal that really is out of reach
+		NavSnapshot grid = world->getPathFinder().getSnapshot();
+		const NavGrid& map = *grid;
+		const Uint32 w = map.getWidth();
+		const Uint32 h = map.getHeight();
+		ArrayList<Uint32> region;
+		region.resize(w * h);
+		memset(region.getArray(), 0, region.getSize() * sizeof(Uint32));
+		ArrayList<Uint32> stack;
+		Uint32 numRegions = 0;
+		for( auto c : open ) {
+			if( region[c] ) {
+				continue;
+			}
+			region[c] = ++numRegions;
+			stack.push(c);
+			while( stack.getSize() ) {
+				Uint32 node = stack.pop();
+				Sint32 x = node / h, y = node % h;
+				for( Sint32 u = std::max(0, x - 1); u <= std::min((Sint32)w - 1, x + 1); ++u ) {
+					for( Sint32 v = std::max(0, y - 1); v <= std::min((Sint32)h - 1, y + 1); ++v ) {
+						Uint32 next = v + u * h;
+						if( !map.isWalkable(next) || region[next] || (u != x && v != y && (!map.isWalkable(y + u * h) || !map.isWalkable(v + x * h))) ) {
+							continue;
 						}
-						break;
+						region[next] = numRegions;
+						stack.push(next);
 					}
 				}
-				
-                if ( alreadyAdded == false ) {
-                    if ( openList.getSize() >= 1000 ) {
-						mainEngine->fmsg(Engine::MSG_WARN, "Pathfinder exceeded maximum tries!");
-                        return path;
-                    }
-                    PathNode *childnode = new PathNode(&openList, currentNode->x + x, currentNode->y + y, currentNode, 1);
-                    if ( x && y ) {
-                        childnode->g = currentNode->g + COST_DIAGONAL;
-                    }
-                    else {
-                        childnode->g = currentNode->g + COST_STRAIGHT;
-                    }
-					childnode->h = heuristic(childnode->x, childnode->y, endnode.x, endnode.y);
-                    visitList.push(childnode);
-					//mainEngine->fmsg(Engine::MSG_WARN, "Queueing up pathnode for (%d, %d)", childnode->x, childnode->y);
-                }
 			}
 		}
-		++tries;
-	}
 
-	// if target is found, retrace path
-	if ( true == foundPath ) {
-		if (currentNode->parent == nullptr)
-		{
-			return path; //Already on the goal tile!
+		Random rand;
+		rand.seedValue(1234 + dungeon);
+		ArrayList<Uint32> starts, ends;
+		for( Uint32 c = 0; c < numPaths; ++c ) {
+			starts.push(open[rand.getUint32() % open.getSize()]);
+			ends.push(open[rand.getUint32() % open.getSize()]);
 		}
 
-		PathNode* parent = currentNode->parent;
-		for ( PathNode *childnode = currentNode; childnode != nullptr; childnode = currentNode->parent )
-		{
-			if ( childnode->parent == nullptr && nullptr != parent )
-			{
-				parent->parent = nullptr;
-				break;
+		// the cost of walking a path of tile steps
+		auto pathCost = [](Uint32 from, Uint32 h, const PathFinder::Path& path) {
+			Uint64 cost = 0;
+			Sint32 x = from / h, y = from % h;
+			for( auto& waypoint : path ) {
+				bool diagonal = waypoint.x != x && waypoint.y != y;
+				cost += diagonal ? PathFinder::AStarTask::COST_DIAGONAL : PathFinder::AStarTask::COST_STRAIGHT;
+				x = waypoint.x;
+				y = waypoint.y;
 			}
-			path->addNodeLast(PathWaypoint(childnode->x, childnode->y));
-			currentNode = currentNode->parent;
+			return cost;
+		};
+
+		Uint32 reachable = 0, found = 0, wrong = 0, waypoints = 0;
+		Uint64 expanded = 0, optimalCost = 0;
+		auto start = std::chrono::steady_clock::now();
+		for( Uint32 c = 0; c < numPaths; ++c ) {
+			Uint32 expandedThis = 0;
+			PathFinder::Path* path = PathFinder::AStarTask::search(map,
+				starts[c] / h, starts[c] % h, ends[c] / h, ends[c] % h, &expandedThis);
+			expanded += expandedThis;
+			bool canReach = region[starts[c]] == region[ends[c]] && starts[c] != ends[c];
+			bool didReach = path->getSize() > 0;
+			reachable += canReach ? 1 : 0;
+			found += didReach ? 1 : 0;
+			wrong += canReach != didReach ? 1 : 0;
+			waypoints += path->getSize();
+			optimalCost += pathCost(starts[c], h, *path);
+			delete path;
 		}
-	}
-	else
-	{
-		mainEngine->fmsg(Engine::MSG_WARN, "Pathfinder could not find path!");
+		std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+
+		// the same trips over the cluster graph, then refined the way a follower would
+		PathHierarchy hierarchy;
+		auto buildStart = std::chrono::steady_clock::now();
+		hierarchy.build(grid);
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - buildStart;
+		Uint32 hierarchicalFound = 0, hierarchicalWrong = 0;
+		Uint64 hierarchicalExpanded = 0, hierarchicalCost = 0;
+		ArrayList<Uint32> tiles;
+		start = std::chrono::steady_clock::now();
+		for( Uint32 c = 0; c < numPaths; ++c ) {
+			Uint32 expandedThis = 0;
+			bool canReach = region[starts[c]] == region[ends[c]] && starts[c] != ends[c];
+			bool didReach = hierarchy.findPath(starts[c] / h, starts[c] % h, ends[c] / h, ends[c] % h, tiles, &expandedThis) && tiles.getSize() > 0;
+			hierarchicalExpanded += expandedThis;
+			hierarchicalFound += didReach ? 1 : 0;
+			hierarchicalWrong += canReach != didReach ? 1 : 0;
+		}
+		std::chrono::duration<double, std::milli> abstractTime = std::chrono::steady_clock::now() - start;
+		start = std::chrono::steady_clock::now();
+		for( Uint32 c = 0; c < numPaths; ++c ) {
+			if( !hierarchy.findPath(starts[c] / h, starts[c] % h, ends[c] / h, ends[c] % h, tiles) ) {
+				continue;
+			}
+			Uint32 from = starts[c];
+			for( auto tile : tiles ) {
+				PathFinder::Path* segment = PathFinder::AStarTask::search(map, from / h, from % h, tile / h, tile % h);
+				hierarchicalCost += pathCost(from, h, *segment);
+				delete segment;
+				from = tile;
+			}
+		}
+		std::chrono::duration<double, std::milli> refinedTime = std::chrono::steady_clock::now() - start;
+
+		mainEngine->fmsg(Engine::MSG_INFO,"dungeon %u (%u x %u, %u open tiles, %u regions): %.0f paths/sec, %u/%u reachable found, %u wrong, %.1f waypoints and %.0f expansions per path",
+			dungeon + 1, w, h, open.getSize(), numRegions, numPaths / (time.count() / 1000.0), found, reachable, wrong,
+			(float)waypoints / numPaths, (double)expanded / numPaths);
+		mainEngine->fmsg(Engine::MSG_INFO,"  hierarchical (%u clusters, %u nodes, built in %.1f ms): %.0f paths/sec coarse, %.0f refined, %u found, %u wrong, %.0f expansions per path, %.1f%% longer",
+			hierarchy.getNumClusters(), hierarchy.getNumNodes(), buildTime.count(),
+			numPaths / (abstractTime.count() / 1000.0), numPaths / (refinedTime.count() / 1000.0),
+			hierarchicalFound, hierarchicalWrong, (double)hierarchicalExpanded / numPaths,
+			optimalCost ? 100.0 * ((double)hierarchicalCost - (double)optimalCost) / (double)optimalCost : 0.0);
+		totalPaths += numPaths;
+		totalReachable += reachable;
+		totalFound += found;
+		totalTime += time.count();
+		if( wrong || hierarchicalWrong ) {
+			result = 1;
+		}
+
+		delete world;
 	}
 
-	return path;
+	mainEngine->fmsg(Engine::MSG_INFO,"%u paths over %u dungeons: %.0f paths/sec, success rate %.1f%%",
+		totalPaths, numDungeons, totalPaths / (totalTime / 1000.0), totalReachable ? 100.0 * totalFound / totalReachable : 100.0);
+	return result;
 }
+
+static Ccmd ccmd_pathBenchmark("path.benchmark","times A* between random tiles of generated dungeons (args: paths per dungeon, dungeon count, generator path)",&console_pathBenchmark);
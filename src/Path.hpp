@@ -4,6 +4,9 @@
 
 #include "Main.hpp"
 #include "LinkedList.hpp"
+#include "Rect.hpp"
+#include "NavGrid.hpp"
+#include "PathHierarchy.hpp"
 
 #include <future>
 
@@ -11,7 +14,7 @@ class TileWorld;
 
 /*
  * Pathfinder usage flow (after constructing with a valid world):
- * * pathfinder.generateSimpleMap(); //This updates the pathfinder's copy. This only needs to be done after world generation, and if the terrain ever changes.
+ * * pathfinder.generateSimpleMap(); //This publishes a snapshot of the map. It's done on the first request, and invalidate() publishes a new one if the terrain ever changes.
  * * std::future pathTask = pathfinder.generateAStarPath(x1, y1, x2, y2);
  * Then you just keep querying the pathTask via wait_for with 0 duration
  */
@@ -22,8 +25,6 @@ class TileWorld;
  * There is one pathfinder per world. It provides asynchronous pathfinding.
  */
 class PathFinder {
-protected:
-	class PathNode;
 public:
 	PathFinder(TileWorld& world);
 	~PathFinder();
@@ -31,30 +32,78 @@ public:
 	// Path Waypoint
 	class PathWaypoint {
 	public:
-		PathWaypoint(int x, int y):
-            x(x), y(y) {}
+		PathWaypoint(int x, int y, bool refined = true):
+            x(x), y(y), refined(refined) {}
 		~PathWaypoint() {}
 
-		bool operator==(const PathNode& rhs) const {
-			if ( rhs.x == x && rhs.y == y ) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-
 		Sint32 x = 0, y = 0;
+		bool refined = true; // false for a hierarchical waypoint; see PathFinder::refinePath()
 	};
 	using Path = LinkedList<PathWaypoint>;
     
+    // per-thread search state, indexed like the map (y + x * mapHeight). a node's g, f, and
+    // parent are only valid when its stamp matches the current search, which saves clearing
+    // them every time. the open list is a binary heap keyed on f that can lower a node's key
+    // in place, and the closed list is a bitset
+    class SearchState {
+    public:
+        static const Uint32 notInHeap = UINT32_MAX;
+
+        ArrayList<Uint32> stamp;
+        ArrayList<Uint32> g;            // cost from the start
+        ArrayList<Uint32> f;            // g + heuristic
+        ArrayList<Uint32> parent;
+        ArrayList<Uint32> heapIndex;    // position in the heap, or notInHeap
+        ArrayList<Uint32> closed;       // one bit per node
+        ArrayList<Uint32> closedWords;  // words of closed that aren't zero
+        ArrayList<Uint32> heap;         // open nodes
+        Uint32 search = 0;
+
+        // @return the calling thread's state
+        static SearchState& get();
+
+        // starts a new search
+        // @param numNodes the size of the map
+        void begin(Uint32 numNodes);
+
+        bool isOpen(Uint32 node) const      { return stamp[node] == search; }
+        bool isClosed(Uint32 node) const    { return (closed[node >> 5] >> (node & 31)) & 1; }
+        void close(Uint32 node) {
+            Uint32& word = closed[node >> 5];
+            if (!word) {
+                closedWords.push(node >> 5);
+            }
+            word |= 1u << (node & 31);
+        }
+
+        // opens a node, or lowers its cost if the new route is cheaper
+        // @return true if the node was opened or lowered
+        bool relax(Uint32 node, Uint32 newG, Uint32 h, Uint32 from);
+
+        // @return the open node with the lowest f, which leaves the heap
+        Uint32 pop();
+
+    private:
+        // lower f first, then higher g (the node nearer the goal)
+        bool before(Uint32 a, Uint32 b) const {
+            return f[a] < f[b] || (f[a] == f[b] && g[a] > g[b]);
+        }
+
+        void place(Uint32 pos, Uint32 node) {
+            heap[pos] = node;
+            heapIndex[node] = pos;
+        }
+
+        void siftUp(Uint32 pos);
+        void siftDown(Uint32 pos);
+    };
+
     // Asynchronous Path Task (Path process)
     class Task {
     public:
-        Task(const ArrayList<Uint32>& _map, Uint32 _mapWidth, Uint32 _mapHeight,
+        Task(const NavSnapshot& _grid,
         Sint32 _startX, Sint32 _startY, Sint32 _endX, Sint32 _endY) :
-            map(_map),
-            mapWidth(_mapWidth),
-            mapHeight(_mapHeight),
+            grid(_grid),
             startX(_startX),
             startY(_startY),
             endX(_endX),
@@ -67,11 +116,14 @@ public:
             return findPath();
         }
 
+        // @return the number of nodes the last findPath() expanded
+        Uint32 getExpanded() const { return expanded; }
+
     protected:
-        ArrayList<Uint32> map;
-        Uint32 mapWidth, mapHeight;
+        NavSnapshot grid; // shared, so the task keeps the map it started with
         Sint32 startX, startY;
         Sint32 endX, endY;
+        Uint32 expanded = 0;
     };
 
 	// class Future : pathTask {
@@ -87,80 +139,89 @@ public:
     public:
         static const Uint32 COST_STRAIGHT = 10;
         static const Uint32 COST_DIAGONAL = 14;
-        static const Uint32 MAX_TRIES = 10000;
 
-        AStarTask(const ArrayList<Uint32>& _map, Uint32 _mapWidth, Uint32 _mapHeight,
+        AStarTask(const NavSnapshot& _grid,
         Sint32 _startX, Sint32 _startY, Sint32 _endX, Sint32 _endY) :
-            Task(_map, _mapWidth, _mapHeight, _startX, _startY, _endX, _endY) {}
+            Task(_grid, _startX, _startY, _endX, _endY) {}
 
         Path* findPath() override;
 
-    protected:
+        // searches a map on the calling thread, using the thread's SearchState, so no step
+        // scans a list or allocates
+        // @param grid the walkable tiles
+        // @param startX the start x coordinate (clamped to the map)
+        // @param startY the start y coordinate (clamped to the map)
+        // @param endX the goal x coordinate (clamped to the map)
+        // @param endY the goal y coordinate (clamped to the map)
+        // @param outExpanded if not null, receives the number of nodes expanded
+        // @return waypoints from the tile after the start to the goal, empty if there is no
+        // path or the start is the goal
+        static Path* search(const NavGrid& grid,
+            Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, Uint32* outExpanded = nullptr);
+
+        // octile distance: the exact cost of the best path across open ground
         static Uint32 heuristic(Sint32 x1, Sint32 y1, Sint32 x2, Sint32 y2) {
-            return (std::abs(x2 - x1) + std::abs(y2 - y1)) * COST_STRAIGHT;
+            Uint32 dx = (Uint32)std::abs(x2 - x1);
+            Uint32 dy = (Uint32)std::abs(y2 - y1);
+            return COST_STRAIGHT * std::max(dx, dy) + (COST_DIAGONAL - COST_STRAIGHT) * std::min(dx, dy);
         }
     };
 
+    // Hierarchical Path Task (searches the cluster graph, see PathHierarchy)
+    class HierarchicalTask : public Task {
+    public:
+        HierarchicalTask(const PathHierarchy& _hierarchy, const NavSnapshot& _grid,
+        Sint32 _startX, Sint32 _startY, Sint32 _endX, Sint32 _endY) :
+            Task(_grid, _startX, _startY, _endX, _endY),
+            hierarchy(_hierarchy) {}
+
+        Path* findPath() override;
+
+    protected:
+        const PathHierarchy& hierarchy;
+    };
+
 	/*
-	 * Creates a PathTask object. Asynchronous pathfinding.
+	 * Queues a search on the engine's PathQueue. Asynchronous pathfinding.
+	 * Requests with a higher priority are searched first.
 	 * 
 	 * (You can use wait_for with 0 duration :) )
 	 */
-	std::future<Path*> generateAStarPath(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY);
+	std::future<Path*> generateAStarPath(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, Sint32 priority = 0);
+
+	// expands the first waypoints of a path up to and including the first unrefined one into
+	// tile steps. hierarchical paths come back coarse, and only the part actually being
+	// followed is refined
+	// @param path the path to refine
+	// @param x the follower's current x coordinate (in tiles)
+	// @param y the follower's current y coordinate (in tiles)
+	// @return false if the waypoint can no longer be reached
+	bool refinePath(Path& path, Sint32 x, Sint32 y);
+
+	// re-reads the given tiles. the cluster graph rebuilds the touched clusters the next time
+	// a path is requested
+	// @param rect the changed tiles
+	void invalidate(const Rect<int>& rect);
+
+	// throws away the map and cluster graph (call when the world changes size)
+	void reset();
+
+	// @return the latest published map, read from the world first if there isn't one. safe
+	// to hold onto from any thread; it never changes
+	NavSnapshot getSnapshot();
 
 protected:
 	TileWorld& world;
 
-    ArrayList<std::future<PathFinder::Path*>> tasks;
+	PathHierarchy hierarchy;
 
-	// Path node
-	class PathNode {
-	public:
-		PathNode(LinkedList<PathNode*>* list, int x, int y, PathNode* parent, int pos, int h = 0, int g = 0) {
-			this->list = list;
-			this->x = x;
-			this->y = y;
-			this->parent = parent;
-			this->g = g;
-			this->h = h;
-
-			if (nullptr != list)
-			{
-				if ( 0 == pos ) {
-					node = list->addNodeFirst(this);
-				} else {
-					node = list->addNodeLast(this);
-				}
-			}
-			else
-			{
-				node = nullptr;
-			}
-		}
-		~PathNode() {}
-
-		PathNode** add(PathNode& child, Uint32 pos);
-		PathNode** remove(PathNode& child, Uint32 pos);
-
-		bool operator==(const PathNode& rhs) const {
-			if ( rhs.x == x && rhs.y == y ) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-
-		PathNode* parent = nullptr;
-		Sint32 x = 0, y = 0;
-		Uint32 g = 0, h = 0; //These are the A* heuristics. We're using Manhattan Distance.
-		LinkedList<PathNode*>* list = nullptr;
-		Node<PathNode*>* node = nullptr;
-	};
+    NavSnapshot snapshot;   // only swapped with std::atomic_store
+
+    // reads every tile into a new grid and publishes it
+    void generateSimpleMap();
 
-    ArrayList<Uint32> map;
-    Uint32 mapWidth = 0;
-    Uint32 mapHeight = 0;
-    void generateSimpleMap(); //TODO Make sure accessing this result is threadsafe...every thread should probably get a copy of the map on creation.
+    // swaps in a new grid for everyone who asks from now on
+    void publish(const NavSnapshot& grid);
 };
 
 // class pathTask
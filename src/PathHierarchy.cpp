@@ -0,0 +1,365 @@
+// PathHierarchy.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "PathHierarchy.hpp"
+#include "Path.hpp"
+#include "Chunk.hpp"
+
+#include <mutex>
+
+static Cvar cvar_pathHierarchical("path.hierarchical", "search long paths over the cluster graph before refining them", "1");
+static Cvar cvar_pathCluster("path.cluster", "width of a pathfinding cluster, in tiles (rounded up to whole chunks)", "16");
+
+// transitions are placed at both ends of openings at least this wide, otherwise in the middle
+static const Sint32 wideOpening = 6;
+
+Uint32 PathHierarchy::getNumNodes() const {
+	Uint32 result = 0;
+	for( auto& cluster : clusters ) {
+		result += cluster.nodes.getSize();
+	}
+	return result;
+}
+
+void PathHierarchy::clear() {
+	std::unique_lock<std::shared_timed_mutex> lock(mutex);
+	grid.reset();
+	width = 0;
+	height = 0;
+	clusterSize = 0;
+	clustersWidth = 0;
+	clustersHeight = 0;
+	clusters.clear();
+	nodeSlots.clear();
+	dirty = false;
+}
+
+void PathHierarchy::build(const NavSnapshot& _grid, Uint32 _clusterSize) {
+	clear();
+	std::unique_lock<std::shared_timed_mutex> lock(mutex);
+	if( _clusterSize == 0 ) {
+		_clusterSize = (Uint32)std::max(1, cvar_pathCluster.toInt());
+	}
+	_clusterSize = ((_clusterSize + Chunk::size - 1) / Chunk::size) * Chunk::size;
+
+	grid = _grid;
+	width = (Sint32)grid->getWidth();
+	height = (Sint32)grid->getHeight();
+	clusterSize = _clusterSize;
+	clustersWidth = (width + (Sint32)clusterSize - 1) / (Sint32)clusterSize;
+	clustersHeight = (height + (Sint32)clusterSize - 1) / (Sint32)clusterSize;
+	clusters.resize(clustersWidth * clustersHeight);
+	nodeSlots.resize(width * height);
+	for( auto& slot : nodeSlots ) {
+		slot = noSlot;
+	}
+
+	for( Sint32 cX = 0; cX < clustersWidth; ++cX ) {
+		for( Sint32 cY = 0; cY < clustersHeight; ++cY ) {
+			buildCluster(cX, cY);
+		}
+	}
+}
+
+void PathHierarchy::invalidate(const Rect<int>& rect) {
+	if( !isBuilt() || rect.w <= 0 || rect.h <= 0 ) {
+		return;
+	}
+	Sint32 startX = std::max(0, rect.x / (Sint32)clusterSize);
+	Sint32 startY = std::max(0, rect.y / (Sint32)clusterSize);
+	Sint32 endX = std::min(clustersWidth - 1, (rect.x + rect.w - 1) / (Sint32)clusterSize);
+	Sint32 endY = std::min(clustersHeight - 1, (rect.y + rect.h - 1) / (Sint32)clusterSize);
+	for( Sint32 cX = startX; cX <= endX; ++cX ) {
+		for( Sint32 cY = startY; cY <= endY; ++cY ) {
+			clusters[cY + cX * clustersHeight].dirty = true;
+			dirty = true;
+		}
+	}
+}
+
+Uint32 PathHierarchy::update(const NavSnapshot& _grid) {
+	if( !dirty ) {
+		return 0;
+	}
+	std::unique_lock<std::shared_timed_mutex> lock(mutex);
+	dirty = false;
+	grid = _grid;
+
+	// a changed cluster shares its borders with its neighbors, so their transitions move too
+	ArrayList<Uint8> rebuild;
+	rebuild.resize(clusters.getSize());
+	memset(rebuild.getArray(), 0, rebuild.getSize());
+	for( Sint32 cX = 0; cX < clustersWidth; ++cX ) {
+		for( Sint32 cY = 0; cY < clustersHeight; ++cY ) {
+			cluster_t& cluster = clusters[cY + cX * clustersHeight];
+			if( !cluster.dirty ) {
+				continue;
+			}
+			cluster.dirty = false;
+			rebuild[cY + cX * clustersHeight] = 1;
+			if( cX > 0 ) rebuild[cY + (cX - 1) * clustersHeight] = 1;
+			if( cY > 0 ) rebuild[(cY - 1) + cX * clustersHeight] = 1;
+			if( cX < clustersWidth - 1 ) rebuild[cY + (cX + 1) * clustersHeight] = 1;
+			if( cY < clustersHeight - 1 ) rebuild[(cY + 1) + cX * clustersHeight] = 1;
+		}
+	}
+
+	Uint32 result = 0;
+	for( Sint32 cX = 0; cX < clustersWidth; ++cX ) {
+		for( Sint32 cY = 0; cY < clustersHeight; ++cY ) {
+			if( rebuild[cY + cX * clustersHeight] ) {
+				buildCluster(cX, cY);
+				++result;
+			}
+		}
+	}
+	return result;
+}
+
+bool PathHierarchy::isWorthUsing(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY) const {
+	if( !isBuilt() || !cvar_pathHierarchical.toInt() ) {
+		return false;
+	}
+
+	// short trips are cheaper on the grid
+	return std::abs(endX - startX) + std::abs(endY - startY) > (Sint32)clusterSize;
+}
+
+void PathHierarchy::findTransitions(Sint32 cX, Sint32 cY, bool south, ArrayList<Uint32>& outTiles) const {
+	outTiles.clearKeepCapacity();
+
+	// the border runs along one line of tiles inside the cluster and one just outside
+	Sint32 inside = (south ? cY + 1 : cX + 1) * (Sint32)clusterSize - 1;
+	if( inside + 1 >= (south ? height : width) ) {
+		return;
+	}
+	Sint32 begin = (south ? cX : cY) * (Sint32)clusterSize;
+	Sint32 end = std::min(begin + (Sint32)clusterSize, south ? width : height);
+	auto tileAt = [&](Sint32 along, Sint32 across) -> Uint32 {
+		return south ? (Uint32)(across + along * height) : (Uint32)(along + across * height);
+	};
+
+	Sint32 run = begin;
+	for( Sint32 c = begin; c <= end; ++c ) {
+		bool open = c < end && grid->isWalkable(tileAt(c, inside)) && grid->isWalkable(tileAt(c, inside + 1));
+		if( open ) {
+			continue;
+		}
+		Sint32 length = c - run;
+		if( length >= wideOpening ) {
+			outTiles.push(tileAt(run, inside));
+			outTiles.push(tileAt(c - 1, inside));
+		} else if( length > 0 ) {
+			outTiles.push(tileAt(run + length / 2, inside));
+		}
+		run = c + 1;
+	}
+}
+
+void PathHierarchy::addNode(cluster_t& cluster, Uint32 tile, Uint32 side, Uint32 across) {
+	Uint16& slot = nodeSlots[tile];
+	if( slot == noSlot ) {
+		node_t node;
+		node.tile = tile;
+		for( int c = 0; c < 4; ++c ) {
+			node.across[c] = UINT32_MAX;
+		}
+		slot = (Uint16)cluster.nodes.getSize();
+		cluster.nodes.push(node);
+	}
+	cluster.nodes[slot].across[side] = across;
+}
+
+void PathHierarchy::buildCluster(Sint32 cX, Sint32 cY) {
+	cluster_t& cluster = clusters[cY + cX * clustersHeight];
+	for( auto& node : cluster.nodes ) {
+		nodeSlots[node.tile] = noSlot;
+	}
+	cluster.nodes.clearKeepCapacity();
+
+	// both clusters on a border find the same transitions, so each node's partner across the
+	// border is always a node of the neighbor
+	static thread_local ArrayList<Uint32> tiles;
+	findTransitions(cX, cY, false, tiles);
+	for( auto tile : tiles ) {
+		addNode(cluster, tile, 0, tile + height);
+	}
+	findTransitions(cX, cY, true, tiles);
+	for( auto tile : tiles ) {
+		addNode(cluster, tile, 1, tile + 1);
+	}
+	if( cX > 0 ) {
+		findTransitions(cX - 1, cY, false, tiles);
+		for( auto tile : tiles ) {
+			addNode(cluster, tile + height, 2, tile);
+		}
+	}
+	if( cY > 0 ) {
+		findTransitions(cX, cY - 1, true, tiles);
+		for( auto tile : tiles ) {
+			addNode(cluster, tile + 1, 3, tile);
+		}
+	}
+
+	// costs between every pair of nodes, staying inside the cluster
+	const Uint32 numNodes = cluster.nodes.getSize();
+	cluster.costs.resize(numNodes * numNodes);
+	PathFinder::SearchState& s = PathFinder::SearchState::get();
+	for( Uint32 a = 0; a < numNodes; ++a ) {
+		floodCluster(cX, cY, cluster.nodes[a].tile);
+		for( Uint32 b = 0; b < numNodes; ++b ) {
+			Uint32 tile = cluster.nodes[b].tile;
+			cluster.costs[b + a * numNodes] = s.isOpen(tile) ? s.g[tile] : noCost;
+		}
+	}
+}
+
+void PathHierarchy::floodCluster(Sint32 cX, Sint32 cY, Uint32 from) const {
+	static const Sint32 dirX[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+	static const Sint32 dirY[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+	const Sint32 startX = cX * (Sint32)clusterSize;
+	const Sint32 startY = cY * (Sint32)clusterSize;
+	const Sint32 endX = std::min(startX + (Sint32)clusterSize, width);
+	const Sint32 endY = std::min(startY + (Sint32)clusterSize, height);
+
+	const NavGrid& map = *grid;
+	PathFinder::SearchState& s = PathFinder::SearchState::get();
+	s.begin(width * height);
+	s.relax(from, 0, 0, from);
+	while( s.heap.getSize() > 0 ) {
+		Uint32 node = s.pop();
+		s.close(node);
+		const Sint32 x = (Sint32)node / height;
+		const Sint32 y = (Sint32)node % height;
+		for( Uint32 dir = 0; dir < 8; ++dir ) {
+			const Sint32 nx = x + dirX[dir];
+			const Sint32 ny = y + dirY[dir];
+			if( nx < startX || ny < startY || nx >= endX || ny >= endY ) {
+				continue;
+			}
+			const Uint32 next = ny + nx * height;
+			if( !map.isWalkable(next) || s.isClosed(next) ) {
+				continue;
+			}
+			const bool diagonal = dir >= 4;
+			if( diagonal && (!map.isWalkable(y + nx * height) || !map.isWalkable(ny + x * height)) ) {
+				continue;
+			}
+			s.relax(next, s.g[node] + (diagonal ? PathFinder::AStarTask::COST_DIAGONAL : PathFinder::AStarTask::COST_STRAIGHT), 0, node);
+		}
+	}
+}
+
+bool PathHierarchy::findPath(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, ArrayList<Uint32>& outTiles, Uint32* outExpanded) const {
+	std::shared_lock<std::shared_timed_mutex> lock(mutex);
+	outTiles.clearKeepCapacity();
+	if( outExpanded ) {
+		*outExpanded = 0;
+	}
+	if( !isBuilt() ) {
+		return false;
+	}
+
+	startX = std::min(std::max(0, startX), width - 1);
+	startY = std::min(std::max(0, startY), height - 1);
+	endX = std::min(std::max(0, endX), width - 1);
+	endY = std::min(std::max(0, endY), height - 1);
+	const Uint32 start = startY + startX * height;
+	const Uint32 goal = endY + endX * height;
+	if( !grid->isWalkable(goal) ) {
+		return false;
+	}
+	if( start == goal ) {
+		return true;
+	}
+
+	// connect the start and goal to the nodes of their clusters
+	const Uint32 startCluster = clusterOf(startX, startY);
+	const Uint32 goalCluster = clusterOf(endX, endY);
+	const cluster_t& first = clusters[startCluster];
+	const cluster_t& last = clusters[goalCluster];
+	PathFinder::SearchState& s = PathFinder::SearchState::get();
+	static thread_local ArrayList<Uint32> startCosts;
+	static thread_local ArrayList<Uint32> goalCosts;
+	startCosts.resize(first.nodes.getSize());
+	goalCosts.resize(last.nodes.getSize());
+	floodCluster(startX / (Sint32)clusterSize, startY / (Sint32)clusterSize, start);
+	for( Uint32 c = 0; c < first.nodes.getSize(); ++c ) {
+		Uint32 tile = first.nodes[c].tile;
+		startCosts[c] = s.isOpen(tile) ? s.g[tile] : noCost;
+	}
+	Uint32 directCost = startCluster == goalCluster && s.isOpen(goal) ? s.g[goal] : noCost;
+	floodCluster(endX / (Sint32)clusterSize, endY / (Sint32)clusterSize, goal);
+	for( Uint32 c = 0; c < last.nodes.getSize(); ++c ) {
+		Uint32 tile = last.nodes[c].tile;
+		goalCosts[c] = s.isOpen(tile) ? s.g[tile] : noCost;
+	}
+
+	// search the graph, with node tiles standing in for nodes
+	auto heuristic = [&](Uint32 tile) {
+		return PathFinder::AStarTask::heuristic((Sint32)tile / height, (Sint32)tile % height, endX, endY);
+	};
+	s.begin(width * height);
+	s.relax(start, 0, heuristic(start), start);
+	Uint32 expanded = 0;
+	bool foundPath = false;
+	while( s.heap.getSize() > 0 ) {
+		Uint32 node = s.pop();
+		if( node == goal ) {
+			foundPath = true;
+			break;
+		}
+		s.close(node);
+		++expanded;
+
+		const Uint32 g = s.g[node];
+		if( node == start ) {
+			for( Uint32 c = 0; c < first.nodes.getSize(); ++c ) {
+				if( startCosts[c] != noCost ) {
+					s.relax(first.nodes[c].tile, g + startCosts[c], heuristic(first.nodes[c].tile), node);
+				}
+			}
+			if( directCost != noCost ) {
+				s.relax(goal, g + directCost, 0, node);
+			}
+		}
+
+		Uint16 slot = nodeSlots[node];
+		if( slot == noSlot ) {
+			continue;
+		}
+		const Uint32 clusterIndex = clusterOf((Sint32)node / height, (Sint32)node % height);
+		const cluster_t& cluster = clusters[clusterIndex];
+		const Uint32 numNodes = cluster.nodes.getSize();
+		for( Uint32 c = 0; c < numNodes; ++c ) {
+			Uint32 cost = cluster.costs[c + slot * numNodes];
+			if( c != slot && cost != noCost ) {
+				s.relax(cluster.nodes[c].tile, g + cost, heuristic(cluster.nodes[c].tile), node);
+			}
+		}
+		for( int side = 0; side < 4; ++side ) {
+			Uint32 across = cluster.nodes[slot].across[side];
+			if( across != UINT32_MAX ) {
+				s.relax(across, g + PathFinder::AStarTask::COST_STRAIGHT, heuristic(across), node);
+			}
+		}
+		if( clusterIndex == goalCluster && goalCosts[slot] != noCost ) {
+			s.relax(goal, g + goalCosts[slot], 0, node);
+		}
+	}
+	if( outExpanded ) {
+		*outExpanded = expanded;
+	}
+	if( !foundPath ) {
+		return false;
+	}
+
+	for( Uint32 node = goal; node != start; node = s.parent[node] ) {
+		outTiles.push(node);
+	}
+	for( Uint32 a = 0, b = outTiles.getSize() - 1; a < b; ++a, --b ) {
+		std::swap(outTiles[a], outTiles[b]);
+	}
+	return true;
+}
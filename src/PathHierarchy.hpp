@@ -0,0 +1,114 @@
+// PathHierarchy.hpp
+// Abstract graph over square clusters of tiles for hierarchical pathfinding (HPA*)
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "Rect.hpp"
+#include "NavGrid.hpp"
+
+#include <shared_mutex>
+
+// the map is cut into square clusters of whole chunks. wherever walkable tiles face each
+// other across the border of two clusters, a transition (one in the middle of a short
+// opening, one at each end of a long one) adds a node on both sides, and the costs between
+// every pair of nodes in a cluster are worked out once and cached. a long search then only
+// walks this small graph, and the tile steps in between are filled in later, a segment at a
+// time, as they are followed. when tiles change, only the touched clusters and their
+// neighbors (which share the borders) are rebuilt.
+//
+// searches may run on any thread; building and updating lock them out.
+class PathHierarchy {
+public:
+	PathHierarchy() {}
+	~PathHierarchy() {}
+
+	// getters & setters
+	bool		isBuilt() const					{ return clusterSize != 0; }
+	bool		isDirty() const					{ return dirty; }
+	Sint32		getWidth() const				{ return width; }
+	Sint32		getHeight() const				{ return height; }
+	Uint32		getClusterSize() const			{ return clusterSize; }
+	Uint32		getNumClusters() const			{ return clusters.getSize(); }
+	Uint32		getNumNodes() const;
+
+	// builds every cluster
+	// @param grid the walkable tiles, kept until the next build or update
+	// @param clusterSize the width of a cluster in tiles, or 0 for the path.cluster cvar
+	void build(const NavSnapshot& grid, Uint32 clusterSize = 0);
+
+	// throws away the graph
+	void clear();
+
+	// marks the clusters holding any of the given tiles for a rebuild
+	// @param rect the changed tiles
+	void invalidate(const Rect<int>& rect);
+
+	// rebuilds every cluster marked by invalidate(), and their neighbors
+	// @param grid the walkable tiles, with the changes
+	// @return the number of clusters rebuilt
+	Uint32 update(const NavSnapshot& grid);
+
+	// @return true if a search between the two tiles should use the graph
+	bool isWorthUsing(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY) const;
+
+	// searches the graph
+	// @param startX the start x coordinate (in tiles)
+	// @param startY the start y coordinate (in tiles)
+	// @param endX the goal x coordinate (in tiles)
+	// @param endY the goal y coordinate (in tiles)
+	// @param outTiles receives the tiles of the nodes passed through after the start, ending
+	// with the goal
+	// @param outExpanded if not null, receives the number of nodes expanded
+	// @return true if a path was found
+	bool findPath(Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, ArrayList<Uint32>& outTiles, Uint32* outExpanded = nullptr) const;
+
+private:
+	static const Uint32 noCost = UINT32_MAX;
+	static const Uint16 noSlot = UINT16_MAX;
+
+	// a transition tile inside a cluster
+	struct node_t {
+		Uint32 tile = 0;
+		Uint32 across[4];		// tile of the node across the east, south, west, and north borders (or UINT32_MAX)
+	};
+
+	struct cluster_t {
+		ArrayList<node_t> nodes;
+		ArrayList<Uint32> costs;	// costs[a + b * nodes] between two nodes (or noCost)
+		bool dirty = false;
+	};
+
+	mutable std::shared_timed_mutex mutex;
+
+	NavSnapshot grid;
+	Sint32 width = 0;
+	Sint32 height = 0;
+	Uint32 clusterSize = 0;
+	Sint32 clustersWidth = 0;
+	Sint32 clustersHeight = 0;
+	ArrayList<cluster_t> clusters;		// y + x * clustersHeight
+	ArrayList<Uint16> nodeSlots;		// tile -> index in its cluster's nodes (or noSlot)
+	bool dirty = false;
+
+	// @return the cluster holding a tile
+	Uint32 clusterOf(Sint32 x, Sint32 y) const	{ return (y / (Sint32)clusterSize) + (x / (Sint32)clusterSize) * clustersHeight; }
+
+	// finds the transitions along the east or south border of a cluster
+	// @param cX the cluster's x coordinate
+	// @param cY the cluster's y coordinate
+	// @param south false for the east border, true for the south border
+	// @param outTiles receives the tile inside the cluster for each transition
+	void findTransitions(Sint32 cX, Sint32 cY, bool south, ArrayList<Uint32>& outTiles) const;
+
+	// finds the nodes of a cluster and the costs between them
+	void buildCluster(Sint32 cX, Sint32 cY);
+
+	// adds a node to the cluster being built (unless it's there already)
+	void addNode(cluster_t& cluster, Uint32 tile, Uint32 side, Uint32 across);
+
+	// floods a cluster from one tile with the calling thread's search state, leaving the cost
+	// to every tile it reached in the state
+	void floodCluster(Sint32 cX, Sint32 cY, Uint32 from) const;
+};
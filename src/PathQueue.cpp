@@ -0,0 +1,273 @@
+// PathQueue.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "PathQueue.hpp"
+#include "PathHierarchy.hpp"
+
+#include <algorithm>
+
+static Cvar cvar_pathWorkers("path.workers", "number of threads that run path searches", "2");
+static Cvar cvar_pathBudget("path.budget", "nodes path searches may expand per tick before waiting for the next (0 for no limit)", "50000");
+static Cvar cvar_pathCache("path.cache", "number of recent path results kept for repeat requests", "256");
+
+PathQueue::~PathQueue() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	for( auto worker : workers ) {
+		worker->join();
+		delete worker;
+	}
+	workers.clear();
+
+	// nobody is left to run what's still waiting
+	for( auto job : queue ) {
+		for( auto waiter : job->waiters ) {
+			waiter->set_value(new PathFinder::Path);
+			delete waiter;
+		}
+		delete job;
+	}
+	queue.clear();
+	jobs.clear();
+	for( auto& pair : cache ) {
+		delete pair.b;
+	}
+	cache.clear();
+	lru.removeAll();
+}
+
+void PathQueue::start() {
+	Uint32 numWorkers = (Uint32)std::max(1, cvar_pathWorkers.toInt());
+	budgetPerTick = (Sint64)cvar_pathBudget.toInt();
+	budget = budgetPerTick;
+	for( Uint32 c = 0; c < numWorkers; ++c ) {
+		workers.push(new std::thread(&PathQueue::work, this));
+	}
+}
+
+std::future<PathFinder::Path*> PathQueue::submit(const void* owner, const NavSnapshot& grid, const PathHierarchy* hierarchy,
+	Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, Sint32 priority) {
+	std::promise<PathFinder::Path*>* waiter = new std::promise<PathFinder::Path*>();
+	std::future<PathFinder::Path*> result = waiter->get_future();
+
+	// the search clamps its endpoints the same way
+	const Sint32 w = (Sint32)grid->getWidth();
+	const Sint32 h = (Sint32)grid->getHeight();
+	key_t key;
+	key.version = grid->getVersion();
+	key.start = std::min(std::max(0, startY), h - 1) + std::min(std::max(0, startX), w - 1) * h;
+	key.goal = std::min(std::max(0, endY), h - 1) + std::min(std::max(0, endX), w - 1) * h;
+
+	std::lock_guard<std::mutex> guard(lock);
+	++stats.requests;
+
+	// answered recently?
+	cached_t** cached = cache.find(key);
+	if( cached ) {
+		++stats.cacheHits;
+		lru.removeNode((*cached)->lruNode);
+		(*cached)->lruNode = lru.addNodeLast(*cached);
+		waiter->set_value(copyPath((*cached)->path));
+		delete waiter;
+		return result;
+	}
+
+	// already on its way?
+	job_t** found = jobs.find(key);
+	if( found ) {
+		job_t* job = *found;
+		++stats.coalesced;
+		job->waiters.push(waiter);
+		if( priority > job->priority ) {
+			job->priority = priority;
+			if( std::find(queue.getArray(), queue.getArray() + queue.getSize(), job) != queue.getArray() + queue.getSize() ) {
+				std::make_heap(queue.getArray(), queue.getArray() + queue.getSize(), heapLess);
+			}
+		}
+		return result;
+	}
+
+	job_t* job = new job_t;
+	job->key = key;
+	job->owner = owner;
+	job->grid = grid;
+	job->hierarchy = hierarchy;
+	job->startX = startX;
+	job->startY = startY;
+	job->endX = endX;
+	job->endY = endY;
+	job->priority = priority;
+	job->sequence = sequence++;
+	job->submitted = std::chrono::steady_clock::now();
+	job->waiters.push(waiter);
+	jobs.insert(key, job);
+	queue.push(job);
+	std::push_heap(queue.getArray(), queue.getArray() + queue.getSize(), heapLess);
+	stats.maxDepth = std::max(stats.maxDepth, queue.getSize());
+
+	if( workers.getSize() == 0 ) {
+		start();
+	}
+	wake.notify_one();
+	return result;
+}
+
+void PathQueue::tick() {
+	std::lock_guard<std::mutex> guard(lock);
+
+	// overspending last tick comes out of this one
+	budgetPerTick = (Sint64)cvar_pathBudget.toInt();
+	budget = budgetPerTick > 0 ? std::min(budget + budgetPerTick, budgetPerTick) : 0;
+	if( queue.getSize() > 0 ) {
+		wake.notify_all();
+	}
+}
+
+void PathQueue::cancel(const void* owner) {
+	std::unique_lock<std::mutex> guard(lock);
+	for( Uint32 c = 0; c < queue.getSize(); ) {
+		job_t* job = queue[c];
+		if( job->owner != owner ) {
+			++c;
+			continue;
+		}
+		for( auto waiter : job->waiters ) {
+			waiter->set_value(new PathFinder::Path);
+			delete waiter;
+		}
+		jobs.remove(job->key);
+		delete job;
+		queue.remove(c);
+	}
+	std::make_heap(queue.getArray(), queue.getArray() + queue.getSize(), heapLess);
+
+	// running searches still read the owner's cluster graph
+	idle.wait(guard, [&]{
+		for( auto job : running ) {
+			if( job->owner == owner ) {
+				return false;
+			}
+		}
+		return true;
+	});
+}
+
+Uint32 PathQueue::getQueueDepth() {
+	std::lock_guard<std::mutex> guard(lock);
+	return queue.getSize();
+}
+
+PathQueue::stats_t PathQueue::getStats() {
+	std::lock_guard<std::mutex> guard(lock);
+	return stats;
+}
+
+void PathQueue::resetStats() {
+	std::lock_guard<std::mutex> guard(lock);
+	stats = stats_t();
+}
+
+void PathQueue::work() {
+	std::unique_lock<std::mutex> guard(lock);
+	while( 1 ) {
+		// a budget of 0 means no limit
+		wake.wait(guard, [this]{
+			return quit || (queue.getSize() > 0 && (budget > 0 || budgetPerTick <= 0));
+		});
+		if( quit ) {
+			return;
+		}
+		std::pop_heap(queue.getArray(), queue.getArray() + queue.getSize(), heapLess);
+		job_t* job = queue.pop();
+		running.push(job);
+		guard.unlock();
+
+		PathFinder::Path* path = nullptr;
+		Uint32 expanded = 0;
+		if( job->hierarchy ) {
+			PathFinder::HierarchicalTask task(*job->hierarchy, job->grid, job->startX, job->startY, job->endX, job->endY);
+			path = task.findPath();
+			expanded = task.getExpanded();
+		} else {
+			PathFinder::AStarTask task(job->grid, job->startX, job->startY, job->endX, job->endY);
+			path = task.findPath();
+			expanded = task.getExpanded();
+		}
+
+		guard.lock();
+		budget -= expanded;
+		++stats.searches;
+		stats.expanded += expanded;
+		for( Uint32 c = 0; c < running.getSize(); ++c ) {
+			if( running[c] == job ) {
+				running.remove(c);
+				break;
+			}
+		}
+		finish(job, path);
+		idle.notify_all();
+	}
+}
+
+void PathQueue::finish(job_t* job, PathFinder::Path* path) {
+	std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - job->submitted;
+	stats.totalLatency += latency.count();
+	stats.maxLatency = std::max(stats.maxLatency, latency.count());
+
+	remember(job->key, *path);
+	for( Uint32 c = 0; c < job->waiters.getSize(); ++c ) {
+		std::promise<PathFinder::Path*>* waiter = job->waiters[c];
+		waiter->set_value(c + 1 < job->waiters.getSize() ? copyPath(*path) : path);
+		delete waiter;
+	}
+	jobs.remove(job->key);
+	delete job;
+}
+
+void PathQueue::remember(const key_t& key, const PathFinder::Path& path) {
+	const Uint32 capacity = (Uint32)std::max(0, cvar_pathCache.toInt());
+	if( capacity == 0 ) {
+		return;
+	}
+	while( cache.getSize() >= capacity && lru.getFirst() ) {
+		cached_t* oldest = lru.getFirst()->getData();
+		lru.removeNode(lru.getFirst());
+		cache.remove(oldest->key);
+		delete oldest;
+	}
+	cached_t* cached = new cached_t;
+	cached->key = key;
+	cached->path.copy(path);
+	cached->lruNode = lru.addNodeLast(cached);
+	cache.insert(key, cached);
+}
+
+PathFinder::Path* PathQueue::copyPath(const PathFinder::Path& path) {
+	PathFinder::Path* result = new PathFinder::Path;
+	result->copy(path);
+	return result;
+}
+
+static int console_pathStats(int argc, const char** argv) {
+	PathQueue& queue = mainEngine->getPathQueue();
+	PathQueue::stats_t stats = queue.getStats();
+	mainEngine->fmsg(Engine::MSG_INFO,"path queue: %u workers, %u waiting (at most %u)",
+		queue.getNumWorkers(), queue.getQueueDepth(), stats.maxDepth);
+	mainEngine->fmsg(Engine::MSG_INFO,"  %u requests: %.1f%% cached, %.1f%% merged, %u searches (%.0f expansions each)",
+		stats.requests,
+		stats.requests ? 100.0 * stats.cacheHits / stats.requests : 0.0,
+		stats.requests ? 100.0 * stats.coalesced / stats.requests : 0.0,
+		stats.searches, stats.searches ? (double)stats.expanded / stats.searches : 0.0);
+	mainEngine->fmsg(Engine::MSG_INFO,"  latency: %.2f ms average, %.2f ms worst",
+		stats.searches ? stats.totalLatency / stats.searches : 0.0, stats.maxLatency);
+	if( argc >= 1 && strcmp(argv[0], "reset") == 0 ) {
+		queue.resetStats();
+	}
+	return 0;
+}
+
+static Ccmd ccmd_pathStats("path.stats","prints path queue depth, latency, and cache hit rate (arg: 'reset' to zero the counters)",&console_pathStats);
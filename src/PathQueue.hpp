@@ -0,0 +1,153 @@
+// PathQueue.hpp
+// Worker threads that run path searches from a shared priority queue
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+#include "LinkedList.hpp"
+#include "NavGrid.hpp"
+#include "Path.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+
+// every pathfinder hands its searches to this one queue instead of starting a thread each.
+// a fixed number of workers take the most urgent request first. a request for the same
+// endpoints on the same map as one already waiting or running just waits for that one, and
+// recent results are kept in a small cache, so a crowd asking for the same trip costs one
+// search. workers stop picking up requests once they've spent the tick's budget of node
+// expansions, so a burst of requests can't crowd out the simulation.
+class PathQueue {
+public:
+	PathQueue() {}
+	~PathQueue();
+
+	// counters since the last resetStats()
+	struct stats_t {
+		Uint32 requests = 0;		// requests submitted
+		Uint32 cacheHits = 0;		// answered from the cache
+		Uint32 coalesced = 0;		// merged into a request already waiting or running
+		Uint32 searches = 0;		// searches run
+		Uint64 expanded = 0;		// nodes expanded by those searches
+		Uint32 maxDepth = 0;		// most requests waiting at once
+		double totalLatency = 0.0;	// ms from submission to result, summed over searches
+		double maxLatency = 0.0;	// ms, slowest search
+	};
+
+	// getters & setters
+	Uint32			getNumWorkers() const		{ return workers.getSize(); }
+
+	// queues a search
+	// @param owner the pathfinder asking (see cancel())
+	// @param grid the map to search
+	// @param hierarchy the cluster graph to search first, or nullptr for a plain A* search
+	// @param startX the start x coordinate (in tiles)
+	// @param startY the start y coordinate (in tiles)
+	// @param endX the goal x coordinate (in tiles)
+	// @param endY the goal y coordinate (in tiles)
+	// @param priority requests with higher priority are searched first
+	// @return a future path, which belongs to the caller once it's ready
+	std::future<PathFinder::Path*> submit(const void* owner, const NavSnapshot& grid, const PathHierarchy* hierarchy,
+		Sint32 startX, Sint32 startY, Sint32 endX, Sint32 endY, Sint32 priority = 0);
+
+	// refills the search budget (call once per tick)
+	void tick();
+
+	// drops every waiting request from an owner (their futures get empty paths) and waits
+	// for the ones it has running to finish
+	// @param owner the owner whose requests are cancelled
+	void cancel(const void* owner);
+
+	// @return the number of requests waiting for a worker
+	Uint32 getQueueDepth();
+
+	// @return a copy of the counters
+	stats_t getStats();
+
+	// zeroes the counters
+	void resetStats();
+
+private:
+	// endpoints on one version of a map
+	struct key_t {
+		Uint32 version = 0;
+		Uint32 start = 0;
+		Uint32 goal = 0;
+
+		bool operator==(const key_t& other) const {
+			return version == other.version && start == other.start && goal == other.goal;
+		}
+		Uint32 hash() const {
+			Uint32 h = version * 0x9e3779b1u;
+			h = (h ^ start) * 0x85ebca6bu;
+			h = (h ^ goal) * 0xc2b2ae35u;
+			return h ^ (h >> 16);
+		}
+	};
+
+	// a search and everyone waiting on it
+	struct job_t {
+		key_t key;
+		const void* owner = nullptr;
+		NavSnapshot grid;
+		const PathHierarchy* hierarchy = nullptr;
+		Sint32 startX = 0, startY = 0, endX = 0, endY = 0;
+		Sint32 priority = 0;
+		Uint32 sequence = 0;
+		std::chrono::steady_clock::time_point submitted;
+		ArrayList<std::promise<PathFinder::Path*>*> waiters;
+	};
+
+	// a recent result
+	struct cached_t {
+		key_t key;
+		PathFinder::Path path;
+		Node<cached_t*>* lruNode = nullptr;
+	};
+
+	std::mutex lock;
+	std::condition_variable wake;		// work was queued, budget was refilled, or quitting
+	std::condition_variable idle;		// a search finished
+	ArrayList<std::thread*> workers;
+	bool quit = false;
+
+	ArrayList<job_t*> queue;			// heap, most urgent first
+	ArrayList<job_t*> running;
+	HashMap<key_t, job_t*> jobs;		// every job waiting or running
+	HashMap<key_t, cached_t*> cache;
+	LinkedList<cached_t*> lru;			// least recently used first
+	Uint32 sequence = 0;
+	Sint64 budget = 0;					// node expansions left this tick
+	Sint64 budgetPerTick = 0;			// path.budget, read on the main thread
+	stats_t stats;
+
+	// @return true if a should be searched before b
+	static bool before(const job_t* a, const job_t* b) {
+		return a->priority > b->priority || (a->priority == b->priority && a->sequence < b->sequence);
+	}
+
+	// heap ordering for std::push_heap and friends (the front is the "largest")
+	static bool heapLess(const job_t* a, const job_t* b) {
+		return before(b, a);
+	}
+
+	// starts the worker threads (called with the lock held)
+	void start();
+
+	// worker thread loop
+	void work();
+
+	// hands a result to everyone waiting on a job and keeps a copy (called with the lock held)
+	void finish(job_t* job, PathFinder::Path* path);
+
+	// adds a result to the cache, throwing out the least recently used (called with the lock held)
+	void remember(const key_t& key, const PathFinder::Path& path);
+
+	// copies a path for another waiter
+	static PathFinder::Path* copyPath(const PathFinder::Path& path);
+};
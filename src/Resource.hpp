@@ -4,8 +4,12 @@
 #pragma once
 
 #include "Asset.hpp"
-#include "Map.hpp"
+#include "HashMap.hpp"
 
+#include <mutex>
+
+// lookups, loads and deletions are locked so that worlds processed on different threads
+// can share the cache. loading happens under the lock, so an asset is never loaded twice
 template <typename T> class Resource {
 public:
 	Resource() {}
@@ -14,12 +18,13 @@ public:
 	}
 
 	// getters & setters
-	Map<String, T*>&		getCache()			{ return cache; }
+	HashMap<String, T*>&	getCache()			{ return cache; }
 	const int				getError() const	{ return error; }
 
 	// number of items in the resource
 	// @return the number of cached items in the resource
 	Uint32 size() const {
+		std::lock_guard<std::recursive_mutex> guard(lock);
 		return cache.getSize();
 	}
 
@@ -35,6 +40,7 @@ public:
 			return nullptr;
 		}
 
+		std::lock_guard<std::recursive_mutex> guard(lock);
 		T** data = cache.find(name);
 		if( data ) {
 			error = 0;
@@ -57,6 +63,7 @@ public:
 
 	// completely clears all data elements stored in the cache
 	void dumpCache() {
+		std::lock_guard<std::recursive_mutex> guard(lock);
 		for( auto& pair : cache ) {
 			delete pair.b;
 		}
@@ -65,6 +72,7 @@ public:
 
 	// delete some specific data from the cache
 	void deleteData(const char* name) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
 		T** data = cache.find(name);
 		if (data) {
 			delete *data;
@@ -79,6 +87,7 @@ public:
 	}
 
 private:
-	Map<String, T*> cache;
+	HashMap<String, T*> cache;
 	int error = 0;
+	mutable std::recursive_mutex lock;
 };
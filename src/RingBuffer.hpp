@@ -0,0 +1,78 @@
+// RingBuffer.hpp
+// Fixed-size queue for handing items from one thread to another without locking
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <atomic>
+
+// a queue with exactly one thread pushing and one other thread popping. the items live in the
+// buffer and are filled and read in place, so passing one along costs no allocation or copy.
+// each end only writes its own counter, which the other end reads to know how far it can go.
+// @param T the item type, which must be default-constructible
+template <typename T>
+class RingBuffer {
+public:
+	// @param _capacity the most items the buffer holds (rounded up to a power of two)
+	RingBuffer(Uint32 _capacity) {
+		capacity = 1;
+		while( capacity < _capacity ) {
+			capacity <<= 1;
+		}
+		items = new T[capacity];
+	}
+	RingBuffer(const RingBuffer&) = delete;
+	~RingBuffer() {
+		delete[] items;
+	}
+
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	// getters & setters
+	Uint32		getCapacity() const		{ return capacity; }
+
+	// @return the number of items waiting; only exact when called from one of the two ends
+	Uint32 getSize() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+	// producer: the slot to fill next. it only joins the queue when push() is called
+	// @return the slot, or nullptr if the buffer is full
+	T* beginPush() {
+		const Uint32 t = tail.load(std::memory_order_relaxed);
+		if( t - head.load(std::memory_order_acquire) >= capacity ) {
+			return nullptr;
+		}
+		return &items[t & (capacity - 1)];
+	}
+
+	// producer: adds the slot returned by beginPush() to the queue
+	void push() {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// consumer: the oldest item, which stays in the queue until pop() is called
+	// @return the item, or nullptr if the buffer is empty
+	T* front() {
+		const Uint32 h = head.load(std::memory_order_relaxed);
+		if( h == tail.load(std::memory_order_acquire) ) {
+			return nullptr;
+		}
+		return &items[h & (capacity - 1)];
+	}
+
+	// consumer: removes the item returned by front(), freeing its slot for the producer
+	void pop() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+private:
+	T* items = nullptr;
+	Uint32 capacity = 0;
+
+	// counters run freely and wrap; the difference is the number of items waiting. they sit on
+	// separate cache lines so the two threads don't keep stealing one line from each other
+	alignas(64) std::atomic<Uint32> head{0};		// next item to pop, written by the consumer
+	alignas(64) std::atomic<Uint32> tail{0};		// next slot to push, written by the producer
+};
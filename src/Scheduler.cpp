@@ -0,0 +1,110 @@
+// Scheduler.cpp
+
+#include "Main.hpp"
+#include "Scheduler.hpp"
+
+#include <thread>
+
+// bounds for the learned sleep margin
+static const std::chrono::nanoseconds minSleepMargin = std::chrono::microseconds(50);
+static const std::chrono::nanoseconds startSleepMargin = std::chrono::milliseconds(1);
+
+Scheduler::Scheduler() {
+	interval = std::chrono::nanoseconds(1000000000 / rate);
+	sleepMargin = startSleepMargin;
+	reset();
+}
+
+void Scheduler::setRate(Uint32 ticksPerSecond) {
+	if( ticksPerSecond == 0 || ticksPerSecond == rate ) {
+		return;
+	}
+	rate = ticksPerSecond;
+	interval = std::chrono::nanoseconds(1000000000 / rate);
+	accumulator = std::min(accumulator, interval);
+}
+
+void Scheduler::reset() {
+	accumulator = std::chrono::nanoseconds::zero();
+	last = clock_t::now();
+	deadline = last + interval;
+}
+
+Uint32 Scheduler::advance(bool paused) {
+	clock_t::time_point now = clock_t::now();
+	accumulator += now - last;
+	last = now;
+
+	Uint64 due = accumulator / interval;
+	if( paused ) {
+		due = 0;
+		accumulator %= interval;
+	} else if( due > maxCatchUp ) {
+		droppedTicks += due - maxCatchUp;
+		due = maxCatchUp;
+		accumulator %= interval;
+	} else {
+		accumulator -= interval * due;
+	}
+	deadline = now + (interval - accumulator);
+	ticks += due;
+	return (Uint32)due;
+}
+
+void Scheduler::waitForTick() {
+	clock_t::time_point now = clock_t::now();
+	if( now >= deadline ) {
+		return;
+	}
+
+	switch( wait ) {
+	case WAIT_SLEEP:
+	{
+		std::chrono::nanoseconds remaining = deadline - now;
+		if( remaining > sleepMargin ) {
+			std::chrono::nanoseconds request = remaining - sleepMargin;
+			std::this_thread::sleep_for(request);
+			clock_t::time_point woke = clock_t::now();
+			std::chrono::nanoseconds overslept = (woke - now) - request;
+
+			// grow at once when the OS oversleeps, shrink slowly when it doesn't
+			if( overslept > sleepMargin ) {
+				sleepMargin = overslept;
+			} else {
+				sleepMargin -= (sleepMargin - overslept) / 16;
+			}
+			sleepMargin = std::max(sleepMargin, minSleepMargin);
+			sleepMargin = std::min(sleepMargin, interval);
+			now = woke;
+		}
+		while( now < deadline ) {
+			std::this_thread::yield();
+			now = clock_t::now();
+		}
+		break;
+	}
+	case WAIT_YIELD:
+		while( now < deadline ) {
+			std::this_thread::yield();
+			now = clock_t::now();
+		}
+		break;
+	default:
+		while( now < deadline ) {
+			now = clock_t::now();
+		}
+		break;
+	}
+
+	Uint64 late = std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count();
+	jitterTotal += late;
+	jitterMax = std::max(jitterMax, late);
+	++waits;
+}
+
+void Scheduler::resetStats() {
+	droppedTicks = 0;
+	waits = 0;
+	jitterTotal = 0;
+	jitterMax = 0;
+}
@@ -0,0 +1,82 @@
+// Scheduler.hpp
+// Fixed-step tick clock with bounded catch-up
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <chrono>
+
+// turns elapsed wall time into a whole number of fixed ticks. time accumulates against a
+// monotonic clock; after a hitch at most maxCatchUp ticks are released at once and the rest
+// of the backlog is dropped (and counted), so a stall never turns into an unbounded burst.
+// between ticks, wait() parks the thread until the next one is due instead of spinning.
+class Scheduler {
+public:
+	// ways to pass the time until the next tick
+	enum wait_t {
+		WAIT_SPIN,		// busy-wait (lowest jitter, burns a core)
+		WAIT_YIELD,		// yield the time slice until the deadline
+		WAIT_SLEEP,		// sleep for most of the interval, then yield for the remainder
+		WAIT_MAX
+	};
+
+	Scheduler();
+	~Scheduler() {}
+
+	// getters & setters
+	Uint32		getRate() const					{ return rate; }
+	Uint32		getMaxCatchUp() const			{ return maxCatchUp; }
+	wait_t		getWait() const					{ return wait; }
+	Uint64		getTicks() const				{ return ticks; }
+	Uint64		getDroppedTicks() const			{ return droppedTicks; }
+	Uint64		getWaits() const				{ return waits; }
+	double		getJitterAvg() const			{ return waits ? (double)jitterTotal / waits / 1000.0 : 0.0; }
+	double		getJitterMax() const			{ return jitterMax / 1000.0; }
+	double		getSleepMargin() const			{ return sleepMargin.count() / 1000.0; }
+
+	void		setMaxCatchUp(Uint32 _maxCatchUp)	{ maxCatchUp = _maxCatchUp > 0 ? _maxCatchUp : 1; }
+	void		setWait(wait_t _wait)				{ wait = _wait; }
+
+	// changes the tick rate. time already accumulated carries over at the new rate
+	// @param ticksPerSecond the number of ticks in a second
+	void setRate(Uint32 ticksPerSecond);
+
+	// throws away accumulated time and starts counting from now
+	void reset();
+
+	// takes the ticks that are due since the last call
+	// @param paused if true, time passes but no ticks are released
+	// @return the number of ticks to run now, never more than maxCatchUp
+	Uint32 advance(bool paused = false);
+
+	// blocks until the next tick is due (returns immediately if it already is).
+	// how late the wake-up was is recorded in the jitter stats
+	void waitForTick();
+
+	// clears jitter and drop counters
+	void resetStats();
+
+private:
+	typedef std::chrono::steady_clock clock_t;
+
+	Uint32 rate = 60;
+	Uint32 maxCatchUp = 4;
+	wait_t wait = WAIT_SLEEP;
+
+	std::chrono::nanoseconds interval;
+	std::chrono::nanoseconds accumulator;
+	clock_t::time_point last;
+	clock_t::time_point deadline;
+
+	// how much sooner than the deadline a sleep must end, learned from how badly the OS
+	// oversleeps. the rest of the wait is spent yielding
+	std::chrono::nanoseconds sleepMargin;
+
+	// stats (nanoseconds)
+	Uint64 ticks = 0;
+	Uint64 droppedTicks = 0;
+	Uint64 waits = 0;
+	Uint64 jitterTotal = 0;
+	Uint64 jitterMax = 0;
+};
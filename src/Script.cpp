@@ -22,6 +22,7 @@
 #include "AnimationState.hpp"
 #include "Vector.hpp"
 #include "WideVector.hpp"
+#include "HashMap.hpp"
 
 //Component headers
 #include "Component.hpp"
@@ -282,6 +283,8 @@ void Script::exposeString() {
 	LinkedList<String*>::exposeToScript(lua, "LinkedListStringPtr", "NodeStringPtr");
 	ArrayList<String>::exposeToScript(lua, "ArrayListString");
 	ArrayList<String*>::exposeToScript(lua, "ArrayListStringPtr");
+	HashMap<String, String>::exposeToScript(lua, "HashMapStringString");
+	HashMap<String, int>::exposeToScript(lua, "HashMapStringInt");
 }
 
 void Script::exposeAngle() {
@@ -581,6 +584,9 @@ void Script::exposeEntity() {
 		.addFunction("hasPath", &Entity::hasPath)
 		.addFunction("getPathNodePosition", &Entity::getPathNodePosition)
 		.addFunction("getPathNodeDir", &Entity::getPathNodeDir)
+		.addFunction("followFlow", &Entity::followFlow)
+		.addFunction("stopFlow", &Entity::stopFlow)
+		.addFunction("isFollowingFlow", &Entity::isFollowingFlow)
 		.addFunction("getCurrentTileX", &Entity::getCurrentTileX)
 		.addFunction("getCurrentTileY", &Entity::getCurrentTileY)
 		.addFunction("getCurrentTileZ", &Entity::getCurrentTileZ)
@@ -337,16 +337,16 @@ void Sector::uploadBuffers() {
 
 	buildPhysicsMesh();
 
-	positionBuffer.clear();
-	texcoordBuffer.clear();
-	normalBuffer.clear();
-	tangentBuffer.clear();
-	indexBuffer.clear();
-	positionBuffer.alloc(numVertices);
-	texcoordBuffer.alloc(numVertices);
-	normalBuffer.alloc(numVertices);
-	tangentBuffer.alloc(numVertices);
-	indexBuffer.alloc(numIndices);
+	positionBuffer.clearKeepCapacity();
+	texcoordBuffer.clearKeepCapacity();
+	normalBuffer.clearKeepCapacity();
+	tangentBuffer.clearKeepCapacity();
+	indexBuffer.clearKeepCapacity();
+	positionBuffer.reserve(numVertices);
+	texcoordBuffer.reserve(numVertices);
+	normalBuffer.reserve(numVertices);
+	tangentBuffer.reserve(numVertices);
+	indexBuffer.reserve(numIndices);
 
 	if( numVertices > 0 ) {
 		GLuint index = 0;
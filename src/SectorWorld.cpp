@@ -94,11 +94,8 @@ void SectorWorld::initialize(bool empty) {
 	}
 
 	// initialize entities
-	for( Uint32 c=0; c<numBuckets; ++c ) {
-		for( Node<Entity*>* node = entities[c].getFirst(); node != nullptr; node = node->getNext() ) {
-			Entity* entity = node->getData();
-			entity->update();
-		}
+	for( auto entity : entities ) {
+		entity->update();
 	}
 
 	// create grid object
@@ -134,10 +131,6 @@ void SectorWorld::deselectGeometry() {
 	// todo
 }
 
-void SectorWorld::findEntitiesInRadius( const Vector& origin, float radius, LinkedList<Entity*>& outList, bool flat ) {
-	// todo
-}
-
 void SectorWorld::process() {
 	World::process();
 
@@ -186,20 +179,16 @@ void SectorWorld::drawSceneObjects(Camera& camera, Light* light) {
 
 	// draw entities
 	if( camera.getDrawMode() != Camera::DRAW_GLOW || !editorActive || !showTools ) {
-		for( Uint32 c = 0; c < numBuckets; ++c ) {
-			for( const Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-				const Entity* entity = node->getData();
-
-				// in silhouette mode, skip unhighlighted or unselected actors
-				if( camera.getDrawMode()==Camera::DRAW_SILHOUETTE ) {
-					if( !entity->isHighlighted() && entity->getUID() != highlightedObj ) {
-						continue;
-					}
+		for( auto entity : entities ) {
+			// in silhouette mode, skip unhighlighted or unselected actors
+			if( camera.getDrawMode()==Camera::DRAW_SILHOUETTE ) {
+				if( !entity->isHighlighted() && entity->getUID() != highlightedObj ) {
+					continue;
 				}
-
-				// draw the entity
-				entity->draw(camera,ArrayList<Light*>({light}));
 			}
+
+			// draw the entity
+			entity->draw(camera,ArrayList<Light*>({light}));
 		}
 	}
 
@@ -223,44 +212,31 @@ void SectorWorld::draw() {
 	Editor* editor = client->getEditor();
 
 	// build camera list
-	LinkedList<Camera*> cameras;
-	for( Uint32 c = 0; c < numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-			entity->findAllComponents<Camera>(Component::COMPONENT_CAMERA, cameras);
-		}
-	}
-
-	// build light list
-	LinkedList<Light*> lights;
-	for( Uint32 c = 0; c < numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-			if( entity->isFlag(Entity::flag_t::FLAG_VISIBLE) ) {
-				entity->findAllComponents<Light>(Component::COMPONENT_LIGHT, lights);
-			}
-		}
-	}
+	ArrayList<Camera*> cameras;
+	for( auto component : components[(int)Component::COMPONENT_CAMERA] ) {
+		Camera* camera = static_cast<Camera*>(component);
 
-	// cull unselected cameras (editor)
-	if( editor && editor->isInitialized() ) {
-		Node<Camera*>* nextNode = nullptr;
-		for( Node<Camera*>* node=cameras.getFirst(); node!=nullptr; node=nextNode ) {
-			Camera* camera = node->getData();
-			nextNode = node->getNext();
-
-			// in editor, skip all but selected cams and the main cams
+		// in editor, skip all but selected cams and the main cams
+		if( editor && editor->isInitialized() ) {
 			if( camera != editor->getEditingCamera() && 
 				camera != editor->getMinimapCamera() &&
 				!camera->getEntity()->isSelected() ) {
-				cameras.removeNode(node);
+				continue;
 			}
 		}
+		cameras.push(camera);
+	}
+
+	// build light list
+	ArrayList<Light*> lights;
+	for( auto component : components[(int)Component::COMPONENT_LIGHT] ) {
+		if( component->getEntity()->isFlag(Entity::flag_t::FLAG_VISIBLE) ) {
+			lights.push(static_cast<Light*>(component));
+		}
 	}
 
 	// iterate cameras
-	for( Node<Camera*>* node=cameras.getFirst(); node!=nullptr; node=node->getNext() ) {
-		Camera* camera = node->getData();
+	for( auto camera : cameras ) {
 
 		// in editor, skip minimap if any other cameras are selected
 		// replace it with our selected camera(s)
@@ -309,8 +285,7 @@ void SectorWorld::draw() {
 			glDepthMask(GL_FALSE);
 			drawSceneObjects(*camera,nullptr);
 		} else {
-			for( Node<Light*>* node = lights.getFirst(); node != nullptr; node = node->getNext() ) {
-				Light* light = node->getData();
+			for( auto light : lights ) {
 
 				// render stencil shadows
 				glEnable(GL_STENCIL_TEST);
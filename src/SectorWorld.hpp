@@ -24,13 +24,6 @@ public:
 	// clears all geometry selection
 	virtual void deselectGeometry();
 
-	// finds all entities within a given radius of the provided point
-	// @param origin position to search from
-	// @param radius the radius to search in
-	// @param outList the list to populate
-	// @param flat if true, the search radius is 2-dimensional
-	virtual void findEntitiesInRadius( const Vector& origin, float radius, LinkedList<Entity*>& outList, bool flat = false );
-
 	// draws the world and its contents
 	virtual void draw();
 
@@ -27,6 +27,11 @@ Server::~Server() {
 		script->dispatch("term");
 		delete script;
 	}
+
+	for( auto& pair : clients ) {
+		delete pair.b;
+	}
+	clients.clear();
 }
 
 void Server::init() {
@@ -71,415 +76,407 @@ void Server::handleNetMessages() {
 						}
 					}
 					
-					// chat message
-					if( strncmp( (const char*)packetType, "CMSG", 4) == 0 ) {
-						Uint32 msgLen;
-						if( packet.read32(msgLen) ) {
-							char* msg = new char[msgLen+1];
-							if( msg ) {
-								msg[msgLen] = 0;
-								packet.read(msg,msgLen);
-
-								Packet msgPacket;
-								msgPacket.write(msg);
-								msgPacket.write32(msgLen);
-								msgPacket.write("CMSG");
-								net->signPacket(msgPacket);
-
-								for( Uint32 c = 0; c < net->getRemoteHosts().getSize(); ++c ) {
-									const Net::remote_t* remote = net->getRemoteHosts()[c];
-									net->sendPacketSafe(remote->id,msgPacket);
-								}
-								delete[] msg;
-							}
-						}
+					getMessages().dispatch(*this, fourcc(packetType), packet, id);
+				}
+			}
+		}
 
-						continue;
-					}
+		// unlock packet receiving thread
+		net->unlockThread();
+	}
+}
 
-					// player spawn
-					else if( strncmp( (const char*)packetType, "SPWN", 4) == 0 ) {
-						if( numWorlds() <= 0 ) {
-							mainEngine->fmsg(Engine::MSG_ERROR,"Client wants to spawn, but there are no worlds!");
-							continue;
-						}
+MessageRegistry<Server>& Server::getMessages() {
+	static MessageRegistry<Server> messages;
+	if( messages.empty() ) {
+		messages.add("CMSG", &Server::handleChat, &msg_cmsg_t::readMessage, &msg_cmsg_t::readChain);
+		messages.add("SACK", &Server::handleSnapshotAck, &msg_sack_t::readMessage, &msg_sack_t::readChain);
+		messages.add("SPWN", &Server::handleSpawn);
+		messages.add("ENTF", &Server::handleEntityCall);
+		messages.add("PLAY", &Server::handlePlayerUpdate);
+		messages.add("ESEL", &Server::handleEntitySelect, &msg_esel_t::readMessage, &msg_esel_t::readChain);
+	}
+	return messages;
+}
 
-						bool playerSpawned = false;
-						Uint32 clientID = id;
-						Uint32 localID = Player::invalidID;
-						Uint32 serverID = Player::invalidID;
-						if( packet.read32(localID) ) {
-							Player* player = findPlayer(clientID, localID);
-
-							// this player has not been created yet, so go ahead and add them to the game
-							if( player == nullptr ) {
-								Player::colors_t colors;
-
-								// read name
-								Uint8 nameLen;
-								StringBuf<64> nameStr = "";
-								if( packet.read8(nameLen) ) {
-									char* name = new char[nameLen+1];
-									if( name ) {
-										packet.read(name, nameLen);
-										name[nameLen] = '\0';
-										nameStr = name;
-										delete[] name;
-									}
-								}
-
-								// read head colors
-								Uint8 headR[3], headG[3], headB[3];
-								packet.read8(headR[0]); packet.read8(headR[1]); packet.read8(headR[2]);
-								packet.read8(headG[0]); packet.read8(headG[1]); packet.read8(headG[2]);
-								packet.read8(headB[0]); packet.read8(headB[1]); packet.read8(headB[2]);
-								colors.headRChannel = { headR[0] / 255.f, headR[1] / 255.f, headR[2] / 255.f, 1.f };
-								colors.headGChannel = { headG[0] / 255.f, headG[1] / 255.f, headG[2] / 255.f, 1.f };
-								colors.headBChannel = { headB[0] / 255.f, headB[1] / 255.f, headB[2] / 255.f, 1.f };
-
-								// read torso colors
-								Uint8 torsoR[3], torsoG[3], torsoB[3];
-								packet.read8(torsoR[0]); packet.read8(torsoR[1]); packet.read8(torsoR[2]);
-								packet.read8(torsoG[0]); packet.read8(torsoG[1]); packet.read8(torsoG[2]);
-								packet.read8(torsoB[0]); packet.read8(torsoB[1]); packet.read8(torsoB[2]);
-								colors.torsoRChannel = { torsoR[0] / 255.f, torsoR[1] / 255.f, torsoR[2] / 255.f, 1.f };
-								colors.torsoGChannel = { torsoG[0] / 255.f, torsoG[1] / 255.f, torsoG[2] / 255.f, 1.f };
-								colors.torsoBChannel = { torsoB[0] / 255.f, torsoB[1] / 255.f, torsoB[2] / 255.f, 1.f };
-
-								// read arms colors
-								Uint8 armsR[3], armsG[3], armsB[3];
-								packet.read8(armsR[0]); packet.read8(armsR[1]); packet.read8(armsR[2]);
-								packet.read8(armsG[0]); packet.read8(armsG[1]); packet.read8(armsG[2]);
-								packet.read8(armsB[0]); packet.read8(armsB[1]); packet.read8(armsB[2]);
-								colors.armsRChannel = { armsR[0] / 255.f, armsR[1] / 255.f, armsR[2] / 255.f, 1.f };
-								colors.armsGChannel = { armsG[0] / 255.f, armsG[1] / 255.f, armsG[2] / 255.f, 1.f };
-								colors.armsBChannel = { armsB[0] / 255.f, armsB[1] / 255.f, armsB[2] / 255.f, 1.f };
-
-								// read feet colors
-								Uint8 feetR[3], feetG[3], feetB[3];
-								packet.read8(feetR[0]); packet.read8(feetR[1]); packet.read8(feetR[2]);
-								packet.read8(feetG[0]); packet.read8(feetG[1]); packet.read8(feetG[2]);
-								packet.read8(feetB[0]); packet.read8(feetB[1]); packet.read8(feetB[2]);
-								colors.feetRChannel = { feetR[0] / 255.f, feetR[1] / 255.f, feetR[2] / 255.f, 1.f };
-								colors.feetGChannel = { feetG[0] / 255.f, feetG[1] / 255.f, feetG[2] / 255.f, 1.f };
-								colors.feetBChannel = { feetB[0] / 255.f, feetB[1] / 255.f, feetB[2] / 255.f, 1.f };
-
-								// create new player
-								Player newPlayer(nameStr.get(), colors);
-
-								serverID = (Uint32)players.getSize();
-								newPlayer.setServerID(serverID);
-								newPlayer.setClientID(clientID);
-								newPlayer.setLocalID(localID);
-
-								player = &players.addNodeLast(newPlayer)->getData();
-							}
-
-							// pick a random world to spawn in
-							int worldID = mainEngine->getRandom().getUint32() % numWorlds();
-							World* world = getWorld(worldID);
-
-							// count spawn locations in world
-							LinkedList<Entity*> spawnLocations;
-							for( Uint32 c=0; c<world->numBuckets; ++c ) {
-								for( Node<Entity*>* node = world->getEntities(c).getFirst(); node != nullptr; node = node->getNext() ) {
-									Entity* entity = node->getData();
-
-									if( strcmp(entity->getScriptStr(),"PlayerStart")==0 ) {
-										if( !entity->checkCollision(entity->getPos()) ) {
-											spawnLocations.addNodeLast(entity);
-										}
-									}
-								}
-							}
-							
-							// pick spawn location at random
-							if( spawnLocations.getSize() > 0 ) {
-								Uint32 spawnIndex = mainEngine->getRandom().getUint32() % spawnLocations.getSize();
-								Node<Entity*>* node = spawnLocations.nodeForIndex(spawnIndex);
-								Entity* entity = node->getData();
-								playerSpawned = player->spawn(*world, entity->getPos(), entity->getAng());
-
-								if( playerSpawned ) {
-									// tell client where to spawn their player
-									Packet packet;
-
-									packet.write32(entity->getAng().degreesRoll());
-									packet.write32(entity->getAng().degreesPitch());
-									packet.write32(entity->getAng().degreesYaw());
-									packet.write32(entity->getPos().z);
-									packet.write32(entity->getPos().y);
-									packet.write32(entity->getPos().x);
-
-									packet.write(world->getShortname().get());
-									packet.write32((Uint32)world->getShortname().length());
-
-									packet.write32(serverID);
-									packet.write32(localID);
-									packet.write32(clientID);
-									packet.write("SPWN");
-
-									net->signPacket(packet);
-									net->sendPacketSafe(clientID, packet);
-
-									// update other clients about this player
-									for( Uint32 c = 0; c < net->getRemoteHosts().getSize(); ++c ) {
-										Net::remote_t* remote = net->getRemoteHosts()[c];
-										if( remote->id == clientID ) {
-											continue;
-										}
-										updateClientAboutPlayers(remote->id);
-									}
-								}
-							} else {
-								mainEngine->fmsg(Engine::MSG_ERROR,"Client wants to spawn, but there are no spawn locations!");
-							}
-						}
-						
-						if( !playerSpawned ) {
-							mainEngine->fmsg(Engine::MSG_ERROR,"Failed to spawn player (%d) of client (%d)!", localID, clientID);
-						}
+void Server::handleChat(Packet& packet, Uint32 remoteID) {
+	msg_cmsg_t header;
+	if( header.read(packet) ) {
+		const Uint32 msgLen = header.length;
+		char* msg = new char[msgLen+1];
+		if( msg ) {
+			msg[msgLen] = 0;
+			packet.read(msg,msgLen);
+
+			Packet msgPacket;
+			msgPacket.write(msg);
+			msgPacket.write32(msgLen);
+			msgPacket.write("CMSG");
+			net->signPacket(msgPacket);
+			net->broadcastSafe(msgPacket);
+			delete[] msg;
+		}
+	}
+}
 
-						continue;
-					}
+void Server::handleSnapshotAck(Packet& packet, Uint32 remoteID) {
+	msg_sack_t msg;
+	if( msg.read(packet) ) {
+		client_t** client = clients.find(remoteID);
+		if( client ) {
+			(*client)->snapshots.ack(msg.sequence);
+		}
+	}
+}
 
-					// entity remote function call
-					else if (strncmp((const char*)packetType, "ENTF", 4) == 0) {
-						// read world
-						Uint32 worldID;
-						packet.read32(worldID);
-						Node<World*>* node = worlds[worldID];
-						if (node) {
-							World& world = *node->getData();
-
-							// get uid
-							Uint32 uid;
-							packet.read32(uid);
-							Entity* entity = world.uidToEntity(uid);
-							if (!entity) {
-								continue;
-							}
-
-							// read func name
-							Uint32 funcNameLen;
-							packet.read32(funcNameLen);
-							char funcName[128];
-							funcName[127] = '\0';
-							packet.read(funcName, funcNameLen);
-							funcName[funcNameLen] = '\0';
-
-							// read args
-							Uint32 argsLen;
-							packet.read32(argsLen);
-							Script::Args args;
-							for (Uint32 c = 0; c < argsLen; ++c) {
-								char argType;
-								packet.read8((Uint8&)argType);
-								switch (argType) {
-								case 'b': {
-									char value;
-									packet.read8((Uint8&)value);
-									if (value == 't') {
-										args.addBool(true);
-									} else if (value == 'f') {
-										args.addBool(false);
-									}
-									break;
-								}
-								case 'i': {
-									Uint32 value;
-									packet.read32(value);
-									args.addInt((int)value);
-									break;
-								}
-								case 'f': {
-									float value;
-									packet.read32((Uint32&)value);
-									args.addFloat(value);
-									break;
-								}
-								case 's': {
-									Uint32 len;
-									packet.read32(len);
-									String value;
-									value.alloc(len + 1);
-									value[len] = '\0';
-									packet.read(&value[0], len);
-									args.addString(value);
-									break;
-								}
-								case 'p': {
-									mainEngine->fmsg(Engine::MSG_ERROR, "Client got RFC with a pointer, will be nullptr");
-									args.addPointer(nullptr);
-									break;
-								}
-								case 'n': {
-									args.addNil();
-									break;
-								}
-								default: {
-									mainEngine->fmsg(Engine::MSG_ERROR, "Unknown arg type for remote function call!");
-									args.addNil();
-									break;
-								}
-								}
-							}
-
-							// run function
-							entity->dispatch(funcName, args);
-						}
+void Server::handleSpawn(Packet& packet, Uint32 remoteID) {
+	if( numWorlds() <= 0 ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"Client wants to spawn, but there are no worlds!");
+		return;
+	}
 
-						continue;
-					}
+	bool playerSpawned = false;
+	Uint32 clientID = remoteID;
+	Uint32 localID = Player::invalidID;
+	Uint32 serverID = Player::invalidID;
+	if( packet.read32(localID) ) {
+		Player* player = findPlayer(clientID, localID);
+
+		// this player has not been created yet, so go ahead and add them to the game
+		if( player == nullptr ) {
+			Player::colors_t colors;
+
+			// read name
+			Uint8 nameLen;
+			StringBuf<64> nameStr = "";
+			if( packet.read8(nameLen) ) {
+				char* name = new char[nameLen+1];
+				if( name ) {
+					packet.read(name, nameLen);
+					name[nameLen] = '\0';
+					nameStr = name;
+					delete[] name;
+				}
+			}
 
-					// player update
-					else if( strncmp( (const char*)packetType, "PLAY", 4) == 0 ) {
-						Uint32 localID;
-						if( packet.read32(localID) ) {
-							Player* player = findPlayer(id, localID);
-							if( player && player->getEntity() ) {
-								Entity* entity = player->getEntity();
-								entity->setLastUpdate(entity->getTicks());
-
-								// get their current world
-								Uint32 worldID;
-								packet.read32(worldID);
-								Node<World*>* node = worlds.nodeForIndex(worldID);
-								World* world = node->getData();
-
-								// only update the player's position if they are on the world that they say they are.
-								if( world != entity->getWorld() ) {
-									Packet packet;
-									packet.write32(entity->getOffset().z);
-									packet.write32(entity->getOffset().y);
-									packet.write32(entity->getOffset().x);
-
-									const Entity* anchor = entity->getAnchor();
-									packet.write32(anchor ? anchor->getUID() : World::nuid);
-
-									World* world = entity->getWorld();
-									assert(world);
-									packet.write(world->getShortname().get());
-									packet.write32((Uint32)world->getShortname().length());
-
-									packet.write32(player->getServerID());
-									packet.write32(player->getLocalID());
-									packet.write32(player->getClientID());
-
-									packet.write("PLVL");
-
-									net->signPacket(packet);
-									net->sendPacket(id,packet);
-								} else {
-									// read pos
-									Uint32 posInt[3];
-									packet.read32(posInt[0]);
-									packet.read32(posInt[1]);
-									packet.read32(posInt[2]);
-									Vector pos( ((Sint32)posInt[0]) / 32.f, ((Sint32)posInt[1]) / 32.f, ((Sint32)posInt[2]) / 32.f );
-
-									// read vel
-									Uint32 velInt[3];
-									packet.read32(velInt[0]);
-									packet.read32(velInt[1]);
-									packet.read32(velInt[2]);
-									Vector vel( ((Sint32)velInt[0]) / 128.f, ((Sint32)velInt[1]) / 128.f, ((Sint32)velInt[2]) / 128.f );
-
-									// read ang
-									Uint32 angInt[3];
-									packet.read32(angInt[0]);
-									packet.read32(angInt[1]);
-									packet.read32(angInt[2]);
-									Angle ang( (((Sint32)angInt[0]) * PI / 180.f) / 32.f, (((Sint32)angInt[1]) * PI / 180.f) / 32.f, (((Sint32)angInt[2]) * PI / 180.f) / 32.f );
-
-									entity->setNewPos(pos);
-									entity->setNewAng(ang);
-									entity->setVel(vel);
-									entity->setLastUpdate(entity->getTicks());
-
-									// read falling status
-									Uint8 falling;
-									packet.read8(falling);
-									entity->setFalling((falling == 1) ? true : false);
-
-									// read crouch status
-									Uint8 crouch;
-									packet.read8(crouch);
-									player->putInCrouch((crouch == 1) ? true : false);
-
-									// read moving status
-									Uint8 moving;
-									packet.read8(moving);
-									player->setMoving((moving == 1) ? true : false);
-
-									// read jumped status
-									Uint8 jumped;
-									packet.read8(jumped);
-									player->setJumped((jumped == 1) ? true : false);
-
-									// read look direction
-									Uint32 lookDirInt[3];
-									packet.read32(lookDirInt[0]);
-									packet.read32(lookDirInt[1]);
-									packet.read32(lookDirInt[2]);
-									Angle lookDir( (((Sint32)lookDirInt[0]) * PI / 180.f) / 32.f, (((Sint32)lookDirInt[1]) * PI / 180.f) / 32.f, (((Sint32)lookDirInt[2]) * PI / 180.f) / 32.f );
-									player->setLookDir(lookDir);
-								}
-							}
-						}
-					}
+			// read head colors
+			Uint8 headR[3], headG[3], headB[3];
+			packet.read8(headR[0]); packet.read8(headR[1]); packet.read8(headR[2]);
+			packet.read8(headG[0]); packet.read8(headG[1]); packet.read8(headG[2]);
+			packet.read8(headB[0]); packet.read8(headB[1]); packet.read8(headB[2]);
+			colors.headRChannel = { headR[0] / 255.f, headR[1] / 255.f, headR[2] / 255.f, 1.f };
+			colors.headGChannel = { headG[0] / 255.f, headG[1] / 255.f, headG[2] / 255.f, 1.f };
+			colors.headBChannel = { headB[0] / 255.f, headB[1] / 255.f, headB[2] / 255.f, 1.f };
+
+			// read torso colors
+			Uint8 torsoR[3], torsoG[3], torsoB[3];
+			packet.read8(torsoR[0]); packet.read8(torsoR[1]); packet.read8(torsoR[2]);
+			packet.read8(torsoG[0]); packet.read8(torsoG[1]); packet.read8(torsoG[2]);
+			packet.read8(torsoB[0]); packet.read8(torsoB[1]); packet.read8(torsoB[2]);
+			colors.torsoRChannel = { torsoR[0] / 255.f, torsoR[1] / 255.f, torsoR[2] / 255.f, 1.f };
+			colors.torsoGChannel = { torsoG[0] / 255.f, torsoG[1] / 255.f, torsoG[2] / 255.f, 1.f };
+			colors.torsoBChannel = { torsoB[0] / 255.f, torsoB[1] / 255.f, torsoB[2] / 255.f, 1.f };
+
+			// read arms colors
+			Uint8 armsR[3], armsG[3], armsB[3];
+			packet.read8(armsR[0]); packet.read8(armsR[1]); packet.read8(armsR[2]);
+			packet.read8(armsG[0]); packet.read8(armsG[1]); packet.read8(armsG[2]);
+			packet.read8(armsB[0]); packet.read8(armsB[1]); packet.read8(armsB[2]);
+			colors.armsRChannel = { armsR[0] / 255.f, armsR[1] / 255.f, armsR[2] / 255.f, 1.f };
+			colors.armsGChannel = { armsG[0] / 255.f, armsG[1] / 255.f, armsG[2] / 255.f, 1.f };
+			colors.armsBChannel = { armsB[0] / 255.f, armsB[1] / 255.f, armsB[2] / 255.f, 1.f };
+
+			// read feet colors
+			Uint8 feetR[3], feetG[3], feetB[3];
+			packet.read8(feetR[0]); packet.read8(feetR[1]); packet.read8(feetR[2]);
+			packet.read8(feetG[0]); packet.read8(feetG[1]); packet.read8(feetG[2]);
+			packet.read8(feetB[0]); packet.read8(feetB[1]); packet.read8(feetB[2]);
+			colors.feetRChannel = { feetR[0] / 255.f, feetR[1] / 255.f, feetR[2] / 255.f, 1.f };
+			colors.feetGChannel = { feetG[0] / 255.f, feetG[1] / 255.f, feetG[2] / 255.f, 1.f };
+			colors.feetBChannel = { feetB[0] / 255.f, feetB[1] / 255.f, feetB[2] / 255.f, 1.f };
+
+			// create new player
+			Player newPlayer(nameStr.get(), colors);
+
+			serverID = (Uint32)players.getSize();
+			newPlayer.setServerID(serverID);
+			newPlayer.setClientID(clientID);
+			newPlayer.setLocalID(localID);
+
+			player = &players.addNodeLast(newPlayer)->getData();
+		}
 
-					// entity selected
-					else if( strncmp( (const char*)packetType, "ESEL", 4) == 0 ) {
-						Uint32 localID;
-						Entity *playerEntity = nullptr;
-						Entity *selectedEntity = nullptr;
-						BBox *selectedBBox = nullptr;
-						Uint32 worldID;
-						Player* player = nullptr;
-						Uint32 selectedEntityUID;
-						Uint32 selectedBBoxUID;
-
-						if( packet.read32(localID) ) {
-							player = findPlayer(id, localID);
-							if( player && player->getEntity() ) {
-								playerEntity = player->getEntity();
-
-								// get player's current world
-								packet.read32(worldID);
-								Node<World*>* node = worlds.nodeForIndex(worldID);
-								World* world = node->getData();
-								if ( world && packet.read32(selectedEntityUID) )
-								{
-									selectedEntity = world->uidToEntity(selectedEntityUID);
-									if ( packet.read32(selectedBBoxUID) )
-									{
-										selectedBBox = selectedEntity->findComponentByUID<BBox>(selectedBBoxUID);
-									}
-								}
-							}
-						}
+		// pick a random world to spawn in
+		int worldID = mainEngine->getRandom().getUint32() % numWorlds();
+		World* world = getWorld(worldID);
 
-						if ( selectedEntity && selectedBBox && playerEntity )
-						{
-							mainEngine->fmsg(Engine::MSG_DEBUG, "Client %d selected entity '%s': UID %d", localID, selectedEntity->getName().get(), selectedEntity->getUID());
-							selectedEntity->interact(*playerEntity, *selectedBBox);
-
-							Packet packet;
-							packet.write32(selectedEntityUID);
-							packet.write32(worldID);
-							packet.write32(player->getServerID());
-							packet.write("PINT");
-							getNet()->signPacket(packet);
-							getNet()->broadcastSafe(packet);
-						}
+		// count spawn locations in world
+		LinkedList<Entity*> spawnLocations;
+		for( auto entity : world->getEntities() ) {
+			if( strcmp(entity->getScriptStr(),"PlayerStart")==0 ) {
+				if( !entity->checkCollision(entity->getPos()) ) {
+					spawnLocations.addNodeLast(entity);
+				}
+			}
+		}
+		
+		// pick spawn location at random
+		if( spawnLocations.getSize() > 0 ) {
+			Uint32 spawnIndex = mainEngine->getRandom().getUint32() % spawnLocations.getSize();
+			Node<Entity*>* node = spawnLocations.nodeForIndex(spawnIndex);
+			Entity* entity = node->getData();
+			playerSpawned = player->spawn(*world, entity->getPos(), entity->getAng());
+
+			if( playerSpawned ) {
+				// tell client where to spawn their player
+				Packet packet;
+
+				packet.write32(entity->getAng().degreesRoll());
+				packet.write32(entity->getAng().degreesPitch());
+				packet.write32(entity->getAng().degreesYaw());
+				packet.write32(entity->getPos().z);
+				packet.write32(entity->getPos().y);
+				packet.write32(entity->getPos().x);
+
+				packet.write(world->getShortname().get());
+				packet.write32((Uint32)world->getShortname().length());
+
+				packet.write32(serverID);
+				packet.write32(localID);
+				packet.write32(clientID);
+				packet.write("SPWN");
+
+				net->signPacket(packet);
+				net->sendPacketSafe(clientID, packet);
+
+				// update other clients about this player
+				for( Uint32 c = 0; c < net->getRemoteHosts().getSize(); ++c ) {
+					Net::remote_t* remote = net->getRemoteHosts()[c];
+					if( remote->id == clientID ) {
+						continue;
 					}
+					updateClientAboutPlayers(remote->id);
 				}
 			}
+		} else {
+			mainEngine->fmsg(Engine::MSG_ERROR,"Client wants to spawn, but there are no spawn locations!");
 		}
+	}
+	
+	if( !playerSpawned ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"Failed to spawn player (%d) of client (%d)!", localID, clientID);
+	}
+}
 
-		// unlock packet receiving thread
-		net->unlockThread();
+void Server::handleEntityCall(Packet& packet, Uint32 remoteID) {
+	// read world
+	Uint32 worldID;
+	packet.read32(worldID);
+	Node<World*>* node = worlds[worldID];
+	if (node) {
+		World& world = *node->getData();
+
+		// get uid
+		Uint32 uid;
+		packet.read32(uid);
+		Entity* entity = world.uidToEntity(uid);
+		if (!entity) {
+			return;
+		}
+
+		// read func name
+		Uint32 funcNameLen;
+		packet.read32(funcNameLen);
+		char funcName[128];
+		funcName[127] = '\0';
+		packet.read(funcName, funcNameLen);
+		funcName[funcNameLen] = '\0';
+
+		// read args
+		Uint32 argsLen;
+		packet.read32(argsLen);
+		Script::Args args;
+		for (Uint32 c = 0; c < argsLen; ++c) {
+			char argType;
+			packet.read8((Uint8&)argType);
+			switch (argType) {
+			case 'b': {
+				char value;
+				packet.read8((Uint8&)value);
+				if (value == 't') {
+					args.addBool(true);
+				} else if (value == 'f') {
+					args.addBool(false);
+				}
+				break;
+			}
+			case 'i': {
+				Uint32 value;
+				packet.read32(value);
+				args.addInt((int)value);
+				break;
+			}
+			case 'f': {
+				float value;
+				packet.read32((Uint32&)value);
+				args.addFloat(value);
+				break;
+			}
+			case 's': {
+				Uint32 len;
+				packet.read32(len);
+				String value;
+				value.alloc(len + 1);
+				value[len] = '\0';
+				packet.read(&value[0], len);
+				args.addString(value);
+				break;
+			}
+			case 'p': {
+				mainEngine->fmsg(Engine::MSG_ERROR, "Client got RFC with a pointer, will be nullptr");
+				args.addPointer(nullptr);
+				break;
+			}
+			case 'n': {
+				args.addNil();
+				break;
+			}
+			default: {
+				mainEngine->fmsg(Engine::MSG_ERROR, "Unknown arg type for remote function call!");
+				args.addNil();
+				break;
+			}
+			}
+		}
+
+		// run function
+		entity->dispatch(funcName, args);
+	}
+}
+
+void Server::handlePlayerUpdate(Packet& packet, Uint32 remoteID) {
+	Uint32 localID;
+	if( packet.read32(localID) ) {
+		Player* player = findPlayer(remoteID, localID);
+		if( player && player->getEntity() ) {
+			Entity* entity = player->getEntity();
+			entity->setLastUpdate(entity->getTicks());
+
+			// get their current world
+			Uint32 worldID;
+			packet.read32(worldID);
+			Node<World*>* node = worlds.nodeForIndex(worldID);
+			World* world = node->getData();
+
+			// only update the player's position if they are on the world that they say they are.
+			if( world != entity->getWorld() ) {
+				Packet packet;
+				packet.write32(entity->getOffset().z);
+				packet.write32(entity->getOffset().y);
+				packet.write32(entity->getOffset().x);
+
+				const Entity* anchor = entity->getAnchor();
+				packet.write32(anchor ? anchor->getUID() : World::nuid);
+
+				World* world = entity->getWorld();
+				assert(world);
+				packet.write(world->getShortname().get());
+				packet.write32((Uint32)world->getShortname().length());
+
+				packet.write32(player->getServerID());
+				packet.write32(player->getLocalID());
+				packet.write32(player->getClientID());
+
+				packet.write("PLVL");
+
+				net->signPacket(packet);
+				net->sendPacket(remoteID,packet);
+			} else {
+				// read pos
+				Uint32 posInt[3];
+				packet.read32(posInt[0]);
+				packet.read32(posInt[1]);
+				packet.read32(posInt[2]);
+				Vector pos( ((Sint32)posInt[0]) / 32.f, ((Sint32)posInt[1]) / 32.f, ((Sint32)posInt[2]) / 32.f );
+
+				// read vel
+				Uint32 velInt[3];
+				packet.read32(velInt[0]);
+				packet.read32(velInt[1]);
+				packet.read32(velInt[2]);
+				Vector vel( ((Sint32)velInt[0]) / 128.f, ((Sint32)velInt[1]) / 128.f, ((Sint32)velInt[2]) / 128.f );
+
+				// read ang
+				Uint32 angInt[3];
+				packet.read32(angInt[0]);
+				packet.read32(angInt[1]);
+				packet.read32(angInt[2]);
+				Angle ang( (((Sint32)angInt[0]) * PI / 180.f) / 32.f, (((Sint32)angInt[1]) * PI / 180.f) / 32.f, (((Sint32)angInt[2]) * PI / 180.f) / 32.f );
+
+				entity->setNewPos(pos);
+				entity->setNewAng(ang);
+				entity->setVel(vel);
+				entity->setLastUpdate(entity->getTicks());
+
+				// read falling status
+				Uint8 falling;
+				packet.read8(falling);
+				entity->setFalling((falling == 1) ? true : false);
+
+				// read crouch status
+				Uint8 crouch;
+				packet.read8(crouch);
+				player->putInCrouch((crouch == 1) ? true : false);
+
+				// read moving status
+				Uint8 moving;
+				packet.read8(moving);
+				player->setMoving((moving == 1) ? true : false);
+
+				// read jumped status
+				Uint8 jumped;
+				packet.read8(jumped);
+				player->setJumped((jumped == 1) ? true : false);
+
+				// read look direction
+				Uint32 lookDirInt[3];
+				packet.read32(lookDirInt[0]);
+				packet.read32(lookDirInt[1]);
+				packet.read32(lookDirInt[2]);
+				Angle lookDir( (((Sint32)lookDirInt[0]) * PI / 180.f) / 32.f, (((Sint32)lookDirInt[1]) * PI / 180.f) / 32.f, (((Sint32)lookDirInt[2]) * PI / 180.f) / 32.f );
+				player->setLookDir(lookDir);
+			}
+		}
+	}
+}
+
+void Server::handleEntitySelect(Packet& packet, Uint32 remoteID) {
+	msg_esel_t msg;
+	if( !msg.read(packet) ) {
+		return;
+	}
+	Player* player = findPlayer(remoteID, msg.localID);
+	Entity* playerEntity = player ? player->getEntity() : nullptr;
+	if( !playerEntity ) {
+		return;
+	}
+
+	// get player's current world
+	Node<World*>* node = worlds.nodeForIndex(msg.world);
+	World* world = node ? node->getData() : nullptr;
+	Entity* selectedEntity = world ? world->uidToEntity(msg.entity) : nullptr;
+	BBox* selectedBBox = selectedEntity ? selectedEntity->findComponentByUID<BBox>(msg.bbox) : nullptr;
+	if( selectedBBox ) {
+		mainEngine->fmsg(Engine::MSG_DEBUG, "Client %d selected entity '%s': UID %d", msg.localID, selectedEntity->getName().get(), selectedEntity->getUID());
+		selectedEntity->interact(*playerEntity, *selectedBBox);
+
+		Packet packet;
+		packet.write32(msg.entity);
+		packet.write32(msg.world);
+		packet.write32(player->getServerID());
+		packet.write("PINT");
+		getNet()->signPacket(packet);
+		getNet()->broadcastSafe(packet);
 	}
 }
 
@@ -584,6 +581,12 @@ void Server::onDisconnect(Uint32 remoteID) {
 			players.removeNode(node);
 		}
 	}
+
+	client_t** client = clients.find(remoteID);
+	if( client ) {
+		delete *client;
+		clients.remove(remoteID);
+	}
 }
 
 void Server::preProcess() {
@@ -610,42 +613,92 @@ void Server::postProcess() {
 	if( framesToRun ) {
 		script->dispatch("postprocess");
 
-		// send entity updates to client
+		// send entity updates to clients
 		if( net->isConnected() ) {
-			if( ticks % (mainEngine->getTicksPerSecond()/10) == 0 ) {
-				for( auto world : worlds ) {
-					for( Uint32 c=0; c<World::numBuckets; ++c ) {
-						for( auto entity : world->getEntities(c) ) {
-							if( !entity->isFlag(Entity::flag_t::FLAG_UPDATE) || entity->isFlag(Entity::flag_t::FLAG_LOCAL) ) {
-								// don't update local-only entities
-								continue;
-							}
-
-							for( Uint32 c = 0; c < net->getRemoteHosts().getSize(); ++c ) {
-								const Net::remote_t* remote = net->getRemoteHosts()[c];
-
-								Player* player = entity->getPlayer();
-								if( player && player->getClientID() == remote->id ) {
-									// do not (normally) tell a client where their players are!
-									continue;
-								}
-
-								// update entity for client
-								Packet packet;
-								entity->updatePacket(packet);
-								net->signPacket(packet);
-								net->sendPacket(remote->id, packet);
-							}
-						}
-					}
-				}
-			}
+			snapshotStats.ticks += framesToRun;
+			sendSnapshots(framesToRun);
 		}
 
 		framesToRun=0;
 	}
 }
 
+void Server::sendSnapshots(Uint32 elapsed) {
+	// capture every entity once, then pick out what each client gets
+	ArrayList<Entity*> entities;
+	ArrayList<Snapshot::state_t> states;
+	for( auto world : worlds ) {
+		for( auto entity : world->getEntities() ) {
+			if( !entity->isFlag(Entity::flag_t::FLAG_UPDATE) || entity->isFlag(Entity::flag_t::FLAG_LOCAL) ) {
+				// don't update local-only entities
+				continue;
+			}
+			Snapshot::state_t state;
+			Snapshot::capture(*entity, state);
+			states.push(state);
+			entities.push(entity);
+		}
+	}
+
+	ArrayList<Packet*> packets;
+	for( Uint32 c = 0; c < net->getRemoteHosts().getSize(); ++c ) {
+		const Net::remote_t* remote = net->getRemoteHosts()[c];
+
+		client_t** found = clients.find(remote->id);
+		client_t* client = found ? *found : nullptr;
+		if( !client ) {
+			client = new client_t();
+			clients.insert(remote->id, client);
+		}
+
+		client->interest.begin(ticks);
+		for( Node<Player>* node = players.getFirst(); node != nullptr; node = node->getNext() ) {
+			Player& player = node->getData();
+			if( player.getClientID() == remote->id ) {
+				client->interest.addPlayer(player);
+			}
+		}
+
+		client->snapshots.begin();
+		for( Uint32 i = 0; i < states.getSize(); ++i ) {
+			Player* player = entities[i]->getPlayer();
+			if( player && player->getClientID() == remote->id ) {
+				// do not (normally) tell a client where their players are!
+				continue;
+			}
+			++snapshotStats.legacyPackets;
+			snapshotStats.legacyBytes += Snapshot::legacySize(states[i]);
+			float distance;
+			if( client->interest.isRelevant(*entities[i], distance) ) {
+				client->snapshots.add(states[i], Snapshot::importance(states[i], distance));
+			}
+		}
+		client->interest.end();
+
+		packets.clearKeepCapacity();
+		client->snapshots.finish(packets, elapsed, &snapshotStats);
+		for( auto packet : packets ) {
+			net->signPacket(*packet);
+			net->sendPacket(remote->id, *packet);
+			++snapshotStats.packets;
+			snapshotStats.bytes += packet->offset;
+			delete packet;
+		}
+	}
+}
+
+void Server::getInterestStats(Uint32& outConsidered, Uint32& outRelevant, bool reset) {
+	outConsidered = 0;
+	outRelevant = 0;
+	for( auto& pair : clients ) {
+		outConsidered += pair.b->interest.getNumConsidered();
+		outRelevant += pair.b->interest.getNumRelevant();
+		if( reset ) {
+			pair.b->interest.resetStats();
+		}
+	}
+}
+
 static int console_serverDisconnect(int argc, const char** argv) {
 	Server* server = mainEngine->getLocalServer();
 	if( server ) {
@@ -746,19 +799,78 @@ static int console_serverCountEntities(int argc, const char** argv) {
 	Uint32 count = 0;
 	for (Uint32 i = 0; i < server->getNumWorlds(); ++i) {
 		World* world = server->getWorld(i);
-		for (Uint32 c = 0; c < World::numBuckets; ++c) {
-			count += world->getEntities(c).getSize();
-		}
+		count += world->getNumEntities();
 	}
 	mainEngine->fmsg(Engine::MSG_INFO, "Server has %u entities", count);
 	return 0;
 }
 
+static int console_serverSnapshots(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"No server currently running.");
+		return 1;
+	}
+
+	// each datagram also costs 28 bytes of IP and UDP headers
+	Snapshot::stats_t& stats = server->getSnapshotStats();
+	double seconds = (double)stats.ticks / mainEngine->getTicksPerSecond();
+	if( seconds <= 0.0 ) {
+		mainEngine->fmsg(Engine::MSG_INFO,"No snapshots sent yet.");
+		return 0;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO,"snapshots over %.1f s: %u sent, %u changed entity states",
+		seconds, stats.snapshots, stats.states);
+	mainEngine->fmsg(Engine::MSG_INFO,"  now:      %.1f packets/s, %.1f bytes/s (%.1f on the wire)",
+		stats.packets / seconds, stats.bytes / seconds, (stats.bytes + 28.0 * stats.packets) / seconds);
+	mainEngine->fmsg(Engine::MSG_INFO,"  one ENTU per entity: %.1f packets/s, %.1f bytes/s (%.1f on the wire)",
+		stats.legacyPackets / seconds, stats.legacyBytes / seconds, (stats.legacyBytes + 28.0 * stats.legacyPackets) / seconds);
+	if( cvar_bandwidth.toInt() > 0 ) {
+		mainEngine->fmsg(Engine::MSG_INFO,"  budget: %d bytes/s per client, %u changed states held back",
+			cvar_bandwidth.toInt(), stats.deferred);
+	} else {
+		mainEngine->fmsg(Engine::MSG_INFO,"  budget: none, %u changed states held back", stats.deferred);
+	}
+	mainEngine->fmsg(Engine::MSG_INFO,"  each written state waited %.1f ticks on average since its last update",
+		stats.states ? (double)stats.waited / stats.states : 0.0);
+
+	const bool reset = argc >= 1 && strcmp(argv[0], "reset") == 0;
+	Uint32 considered, relevant;
+	server->getInterestStats(considered, relevant, reset);
+	mainEngine->fmsg(Engine::MSG_INFO,"  interest: %u of %u entities sent (%.1f%%)",
+		relevant, considered, considered ? 100.0 * relevant / considered : 100.0);
+	if( reset ) {
+		stats = Snapshot::stats_t();
+	}
+	return 0;
+}
+
+static int console_serverBenchMessages(int argc, const char** argv) {
+	Uint32 rounds = 1000;
+	if( argc >= 1 ) {
+		rounds = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+
+	const MessageRegistry<Server>& messages = Server::getMessages();
+	double chainNs, tableNs;
+	if( !messages.benchmark(rounds, chainNs, tableNs) ) {
+		mainEngine->fmsg(Engine::MSG_INFO,"No packets received by the server yet.");
+		return 0;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO,"replayed the last %u packets %u times against %u handlers (handlers not called):",
+		messages.getNumRecent(), rounds, messages.getSize());
+	mainEngine->fmsg(Engine::MSG_INFO,"  strncmp chain + read32:     %.1f ns per packet", chainNs);
+	mainEngine->fmsg(Engine::MSG_INFO,"  table lookup + schema read: %.1f ns per packet", tableNs);
+	return 0;
+}
+
 static Ccmd ccmd_host("host","inits a new local server",&console_host);
 static Ccmd ccmd_serverReset("server.reset","restarts the local server",&console_serverReset);
 static Ccmd ccmd_serverDisconnect("server.disconnect","disconnects the server from all remote hosts",&console_serverDisconnect);
 static Ccmd ccmd_serverMap("server.map","loads a world file on the local server",&console_serverMap);
 static Ccmd ccmd_serverGen("server.gen","generates a level using the given properties",&console_serverGen);
 static Ccmd ccmd_serverSaveMap("server.savemap","saves the given level to disk",&console_serverSaveMap);
+static Ccmd ccmd_serverSnapshots("server.snapshots","prints entity snapshot bandwidth next to what one datagram per entity would cost (arg: 'reset' to zero the counters)",&console_serverSnapshots);
 static Ccmd ccmd_serverCount("server.count","counts the number of levels running on the server",&console_serverCount);
-static Ccmd ccmd_serverCountEntities("server.countentities", "count the number of entities in all worlds on the server", &console_serverCountEntities);
\ No newline at end of file
+static Ccmd ccmd_serverCountEntities("server.countentities", "count the number of entities in all worlds on the server", &console_serverCountEntities);
+static Ccmd ccmd_serverBenchMessages("server.benchmessages","replays recently received packets, payloads included, timing table lookup and schema reads against the old strncmp chain and read32 calls; handlers aren't called (arg: rounds)",&console_serverBenchMessages);
\ No newline at end of file
@@ -3,6 +3,10 @@
 #pragma once
 
 #include "Game.hpp"
+#include "HashMap.hpp"
+#include "Message.hpp"
+#include "Snapshot.hpp"
+#include "Interest.hpp"
 
 class Script;
 
@@ -44,6 +48,41 @@ public:
 	// update all clients about the players that are connected to me
 	void updateAllClientsAboutPlayers();
 
+	// getters & setters
+	Snapshot::stats_t&		getSnapshotStats()			{ return snapshotStats; }
+
+	// sums the interest counters of every client
+	// @param outConsidered receives the number of entities tested
+	// @param outRelevant receives the number that were sent
+	// @param reset if true, zeroes the counters afterward
+	void getInterestStats(Uint32& outConsidered, Uint32& outRelevant, bool reset);
+
+	// @return the handler for each packet type the server understands
+	static MessageRegistry<Server>& getMessages();
+
 private:
 	Script* script = nullptr;
+
+	// what the server keeps for each client
+	struct client_t {
+		SnapshotSender snapshots;
+		Interest interest;
+	};
+
+	HashMap<Uint32, client_t*> clients;		// by client id
+	Snapshot::stats_t snapshotStats;
+
+	// sends every client a snapshot of the entities it should know about
+	// @param elapsed ticks since the last snapshot
+	void sendSnapshots(Uint32 elapsed);
+
+	// handlers for each packet type (see getMessages())
+	// @param packet the packet, with its signature and type already read
+	// @param remoteID the remote host that sent it
+	void handleChat(Packet& packet, Uint32 remoteID);	// CMSG: a chat message to pass on to everyone
+	void handleSnapshotAck(Packet& packet, Uint32 remoteID);	// SACK: a client has a whole snapshot
+	void handleSpawn(Packet& packet, Uint32 remoteID);	// SPWN: a client wants a player spawned
+	void handleEntityCall(Packet& packet, Uint32 remoteID);	// ENTF: a remote function call on an entity
+	void handlePlayerUpdate(Packet& packet, Uint32 remoteID);	// PLAY: a client's player moved
+	void handleEntitySelect(Packet& packet, Uint32 remoteID);	// ESEL: a client's player selected an entity
 };
\ No newline at end of file
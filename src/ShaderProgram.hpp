@@ -6,7 +6,7 @@
 #include "ArrayList.hpp"
 #include "Node.hpp"
 #include "Shader.hpp"
-#include "Map.hpp"
+#include "HashMap.hpp"
 
 class Light;
 
@@ -64,5 +64,5 @@ private:
 	static const ShaderProgram* currentShader;
 	ArrayList<Shader> shaders;
 	GLuint programObject = 0;
-	Map<StringBuf<32>, GLuint> uniforms;
+	HashMap<StringBuf<32>, GLuint> uniforms;
 };
\ No newline at end of file
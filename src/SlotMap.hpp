@@ -0,0 +1,244 @@
+// SlotMap.hpp
+// Dense storage with stable, generation-checked handles
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+
+// templated SlotMap
+// values are kept contiguous in insertion order so iteration never chases pointers.
+// a handle stays valid until its value is erased, after which the slot's generation
+// is bumped and the stale handle resolves to nothing.
+// erasing only marks a value dead; holes are squeezed out by compact(), so it is safe
+// to erase (and insert) while iterating.
+// @param T generic type that the map will contain
+template <typename T>
+class SlotMap {
+public:
+	// handle to a value in the map
+	struct handle_t {
+		Uint32 index = UINT32_MAX;
+		Uint32 generation = 0;
+
+		bool operator==(const handle_t& src) const {
+			return index == src.index && generation == src.generation;
+		}
+		bool operator!=(const handle_t& src) const {
+			return index != src.index || generation != src.generation;
+		}
+	};
+
+	// invalid handle
+	static const handle_t nhandle;
+
+	SlotMap() {}
+	~SlotMap() {}
+
+	// getters & setters
+	Uint32		getSize() const				{ return size; }
+	Uint32		getDenseSize() const		{ return values.getSize(); }
+	bool		empty() const				{ return size == 0; }
+
+	// inserts a value at the end of the map
+	// @param value the value to insert
+	// @return a handle to the new value
+	handle_t insert(const T& value) {
+		Uint32 slotIndex;
+		if( freeHead != UINT32_MAX ) {
+			slotIndex = freeHead;
+			freeHead = slots[slotIndex].dense;
+		} else {
+			slotIndex = slots.getSize();
+			slots.push(slot_t());
+		}
+		slot_t& slot = slots[slotIndex];
+		slot.dense = values.getSize();
+
+		values.push(value);
+		owners.push(slotIndex);
+		alive.push(true);
+		++size;
+
+		handle_t handle;
+		handle.index = slotIndex;
+		handle.generation = slot.generation;
+		return handle;
+	}
+
+	// erases the value with the given handle. the value remains in dense storage
+	// (but is skipped by iteration) until the next call to compact()
+	// @param handle the handle of the value to erase
+	// @return true if the value was erased, false if the handle was stale
+	bool erase(const handle_t& handle) {
+		if( !valid(handle) ) {
+			return false;
+		}
+		slot_t& slot = slots[handle.index];
+		alive[slot.dense] = false;
+		++slot.generation;
+		slot.dense = freeHead;
+		freeHead = handle.index;
+		--size;
+		dirty = true;
+		return true;
+	}
+
+	// determines whether the given handle refers to a live value
+	// @param handle the handle to test
+	// @return true if the handle is live
+	bool valid(const handle_t& handle) const {
+		return handle.index < slots.getSize() && slots[handle.index].generation == handle.generation;
+	}
+
+	// finds the value with the given handle
+	// @param handle the handle of the value
+	// @return a pointer to the value, or nullptr if the handle is stale
+	T* find(const handle_t& handle) {
+		if( !valid(handle) ) {
+			return nullptr;
+		}
+		return &values[slots[handle.index].dense];
+	}
+	const T* find(const handle_t& handle) const {
+		if( !valid(handle) ) {
+			return nullptr;
+		}
+		return &values[slots[handle.index].dense];
+	}
+
+	// squeezes erased values out of dense storage, preserving the order of the rest.
+	// must not be called while iterating
+	void compact() {
+		if( !dirty ) {
+			return;
+		}
+		Uint32 dst = 0;
+		for( Uint32 src = 0; src < values.getSize(); ++src ) {
+			if( !alive[src] ) {
+				continue;
+			}
+			if( dst != src ) {
+				values[dst] = std::move(values[src]);
+				owners[dst] = owners[src];
+				alive[dst] = true;
+				slots[owners[dst]].dense = dst;
+			}
+			++dst;
+		}
+		values.resize(dst);
+		owners.resize(dst);
+		alive.resize(dst);
+		dirty = false;
+	}
+
+	// erases every value and invalidates all outstanding handles
+	void clear() {
+		for( Uint32 c = 0; c < values.getSize(); ++c ) {
+			if( alive[c] ) {
+				erase(handleForDense(c));
+			}
+		}
+		compact();
+	}
+
+	// Iterator
+	class Iterator {
+	public:
+		Iterator(SlotMap<T>& _map, Uint32 _pos) :
+			map(_map),
+			pos(_pos) { skip(); }
+
+		T& operator*() {
+			assert(pos < map.values.getSize());
+			return map.values[pos];
+		}
+		Iterator& operator++() {
+			++pos;
+			skip();
+			return *this;
+		}
+		// values inserted during iteration are past end() and are not visited,
+		// so this compares with < rather than != to stop cleanly
+		bool operator!=(const Iterator& it) const {
+			return pos < it.pos;
+		}
+	private:
+		void skip() {
+			while( pos < map.values.getSize() && !map.alive[pos] ) {
+				++pos;
+			}
+		}
+		SlotMap<T>& map;
+		Uint32 pos;
+	};
+
+	// ConstIterator
+	class ConstIterator {
+	public:
+		ConstIterator(const SlotMap<T>& _map, Uint32 _pos) :
+			map(_map),
+			pos(_pos) { skip(); }
+
+		const T& operator*() const {
+			assert(pos < map.values.getSize());
+			return map.values[pos];
+		}
+		ConstIterator& operator++() {
+			++pos;
+			skip();
+			return *this;
+		}
+		bool operator!=(const ConstIterator& it) const {
+			return pos < it.pos;
+		}
+	private:
+		void skip() {
+			while( pos < map.values.getSize() && !map.alive[pos] ) {
+				++pos;
+			}
+		}
+		const SlotMap<T>& map;
+		Uint32 pos;
+	};
+
+	// begin()
+	Iterator begin() {
+		return Iterator(*this, 0);
+	}
+	const ConstIterator begin() const {
+		return ConstIterator(*this, 0);
+	}
+
+	// end()
+	Iterator end() {
+		return Iterator(*this, values.getSize());
+	}
+	const ConstIterator end() const {
+		return ConstIterator(*this, values.getSize());
+	}
+
+private:
+	struct slot_t {
+		Uint32 dense = UINT32_MAX;	// index into dense storage, or next free slot
+		Uint32 generation = 0;		// bumped every time the slot is vacated
+	};
+
+	ArrayList<T> values;			// dense values
+	ArrayList<Uint32> owners;		// dense index -> slot index
+	ArrayList<bool> alive;			// dense index -> whether value is live
+	ArrayList<slot_t> slots;		// sparse slots
+	Uint32 freeHead = UINT32_MAX;	// first free slot
+	Uint32 size = 0;				// number of live values
+	bool dirty = false;				// true if there are holes in dense storage
+
+	handle_t handleForDense(Uint32 dense) const {
+		handle_t handle;
+		handle.index = owners[dense];
+		handle.generation = slots[handle.index].generation;
+		return handle;
+	}
+};
+
+template <typename T>
+const typename SlotMap<T>::handle_t SlotMap<T>::nhandle;
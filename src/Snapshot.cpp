@@ -0,0 +1,635 @@
+// Snapshot.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Snapshot.hpp"
+#include "BitStream.hpp"
+#include "Entity.hpp"
+#include "Player.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+
+Cvar cvar_bandwidth("server.bandwidth", "bytes per second of entity snapshots each client may receive (0 for no limit)", "32000");
+static Cvar cvar_priorityDistance("server.priority.distance", "distance from a player at which an entity's update priority falls to half", "512");
+static Cvar cvar_prioritySpeed("server.priority.speed", "update priority added per unit of speed", "0.5");
+static Cvar cvar_priorityPlayer("server.priority.player", "update priority multiplier for entities carrying a player", "4");
+
+// bytes of IP and UDP header on every datagram, and of the snapshot header and signature
+static const Uint32 datagramOverhead = 28 + (Packet::maxLen - Snapshot::maxPayload);
+
+// bits a key difference takes in a typical snapshot, for budgeting before the order is known
+static const Uint32 keyBitsEstimate = 10;
+
+// fields that can change between two states
+static const Uint32 CHANGED_POS = 1 << 0;
+static const Uint32 CHANGED_VEL = 1 << 1;
+static const Uint32 CHANGED_ANG = 1 << 2;
+static const Uint32 CHANGED_FLAGS = 1 << 3;
+static const Uint32 CHANGED_PLAYER = 1 << 4;
+static const Uint32 CHANGED_NUM = 5;
+
+template <typename T>
+static bool same(const T (&a)[3], const T (&b)[3]) {
+	return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+static bool keyLess(const Snapshot::state_t& a, const Snapshot::state_t& b) {
+	return a.getKey() < b.getKey();
+}
+
+// @return the state with the given key in a sorted list, or nullptr
+static const Snapshot::state_t* findState(const ArrayList<Snapshot::state_t>& states, Uint64 key) {
+	const Snapshot::state_t* begin = states.getArray();
+	const Snapshot::state_t* end = begin + states.getSize();
+	const Snapshot::state_t* it = std::lower_bound(begin, end, key, [](const Snapshot::state_t& state, Uint64 key) {
+		return state.getKey() < key;
+	});
+	return it != end && it->getKey() == key ? it : nullptr;
+}
+
+float Snapshot::importance(const state_t& state, float distance) {
+	const float half = std::max(1.f, cvar_priorityDistance.toFloat());
+	const float falloff = 1.f / (1.f + (distance * distance) / (half * half));
+	const float speed = state.getVel().length();
+	float result = (1.f + speed * cvar_prioritySpeed.toFloat()) * falloff;
+	if( state.flags & FLAG_PLAYER ) {
+		result *= std::max(1.f, cvar_priorityPlayer.toFloat());
+	}
+	return result;
+}
+
+void Snapshot::capture(Entity& entity, state_t& state) {
+	const World* world = entity.getWorld();
+	state.world = world ? world->getID() : 0;
+	state.uid = entity.getUID();
+	state.def = entity.getDefIndex();
+	state.pos[0] = (Sint32)(entity.getPos().x * 32);
+	state.pos[1] = (Sint32)(entity.getPos().y * 32);
+	state.pos[2] = (Sint32)(entity.getPos().z * 32);
+	state.vel[0] = (Sint32)(entity.getVel().x * 128);
+	state.vel[1] = (Sint32)(entity.getVel().y * 128);
+	state.vel[2] = (Sint32)(entity.getVel().z * 128);
+	fromAngle(entity.getAng(), state.ang);
+	state.flags = entity.isFalling() ? FLAG_FALLING : 0;
+
+	Player* player = entity.getPlayer();
+	if( player ) {
+		state.flags |= FLAG_PLAYER;
+		state.flags |= player->hasJumped() ? FLAG_JUMPED : 0;
+		state.flags |= player->isMoving() ? FLAG_MOVING : 0;
+		state.flags |= player->isCrouching() ? FLAG_CROUCHING : 0;
+		state.serverID = player->getServerID();
+		fromAngle(entity.getLookDir(), state.lookDir);
+	} else {
+		state.serverID = UINT32_MAX;
+		state.lookDir[0] = state.lookDir[1] = state.lookDir[2] = 0;
+	}
+}
+
+Uint32 Snapshot::legacySize(const state_t& state) {
+	// signature, type, world, uid, def, pos, vel, ang, falling, player byte
+	Uint32 size = 8 + 4 + 4 + 4 + 4 + 12 + 12 + 12 + 1 + 1;
+	if( state.flags & FLAG_PLAYER ) {
+		// server id, crouching, moving, jumped, look direction
+		size += 4 + 3 + 12;
+	}
+	return size;
+}
+
+void Snapshot::fromAngle(const Angle& angle, Uint16 (&out)[3]) {
+	const float scale = 65536.f / (PI * 2.f);
+	out[0] = (Uint16)(Sint32)floorf(angle.yaw * scale + .5f);
+	out[1] = (Uint16)(Sint32)floorf(angle.pitch * scale + .5f);
+	out[2] = (Uint16)(Sint32)floorf(angle.roll * scale + .5f);
+}
+
+Angle Snapshot::toAngle(const Uint16 (&in)[3]) {
+	const float scale = (PI * 2.f) / 65536.f;
+	return Angle((Sint16)in[0] * scale, (Sint16)in[1] * scale, (Sint16)in[2] * scale);
+}
+
+bool Snapshot::writeState(BitWriter& bits, const state_t& state, const state_t* baseline) {
+	static const state_t zero;
+	Uint32 changed = 0;
+	if( baseline && baseline->def == state.def ) {
+		changed |= same(state.pos, baseline->pos) ? 0 : CHANGED_POS;
+		changed |= same(state.vel, baseline->vel) ? 0 : CHANGED_VEL;
+		changed |= same(state.ang, baseline->ang) ? 0 : CHANGED_ANG;
+		changed |= state.flags == baseline->flags ? 0 : CHANGED_FLAGS;
+		if( state.flags & FLAG_PLAYER ) {
+			if( state.serverID != baseline->serverID || !same(state.lookDir, baseline->lookDir) ) {
+				changed |= CHANGED_PLAYER;
+			}
+		}
+		if( !changed ) {
+			return false;
+		}
+		bits.writeBool(false);
+		bits.write(changed, CHANGED_NUM);
+	} else {
+		// new to the client, so everything is written against zero
+		baseline = &zero;
+		changed = CHANGED_POS | CHANGED_VEL | CHANGED_ANG | CHANGED_FLAGS;
+		changed |= (state.flags & FLAG_PLAYER) ? CHANGED_PLAYER : 0;
+		bits.writeBool(true);
+		bits.writeVar((Uint32)(state.def + 1));
+	}
+
+	for( int c = 0; c < 3 && (changed & CHANGED_POS); ++c ) {
+		bits.writeSigned((Sint32)((Uint32)state.pos[c] - (Uint32)baseline->pos[c]));
+	}
+	for( int c = 0; c < 3 && (changed & CHANGED_VEL); ++c ) {
+		bits.writeSigned((Sint32)((Uint32)state.vel[c] - (Uint32)baseline->vel[c]));
+	}
+	for( int c = 0; c < 3 && (changed & CHANGED_ANG); ++c ) {
+		bits.writeSigned((Sint16)(Uint16)(state.ang[c] - baseline->ang[c]));
+	}
+	if( changed & CHANGED_FLAGS ) {
+		bits.write(state.flags, numFlags);
+	}
+	if( changed & CHANGED_PLAYER ) {
+		bits.writeVar((Uint32)(state.serverID + 1));
+		for( int c = 0; c < 3; ++c ) {
+			bits.writeSigned((Sint16)(Uint16)(state.lookDir[c] - baseline->lookDir[c]));
+		}
+	}
+	return true;
+}
+
+bool Snapshot::readState(BitReader& bits, state_t& state, const state_t* baseline) {
+	static const state_t zero;
+	Uint32 changed = 0;
+	if( bits.readBool() ) {
+		baseline = &zero;
+		state.def = (Uint32)bits.readVar() - 1;
+		changed = CHANGED_POS | CHANGED_VEL | CHANGED_ANG | CHANGED_FLAGS;
+	} else {
+		if( !baseline ) {
+			return false;
+		}
+		state = *baseline;
+		changed = bits.read(CHANGED_NUM);
+	}
+
+	for( int c = 0; c < 3 && (changed & CHANGED_POS); ++c ) {
+		state.pos[c] = (Sint32)((Uint32)baseline->pos[c] + (Uint32)bits.readSigned());
+	}
+	for( int c = 0; c < 3 && (changed & CHANGED_VEL); ++c ) {
+		state.vel[c] = (Sint32)((Uint32)baseline->vel[c] + (Uint32)bits.readSigned());
+	}
+	for( int c = 0; c < 3 && (changed & CHANGED_ANG); ++c ) {
+		state.ang[c] = (Uint16)(baseline->ang[c] + bits.readSigned());
+	}
+	if( changed & CHANGED_FLAGS ) {
+		state.flags = (Uint8)bits.read(numFlags);
+		if( baseline == &zero && (state.flags & FLAG_PLAYER) ) {
+			changed |= CHANGED_PLAYER;
+		}
+	}
+	if( changed & CHANGED_PLAYER ) {
+		state.serverID = (Uint32)bits.readVar() - 1;
+		for( int c = 0; c < 3; ++c ) {
+			state.lookDir[c] = (Uint16)(baseline->lookDir[c] + bits.readSigned());
+		}
+	}
+	return true;
+}
+
+void SnapshotSender::begin() {
+	current.clearKeepCapacity();
+}
+
+void SnapshotSender::add(const Snapshot::state_t& state, float importance) {
+	pending_t pending;
+	pending.state = state;
+	pending.importance = importance;
+	current.push(pending);
+}
+
+void SnapshotSender::finish(ArrayList<Packet*>& out, Uint32 elapsed, Snapshot::stats_t* stats) {
+	std::sort(current.getArray(), current.getArray() + current.getSize(), [](const pending_t& a, const pending_t& b) {
+		return a.state.getKey() < b.state.getKey();
+	});
+
+	// the baseline is usable while the client still remembers it
+	const sent_t* base = nullptr;
+	if( acked != Snapshot::noBaseline && sequence - acked < Snapshot::historySize ) {
+		const sent_t& candidate = history[acked % Snapshot::historySize];
+		if( candidate.sequence == acked ) {
+			base = &candidate;
+		}
+	}
+	const Snapshot::state_t* baseStates = base ? base->states.getArray() : nullptr;
+	const Uint32 numBaseStates = base ? base->states.getSize() : 0;
+
+	// top up the budget. it can bank a tenth of a second, or one full datagram at low rates
+	const Sint32 bandwidth = cvar_bandwidth.toInt();
+	const bool limited = bandwidth > 0;
+	if( limited ) {
+		const Sint32 perTick = bandwidth / (Sint32)std::max(1u, mainEngine->getTicksPerSecond());
+		const Sint32 burst = std::max(bandwidth / 10, (Sint32)(Packet::maxLen + 28));
+		allowance = std::min(allowance + perTick * (Sint32)elapsed, burst);
+	}
+
+	// grow every priority, and price each change
+	struct choice_t {
+		Uint32 index;
+		float priority;
+		Uint32 bits;
+	};
+	ArrayList<choice_t> choices;
+	for( Uint32 c = 0; c < current.getSize(); ++c ) {
+		pending_t& pending = current[c];
+		const Uint64 key = pending.state.getKey();
+		priority_t* priority = priorities.find(key);
+		if( !priority ) {
+			priorities.insert(key, priority_t());
+			priority = priorities.find(key);
+		}
+		priority->accumulated += pending.importance * elapsed;
+		priority->waited += elapsed;
+
+		const Snapshot::state_t* baseline = base ? findState(base->states, key) : nullptr;
+		Uint8 scratch[Snapshot::maxPayload];
+		BitWriter bits(scratch, sizeof(scratch));
+		if( !Snapshot::writeState(bits, pending.state, baseline) ) {
+			pending.action = ACTION_KEEP;
+			priority->accumulated = 0.f;
+			priority->waited = 0;
+			continue;
+		}
+		pending.action = limited ? ACTION_DEFER : ACTION_SEND;
+		choices.push(choice_t{ c, priority->accumulated, bits.getBits() + keyBitsEstimate });
+	}
+
+	// spend the budget on the highest priorities. something too big for what's left doesn't
+	// stop smaller ones behind it from going
+	if( limited ) {
+		std::sort(choices.getArray(), choices.getArray() + choices.getSize(), [](const choice_t& a, const choice_t& b) {
+			return a.priority > b.priority;
+		});
+		const Uint32 payloadBits = Snapshot::maxPayload * 8;
+		Uint32 spent = 0;
+		for( auto& choice : choices ) {
+			const Uint32 total = spent + choice.bits;
+			const Uint32 numDatagrams = total / payloadBits + 1;
+			if( (Sint32)((total + 7) / 8 + numDatagrams * datagramOverhead) > allowance ) {
+				continue;
+			}
+			spent = total;
+			current[choice.index].action = ACTION_SEND;
+		}
+	}
+
+	// record what the client will have once this snapshot is whole
+	sent_t& sent = history[sequence % Snapshot::historySize];
+	sent.states.clearKeepCapacity();
+
+	struct fragment_t {
+		Packet* packet = nullptr;
+		Uint16 numUpdates = 0;
+		Uint16 numRemoved = 0;
+	};
+	ArrayList<fragment_t> fragments;
+	Packet* packet = new Packet();
+	BitWriter* bits = new BitWriter((Uint8*)packet->data, Snapshot::maxPayload);
+	fragment_t fragment;
+	fragment.packet = packet;
+	Uint64 lastKey = 0;
+	bool full = false;
+	Uint32 numDeferred = 0;
+	Uint64 waited = 0;
+
+	// finishes the current datagram
+	auto closeFragment = [&]() {
+		packet->offset = bits->getBytes();
+		fragments.push(fragment);
+		delete bits;
+		bits = nullptr;
+	};
+
+	// starts the next datagram, or returns false if the snapshot can't take another
+	auto nextFragment = [&]() {
+		closeFragment();
+		if( fragments.getSize() >= Snapshot::maxFragments ) {
+			full = true;
+			return false;
+		}
+		packet = new Packet();
+		bits = new BitWriter((Uint8*)packet->data, Snapshot::maxPayload);
+		fragment = fragment_t();
+		fragment.packet = packet;
+		lastKey = 0;
+		return true;
+	};
+
+	// updates first, by key. if the last snapshot ran out of room, start where it stopped so
+	// the same entities aren't always the ones left out (keys wrap around once, which the
+	// running key difference handles)
+	const pending_t* begin = current.getArray();
+	const pending_t* end = begin + current.getSize();
+	const Uint32 start = (Uint32)(std::lower_bound(begin, end, resumeKey, [](const pending_t& pending, Uint64 key) {
+		return pending.state.getKey() < key;
+	}) - begin);
+	resumeKey = 0;
+	for( Uint32 c = 0; c < current.getSize(); ++c ) {
+		const pending_t& pending = current[(start + c) % current.getSize()];
+		const Snapshot::state_t& state = pending.state;
+		const Uint64 key = state.getKey();
+		const Snapshot::state_t* baseline = base ? findState(base->states, key) : nullptr;
+
+		if( pending.action == ACTION_KEEP ) {
+			sent.states.push(state);
+			continue;
+		}
+		if( full || pending.action == ACTION_DEFER ) {
+			// out of room or budget: the client keeps whatever it had
+			if( baseline ) {
+				sent.states.push(*baseline);
+			}
+			++numDeferred;
+			continue;
+		}
+
+		Uint32 mark = bits->getBits();
+		bits->writeVar(key - lastKey);
+		Snapshot::writeState(*bits, state, baseline);
+		if( bits->isOverflowed() ) {
+			bits->rewind(mark);
+			if( !nextFragment() ) {
+				resumeKey = key;
+				if( baseline ) {
+					sent.states.push(*baseline);
+				}
+				++numDeferred;
+				continue;
+			}
+			bits->writeVar(key);
+			Snapshot::writeState(*bits, state, baseline);
+		}
+		lastKey = key;
+		++fragment.numUpdates;
+		sent.states.push(state);
+
+		priority_t* priority = priorities.find(key);
+		waited += priority->waited;
+		priority->accumulated = 0.f;
+		priority->waited = 0;
+	}
+
+	// forget the priorities of entities that left
+	if( priorities.getSize() > current.getSize() ) {
+		ArrayList<Uint64> gone;
+		for( auto& pair : priorities ) {
+			const pending_t* it = std::lower_bound(begin, end, pair.a, [](const pending_t& pending, Uint64 key) {
+				return pending.state.getKey() < key;
+			});
+			if( it == end || it->state.getKey() != pair.a ) {
+				gone.push(pair.a);
+			}
+		}
+		for( auto key : gone ) {
+			priorities.remove(key);
+		}
+	}
+
+	// then the keys the client should forget
+	for( Uint32 c = 0, index = 0; c < numBaseStates; ++c ) {
+		const Uint64 key = baseStates[c].getKey();
+		while( index < current.getSize() && current[index].state.getKey() < key ) {
+			++index;
+		}
+		if( index < current.getSize() && current[index].state.getKey() == key ) {
+			continue;
+		}
+		if( full ) {
+			sent.states.push(baseStates[c]);
+			continue;
+		}
+		if( fragment.numRemoved == 0 ) {
+			lastKey = 0;
+		}
+		Uint32 mark = bits->getBits();
+		bits->writeVar(key - lastKey);
+		if( bits->isOverflowed() ) {
+			bits->rewind(mark);
+			if( !nextFragment() ) {
+				sent.states.push(baseStates[c]);
+				continue;
+			}
+			bits->writeVar(key);
+		}
+		lastKey = key;
+		++fragment.numRemoved;
+	}
+	if( !full ) {
+		closeFragment();
+	}
+	std::sort(sent.states.getArray(), sent.states.getArray() + sent.states.getSize(), keyLess);
+
+	// the client already has all of it
+	Uint32 numUpdates = 0;
+	Uint32 numRemoved = 0;
+	for( auto& f : fragments ) {
+		numUpdates += f.numUpdates;
+		numRemoved += f.numRemoved;
+	}
+	if( stats ) {
+		stats->deferred += numDeferred;
+		stats->waited += waited;
+	}
+	if( numUpdates == 0 && numRemoved == 0 ) {
+		for( auto& f : fragments ) {
+			delete f.packet;
+		}
+		sent.sequence = Snapshot::noBaseline;
+		return;
+	}
+
+	for( Uint32 c = 0; c < fragments.getSize(); ++c ) {
+		const fragment_t& f = fragments[c];
+		if( limited ) {
+			allowance -= (Sint32)(f.packet->offset + datagramOverhead);
+		}
+		f.packet->write16((Uint16)f.packet->offset);
+		f.packet->write16(f.numRemoved);
+		f.packet->write16(f.numUpdates);
+		f.packet->write8((Uint8)fragments.getSize());
+		f.packet->write8((Uint8)c);
+		f.packet->write32(base ? base->sequence : Snapshot::noBaseline);
+		f.packet->write32(sequence);
+		f.packet->write("SNAP");
+		out.push(f.packet);
+	}
+	if( stats ) {
+		++stats->snapshots;
+		stats->states += numUpdates;
+	}
+	sent.sequence = sequence;
+	++sequence;
+}
+
+void SnapshotSender::ack(Uint32 _sequence) {
+	if( _sequence == Snapshot::noBaseline ) {
+		acked = Snapshot::noBaseline;
+		return;
+	}
+	if( _sequence >= sequence || sequence - _sequence >= Snapshot::historySize ) {
+		return;
+	}
+	if( history[_sequence % Snapshot::historySize].sequence != _sequence ) {
+		return;
+	}
+	if( acked == Snapshot::noBaseline || _sequence > acked ) {
+		acked = _sequence;
+	}
+}
+
+SnapshotReceiver::result_t SnapshotReceiver::read(Packet& packet, ArrayList<Snapshot::state_t>& out, ArrayList<Uint64>& outRemoved, Uint32& outSequence) {
+	Uint32 sequence, baseline;
+	Uint8 index, numFragments;
+	Uint16 numUpdates, numRemoved, len;
+	if( !packet.read32(sequence) || !packet.read32(baseline) ||
+		!packet.read8(index) || !packet.read8(numFragments) ||
+		!packet.read16(numUpdates) || !packet.read16(numRemoved) || !packet.read16(len) ) {
+		return IGNORED;
+	}
+	if( numFragments == 0 || numFragments > Snapshot::maxFragments || index >= numFragments ) {
+		return IGNORED;
+	}
+	if( len == 0 || len > Snapshot::maxPayload ) {
+		return IGNORED;
+	}
+	Uint8 payload[Snapshot::maxPayload];
+	if( !packet.read((char*)payload, len) ) {
+		return IGNORED;
+	}
+	outSequence = sequence;
+
+	// too old to be anyone's baseline
+	if( newest != Snapshot::noBaseline && sequence + Snapshot::historySize <= newest ) {
+		return IGNORED;
+	}
+
+	received_t& received = history[sequence % Snapshot::historySize];
+	if( received.sequence != sequence ) {
+		received.sequence = sequence;
+		received.baseline = baseline;
+		received.numFragments = numFragments;
+		received.fragments = 0;
+		received.complete = false;
+		received.updates.clearKeepCapacity();
+		received.removed.clearKeepCapacity();
+		received.states.clearKeepCapacity();
+	} else if( received.baseline != baseline || received.numFragments != numFragments ) {
+		return IGNORED;
+	} else if( received.fragments & (1u << index) ) {
+		return IGNORED;
+	}
+
+	const received_t* base = nullptr;
+	if( baseline != Snapshot::noBaseline ) {
+		base = findComplete(baseline);
+		if( !base ) {
+			return NEED_BASELINE;
+		}
+	}
+
+	BitReader bits(payload, len);
+	const Uint32 firstUpdate = received.updates.getSize();
+	const Uint32 firstRemoved = received.removed.getSize();
+	Uint64 key = 0;
+	for( Uint32 c = 0; c < numUpdates; ++c ) {
+		key += bits.readVar();
+		Snapshot::state_t state;
+		state.world = (Uint32)(key >> 32);
+		state.uid = (Uint32)key;
+		const Snapshot::state_t* prior = base ? findState(base->states, key) : nullptr;
+		if( !Snapshot::readState(bits, state, prior) ) {
+			// the server thinks we have something we don't
+			received.updates.resize(firstUpdate);
+			return NEED_BASELINE;
+		}
+		received.updates.push(state);
+	}
+	key = 0;
+	for( Uint32 c = 0; c < numRemoved; ++c ) {
+		key += bits.readVar();
+		received.removed.push(key);
+	}
+	if( bits.isOverflowed() ) {
+		received.updates.resize(firstUpdate);
+		received.removed.resize(firstRemoved);
+		return IGNORED;
+	}
+	received.fragments |= 1u << index;
+
+	// states older than what's on screen are only kept as a baseline
+	if( newest == Snapshot::noBaseline || sequence >= newest ) {
+		newest = sequence;
+		for( Uint32 c = firstUpdate; c < received.updates.getSize(); ++c ) {
+			out.push(received.updates[c]);
+		}
+		for( Uint32 c = firstRemoved; c < received.removed.getSize(); ++c ) {
+			outRemoved.push(received.removed[c]);
+		}
+	}
+
+	if( received.fragments == (numFragments == 32 ? UINT32_MAX : (1u << numFragments) - 1) ) {
+		complete(received, base);
+		return COMPLETE;
+	}
+	return PARTIAL;
+}
+
+void SnapshotReceiver::reset() {
+	for( auto& received : history ) {
+		received.sequence = Snapshot::noBaseline;
+		received.complete = false;
+		received.updates.clear();
+		received.removed.clear();
+		received.states.clear();
+	}
+	newest = Snapshot::noBaseline;
+}
+
+const SnapshotReceiver::received_t* SnapshotReceiver::findComplete(Uint32 sequence) const {
+	const received_t& received = history[sequence % Snapshot::historySize];
+	return received.sequence == sequence && received.complete ? &received : nullptr;
+}
+
+void SnapshotReceiver::complete(received_t& received, const received_t* baseline) {
+	ArrayList<Snapshot::state_t>& updates = received.updates;
+	ArrayList<Uint64>& removed = received.removed;
+	std::sort(updates.getArray(), updates.getArray() + updates.getSize(), keyLess);
+	std::sort(removed.getArray(), removed.getArray() + removed.getSize());
+
+	// everything in the baseline that wasn't replaced or removed, plus the updates
+	received.states.clearKeepCapacity();
+	Uint32 u = 0, r = 0;
+	const Uint32 numBase = baseline ? baseline->states.getSize() : 0;
+	for( Uint32 c = 0; c < numBase; ++c ) {
+		const Snapshot::state_t& state = baseline->states[c];
+		const Uint64 key = state.getKey();
+		while( u < updates.getSize() && updates[u].getKey() < key ) {
+			received.states.push(updates[u++]);
+		}
+		while( r < removed.getSize() && removed[r] < key ) {
+			++r;
+		}
+		if( u < updates.getSize() && updates[u].getKey() == key ) {
+			continue;
+		}
+		if( r < removed.getSize() && removed[r] == key ) {
+			continue;
+		}
+		received.states.push(state);
+	}
+	while( u < updates.getSize() ) {
+		received.states.push(updates[u++]);
+	}
+	updates.clearKeepCapacity();
+	removed.clearKeepCapacity();
+	received.complete = true;
+}
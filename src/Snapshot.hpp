@@ -0,0 +1,238 @@
+// Snapshot.hpp
+// Batched, delta-compressed entity updates from the server to each client
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+#include "Packet.hpp"
+#include "Vector.hpp"
+#include "Angle.hpp"
+
+class Entity;
+class BitWriter;
+class BitReader;
+class Cvar;
+
+// every tick the server captures the state of each entity a client should hear about,
+// quantizes it, and compares it with the last snapshot that client acknowledged. only the
+// fields that changed are written, as small deltas where possible, and as many entities as fit
+// go in each datagram. each client gets a budget of bytes per second, and when there's more to
+// say than the budget allows, the entities that matter most to the client go first (see
+// SnapshotSender). the client acknowledges a snapshot once every datagram of it has
+// arrived, and the server uses the newest acknowledged snapshot as the baseline for the next.
+// if acknowledgements stop coming the baseline ages out, and states are sent in full again.
+// entities in the baseline but not in the snapshot are listed as removed, which is how a client
+// learns to despawn what it no longer needs to see (see Interest).
+class Snapshot {
+public:
+	// snapshots remembered on each end (about a second at the default tick rate)
+	static const Uint32 historySize = 64;
+
+	// most datagrams one snapshot can be split over
+	static const Uint32 maxFragments = 32;
+
+	// bytes of a datagram the entity states can fill (the rest is the header and signature)
+	static const Uint32 maxPayload = Packet::maxLen - 32;
+
+	// means a snapshot has no baseline, or asks the server to stop using one
+	static const Uint32 noBaseline = UINT32_MAX;
+
+	// state flags
+	enum flag_t {
+		FLAG_FALLING = 1 << 0,
+		FLAG_PLAYER = 1 << 1,
+		FLAG_JUMPED = 1 << 2,
+		FLAG_MOVING = 1 << 3,
+		FLAG_CROUCHING = 1 << 4
+	};
+	static const Uint32 numFlags = 5;
+
+	// quantized state of one entity
+	struct state_t {
+		Uint32 world = 0;
+		Uint32 uid = 0;
+		Uint32 def = UINT32_MAX;
+		Sint32 pos[3] = { 0, 0, 0 };		// 1/32 of a unit
+		Sint32 vel[3] = { 0, 0, 0 };		// 1/128 of a unit
+		Uint16 ang[3] = { 0, 0, 0 };		// yaw, pitch, roll in 1/65536 of a turn
+		Uint16 lookDir[3] = { 0, 0, 0 };	// players only
+		Uint32 serverID = UINT32_MAX;		// players only
+		Uint8 flags = 0;
+
+		// @return the key states are sorted and matched by
+		Uint64 getKey() const {
+			return ((Uint64)world << 32) | uid;
+		}
+
+		// getters & setters
+		Vector		getPos() const		{ return Vector(pos[0] / 32.f, pos[1] / 32.f, pos[2] / 32.f); }
+		Vector		getVel() const		{ return Vector(vel[0] / 128.f, vel[1] / 128.f, vel[2] / 128.f); }
+		Angle		getAng() const		{ return toAngle(ang); }
+		Angle		getLookDir() const	{ return toAngle(lookDir); }
+	};
+
+	// counters since the last reset, for comparing with one ENTU datagram per entity per client
+	struct stats_t {
+		Uint32 ticks = 0;				// ticks counted
+		Uint32 snapshots = 0;			// snapshots sent
+		Uint32 packets = 0;				// datagrams sent
+		Uint64 bytes = 0;				// bytes sent
+		Uint32 states = 0;				// entity states that changed and were written
+		Uint32 legacyPackets = 0;		// datagrams one ENTU per entity would have taken
+		Uint64 legacyBytes = 0;			// bytes those would have taken
+		Uint32 deferred = 0;			// changed states held back by the bandwidth budget
+		Uint64 waited = 0;				// ticks each written state waited since it was last written
+	};
+
+	// captures the state of an entity
+	// @param entity the entity
+	// @param state receives the quantized state
+	static void capture(Entity& entity, state_t& state);
+
+	// how much a client cares about an entity right now: entities close to one of the client's
+	// players, moving fast, or carrying a player rank higher
+	// @param state the entity's state
+	// @param distance distance from the nearest of the client's players in the same world
+	// @return the amount the entity's priority grows by each tick it isn't sent
+	static float importance(const state_t& state, float distance);
+
+	// @return the size of the ENTU datagram that used to carry one entity's state
+	static Uint32 legacySize(const state_t& state);
+
+	// quantizes an angle to 1/65536 of a turn
+	static void fromAngle(const Angle& angle, Uint16 (&out)[3]);
+
+	// @return the angle a quantized angle stands for
+	static Angle toAngle(const Uint16 (&in)[3]);
+
+	// writes one state, as a change from a baseline if there is one
+	// @param bits the stream to write to
+	// @param state the state to write
+	// @param baseline the state the client already has, or nullptr
+	// @return false if nothing changed (and nothing was written)
+	static bool writeState(BitWriter& bits, const state_t& state, const state_t* baseline);
+
+	// reads one state written by writeState()
+	// @param bits the stream to read from
+	// @param state receives the state (its world and uid must already be set)
+	// @param baseline the client's state for the same key, or nullptr
+	// @return false if the state was written as a change but there's no baseline to change
+	static bool readState(BitReader& bits, state_t& state, const state_t* baseline);
+};
+
+// what the server remembers about the snapshots it has sent one client. each entity has a
+// priority that grows by its importance every tick it goes unsent, and goes back to zero when
+// it's written. when the changes don't all fit in the client's budget the highest priorities
+// go first, so a fast mover next to the player is sent every tick while a prop at the edge of
+// view waits until enough ticks have piled up. unchanged entities cost nothing and never wait.
+class SnapshotSender {
+public:
+	SnapshotSender() {}
+	~SnapshotSender() {}
+
+	// getters & setters
+	Uint32		getSequence() const			{ return sequence; }
+	Uint32		getAcked() const			{ return acked; }
+
+	// starts a new snapshot
+	void begin();
+
+	// adds an entity to the snapshot
+	// @param state the entity's state
+	// @param importance see Snapshot::importance()
+	void add(const Snapshot::state_t& state, float importance);
+
+	// encodes the snapshot against the newest one the client acknowledged, keeping within the
+	// bandwidth budget, and splits it into datagrams. the datagrams still need to be signed
+	// @param out receives the new packets, which belong to the caller
+	// @param elapsed ticks since the last snapshot
+	// @param stats if not nullptr, is updated with the number of states written and held back
+	void finish(ArrayList<Packet*>& out, Uint32 elapsed, Snapshot::stats_t* stats = nullptr);
+
+	// records that the client has every datagram of a snapshot
+	// @param sequence the snapshot acknowledged, or Snapshot::noBaseline if the client lost
+	// track and needs full states
+	void ack(Uint32 sequence);
+
+private:
+	struct sent_t {
+		Uint32 sequence = Snapshot::noBaseline;
+		ArrayList<Snapshot::state_t> states;	// sorted by key
+	};
+
+	// what to do with an entity in the snapshot being built
+	enum action_t {
+		ACTION_SEND,							// write it
+		ACTION_KEEP,							// the client already has it
+		ACTION_DEFER							// changed, but over budget
+	};
+
+	struct pending_t {
+		Snapshot::state_t state;
+		float importance = 0.f;
+		action_t action = ACTION_SEND;
+	};
+
+	struct priority_t {
+		float accumulated = 0.f;				// importance summed over the ticks it went unsent
+		Uint32 waited = 0;						// ticks since it was last written
+	};
+
+	sent_t history[Snapshot::historySize];
+	Uint32 sequence = 0;						// the next snapshot's sequence number
+	Uint32 acked = Snapshot::noBaseline;
+	Uint64 resumeKey = 0;						// where the last snapshot ran out of room
+	Sint32 allowance = 0;						// bytes the budget has left to spend
+	ArrayList<pending_t> current;				// sorted by key once finish() starts
+	HashMap<Uint64, priority_t> priorities;		// by key, for entities in the snapshot
+};
+
+// the client's end: rebuilds each snapshot from its baseline and the datagrams that arrive
+class SnapshotReceiver {
+public:
+	SnapshotReceiver() {}
+	~SnapshotReceiver() {}
+
+	enum result_t {
+		IGNORED,			// the datagram was stale, repeated, or damaged
+		PARTIAL,			// more datagrams of the snapshot are still due
+		COMPLETE,			// the snapshot is whole and should be acknowledged
+		NEED_BASELINE		// the baseline isn't here anymore; ask for full states
+	};
+
+	// reads one datagram of a snapshot
+	// @param packet the packet, with its type already read
+	// @param out receives the states it carried, unless a newer snapshot was already applied
+	// @param outRemoved receives the keys of entities the server stopped sending (same rule)
+	// @param outSequence receives the snapshot's sequence number
+	// @return what to do about it
+	result_t read(Packet& packet, ArrayList<Snapshot::state_t>& out, ArrayList<Uint64>& outRemoved, Uint32& outSequence);
+
+	// forgets every snapshot (when the worlds are closed)
+	void reset();
+
+private:
+	struct received_t {
+		Uint32 sequence = Snapshot::noBaseline;
+		Uint32 baseline = Snapshot::noBaseline;
+		Uint32 numFragments = 0;
+		Uint32 fragments = 0;					// bit per datagram received
+		bool complete = false;
+		ArrayList<Snapshot::state_t> updates;	// states received so far
+		ArrayList<Uint64> removed;				// keys dropped since the baseline
+		ArrayList<Snapshot::state_t> states;	// the whole snapshot once complete, sorted by key
+	};
+
+	received_t history[Snapshot::historySize];
+	Uint32 newest = Snapshot::noBaseline;		// newest snapshot applied
+
+	// @return the complete snapshot with the given sequence number, or nullptr
+	const received_t* findComplete(Uint32 sequence) const;
+
+	// merges the baseline and the updates once every datagram is in
+	void complete(received_t& received, const received_t* baseline);
+};
+
+extern Cvar cvar_bandwidth;
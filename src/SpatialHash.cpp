@@ -0,0 +1,271 @@
+// SpatialHash.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Entity.hpp"
+#include "SpatialHash.hpp"
+#include "Tile.hpp"
+#include "Chunk.hpp"
+
+#include <algorithm>
+
+const float SpatialHash::defaultCellSize = (float)(Tile::size * Chunk::size * 2);
+
+// batches smaller than this aren't worth waking the worker threads for
+static const Uint32 minParallelQueries = 64;
+
+SpatialHash::SpatialHash(float _cellSize) {
+	cellSize = _cellSize > 0.f ? _cellSize : defaultCellSize;
+	invCellSize = 1.f / cellSize;
+}
+
+SpatialHash::~SpatialHash() {
+	for( auto cell : cells ) {
+		delete cell;
+	}
+	cells.clear();
+}
+
+Sint32 SpatialHash::toCell(float v) const {
+	float c = floorf(v * invCellSize);
+	c = std::min(std::max(c, (float)INT16_MIN), (float)INT16_MAX);
+	return (Sint32)c;
+}
+
+// coordinates wrap every 65536 cells, so very distant cells can share a key. that only costs
+// time: every query still checks real positions
+Uint32 SpatialHash::packCell(Sint32 x, Sint32 y) {
+	return ((Uint32)x & 0xffff) | (((Uint32)y & 0xffff) << 16);
+}
+
+Uint32 SpatialHash::findCell(Sint32 x, Sint32 y) const {
+	const Uint32* index = cellMap.find(packCell(x, y));
+	return index ? *index : nullCell;
+}
+
+Uint32 SpatialHash::getCell(Sint32 x, Sint32 y) {
+	Uint32 key = packCell(x, y);
+	Uint32* index = cellMap.find(key);
+	if( index ) {
+		return *index;
+	}
+	Uint32 newIndex = cells.getSize();
+	cells.push(new cell_t());
+	cellMap.insert(key, newIndex);
+	return newIndex;
+}
+
+void SpatialHash::update(Entity* entity) {
+	proxy_t& proxy = entity->getSpatialProxy();
+	const Vector& pos = entity->getPos();
+	Uint32 index = getCell(toCell(pos.x), toCell(pos.y));
+
+	// still in the same cell, just refresh the position
+	if( proxy.cell == index ) {
+		cell_t& cell = *cells[index];
+		cell.x[proxy.slot] = pos.x;
+		cell.y[proxy.slot] = pos.y;
+		cell.z[proxy.slot] = pos.z;
+		return;
+	}
+
+	remove(entity);
+	cell_t& cell = *cells[index];
+	proxy.cell = index;
+	proxy.slot = cell.entities.getSize();
+	cell.x.push(pos.x);
+	cell.y.push(pos.y);
+	cell.z.push(pos.z);
+	cell.entities.push(entity);
+	++size;
+}
+
+void SpatialHash::remove(Entity* entity) {
+	proxy_t& proxy = entity->getSpatialProxy();
+	if( proxy.cell == nullCell ) {
+		return;
+	}
+	assert(proxy.cell < cells.getSize());
+	cell_t& cell = *cells[proxy.cell];
+	assert(cell.entities[proxy.slot] == entity);
+
+	// swap the last entity of the cell into the hole
+	Uint32 slot = proxy.slot;
+	cell.x.remove(slot);
+	cell.y.remove(slot);
+	cell.z.remove(slot);
+	cell.entities.remove(slot);
+	if( slot < cell.entities.getSize() ) {
+		cell.entities[slot]->getSpatialProxy().slot = slot;
+	}
+
+	proxy.cell = nullCell;
+	proxy.slot = 0;
+	--size;
+}
+
+void SpatialHash::clear() {
+	for( auto cell : cells ) {
+		for( auto entity : cell->entities ) {
+			entity->getSpatialProxy() = proxy_t();
+		}
+		cell->x.clearKeepCapacity();
+		cell->y.clearKeepCapacity();
+		cell->z.clearKeepCapacity();
+		cell->entities.clearKeepCapacity();
+	}
+	size = 0;
+}
+
+Uint32 SpatialHash::filterCell(const cell_t& cell, float ox, float oy, float oz, float radiusSq, bool flat, ArrayList<Entity*>& outList) {
+	const Uint32 num = cell.entities.getSize();
+	if( num == 0 ) {
+		return 0;
+	}
+
+	// make room for every entity in the cell, then keep the ones that pass. the loop has no
+	// branches, so the compiler is free to vectorize the distance math
+	const Uint32 base = outList.getSize();
+	if( base + num > outList.getMaxSize() ) {
+		outList.reserve(std::max(base + num, outList.getMaxSize() * 2));
+	}
+	outList.resize(base + num);
+
+	const float* xs = cell.x.getArray();
+	const float* ys = cell.y.getArray();
+	const float* zs = cell.z.getArray();
+	Entity* const* entities = cell.entities.getArray();
+	Entity** out = outList.getArray() + base;
+	const float zScale = flat ? 0.f : 1.f;
+	Uint32 count = 0;
+	for( Uint32 c = 0; c < num; ++c ) {
+		float dx = xs[c] - ox;
+		float dy = ys[c] - oy;
+		float dz = (zs[c] - oz) * zScale;
+		float distSq = dx * dx + dy * dy + dz * dz;
+		out[count] = entities[c];
+		count += distSq <= radiusSq ? 1 : 0;
+	}
+	outList.resize(base + count);
+	return count;
+}
+
+Uint32 SpatialHash::queryRadius(const Vector& origin, float radius, ArrayList<Entity*>& outList, bool flat) const {
+	if( radius <= 0.f || size == 0 ) {
+		return 0;
+	}
+	const float radiusSq = radius * radius;
+	Sint32 startX = toCell(origin.x - radius);
+	Sint32 startY = toCell(origin.y - radius);
+	Sint32 endX = toCell(origin.x + radius);
+	Sint32 endY = toCell(origin.y + radius);
+
+	// a huge radius would visit more empty coordinates than there are cells
+	Uint32 found = 0;
+	Uint64 span = (Uint64)(endX - startX + 1) * (Uint64)(endY - startY + 1);
+	if( span > cells.getSize() ) {
+		for( auto cell : cells ) {
+			found += filterCell(*cell, origin.x, origin.y, origin.z, radiusSq, flat, outList);
+		}
+		return found;
+	}
+
+	for( Sint32 x = startX; x <= endX; ++x ) {
+		for( Sint32 y = startY; y <= endY; ++y ) {
+			Uint32 index = findCell(x, y);
+			if( index != nullCell ) {
+				found += filterCell(*cells[index], origin.x, origin.y, origin.z, radiusSq, flat, outList);
+			}
+		}
+	}
+	return found;
+}
+
+Uint32 SpatialHash::queryBox(const Vector& min, const Vector& max, ArrayList<Entity*>& outList) const {
+	if( size == 0 || min.x > max.x || min.y > max.y || min.z > max.z ) {
+		return 0;
+	}
+	Sint32 startX = toCell(min.x);
+	Sint32 startY = toCell(min.y);
+	Sint32 endX = toCell(max.x);
+	Sint32 endY = toCell(max.y);
+
+	// box test on one cell; same branch-free compaction as filterCell()
+	Uint32 found = 0;
+	auto filter = [&](const cell_t& cell) {
+		const Uint32 num = cell.entities.getSize();
+		const Uint32 base = outList.getSize();
+		if( base + num > outList.getMaxSize() ) {
+			outList.reserve(std::max(base + num, outList.getMaxSize() * 2));
+		}
+		outList.resize(base + num);
+		Entity** out = outList.getArray() + base;
+		Uint32 count = 0;
+		for( Uint32 c = 0; c < num; ++c ) {
+			bool inside = (cell.x[c] >= min.x) & (cell.x[c] <= max.x) &
+				(cell.y[c] >= min.y) & (cell.y[c] <= max.y) &
+				(cell.z[c] >= min.z) & (cell.z[c] <= max.z);
+			out[count] = cell.entities[c];
+			count += inside ? 1 : 0;
+		}
+		outList.resize(base + count);
+		found += count;
+	};
+
+	Uint64 span = (Uint64)(endX - startX + 1) * (Uint64)(endY - startY + 1);
+	if( span > cells.getSize() ) {
+		for( auto cell : cells ) {
+			filter(*cell);
+		}
+		return found;
+	}
+	for( Sint32 x = startX; x <= endX; ++x ) {
+		for( Sint32 y = startY; y <= endY; ++y ) {
+			Uint32 index = findCell(x, y);
+			if( index != nullCell ) {
+				filter(*cells[index]);
+			}
+		}
+	}
+	return found;
+}
+
+Uint32 SpatialHash::queryNearest(const Vector& origin, Uint32 count, float maxRadius, ArrayList<Entity*>& outList, bool flat) const {
+	if( count == 0 || maxRadius <= 0.f || size == 0 ) {
+		return 0;
+	}
+
+	// widen the search until it holds enough entities. everything within the radius is a
+	// candidate, so once there are `count` of them the nearest ones are among them
+	static thread_local ArrayList<Entity*> candidates;
+	float radius = std::min(cellSize, maxRadius);
+	while( 1 ) {
+		candidates.clearKeepCapacity();
+		queryRadius(origin, radius, candidates, flat);
+		if( candidates.getSize() >= count || radius >= maxRadius ) {
+			break;
+		}
+		radius = std::min(radius * 2.f, maxRadius);
+	}
+
+	auto distSq = [&origin, flat](const Entity* entity) {
+		Vector diff = entity->getPos() - origin;
+		return diff.x * diff.x + diff.y * diff.y + (flat ? 0.f : diff.z * diff.z);
+	};
+	Uint32 found = std::min(count, candidates.getSize());
+	Entity** first = candidates.getArray();
+	std::partial_sort(first, first + found, first + candidates.getSize(), [&distSq](const Entity* a, const Entity* b) {
+		return distSq(a) < distSq(b);
+	});
+	for( Uint32 c = 0; c < found; ++c ) {
+		outList.push(first[c]);
+	}
+	return found;
+}
+
+void SpatialHash::queryRadiusBatch(const query_t* queries, Uint32 numQueries, ArrayList<Entity*>& outList, ArrayList<Uint32>& outOffsets) const {
+	mainEngine->getThreadPool().gather(numQueries, minParallelQueries, 1, outList, outOffsets, [&](Uint32 index, ArrayList<Entity*>& list) {
+		const query_t& query = queries[index];
+		return queryRadius(query.origin, query.radius, list, query.flat);
+	});
+}
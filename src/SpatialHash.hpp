@@ -0,0 +1,125 @@
+// SpatialHash.hpp
+// Uniform grid of entity positions for proximity queries in any kind of world
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+#include "Vector.hpp"
+
+class Entity;
+
+// entities are bucketed into square cells on the x/y plane by their position. only the
+// cells that have ever held an entity exist (found through a hash of their coordinates),
+// so the grid doesn't care how big the world is or what it is made of. each cell keeps its
+// positions in separate x/y/z arrays so that queries can test a whole cell at a time with
+// squared distances. entities track their own cell through their proxy, so moving one only
+// touches the cells it leaves and enters.
+class SpatialHash {
+public:
+	// where an entity lives in the grid (stored in the entity)
+	struct proxy_t {
+		Uint32 cell = nullCell;		// index of the cell holding the entity
+		Uint32 slot = 0;			// index of the entity within that cell
+	};
+
+	// one radius query in a batch
+	struct query_t {
+		Vector origin;				// center of the query
+		float radius = 0.f;			// radius to search in
+		bool flat = false;			// if true, height is ignored
+	};
+
+	// index of no cell
+	static const Uint32 nullCell = UINT32_MAX;
+
+	// default width of a cell in world units
+	static const float defaultCellSize;
+
+	// @param cellSize the width of a cell in world units
+	SpatialHash(float cellSize = defaultCellSize);
+	~SpatialHash();
+
+	// getters & setters
+	float		getCellSize() const			{ return cellSize; }
+	Uint32		getSize() const				{ return size; }
+	Uint32		getNumCells() const			{ return cells.getSize(); }
+
+	// adds an entity at its current position, or moves it there if it is already in the grid
+	// @param entity the entity to place
+	void update(Entity* entity);
+
+	// takes an entity out of the grid (does nothing if it isn't in the grid)
+	// @param entity the entity to remove
+	void remove(Entity* entity);
+
+	// takes every entity out of the grid, keeping the cells' storage
+	void clear();
+
+	// finds all entities within a given radius of a point
+	// @param origin position to search from
+	// @param radius the radius to search in
+	// @param outList the list to append results to
+	// @param flat if true, the search radius is 2-dimensional
+	// @return the number of entities found
+	Uint32 queryRadius(const Vector& origin, float radius, ArrayList<Entity*>& outList, bool flat = false) const;
+
+	// finds all entities inside an axis-aligned box
+	// @param min the low corner of the box
+	// @param max the high corner of the box
+	// @param outList the list to append results to
+	// @return the number of entities found
+	Uint32 queryBox(const Vector& min, const Vector& max, ArrayList<Entity*>& outList) const;
+
+	// finds the entities nearest to a point, closest first
+	// @param origin position to search from
+	// @param count the most entities to find
+	// @param maxRadius entities further than this are ignored
+	// @param outList the list to append results to
+	// @param flat if true, distance is 2-dimensional
+	// @return the number of entities found
+	Uint32 queryNearest(const Vector& origin, Uint32 count, float maxRadius, ArrayList<Entity*>& outList, bool flat = false) const;
+
+	// answers many radius queries at once. big batches are split across the engine's worker
+	// threads; the results come out the same either way
+	// @param queries the queries to answer
+	// @param numQueries the number of queries
+	// @param outList receives the results of every query back to back
+	// @param outOffsets receives numQueries + 1 offsets; the results of query i are in
+	// outList[outOffsets[i]] to outList[outOffsets[i + 1] - 1]
+	void queryRadiusBatch(const query_t* queries, Uint32 numQueries, ArrayList<Entity*>& outList, ArrayList<Uint32>& outOffsets) const;
+
+private:
+	struct cell_t {
+		ArrayList<float> x;
+		ArrayList<float> y;
+		ArrayList<float> z;
+		ArrayList<Entity*> entities;
+	};
+
+	float cellSize;
+	float invCellSize;
+	Uint32 size = 0;
+	ArrayList<cell_t*> cells;			// every cell that has been used
+	HashMap<Uint32, Uint32> cellMap;	// packed cell coordinates -> index in cells
+
+	// @return the cell coordinate for a world coordinate
+	Sint32 toCell(float v) const;
+
+	// @return the key for the given cell coordinates
+	static Uint32 packCell(Sint32 x, Sint32 y);
+
+	// finds the cell at the given coordinates
+	// @return the cell's index, or nullCell if no entity has ever been there
+	Uint32 findCell(Sint32 x, Sint32 y) const;
+
+	// finds or creates the cell at the given coordinates
+	// @return the cell's index
+	Uint32 getCell(Sint32 x, Sint32 y);
+
+	// appends the entities of one cell that lie within a squared distance of a point
+	// @return the number of entities appended
+	static Uint32 filterCell(const cell_t& cell, float ox, float oy, float oz, float radiusSq, bool flat, ArrayList<Entity*>& outList);
+
+};
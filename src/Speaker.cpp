@@ -164,7 +164,10 @@ static Cvar cvar_speakerCull("speaker.cull", "accuracy for speakers' occlusion c
 
 void Speaker::process() {
 	Component::process();
+	queueProcessShared();
+}
 
+void Speaker::processShared() {
 	// update sound sources
 	for( int i=0; i<maxSources; ++i ) {
 		if( sources[i] ) {
@@ -28,6 +28,9 @@ public:
 	// update the component
 	virtual void process() override;
 
+	// updates sound sources
+	virtual void processShared() override;
+
 	// plays the given sound
 	// @param name the filename of the sound
 	// @param loop if true, the sound will loop when played; otherwise, it will not
@@ -267,12 +267,18 @@ public:
 	// hash the string
 	// @return a number representation of the string
 	unsigned long hash() const {
-		if (str == nullptr) {
+		return hash(str);
+	}
+
+	// hash a C string the same way a String holding it would be hashed
+	// @param data the characters to hash (may be nullptr)
+	// @return a number representation of the string
+	static unsigned long hash(const char* data) {
+		if (data == nullptr) {
 			return 0;
 		}
 		unsigned long value = 5381;
 		int c;
-		const char* data = str;
 		while((c = *data++)!=0) {
 			value = ((value << 5) + value) + c; // hash * 33 + c
 		}
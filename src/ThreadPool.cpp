@@ -0,0 +1,116 @@
+// ThreadPool.cpp
+
+#include "Main.hpp"
+#include "ThreadPool.hpp"
+
+static thread_local bool inJob = false;
+
+ThreadPool::ThreadPool(Uint32 _numWorkers) {
+	numWorkers = _numWorkers;
+	if( numWorkers == 0 ) {
+		Uint32 cores = std::thread::hardware_concurrency();
+		numWorkers = cores > 1 ? cores - 1 : 0;
+	}
+	nextSlice = 0;
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	for( auto worker : workers ) {
+		worker->join();
+		delete worker;
+	}
+	workers.clear();
+}
+
+bool ThreadPool::isInJob() {
+	return inJob;
+}
+
+void ThreadPool::start() {
+	started = true;
+	for( Uint32 c = 0; c < numWorkers; ++c ) {
+		workers.push(new std::thread(&ThreadPool::work, this));
+	}
+}
+
+void ThreadPool::run(Uint32 _count, Uint32 _numSlices, const job_t& _job) {
+	if( _count == 0 || _numSlices == 0 ) {
+		return;
+	}
+	_numSlices = std::min(_numSlices, _count);
+
+	// nested or concurrent batches run inline
+	std::unique_lock<std::mutex> runGuard(runLock, std::defer_lock);
+	if( inJob || numWorkers == 0 || _numSlices == 1 || !runGuard.try_lock() ) {
+		bool wasInJob = inJob;
+		inJob = true;
+		for( Uint32 slice = 0; slice < _numSlices; ++slice ) {
+			_job(slice, (Uint64)_count * slice / _numSlices, (Uint64)_count * (slice + 1) / _numSlices);
+		}
+		inJob = wasInJob;
+		return;
+	}
+
+	if( !started ) {
+		start();
+	}
+
+	{
+		// wait for stragglers from the last batch to leave before reusing its state
+		std::unique_lock<std::mutex> guard(lock);
+		done.wait(guard, [this]{ return busy == 0; });
+		job = &_job;
+		count = _count;
+		numSlices = _numSlices;
+		nextSlice = 0;
+		slicesLeft = _numSlices;
+		++generation;
+	}
+	wake.notify_all();
+
+	inJob = true;
+	runSlices();
+	inJob = false;
+
+	std::unique_lock<std::mutex> guard(lock);
+	done.wait(guard, [this]{ return slicesLeft == 0; });
+}
+
+void ThreadPool::runSlices() {
+	for( Uint32 slice = nextSlice++; slice < numSlices; slice = nextSlice++ ) {
+		(*job)(slice, (Uint64)count * slice / numSlices, (Uint64)count * (slice + 1) / numSlices);
+
+		std::lock_guard<std::mutex> guard(lock);
+		if( --slicesLeft == 0 ) {
+			done.notify_all();
+		}
+	}
+}
+
+void ThreadPool::work() {
+	inJob = true;
+	Uint32 lastGeneration = 0;
+	while( 1 ) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&]{ return quit || generation != lastGeneration; });
+			if( quit ) {
+				return;
+			}
+			lastGeneration = generation;
+			++busy;
+		}
+		runSlices();
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if( --busy == 0 ) {
+				done.notify_all();
+			}
+		}
+	}
+}
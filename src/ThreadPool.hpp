@@ -0,0 +1,125 @@
+// ThreadPool.hpp
+// Fixed set of worker threads that split loops into slices
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class ThreadPool {
+public:
+	// a job receives the slice index and the [begin, end) range of that slice
+	typedef std::function<void(Uint32 slice, Uint32 begin, Uint32 end)> job_t;
+
+	// @param numWorkers the number of worker threads, or 0 to pick one per spare core
+	ThreadPool(Uint32 numWorkers = 0);
+	~ThreadPool();
+
+	// getters & setters
+	Uint32		getNumWorkers() const		{ return numWorkers; }
+	Uint32		getNumThreads() const		{ return numWorkers + 1; }
+
+	// splits [0, count) into contiguous slices of near-equal size and runs the job once per
+	// slice, returning when every slice is done. slice boundaries depend only on count and
+	// numSlices, never on timing, so per-slice results can be merged deterministically.
+	// the calling thread works on slices too. calls made from inside a job (or while another
+	// thread is running a job) run every slice inline on the calling thread
+	// @param count the number of items to split up
+	// @param numSlices the number of slices to split them into
+	// @param job the function to run for each slice
+	void run(Uint32 count, Uint32 numSlices, const job_t& job);
+
+	// @return true if the calling thread is inside a job (on a worker or the calling thread)
+	static bool isInJob();
+
+	// runs a batch of queries and joins their results into one list, query i's results being
+	// outList[outOffsets[i]] up to outList[outOffsets[i + 1]]. big batches are split into
+	// slices, each filling its own lists, which are joined in slice order afterward, so the
+	// result is the same as running the queries one after another. small batches, and calls
+	// from inside a job, run on the calling thread
+	// @param count the number of queries
+	// @param minParallel batches smaller than this aren't worth waking the workers for
+	// @param slicesPerThread slices to split the batch into per thread
+	// @param outList receives the results
+	// @param outOffsets receives count + 1 offsets into outList
+	// @param query function (Uint32 index, ArrayList<T>& list) that runs query index, appends
+	// its results to the list, and returns how many it appended
+	template <typename T, typename F>
+	void gather(Uint32 count, Uint32 minParallel, Uint32 slicesPerThread, ArrayList<T>& outList, ArrayList<Uint32>& outOffsets, const F& query) {
+		outList.clearKeepCapacity();
+		outOffsets.clearKeepCapacity();
+		outOffsets.reserve(count + 1);
+		outOffsets.push(0);
+		if( count == 0 ) {
+			return;
+		}
+
+		if( count < minParallel || numWorkers == 0 || isInJob() ) {
+			for( Uint32 c = 0; c < count; ++c ) {
+				Uint32 numResults = query(c, outList);
+				outOffsets.push(outOffsets.peek() + numResults);
+			}
+			return;
+		}
+
+		Uint32 numSlices = getNumThreads() * slicesPerThread;
+		ArrayList<ArrayList<T>> sliceLists;
+		ArrayList<ArrayList<Uint32>> sliceCounts;
+		sliceLists.resize(numSlices);
+		sliceCounts.resize(numSlices);
+		run(count, numSlices, [&](Uint32 slice, Uint32 begin, Uint32 end) {
+			for( Uint32 c = begin; c < end; ++c ) {
+				sliceCounts[slice].push(query(c, sliceLists[slice]));
+			}
+		});
+
+		Uint32 total = 0;
+		for( Uint32 c = 0; c < numSlices; ++c ) {
+			total += sliceLists[c].getSize();
+		}
+		outList.reserve(total);
+		for( Uint32 c = 0; c < numSlices; ++c ) {
+			for( auto& result : sliceLists[c] ) {
+				outList.push(result);
+			}
+			for( auto numResults : sliceCounts[c] ) {
+				outOffsets.push(outOffsets.peek() + numResults);
+			}
+		}
+	}
+
+private:
+	Uint32 numWorkers = 0;
+	ArrayList<std::thread*> workers;
+	bool started = false;
+
+	std::mutex lock;
+	std::mutex runLock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	bool quit = false;
+	Uint32 generation = 0;
+	Uint32 busy = 0;				// workers inside runSlices()
+
+	// current batch
+	const job_t* job = nullptr;
+	Uint32 count = 0;
+	Uint32 numSlices = 0;
+	std::atomic<Uint32> nextSlice;
+	Uint32 slicesLeft = 0;
+
+	// starts the worker threads
+	void start();
+
+	// worker thread loop
+	void work();
+
+	// runs slices of the current batch until there are none left
+	void runSlices();
+};
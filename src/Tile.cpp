@@ -41,19 +41,6 @@ Tile::Tile() {
 }
 
 Tile::~Tile() {
-	if( triMesh!=nullptr ) {
-		delete triMesh;
-	}
-	if( triMeshShape!=nullptr ) {
-		delete triMeshShape;
-	}
-	if( motionState!=nullptr ) {
-		delete motionState;
-	}
-	if( rigidBody!=nullptr ) {
-		dynamicsWorld->removeRigidBody(rigidBody);
-		delete rigidBody;
-	}
 }
 
 ShaderProgram* Tile::loadShader(const TileWorld& world, const Camera& camera, const ArrayList<Light*>& lights) {
@@ -996,75 +983,34 @@ LinkedList<Tile::vertex_t>* Tile::intForVertices(const int i) {
 	}
 }
 
-void Tile::compileBulletPhysicsMesh() {
-	// delete old rigid mesh
-	if( rigidBody!=nullptr ) {
-		dynamicsWorld->removeRigidBody(rigidBody);
-		delete rigidBody;
-		rigidBody = nullptr;
-	}
-
+Uint32 Tile::addPhysicsTriangles(btTriangleMesh& mesh) {
 	// check that there are any vertices to even build for
 	if( floorVertices.getFirst()==nullptr ) {
-		return;
+		return 0;
 	}
 
-	// delete the old triangle mesh and generate a new one
-	if( triMesh!=nullptr )
-		delete triMesh;
-	triMesh = new btTriangleMesh();
-
-	LinkedList<Vector> vlist;
+	Uint32 numTriangles = 0;
 	for( int tri=0; tri<10; ++tri ) {
 		// iterate through all the vertex structures
 		LinkedList<vertex_t>* list = intForVertices(tri);
 		if( list==nullptr )
 			continue;
 
-		// collect the vertex data and store it in a list
+		// every three vertices make a triangle (leftovers are dropped)
+		btVector3 v[3];
+		int numVerts = 0;
 		for( Node<vertex_t>* node=list->getFirst(); node!=nullptr; node=node->getNext() ) {
 			vertex_t& vert = node->getData();
-
-			// create vertex for physics mesh
-			Vector v(vert.pos.x,vert.pos.y,vert.pos.z);
-			vlist.addNodeLast(v);
-
-			if( vlist.getSize()==3 ) {
-				// add the three vertices to the triangle mesh
-				Vector& v0 = vlist.nodeForIndex(0)->getData();
-				Vector& v1 = vlist.nodeForIndex(1)->getData();
-				Vector& v2 = vlist.nodeForIndex(2)->getData();
-				triMesh->addTriangle(v0,v1,v2,true);
-
-				// clear the triangle list
-				vlist.removeAll();
+			v[numVerts++] = btVector3(vert.pos.x,vert.pos.y,vert.pos.z);
+			if( numVerts==3 ) {
+				mesh.addTriangle(v[0],v[1],v[2],false);
+				++numTriangles;
+				numVerts = 0;
 			}
 		}
-
-		// clear the vertex list for next time (in case there are leftovers)
-		vlist.removeAll();
 	}
 
-	// build a new triangle shape
-	if( triMeshShape!=nullptr )
-		delete triMeshShape;
-	triMeshShape = new btBvhTriangleMeshShape(triMesh,true,true);
-
-	// create motion state
-	if( motionState!=nullptr )
-		delete motionState;
-	motionState = new btDefaultMotionState(btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
-
-	// create rigid body
-	btRigidBody::btRigidBodyConstructionInfo
-		tileRigidBodyCI(0, motionState, triMeshShape, btVector3(0, 0, 0));
-	rigidBody = new btRigidBody(tileRigidBodyCI);
-	rigidBody->setUserIndex(World::nuid);
-	rigidBody->setUserIndex2(World::nuid);
-	rigidBody->setUserPointer((void*)this);
-
-	// add a new rigid body to the simulation
-	dynamicsWorld->addRigidBody(rigidBody);
+	return numTriangles;
 }
 
 bool Tile::selected() const {
@@ -111,7 +111,6 @@ public:
 	void	setCeilingSlopeSize(Sint32 size)								{ ceilingSlopeSize = size; }
 	void	setFloorSlopeSide(side_t side)									{ floorSlopeSide = side; }
 	void	setFloorSlopeSize(Sint32 size)									{ floorSlopeSize = size; }
-	void	setDynamicsWorld(btDiscreteDynamicsWorld& _dynamicsWorld)		{ dynamicsWorld = &_dynamicsWorld; }
 	void	setChanged(bool _changed)										{ changed = _changed; }
 	void	setLocked(bool _locked)											{ locked = _locked; }
 	void	setShaderVars(const shadervars_t& src)							{ shaderVars = src; }
@@ -175,8 +174,10 @@ public:
 	// @return the height of the wall corner in map units
 	Sint32 lowerWallHeight(const Tile& neighbor, const side_t side, const corner_t corner);
 
-	// recompile the physics mesh for this tile
-	void compileBulletPhysicsMesh();
+	// adds the triangles of this tile's physics mesh to a larger mesh (see TileCollision)
+	// @param mesh the mesh to add to
+	// @return the number of triangles added
+	Uint32 addPhysicsTriangles(btTriangleMesh& mesh);
 
 	// finds the tile neighboring this one, if one exists
 	// @param side the particular neighbor we are looking for
@@ -257,13 +258,6 @@ private:
 	// generation data
 	bool locked = false;
 
-	// bullet physics objects
-	btDiscreteDynamicsWorld* dynamicsWorld = nullptr;
-	btTriangleMesh* triMesh = nullptr;
-	btCollisionShape* triMeshShape = nullptr;
-	btDefaultMotionState* motionState = nullptr;
-	btRigidBody* rigidBody = nullptr;
-
 	// vertex lists
 	Uint32 numVertices = 0;
 	LinkedList<vertex_t> ceilingVertices;
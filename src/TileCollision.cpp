@@ -0,0 +1,312 @@
+// TileCollision.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "TileCollision.hpp"
+#include "TileWorld.hpp"
+#include "Tile.hpp"
+#include "Chunk.hpp"
+#include "Server.hpp"
+#include "Random.hpp"
+
+#include <chrono>
+
+static Cvar cvar_physicsRegion("physics.region", "width of the regions tile collision is merged into, in tiles (1 gives every tile its own body)", "8");
+
+TileCollision::~TileCollision() {
+	clear();
+}
+
+Uint32 TileCollision::getNumBodies() const {
+	Uint32 result = 0;
+	for( auto& region : regions ) {
+		if( region.body ) {
+			++result;
+		}
+	}
+	return result;
+}
+
+Uint32 TileCollision::getNumTriangles() const {
+	Uint32 result = 0;
+	for( auto& region : regions ) {
+		result += region.triangleTiles.getSize();
+	}
+	return result;
+}
+
+Uint32 TileCollision::getMemoryUsage() const {
+	Uint32 result = regions.getMaxSize() * sizeof(region_t);
+	for( auto& region : regions ) {
+		if( !region.body ) {
+			continue;
+		}
+		result += sizeof(btTriangleMesh) + sizeof(btBvhTriangleMeshShape) + sizeof(btDefaultMotionState) + sizeof(btRigidBody);
+
+		// vertices aren't shared between triangles, so each triangle holds three of its own
+		Uint32 numTriangles = region.triangleTiles.getSize();
+		result += numTriangles * (3 * sizeof(btVector3) + 3 * sizeof(Uint32) + sizeof(Tile*));
+
+		btOptimizedBvh* bvh = region.shape->getOptimizedBvh();
+		if( bvh ) {
+			result += sizeof(btOptimizedBvh);
+			result += bvh->getQuantizedNodeArray().size() * sizeof(btQuantizedBvhNode);
+			result += bvh->getSubtreeInfoArray().size() * sizeof(btBvhSubtreeInfo);
+		}
+	}
+	return result;
+}
+
+void TileCollision::clear() {
+	for( auto& region : regions ) {
+		destroyRegion(region);
+	}
+	regions.clear();
+	regionsWidth = 0;
+	regionsHeight = 0;
+	dirty = false;
+}
+
+void TileCollision::build(TileWorld& world, Uint32 _regionSize) {
+	clear();
+	dynamicsWorld = world.getBulletDynamicsWorld();
+	if( !dynamicsWorld ) {
+		return;
+	}
+
+	// a multiple of the chunk size keeps every chunk inside one region
+	if( _regionSize == 0 ) {
+		_regionSize = (Uint32)std::max(1, cvar_physicsRegion.toInt());
+	}
+	regionSize = _regionSize;
+	regionsWidth = (world.getWidth() + regionSize - 1) / regionSize;
+	regionsHeight = (world.getHeight() + regionSize - 1) / regionSize;
+	regions.resize(regionsWidth * regionsHeight);
+
+	for( Uint32 rX = 0; rX < regionsWidth; ++rX ) {
+		for( Uint32 rY = 0; rY < regionsHeight; ++rY ) {
+			buildRegion(world, rX, rY);
+		}
+	}
+}
+
+void TileCollision::invalidate(const Rect<int>& rect) {
+	if( regionSize == 0 || rect.w <= 0 || rect.h <= 0 ) {
+		return;
+	}
+	Sint32 startX = std::max(0, rect.x / (Sint32)regionSize);
+	Sint32 startY = std::max(0, rect.y / (Sint32)regionSize);
+	Sint32 endX = std::min((Sint32)regionsWidth - 1, (rect.x + rect.w - 1) / (Sint32)regionSize);
+	Sint32 endY = std::min((Sint32)regionsHeight - 1, (rect.y + rect.h - 1) / (Sint32)regionSize);
+	for( Sint32 rX = startX; rX <= endX; ++rX ) {
+		for( Sint32 rY = startY; rY <= endY; ++rY ) {
+			regions[rY + rX * regionsHeight].dirty = true;
+			dirty = true;
+		}
+	}
+}
+
+Uint32 TileCollision::update(TileWorld& world) {
+	if( !dirty ) {
+		return 0;
+	}
+	dirty = false;
+
+	Uint32 result = 0;
+	for( Uint32 rX = 0; rX < regionsWidth; ++rX ) {
+		for( Uint32 rY = 0; rY < regionsHeight; ++rY ) {
+			if( regions[rY + rX * regionsHeight].dirty ) {
+				buildRegion(world, rX, rY);
+				++result;
+			}
+		}
+	}
+	return result;
+}
+
+Tile* TileCollision::findTile(const btCollisionObject* object, int triangleIndex) const {
+	const region_t* region = static_cast<const region_t*>(object->getUserPointer());
+	if( !region || regions.getSize() == 0 ) {
+		return nullptr;
+	}
+	if( region < &regions[0] || region > &regions[regions.getSize() - 1] || region->body != object ) {
+		return nullptr;
+	}
+	if( triangleIndex < 0 || (Uint32)triangleIndex >= region->triangleTiles.getSize() ) {
+		return nullptr;
+	}
+	return region->triangleTiles[triangleIndex];
+}
+
+void TileCollision::buildRegion(TileWorld& world, Uint32 rX, Uint32 rY) {
+	region_t& region = regions[rY + rX * regionsHeight];
+	destroyRegion(region);
+	region.dirty = false;
+
+	// gather the triangles of every tile in the region. vertices aren't welded, since
+	// searching for duplicates makes the build quadratic in the size of the region
+	btTriangleMesh* mesh = new btTriangleMesh(true, true);
+	ArrayList<Tile>& tiles = world.getTiles();
+	const Uint32 startX = rX * regionSize;
+	const Uint32 startY = rY * regionSize;
+	const Uint32 endX = std::min(startX + regionSize, world.getWidth());
+	const Uint32 endY = std::min(startY + regionSize, world.getHeight());
+	for( Uint32 x = startX; x < endX; ++x ) {
+		for( Uint32 y = startY; y < endY; ++y ) {
+			Tile& tile = tiles[y + x * world.getHeight()];
+			Uint32 numTriangles = tile.addPhysicsTriangles(*mesh);
+			for( Uint32 c = 0; c < numTriangles; ++c ) {
+				region.triangleTiles.push(&tile);
+			}
+		}
+	}
+	if( region.triangleTiles.getSize() == 0 ) {
+		delete mesh;
+		return;
+	}
+
+	// build the shape and its hierarchy
+	region.mesh = mesh;
+	region.shape = new btBvhTriangleMeshShape(mesh, true, true);
+	region.motionState = new btDefaultMotionState(btTransform(btQuaternion(0, 0, 0, 1), btVector3(0, 0, 0)));
+
+	// create rigid body
+	btRigidBody::btRigidBodyConstructionInfo
+		regionRigidBodyCI(0, region.motionState, region.shape, btVector3(0, 0, 0));
+	region.body = new btRigidBody(regionRigidBodyCI);
+	region.body->setUserIndex(World::nuid);
+	region.body->setUserIndex2(World::nuid);
+	region.body->setUserPointer((void*)&region);
+
+	// add the rigid body to the simulation
+	dynamicsWorld->addRigidBody(region.body);
+}
+
+void TileCollision::destroyRegion(region_t& region) {
+	if( region.body ) {
+		dynamicsWorld->removeRigidBody(region.body);
+		delete region.body;
+		region.body = nullptr;
+	}
+	if( region.motionState ) {
+		delete region.motionState;
+		region.motionState = nullptr;
+	}
+	if( region.shape ) {
+		delete region.shape;
+		region.shape = nullptr;
+	}
+	if( region.mesh ) {
+		delete region.mesh;
+		region.mesh = nullptr;
+	}
+	region.triangleTiles.clear();
+}
+
+static int console_physicsTileBenchmark(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"physics.tilebenchmark needs a running server.");
+		return 1;
+	}
+
+	Uint32 numRays = 10000;
+	const char* path = "maps/tilesets/template.json";
+	if( argc >= 1 ) {
+		numRays = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		path = argv[1];
+	}
+
+	// generate a scratch dungeon that isn't part of the game
+	ArrayList<Uint32> open;
+	TileWorld* world = TileWorld::generateScratch(server, path, 0, false, open);
+	if( world == nullptr ) {
+		return 1;
+	}
+
+	// rays from the middle of open tiles toward random points in the dungeon
+	Random rand;
+	rand.seedValue(1234);
+	ArrayList<World::ray_t> rays;
+	rays.alloc(numRays);
+	auto tileCenter = [world](Uint32 index) {
+		const Tile& tile = world->getTiles()[index];
+		return Vector(
+			tile.getX() + Tile::size / 2.f,
+			tile.getY() + Tile::size / 2.f,
+			(tile.getFloorHeight() + tile.getCeilingHeight()) / 2.f);
+	};
+	for( Uint32 c = 0; c < numRays; ++c ) {
+		World::ray_t ray;
+		ray.origin = tileCenter(open[rand.getUint32() % open.getSize()]);
+		ray.dest = tileCenter(open[rand.getUint32() % open.getSize()]);
+		rays.push(ray);
+	}
+
+	mainEngine->fmsg(Engine::MSG_INFO,"%u rays over %u x %u tiles (%u open):",
+		numRays, world->getWidth(), world->getHeight(), open.getSize());
+
+	// one body per tile (the old layout), one per chunk, then the configured regions
+	const Uint32 sizes[3] = { 1, Chunk::size, (Uint32)std::max(1, cvar_physicsRegion.toInt()) };
+	TileCollision& collision = world->getCollision();
+	ArrayList<World::hit_t> baseline;
+	ArrayList<World::hit_t> hits;
+	ArrayList<Uint32> offsets;
+	int result = 0;
+	for( Uint32 size : sizes ) {
+		auto start = std::chrono::steady_clock::now();
+		collision.build(*world, size);
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+		// rebuilding one region is what an edit costs
+		start = std::chrono::steady_clock::now();
+		collision.invalidate(Rect<int>(open[0] / world->getHeight(), open[0] % world->getHeight(), 1, 1));
+		collision.update(*world);
+		std::chrono::duration<double, std::milli> editTime = std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		Uint32 singleHits = 0;
+		for( auto& ray : rays ) {
+			World::hit_t hit = world->lineTrace(ray.origin, ray.dest);
+			singleHits += hit.hitTile ? 1 : 0;
+		}
+		std::chrono::duration<double, std::milli> singleTime = std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		world->lineTraceBatch(rays.getArray(), numRays, World::TRACE_CLOSEST, hits, offsets);
+		std::chrono::duration<double, std::milli> batchTime = std::chrono::steady_clock::now() - start;
+
+		// every tile hit has to name its tile, and land where the first layout's did
+		Uint32 unattributed = 0;
+		Uint32 mismatches = 0;
+		bool first = baseline.getSize() == 0;
+		for( Uint32 c = 0; c < numRays; ++c ) {
+			World::hit_t hit;
+			if( offsets[c + 1] > offsets[c] ) {
+				hit = hits[offsets[c]];
+			}
+			if( hit.hitTile && hit.pointer == nullptr ) {
+				++unattributed;
+			}
+			if( first ) {
+				baseline.push(hit);
+			} else if( hit.hitTile != baseline[c].hitTile || (hit.hitTile && (hit.pos - baseline[c].pos).lengthSquared() > 1.f) ) {
+				++mismatches;
+			}
+		}
+		if( unattributed || mismatches ) {
+			result = 1;
+		}
+
+		mainEngine->fmsg(Engine::MSG_INFO,"  region %2u: %6u bodies, %7u triangles, %6u KB, build %.1f ms, edit %.3f ms, lineTrace %.3f ms, batch %.3f ms (%u hits, %u unattributed, %u mismatches)",
+			size, collision.getNumBodies(), collision.getNumTriangles(), collision.getMemoryUsage() / 1024,
+			buildTime.count(), editTime.count(), singleTime.count(), batchTime.count(), singleHits, unattributed, mismatches);
+	}
+
+	delete world;
+	return result;
+}
+
+static Ccmd ccmd_physicsTileBenchmark("physics.tilebenchmark","compares tile collision merged at different region sizes in a generated dungeon (args: ray count, generator path)",&console_physicsTileBenchmark);
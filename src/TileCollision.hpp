@@ -0,0 +1,77 @@
+// TileCollision.hpp
+// Static collision geometry of a TileWorld, merged into one body per region of tiles
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "Rect.hpp"
+
+#include <btBulletDynamicsCommon.h>
+
+class TileWorld;
+class Tile;
+
+// the floors, ceilings and walls of every tile in a square region go into a single triangle
+// mesh with its own bounding volume hierarchy, so the broadphase holds one static body per
+// region instead of one per tile. each triangle remembers the tile it came from, so traces
+// can still tell which tile they hit. editing tiles only rebuilds the regions they touch.
+class TileCollision {
+public:
+	TileCollision() {}
+	~TileCollision();
+
+	// getters & setters
+	Uint32		getRegionSize() const			{ return regionSize; }
+	Uint32		getNumBodies() const;
+	Uint32		getNumTriangles() const;
+
+	// @return a rough count of the bytes held by the meshes, their hierarchies and bodies
+	Uint32 getMemoryUsage() const;
+
+	// builds every region of the world
+	// @param world the world to build
+	// @param regionSize the width of a region in tiles, or 0 for the physics.region cvar
+	void build(TileWorld& world, Uint32 regionSize = 0);
+
+	// marks the regions that hold any of the given tiles for a rebuild
+	// @param rect the changed tiles
+	void invalidate(const Rect<int>& rect);
+
+	// rebuilds every region marked by invalidate()
+	// @param world the world that changed
+	// @return the number of regions rebuilt
+	Uint32 update(TileWorld& world);
+
+	// removes every body from the simulation and frees it
+	void clear();
+
+	// finds the tile a trace hit
+	// @param object the object that was hit
+	// @param triangleIndex the index of the triangle that was hit
+	// @return the tile, or nullptr if the object isn't one of our regions
+	Tile* findTile(const btCollisionObject* object, int triangleIndex) const;
+
+private:
+	struct region_t {
+		btTriangleMesh* mesh = nullptr;
+		btBvhTriangleMeshShape* shape = nullptr;
+		btDefaultMotionState* motionState = nullptr;
+		btRigidBody* body = nullptr;
+		ArrayList<Tile*> triangleTiles;		// triangle index -> tile it belongs to
+		bool dirty = false;
+	};
+
+	btDiscreteDynamicsWorld* dynamicsWorld = nullptr;
+	Uint32 regionSize = 0;					// in tiles
+	Uint32 regionsWidth = 0;
+	Uint32 regionsHeight = 0;
+	ArrayList<region_t> regions;			// y + x * regionsHeight
+	bool dirty = false;						// any region needs a rebuild
+
+	// (re)builds the collision body for one region
+	void buildRegion(TileWorld& world, Uint32 rX, Uint32 rY);
+
+	// takes a region's body out of the simulation and frees it
+	void destroyRegion(region_t& region);
+};
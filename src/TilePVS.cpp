@@ -0,0 +1,265 @@
+// TilePVS.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "TilePVS.hpp"
+#include "TileWorld.hpp"
+#include "Tile.hpp"
+#include "Chunk.hpp"
+
+static Cvar cvar_pvsEnabled("pvs.enabled", "use baked visibility sets for occlusion culling when possible (sets are baked when a world loads)", "1");
+static Cvar cvar_pvsRange("pvs.range", "how far baked visibility sets reach, in world units", "2048");
+
+bool TilePVS::isEnabled() {
+	return cvar_pvsEnabled.toInt() != 0;
+}
+
+bool TilePVS::isUsable(float viewRange) const {
+	return baked && cvar_pvsEnabled.toInt() && viewRange <= range;
+}
+
+void TilePVS::clear() {
+	baked = false;
+	range = 0.f;
+	width = 0;
+	height = 0;
+	open.clear();
+	tileSets.clear();
+	words.clear();
+	numSets = 0;
+	setMap.clear();
+	++version;
+}
+
+void TilePVS::bake(const TileWorld& world) {
+	clear();
+
+	// nothing would read the sets
+	if( !isEnabled() ) {
+		return;
+	}
+	width = (Sint32)world.getWidth();
+	height = (Sint32)world.getHeight();
+	range = std::max(cvar_pvsRange.toFloat(), (float)Tile::size);
+	tileRange = (Sint32)(range / Tile::size);
+	windowRange = (tileRange + 1) / (Sint32)Chunk::size + 1;
+	windowSize = (Uint32)(windowRange * 2 + 1);
+	windowWords = (windowSize * windowSize + 31) / 32;
+
+	const Uint32 numTiles = (Uint32)(width * height);
+	const ArrayList<Tile>& tiles = world.getTiles();
+	open.resize(numTiles);
+	tileSets.resize(numTiles);
+	for( Uint32 c = 0; c < numTiles; ++c ) {
+		open[c] = tiles[c].hasVolume() ? 1 : 0;
+	}
+
+	// every tile bakes into its own slot, then identical sets are merged
+	ArrayList<Uint32> scratch;
+	scratch.resize(numTiles * windowWords);
+	ThreadPool& pool = mainEngine->getThreadPool();
+	pool.run(numTiles, pool.getNumThreads() * 4, [&](Uint32 slice, Uint32 begin, Uint32 end) {
+		for( Uint32 c = begin; c < end; ++c ) {
+			if( open[c] ) {
+				bakeTile((Sint32)c / height, (Sint32)c % height, &scratch[c * windowWords]);
+			}
+		}
+	});
+	for( Uint32 c = 0; c < numTiles; ++c ) {
+		tileSets[c] = open[c] ? addSet(&scratch[c * windowWords]) : nullSet;
+	}
+
+	baked = true;
+}
+
+void TilePVS::invalidate(const TileWorld& world, const Rect<int>& rect) {
+	if( !baked ) {
+		return;
+	}
+
+	// pick up the new state of the changed tiles
+	const ArrayList<Tile>& tiles = world.getTiles();
+	Sint32 startX = std::max(0, rect.x);
+	Sint32 startY = std::max(0, rect.y);
+	Sint32 endX = std::min(width, rect.x + rect.w);
+	Sint32 endY = std::min(height, rect.y + rect.h);
+	for( Sint32 x = startX; x < endX; ++x ) {
+		for( Sint32 y = startY; y < endY; ++y ) {
+			Uint32 index = y + x * height;
+			open[index] = tiles[index].hasVolume() ? 1 : 0;
+		}
+	}
+
+	// anything in range could have seen through (or into) the changed tiles
+	Sint32 reach = tileRange + 1;
+	startX = std::max(0, rect.x - reach);
+	startY = std::max(0, rect.y - reach);
+	endX = std::min(width, rect.x + rect.w + reach);
+	endY = std::min(height, rect.y + rect.h + reach);
+	for( Sint32 x = startX; x < endX; ++x ) {
+		for( Sint32 y = startY; y < endY; ++y ) {
+			tileSets[y + x * height] = dirtySet;
+		}
+	}
+	++version;
+}
+
+const Uint32* TilePVS::getSet(Sint32 x, Sint32 y) {
+	if( !baked || x < 0 || y < 0 || x >= width || y >= height ) {
+		return nullptr;
+	}
+	Uint32 index = y + x * height;
+	if( tileSets[index] == dirtySet ) {
+		if( open[index] ) {
+			static thread_local ArrayList<Uint32> set;
+			set.resize(windowWords);
+			bakeTile(x, y, set.getArray());
+			tileSets[index] = addSet(set.getArray());
+		} else {
+			tileSets[index] = nullSet;
+		}
+	}
+	if( tileSets[index] == nullSet ) {
+		return nullptr;
+	}
+	return &words[tileSets[index] * windowWords];
+}
+
+bool TilePVS::testChunk(const Uint32* set, Sint32 x, Sint32 y, Sint32 cX, Sint32 cY) const {
+	Sint32 u = cX - x / (Sint32)Chunk::size + windowRange;
+	Sint32 v = cY - y / (Sint32)Chunk::size + windowRange;
+	if( u < 0 || v < 0 || u >= (Sint32)windowSize || v >= (Sint32)windowSize ) {
+		return false;
+	}
+	Uint32 bit = v + u * windowSize;
+	return (set[bit >> 5] >> (bit & 31)) & 1;
+}
+
+void TilePVS::bakeTile(Sint32 x, Sint32 y, Uint32* outWords) const {
+	// visible tiles in a window around this one, with a one tile border for the extension
+	const Sint32 span = tileRange * 2 + 3;
+	const Sint32 offset = tileRange + 1;
+	static thread_local ArrayList<Uint8> visible;
+	visible.resize(span * span);
+	memset(visible.getArray(), 0, span * span);
+	auto at = [&](Sint32 u, Sint32 v) -> Uint8& {
+		return visible[(v - y + offset) + (u - x + offset) * span];
+	};
+
+	// line tests
+	at(x, y) = 1;
+	for( Sint32 u = x - tileRange; u <= x + tileRange; ++u ) {
+		for( Sint32 v = y - tileRange; v <= y + tileRange; ++v ) {
+			if( u < 0 || v < 0 || u >= width || v >= height ) {
+				continue;
+			}
+			if( !open[v + u * height] ) {
+				continue;
+			}
+			if( traceLine(x, y, u, v) || traceLine(u, v, x, y) ) {
+				at(u, v) = 1;
+			}
+		}
+	}
+
+	// open tiles next to a visible tile count too (2 marks an extended tile, which doesn't
+	// extend any further)
+	for( Sint32 u = x - offset; u <= x + offset; ++u ) {
+		for( Sint32 v = y - offset; v <= y + offset; ++v ) {
+			if( u < 0 || v < 0 || u >= width || v >= height ) {
+				continue;
+			}
+			if( at(u, v) || !open[v + u * height] ) {
+				continue;
+			}
+			for( Sint32 u2 = std::max(u - 1, x - offset); u2 <= std::min(u + 1, x + offset); ++u2 ) {
+				for( Sint32 v2 = std::max(v - 1, y - offset); v2 <= std::min(v + 1, y + offset); ++v2 ) {
+					if( at(u2, v2) == 1 ) {
+						at(u, v) = 2;
+						goto next;
+					}
+				}
+			}
+		next:;
+		}
+	}
+
+	// fold tiles into chunks
+	memset(outWords, 0, windowWords * sizeof(Uint32));
+	const Sint32 cX = x / (Sint32)Chunk::size;
+	const Sint32 cY = y / (Sint32)Chunk::size;
+	for( Sint32 u = x - offset; u <= x + offset; ++u ) {
+		for( Sint32 v = y - offset; v <= y + offset; ++v ) {
+			if( u < 0 || v < 0 || u >= width || v >= height || !at(u, v) ) {
+				continue;
+			}
+			Uint32 bit = (v / (Sint32)Chunk::size - cY + windowRange) + (u / (Sint32)Chunk::size - cX + windowRange) * windowSize;
+			outWords[bit >> 5] |= 1u << (bit & 31);
+		}
+	}
+}
+
+bool TilePVS::traceLine(Sint32 sX, Sint32 sY, Sint32 eX, Sint32 eY) const {
+	Sint32 dx = eX - sX;
+	Sint32 dy = eY - sY;
+	Sint32 dxabs = abs(dx);
+	Sint32 dyabs = abs(dy);
+	Sint32 a = dyabs / 2;
+	Sint32 b = dxabs / 2;
+	Sint32 u2 = sX;
+	Sint32 v2 = sY;
+
+	if( dxabs > dyabs ) { // the line is more horizontal than vertical
+		for( Sint32 i = 0; i < dxabs; ++i ) {
+			u2 += sgn(dx);
+			b += dyabs;
+			if( b >= dxabs ) {
+				b -= dxabs;
+				v2 += sgn(dy);
+			}
+			if( u2 >= 0 && u2 < width && v2 >= 0 && v2 < height && !open[v2 + u2 * height] ) {
+				return false;
+			}
+		}
+	} else { // the line is more vertical than horizontal
+		for( Sint32 i = 0; i < dyabs; ++i ) {
+			v2 += sgn(dy);
+			a += dxabs;
+			if( a >= dyabs ) {
+				a -= dyabs;
+				u2 += sgn(dx);
+			}
+			if( u2 >= 0 && u2 < width && v2 >= 0 && v2 < height && !open[v2 + u2 * height] ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+Uint32 TilePVS::addSet(const Uint32* set) {
+	// FNV-1a over the words
+	Uint32 hash = 2166136261u;
+	for( Uint32 c = 0; c < windowWords; ++c ) {
+		hash = (hash ^ set[c]) * 16777619u;
+	}
+
+	const Uint32* found = setMap.find(hash);
+	if( found && memcmp(&words[*found * windowWords], set, windowWords * sizeof(Uint32)) == 0 ) {
+		return *found;
+	}
+
+	// a hash collision just means the new set isn't shared
+	Uint32 index = numSets++;
+	Uint32 base = words.getSize();
+	if( base + windowWords > words.getMaxSize() ) {
+		words.reserve(std::max(base + windowWords, words.getMaxSize() * 2));
+	}
+	words.resize(base + windowWords);
+	memcpy(&words[base], set, windowWords * sizeof(Uint32));
+	if( !found ) {
+		setMap.insert(hash, index);
+	}
+	return index;
+}
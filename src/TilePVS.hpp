@@ -0,0 +1,107 @@
+// TilePVS.hpp
+// Potentially visible set of chunks for every open tile in a TileWorld
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+#include "Rect.hpp"
+
+class TileWorld;
+
+// for each open tile, the chunks that could be seen from it are baked into a bitset when
+// the world loads, so occlusion culling becomes a lookup instead of line tests. a set only
+// covers a window of chunks centered on the tile's own chunk (anything further is out of
+// range anyway), and identical windows are stored once, so tiles in the same room usually
+// share a set. sets are conservative: a tile counts as visible if a line to it is clear in
+// either direction, or if it is next to a visible tile. entities that occlude aren't baked.
+class TilePVS {
+public:
+	// index of no set (the tile is solid or outside the world)
+	static const Uint32 nullSet = UINT32_MAX;
+
+	TilePVS() {}
+	~TilePVS() {}
+
+	// getters & setters
+	bool		isBaked() const					{ return baked; }
+	float		getRange() const				{ return range; }
+	Uint32		getVersion() const				{ return version; }
+	Uint32		getNumSets() const				{ return numSets; }
+	Sint32		getWindowRange() const			{ return windowRange; }
+	Uint32		getWindowSize() const			{ return windowSize; }
+	Uint32		getMemoryUsage() const			{ return (words.getSize() + tileSets.getSize()) * sizeof(Uint32) + open.getSize(); }
+
+	// @return true if lookups should be used wherever they can answer (pvs.enabled)
+	static bool isEnabled();
+
+	// @param viewRange how far the viewer can see, in world units
+	// @return true if lookups can stand in for line tests at the given range
+	bool isUsable(float viewRange) const;
+
+	// bakes the sets for every tile in the world, split across the engine's worker threads.
+	// does nothing but clear the old sets if lookups are disabled
+	// @param world the world to bake
+	void bake(const TileWorld& world);
+
+	// throws away all baked data
+	void clear();
+
+	// re-reads the tiles in a region and marks every tile that could see into it for a
+	// rebake. the rebake happens the next time the tile is looked up
+	// @param world the world that changed
+	// @param rect the changed tiles
+	void invalidate(const TileWorld& world, const Rect<int>& rect);
+
+	// finds the set for a tile, rebaking it first if it was invalidated
+	// @param x the tile's x coordinate (in tiles)
+	// @param y the tile's y coordinate (in tiles)
+	// @return the set's bits, or nullptr if the tile has none. the pointer is only good until
+	// the next lookup, which may rebake and grow the storage
+	const Uint32* getSet(Sint32 x, Sint32 y);
+
+	// tests whether a chunk is in a set
+	// @param set the set (from getSet())
+	// @param x the tile's x coordinate (in tiles)
+	// @param y the tile's y coordinate (in tiles)
+	// @param cX the chunk's x coordinate (in chunks)
+	// @param cY the chunk's y coordinate (in chunks)
+	// @return true if the chunk is potentially visible from the tile
+	bool testChunk(const Uint32* set, Sint32 x, Sint32 y, Sint32 cX, Sint32 cY) const;
+
+private:
+	// index of a set that must be rebaked before use
+	static const Uint32 dirtySet = UINT32_MAX - 1;
+
+	bool baked = false;
+	float range = 0.f;
+	Uint32 version = 0;
+
+	Sint32 width = 0;				// world width in tiles
+	Sint32 height = 0;				// world height in tiles
+	Sint32 tileRange = 0;			// bake range in tiles
+	Sint32 windowRange = 0;			// chunks covered on each side of the tile's chunk
+	Uint32 windowSize = 0;			// width of the window in chunks
+	Uint32 windowWords = 0;			// words per set
+
+	ArrayList<Uint8> open;			// 1 for each tile with volume
+	ArrayList<Uint32> tileSets;		// tile index -> set index
+	ArrayList<Uint32> words;		// every set back to back
+	Uint32 numSets = 0;
+	HashMap<Uint32, Uint32> setMap;	// hash of a set's words -> set index
+
+	// computes one tile's window of visible chunks
+	// @param x the tile's x coordinate
+	// @param y the tile's y coordinate
+	// @param outWords receives windowWords words
+	void bakeTile(Sint32 x, Sint32 y, Uint32* outWords) const;
+
+	// traces a line between two tiles
+	// @return true if no solid tile is in the way
+	bool traceLine(Sint32 sX, Sint32 sY, Sint32 eX, Sint32 eY) const;
+
+	// finds or stores a set
+	// @return the set's index
+	Uint32 addSet(const Uint32* set);
+};
@@ -0,0 +1,588 @@
+// TileVis.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "TileVis.hpp"
+#include "TilePVS.hpp"
+#include "TileWorld.hpp"
+#include "Tile.hpp"
+#include "Chunk.hpp"
+#include "Client.hpp"
+#include "Server.hpp"
+
+#include <chrono>
+
+static Cvar cvar_visShadowcast("vis.shadowcast", "work out tile visibility by shadowcasting instead of line tests where the baked sets can't answer (same result, less work)", "1");
+static Cvar cvar_visCache("vis.cache", "number of viewer tiles to keep visibility results for (0 to disable)", "256");
+
+TileVis::~TileVis() {
+	for( auto entry : entries ) {
+		delete entry;
+	}
+	entries.clear();
+}
+
+void TileVis::invalidate() {
+	numEntries = 0;
+	cacheMap.clear();
+}
+
+void TileVis::test(TileWorld& _world, Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out) {
+	method_t method = TilePVS::isEnabled() ? METHOD_PVS : (cvar_visShadowcast.toInt() ? METHOD_SHADOWCAST : METHOD_LINES);
+	Sint32 maxEntries = cvar_visCache.toInt();
+	if( maxEntries <= 0 ) {
+		compute(_world, tX, tY, range, accuracy, method, out);
+		return;
+	}
+
+	// whether the baked sets can answer, and how it's worked out when they can't, change the
+	// answer, so they are part of the key
+	Sint32 tRange = (Sint32)(range / Tile::size);
+	bool pvs = method == METHOD_PVS && _world.getPVS().isUsable(range);
+	bool shadowcast = cvar_visShadowcast.toInt() != 0;
+	Uint64 key = (Uint64)(Uint16)(tX + 1) |
+		((Uint64)(Uint16)(tY + 1) << 16) |
+		((Uint64)(Uint16)tRange << 32) |
+		((Uint64)(accuracy & 0xff) << 48) |
+		((Uint64)method << 56) |
+		((Uint64)(pvs ? 1 : 0) << 60) |
+		((Uint64)(shadowcast ? 1 : 0) << 61);
+	Uint32 version = occluderVersion;
+
+	const Uint32* found = cacheMap.find(key);
+	if( found ) {
+		entry_t& entry = *entries[*found];
+		if( !(accuracy&4) || entry.occluderVersion == version ) {
+			++cacheHits;
+			out = entry.result;
+			return;
+		}
+
+		// an occluder moved since, so work it out again in place
+		++cacheMisses;
+		entry.occluderVersion = version;
+		compute(_world, tX, tY, range, accuracy, method, entry.result);
+		out = entry.result;
+		return;
+	}
+
+	// start over once the cache is full, keeping the entries' storage
+	++cacheMisses;
+	if( numEntries >= (Uint32)maxEntries ) {
+		invalidate();
+	}
+	if( numEntries == entries.getSize() ) {
+		entries.push(new entry_t());
+	}
+	Uint32 index = numEntries++;
+	entry_t& entry = *entries[index];
+	entry.occluderVersion = version;
+	compute(_world, tX, tY, range, accuracy, method, entry.result);
+	cacheMap.insert(key, index);
+	out = entry.result;
+}
+
+void TileVis::compute(TileWorld& _world, Sint32 tX, Sint32 tY, float range, int accuracy, method_t method, result_t& out) {
+	begin(_world, tX, tY, range, accuracy, out);
+
+	// sees everything
+	if( tX < 0 ) {
+		memset(out.tiles.getArray(), 0xff, out.tiles.getSize() * sizeof(Uint32));
+		memset(out.chunks.getArray(), 0xff, out.chunks.getSize() * sizeof(Uint32));
+		for( Sint32 u = 0; u < chunksWidth; ++u ) {
+			for( Sint32 v = 0; v < chunksHeight; ++v ) {
+				out.visibleChunks.push(&world->getChunks()[v + u * chunksHeight]);
+			}
+		}
+		return;
+	}
+
+	if( method == METHOD_PVS && world->getPVS().isUsable(range) && lookupPVS(tX, tY, range, accuracy, out) ) {
+		listChunks(tX, tY, range, out);
+		return;
+	}
+
+	// where the sets can't answer, cast the way vis.shadowcast says
+	bool shadowcast = method == METHOD_SHADOWCAST || (method == METHOD_PVS && cvar_visShadowcast.toInt());
+	if( isOpen(tX, tY) ) {
+		at(tX, tY) = 1;
+	}
+	auto cast = [&](Sint32 x, Sint32 y) {
+		if( shadowcast ) {
+			castShadows(x, y);
+		} else {
+			castLines(x, y);
+		}
+	};
+	cast(tX, tY);
+	if( accuracy&1 ) {
+		if( tX > 0 ) {
+			cast(tX - 1, tY);
+		}
+		if( tX < width - 1 ) {
+			cast(tX + 1, tY);
+		}
+		if( tY > 0 ) {
+			cast(tX, tY - 1);
+		}
+		if( tY < height - 1 ) {
+			cast(tX, tY + 1);
+		}
+	}
+	finish(tX, tY, range, accuracy, out);
+	listChunks(tX, tY, range, out);
+}
+
+void TileVis::begin(TileWorld& _world, Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out) {
+	world = &_world;
+	width = (Sint32)world->getWidth();
+	height = (Sint32)world->getHeight();
+	chunksWidth = world->calcChunksWidth();
+	chunksHeight = world->calcChunksHeight();
+	tileRange = std::max(0, (Sint32)(range / Tile::size));
+	occluders = (accuracy&4) != 0;
+
+	// room for casting from a neighbor, plus one more tile for the extension
+	Sint32 margin = tileRange + 2;
+	windowX = tX - margin;
+	windowY = tY - margin;
+	windowSpan = margin * 2 + 1;
+	window.resize(windowSpan * windowSpan);
+	memset(window.getArray(), 0, window.getSize());
+
+	out.tiles.resize((width * height + 31) / 32);
+	out.chunks.resize((chunksWidth * chunksHeight + 31) / 32);
+	memset(out.tiles.getArray(), 0, out.tiles.getSize() * sizeof(Uint32));
+	memset(out.chunks.getArray(), 0, out.chunks.getSize() * sizeof(Uint32));
+	out.visibleChunks.clearKeepCapacity();
+}
+
+bool TileVis::isOpen(Sint32 x, Sint32 y) const {
+	if( x < 0 || y < 0 || x >= width || y >= height ) {
+		return false;
+	}
+	return world->getTiles()[y + x * height].hasVolume();
+}
+
+bool TileVis::isOpaque(Sint32 x, Sint32 y) const {
+	if( !isOpen(x, y) ) {
+		return true;
+	}
+	if( occluders ) {
+		Uint32 index = (y / Chunk::size) + (x / Chunk::size) * chunksHeight;
+		if( world->getChunks()[index].getCPopulation().getSize() ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void TileVis::castLines(Sint32 tX, Sint32 tY) {
+	if( !isOpen(tX, tY) ) {
+		return;
+	}
+	for( Sint32 u = std::max(0, tX - tileRange); u <= std::min(width - 1, tX + tileRange); ++u ) {
+		for( Sint32 v = std::max(0, tY - tileRange); v <= std::min(height - 1, tY + tileRange); ++v ) {
+			if( !isOpen(u, v) ) {
+				continue;
+			}
+
+			// trace both ways
+			if( traceLine(tX, tY, u, v) || traceLine(u, v, tX, tY) ) {
+				at(u, v) = 1;
+			}
+		}
+	}
+}
+
+bool TileVis::traceLine(Sint32 sX, Sint32 sY, Sint32 eX, Sint32 eY) const {
+	Sint32 dx = eX - sX;
+	Sint32 dy = eY - sY;
+	Sint32 dxabs = abs(dx);
+	Sint32 dyabs = abs(dy);
+	Sint32 a = dyabs / 2;
+	Sint32 b = dxabs / 2;
+	Sint32 u2 = sX;
+	Sint32 v2 = sY;
+
+	if( dxabs > dyabs ) { // the line is more horizontal than vertical
+		for( Sint32 i = 0; i < dxabs; ++i ) {
+			u2 += sgn(dx);
+			b += dyabs;
+			if( b >= dxabs ) {
+				b -= dxabs;
+				v2 += sgn(dy);
+			}
+			if( u2 >= 0 && u2 < width && v2 >= 0 && v2 < height && isOpaque(u2, v2) ) {
+				return false;
+			}
+		}
+	} else { // the line is more vertical than horizontal
+		for( Sint32 i = 0; i < dyabs; ++i ) {
+			v2 += sgn(dy);
+			a += dxabs;
+			if( a >= dyabs ) {
+				a -= dyabs;
+				u2 += sgn(dx);
+			}
+			if( u2 >= 0 && u2 < width && v2 >= 0 && v2 < height && isOpaque(u2, v2) ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void TileVis::castShadows(Sint32 tX, Sint32 tY) {
+	if( !isOpen(tX, tY) ) {
+		return;
+	}
+	at(tX, tY) = 1;
+
+	// transforms from octant space (rows leading away from the viewer) to the world
+	static const Sint32 octants[8][4] = {
+		{ 1, 0, 0, 1 }, { 1, 0, 0, -1 }, { -1, 0, 0, 1 }, { -1, 0, 0, -1 },
+		{ 0, 1, 1, 0 }, { 0, 1, -1, 0 }, { 0, -1, 1, 0 }, { 0, -1, -1, 0 }
+	};
+	for( auto& octant : octants ) {
+		castOctant(tX, tY, octant[0], octant[1], octant[2], octant[3]);
+	}
+}
+
+// scans one octant a row at a time. row i holds the tiles i steps out along the major axis and
+// n steps (0 to i) along the minor one. a line test to a tile passes, on every row before it,
+// the tile nearest the straight line between the two tile centers. so an opaque tile on row k
+// hides every later tile whose line runs less than half a tile from its center, which is the
+// open range of slopes (2m-1)/2k to (2m+1)/2k; those ranges are kept as shadows. a tile in no
+// shadow passes the line tests exactly when one of its ends isn't opaque, unless its line
+// runs midway between two tiles on some row. the line tests round those two ways apart, so
+// they are asked directly
+void TileVis::castOctant(Sint32 tX, Sint32 tY, Sint32 xx, Sint32 xy, Sint32 yx, Sint32 yy) {
+	bool viewerOpaque = isOpaque(tX, tY);
+	shadows.clearKeepCapacity();
+	for( Sint32 i = 1; i <= tileRange; ++i ) {
+		// light the tiles in this row that no shadow covers
+		Uint32 s = 0;
+		for( Sint32 n = 0; n <= i; ++n ) {
+			Sint32 x = tX + i * xx + n * xy;
+			Sint32 y = tY + i * yx + n * yy;
+			if( !isOpen(x, y) || at(x, y) == 1 ) {
+				continue;
+			}
+			while( s < shadows.getSize() && shadows[s].highNum * i <= n * shadows[s].highDen ) {
+				++s;
+			}
+			if( s < shadows.getSize() && shadows[s].lowNum * i < n * shadows[s].lowDen ) {
+				continue;
+			}
+
+			// the line runs midway between two tiles somewhere iff n has fewer trailing zero
+			// bits than i
+			bool midway = n > 0 && (n & -n) < (i & -i);
+			if( midway ? (traceLine(tX, tY, x, y) || traceLine(x, y, tX, tY)) : (!viewerOpaque || !isOpaque(x, y)) ) {
+				at(x, y) = 1;
+			}
+		}
+
+		// opaque tiles in this row cast shadows over the rows past it. the new shadows only
+		// touch each other, so they are merged in with the old ones in order
+		newShadows.clearKeepCapacity();
+		s = 0;
+		auto add = [&](const shadow_t& shadow) {
+			if( newShadows.getSize() ) {
+				shadow_t& last = newShadows.peek();
+				if( shadow.lowNum * last.highDen < last.highNum * shadow.lowDen ) {
+					if( shadow.highNum * last.highDen > last.highNum * shadow.highDen ) {
+						last.highNum = shadow.highNum;
+						last.highDen = shadow.highDen;
+					}
+					return;
+				}
+			}
+			newShadows.push(shadow);
+		};
+		for( Sint32 n = 0; n <= i; ++n ) {
+			Sint32 x = tX + i * xx + n * xy;
+			Sint32 y = tY + i * yx + n * yy;
+			if( x < 0 || y < 0 || x >= width || y >= height || !isOpaque(x, y) ) {
+				continue;
+			}
+			shadow_t shadow;
+			shadow.lowNum = n * 2 - 1;
+			shadow.lowDen = i * 2;
+			shadow.highNum = n * 2 + 1;
+			shadow.highDen = i * 2;
+			while( s < shadows.getSize() && shadows[s].lowNum * shadow.lowDen <= shadow.lowNum * shadows[s].lowDen ) {
+				add(shadows[s]);
+				++s;
+			}
+			add(shadow);
+		}
+		for( ; s < shadows.getSize(); ++s ) {
+			add(shadows[s]);
+		}
+		shadows.swap(newShadows);
+	}
+}
+
+bool TileVis::lookupPVS(Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out) {
+	TilePVS& pvs = world->getPVS();
+	Sint32 cX = tX / Chunk::size;
+	Sint32 cY = tY / Chunk::size;
+	Sint32 cRange = (range / Tile::size) / Chunk::size;
+	Sint32 startU = std::max(0, cX - cRange);
+	Sint32 endU = std::min(chunksWidth - 1, cX + cRange);
+	Sint32 startV = std::max(0, cY - cRange);
+	Sint32 endV = std::min(chunksHeight - 1, cY + cRange);
+
+	// the viewer's tile, plus its neighbors when casting from them too
+	static const Sint32 views[5][2] = { { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	int numViews = (accuracy&1) ? 5 : 1;
+	for( int c = 0; c < numViews; ++c ) {
+		Sint32 x = tX + views[c][0];
+		Sint32 y = tY + views[c][1];
+		const Uint32* set = pvs.getSet(x, y);
+		if( !set ) {
+			continue;
+		}
+		for( Sint32 u = startU; u <= endU; ++u ) {
+			for( Sint32 v = startV; v <= endV; ++v ) {
+				if( pvs.testChunk(set, x, y, u, v) ) {
+					Uint32 index = v + u * chunksHeight;
+					out.chunks[index >> 5] |= 1u << (index & 31);
+				}
+			}
+		}
+	}
+
+	// occluding entities aren't baked. if one is in view, casting has to decide
+	if( accuracy&4 ) {
+		for( Sint32 u = startU; u <= endU; ++u ) {
+			for( Sint32 v = startV; v <= endV; ++v ) {
+				Uint32 index = v + u * chunksHeight;
+				if( out.isChunkVisible(index) && world->getChunks()[index].getCPopulation().getSize() ) {
+					memset(out.chunks.getArray(), 0, out.chunks.getSize() * sizeof(Uint32));
+					return false;
+				}
+			}
+		}
+	}
+
+	// mark the open tiles of the visible chunks
+	Uint32 chunkDim = Chunk::size * Chunk::size;
+	for( Sint32 u = startU; u <= endU; ++u ) {
+		for( Sint32 v = startV; v <= endV; ++v ) {
+			Uint32 index = v + u * chunksHeight;
+			if( !out.isChunkVisible(index) ) {
+				continue;
+			}
+			Chunk& chunk = world->getChunks()[index];
+			for( Uint32 c = 0; c < chunkDim; ++c ) {
+				Tile* tile = chunk.getTile(c);
+				if( tile && tile->hasVolume() ) {
+					Uint32 tileIndex = tile->getY() / Tile::size + (tile->getX() / Tile::size) * height;
+					out.tiles[tileIndex >> 5] |= 1u << (tileIndex & 31);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void TileVis::finish(Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out) {
+	Sint32 startU = std::max(0, windowX);
+	Sint32 endU = std::min(width - 1, windowX + windowSpan - 1);
+	Sint32 startV = std::max(0, windowY);
+	Sint32 endV = std::min(height - 1, windowY + windowSpan - 1);
+
+	// neighbor tiles are visible by extension, but don't extend any further themselves
+	if( accuracy&2 ) {
+		for( Sint32 u = std::max(1, startU); u <= std::min(width - 2, endU); ++u ) {
+			for( Sint32 v = std::max(1, startV); v <= std::min(height - 2, endV); ++v ) {
+				if( at(u, v) || !isOpen(u, v) ) {
+					continue;
+				}
+				Sint32 u1 = std::max(u - 1, startU);
+				Sint32 u2 = std::min(u + 1, endU);
+				Sint32 v1 = std::max(v - 1, startV);
+				Sint32 v2 = std::min(v + 1, endV);
+				if( accuracy&8 ) {
+					for( Sint32 x = u1; x <= u2; ++x ) {
+						for( Sint32 y = v1; y <= v2; ++y ) {
+							if( at(x, y) == 1 ) {
+								at(u, v) = 2;
+								goto next;
+							}
+						}
+					}
+				} else {
+					if( (v2 > v && at(u, v + 1) == 1) || (v1 < v && at(u, v - 1) == 1) ||
+						(u2 > u && at(u + 1, v) == 1) || (u1 < u && at(u - 1, v) == 1) ) {
+						at(u, v) = 2;
+					}
+				}
+			next:;
+			}
+		}
+	}
+
+	// pack tiles, and the chunks in range that hold them
+	Sint32 cX = tX / Chunk::size;
+	Sint32 cY = tY / Chunk::size;
+	Sint32 cRange = (range / Tile::size) / Chunk::size;
+	for( Sint32 u = startU; u <= endU; ++u ) {
+		for( Sint32 v = startV; v <= endV; ++v ) {
+			if( !at(u, v) ) {
+				continue;
+			}
+			Uint32 index = v + u * height;
+			out.tiles[index >> 5] |= 1u << (index & 31);
+
+			Sint32 chunkX = u / Chunk::size;
+			Sint32 chunkY = v / Chunk::size;
+			if( abs(chunkX - cX) <= cRange && abs(chunkY - cY) <= cRange ) {
+				Uint32 chunkIndex = chunkY + chunkX * chunksHeight;
+				out.chunks[chunkIndex >> 5] |= 1u << (chunkIndex & 31);
+			}
+		}
+	}
+}
+
+void TileVis::listChunks(Sint32 tX, Sint32 tY, float range, result_t& out) {
+	Sint32 cX = tX / Chunk::size;
+	Sint32 cY = tY / Chunk::size;
+	Sint32 cRange = (range / Tile::size) / Chunk::size;
+	for( Sint32 u = std::max(0, cX - cRange); u <= std::min(chunksWidth - 1, cX + cRange); ++u ) {
+		for( Sint32 v = std::max(0, cY - cRange); v <= std::min(chunksHeight - 1, cY + cRange); ++v ) {
+			Uint32 index = v + u * chunksHeight;
+			if( out.isChunkVisible(index) ) {
+				out.visibleChunks.push(&world->getChunks()[index]);
+			}
+		}
+	}
+}
+
+static int console_visBenchmark(int argc, const char** argv) {
+	TileWorld* world = nullptr;
+	Client* client = mainEngine->getLocalClient();
+	Server* server = mainEngine->getLocalServer();
+	if( client && client->getNumWorlds() && client->getWorld(0)->getType() == World::WORLD_TILES ) {
+		world = static_cast<TileWorld*>(client->getWorld(0));
+	} else if( server && server->getNumWorlds() && server->getWorld(0)->getType() == World::WORLD_TILES ) {
+		world = static_cast<TileWorld*>(server->getWorld(0));
+	}
+	if( world == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"vis.benchmark needs a tile world loaded on the local client or server.");
+		return 1;
+	}
+
+	Uint32 numViewers = 200;
+	Uint32 rounds = 10;
+	float range = 1024.f;
+	int accuracy = 7;
+	Uint32 tolerance = 0;
+	if( argc >= 1 ) {
+		numViewers = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		rounds = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+	if( argc >= 3 ) {
+		range = std::max(1.f, (float)strtod(argv[2], nullptr));
+	}
+	if( argc >= 4 ) {
+		accuracy = (int)strtol(argv[3], nullptr, 10);
+	}
+	if( argc >= 5 ) {
+		tolerance = std::max(0, (int)strtol(argv[4], nullptr, 10));
+	}
+
+	// viewers stand on random open tiles
+	ArrayList<Sint32> viewers;
+	Random rand;
+	rand.seedValue(1234);
+	Uint32 width = world->getWidth();
+	Uint32 height = world->getHeight();
+	for( Uint32 c = 0, tries = 0; c < numViewers && tries < numViewers * 100; ++tries ) {
+		Sint32 x = rand.getUint32() % width;
+		Sint32 y = rand.getUint32() % height;
+		if( world->getTiles()[y + x * height].hasVolume() ) {
+			viewers.push(x);
+			viewers.push(y);
+			++c;
+		}
+	}
+	numViewers = viewers.getSize() / 2;
+	if( numViewers == 0 ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"vis.benchmark: the world has no open tiles.");
+		return 1;
+	}
+
+	// time each method with the cache out of the way
+	TileVis vis;
+	ArrayList<TileVis::result_t> results[TileVis::METHOD_MAX];
+	double times[TileVis::METHOD_MAX];
+	for( int method = 0; method < TileVis::METHOD_MAX; ++method ) {
+		results[method].resize(numViewers);
+		auto start = std::chrono::steady_clock::now();
+		for( Uint32 round = 0; round < rounds; ++round ) {
+			for( Uint32 c = 0; c < numViewers; ++c ) {
+				vis.compute(*world, viewers[c * 2], viewers[c * 2 + 1], range, accuracy, (TileVis::method_t)method, results[method][c]);
+			}
+		}
+		std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - start;
+		times[method] = time.count() / (rounds * numViewers);
+	}
+
+	// then through the cache, as several viewers per tile would see it
+	ArrayList<TileVis::result_t> cached;
+	cached.resize(numViewers);
+	auto start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < rounds; ++round ) {
+		for( Uint32 c = 0; c < numViewers; ++c ) {
+			vis.test(*world, viewers[c * 2], viewers[c * 2 + 1], range, accuracy, cached[c]);
+		}
+	}
+	std::chrono::duration<double, std::micro> cachedTime = std::chrono::steady_clock::now() - start;
+
+	// counts chunks that agree with the line tests, and those that don't
+	Uint32 numChunks = world->calcChunksWidth() * world->calcChunksHeight();
+	Uint32 same = 0, missing = 0, extra = 0;
+	auto compare = [&](const ArrayList<TileVis::result_t>& others) {
+		same = 0; missing = 0; extra = 0;
+		for( Uint32 c = 0; c < numViewers; ++c ) {
+			const TileVis::result_t& reference = results[TileVis::METHOD_LINES][c];
+			for( Uint32 index = 0; index < numChunks; ++index ) {
+				bool a = reference.isChunkVisible(index);
+				bool b = others[c].isChunkVisible(index);
+				same += (a && b) ? 1 : 0;
+				missing += (a && !b) ? 1 : 0;
+				extra += (!a && b) ? 1 : 0;
+			}
+		}
+	};
+
+	// no method may lose a chunk the line tests see. the baked sets are supersets, so extra
+	// chunks from them are fine, but shadowcasting should only differ within the tolerance
+	const char* names[TileVis::METHOD_MAX] = { "lines", "shadowcast", "pvs" };
+	bool failed = false;
+	mainEngine->fmsg(Engine::MSG_INFO,"%u viewers, range %.0f, accuracy %d, %u rounds, tolerance %u chunks:", numViewers, range, accuracy, rounds, tolerance);
+	for( int method = 0; method < TileVis::METHOD_MAX; ++method ) {
+		compare(results[method]);
+		failed = failed || missing || (method == TileVis::METHOD_SHADOWCAST && missing + extra > tolerance);
+		mainEngine->fmsg(Engine::MSG_INFO,"  %-10s %8.2f us/viewer (%u chunks agree with lines, %u missing, %u extra)",
+			names[method], times[method], same, missing, extra);
+	}
+	compare(cached);
+	failed = failed || missing;
+	mainEngine->fmsg(Engine::MSG_INFO,"  cached     %8.2f us/viewer (%u hits, %u misses, %u chunks agree with lines, %u missing, %u extra)",
+		cachedTime.count() / (rounds * numViewers), vis.getCacheHits(), vis.getCacheMisses(), same, missing, extra);
+	if( failed ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"vis.benchmark: FAILED, a method lost chunks the line tests see, or shadowcasting differs by more than %u chunks", tolerance);
+		return 1;
+	}
+	return 0;
+}
+
+static Ccmd ccmd_visBenchmark("vis.benchmark","times tile visibility methods from random viewer tiles, failing if any loses a chunk the line tests see (args: viewer count, rounds, range, accuracy, chunks shadowcasting may differ by)",&console_visBenchmark);
@@ -0,0 +1,142 @@
+// TileVis.hpp
+// Runtime tile and chunk visibility for viewers in a TileWorld
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "HashMap.hpp"
+
+#include <atomic>
+
+class TileWorld;
+class Chunk;
+
+// answers "what can be seen from this tile" for cameras, lights, and speakers. results are
+// bit-packed and cached per viewer tile, so every viewer standing on the same tile with the
+// same range and accuracy shares one computation until the world changes. the accuracy
+// flags mean the same as they do for Component::seesEntity():
+//		* 1: also cast from immediate neighbors
+//		* 2: neighbor tiles always visible by extension
+//		* 4: respect entities with OCCLUDE flag
+//		* 8: with 2: diagonal neighbors also counted
+class TileVis {
+public:
+	// visibility from one viewer
+	struct result_t {
+		ArrayList<Uint32> tiles;			// one bit per tile (y + x * height)
+		ArrayList<Uint32> chunks;			// one bit per chunk (y + x * chunks height)
+		ArrayList<Chunk*> visibleChunks;	// every chunk whose bit is set
+
+		bool isTileVisible(Uint32 index) const	{ return (tiles[index >> 5] >> (index & 31)) & 1; }
+		bool isChunkVisible(Uint32 index) const	{ return (chunks[index >> 5] >> (index & 31)) & 1; }
+	};
+
+	// ways to work out visibility
+	enum method_t {
+		METHOD_LINES,		// Bresenham lines both ways to every tile in range (the original test)
+		METHOD_SHADOWCAST,	// shadowcasting, which marks the same tiles as the lines but only traces a few of them
+		METHOD_PVS,			// baked sets where possible (a superset of the lines), otherwise lines or shadowcasting as vis.shadowcast says
+		METHOD_MAX
+	};
+
+	TileVis() {}
+	~TileVis();
+
+	// getters & setters
+	Uint32		getCacheHits() const			{ return cacheHits; }
+	Uint32		getCacheMisses() const			{ return cacheMisses; }
+	Uint32		getCacheSize() const			{ return numEntries; }
+
+	// finds what can be seen from a tile, reusing the result of another viewer if possible
+	// @param world the world to look in
+	// @param tX the viewer's x coordinate (in tiles), or -1 for a viewer that sees everything
+	// @param tY the viewer's y coordinate (in tiles)
+	// @param range maximum range to test occlusion with
+	// @param accuracy resolution for the occlusion test (see above)
+	// @param out receives the result
+	void test(TileWorld& world, Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out);
+
+	// works out visibility without the cache
+	// @param method the way to do it
+	// (other params as test())
+	void compute(TileWorld& world, Sint32 tX, Sint32 tY, float range, int accuracy, method_t method, result_t& out);
+
+	// drops every cached result (call when tiles change)
+	void invalidate();
+
+	// drops cached results that respect occluding entities. safe to call from worker threads
+	void invalidateOccluders()					{ ++occluderVersion; }
+
+	// zeroes the cache counters
+	void resetStats()							{ cacheHits = 0; cacheMisses = 0; }
+
+private:
+	struct entry_t {
+		result_t result;
+		Uint32 occluderVersion = 0;
+	};
+
+	// cached results, reused in place once the cache fills up
+	ArrayList<entry_t*> entries;
+	Uint32 numEntries = 0;
+	HashMap<Uint64, Uint32> cacheMap;	// packed viewer tile, range, and accuracy -> entry
+	std::atomic<Uint32> occluderVersion{0};
+	Uint32 cacheHits = 0;
+	Uint32 cacheMisses = 0;
+
+	// state of the computation in progress
+	TileWorld* world = nullptr;
+	Sint32 width = 0;
+	Sint32 height = 0;
+	Sint32 chunksWidth = 0;
+	Sint32 chunksHeight = 0;
+	Sint32 tileRange = 0;
+	bool occluders = false;
+
+	// slopes (low to high, both open) hidden behind opaque tiles in the octant being cast,
+	// in order and not overlapping
+	struct shadow_t {
+		Sint32 lowNum, lowDen;
+		Sint32 highNum, highDen;
+	};
+	ArrayList<shadow_t> shadows;
+	ArrayList<shadow_t> newShadows;
+
+	// tiles visible around the viewer: 1 if seen directly, 2 if by extension
+	Sint32 windowX = 0;
+	Sint32 windowY = 0;
+	Sint32 windowSpan = 0;
+	ArrayList<Uint8> window;
+
+	// prepares the window and per-world sizes for a viewer
+	void begin(TileWorld& world, Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out);
+
+	// @return the window cell for a tile (which must lie inside the window)
+	Uint8& at(Sint32 x, Sint32 y) { return window[(y - windowY) + (x - windowX) * windowSpan]; }
+
+	// @return true if the tile exists and has volume
+	bool isOpen(Sint32 x, Sint32 y) const;
+
+	// @return true if sight can't pass through the tile
+	bool isOpaque(Sint32 x, Sint32 y) const;
+
+	// marks everything within range of one viewer tile with line tests
+	void castLines(Sint32 tX, Sint32 tY);
+	bool traceLine(Sint32 sX, Sint32 sY, Sint32 eX, Sint32 eY) const;
+
+	// marks everything within range of one viewer tile by shadowcasting all eight octants.
+	// marks exactly the tiles castLines() does
+	void castShadows(Sint32 tX, Sint32 tY);
+	void castOctant(Sint32 tX, Sint32 tY, Sint32 xx, Sint32 xy, Sint32 yx, Sint32 yy);
+
+	// fills chunk bits from baked sets
+	// @return false if the sets can't answer (an occluder is in view)
+	bool lookupPVS(Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out);
+
+	// turns the window into tile and chunk bits
+	void finish(Sint32 tX, Sint32 tY, float range, int accuracy, result_t& out);
+
+	// lists the chunks whose bits are set, in the order they are scanned
+	void listChunks(Sint32 tX, Sint32 tY, float range, result_t& out);
+};
@@ -9,6 +9,7 @@
 #include <glm/vec3.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
 
 #include "LinkedList.hpp"
 #include "Node.hpp"
@@ -1087,6 +1088,9 @@ TileWorld::TileWorld(Game* _game, bool _silent, Uint32 _id, Tile::side_t orienta
 }
 
 TileWorld::~TileWorld() {
+	// the bodies have to leave the simulation before the world deletes it
+	collision.clear();
+
 	chunks.clear();
 	tiles.clear();
 
@@ -1280,44 +1284,40 @@ void TileWorld::rotate(Tile::side_t orientation) {
 	}
 	
 	// rotate entities
-	for( Uint32 c=0; c<numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-
-			if (!entity->isShouldSave())
-				continue;
-
-			// update position
-			float temp = 0.f;
-			Vector pos = entity->getPos();
-			float x = (pos.x * cos(rot)) - (pos.y * sin(rot));
-			float y = (pos.x * sin(rot)) + (pos.y * cos(rot));
-			switch( orientation ) {
-				case Tile::SIDE_SOUTH:
-					x += width * Tile::size;
-					break;
-				case Tile::SIDE_WEST:
-					x += width * Tile::size;
-					y += height * Tile::size;
-					break;
-				case Tile::SIDE_NORTH:
-					y += height * Tile::size;
-					break;
-				default:
-					break;
-			}
-			pos.x = x;
-			pos.y = y;
-			entity->setPos(pos);
-			entity->setNewPos(pos);
+	for( auto entity : entities ) {
+		if (!entity->isShouldSave())
+			continue;
 
-			// update angle
-			Angle ang = entity->getAng();
-			ang.yaw += rot;
-			entity->setAng(ang);
-			entity->setNewAng(ang);
-			entity->update();
+		// update position
+		float temp = 0.f;
+		Vector pos = entity->getPos();
+		float x = (pos.x * cos(rot)) - (pos.y * sin(rot));
+		float y = (pos.x * sin(rot)) + (pos.y * cos(rot));
+		switch( orientation ) {
+			case Tile::SIDE_SOUTH:
+				x += width * Tile::size;
+				break;
+			case Tile::SIDE_WEST:
+				x += width * Tile::size;
+				y += height * Tile::size;
+				break;
+			case Tile::SIDE_NORTH:
+				y += height * Tile::size;
+				break;
+			default:
+				break;
 		}
+		pos.x = x;
+		pos.y = y;
+		entity->setPos(pos);
+		entity->setNewPos(pos);
+
+		// update angle
+		Angle ang = entity->getAng();
+		ang.yaw += rot;
+		entity->setAng(ang);
+		entity->setNewAng(ang);
+		entity->update();
 	}
 }
 
@@ -1332,7 +1332,6 @@ void TileWorld::initialize(bool empty) {
 			tile.setWorld(*this);
 			tile.setX(x*Tile::size);
 			tile.setY(y*Tile::size);
-			tile.setDynamicsWorld(*bulletDynamicsWorld);
 
 			// assign chunks to tiles and vice versa
 			Uint32 cX = x/Chunk::size;
@@ -1372,7 +1371,6 @@ void TileWorld::initialize(bool empty) {
 				tile.compileUpperVertices(neighbor,Tile::SIDE_NORTH);
 			}
 			tile.buildBuffers();
-			tile.compileBulletPhysicsMesh();
 		}
 	}
 
@@ -1393,6 +1391,10 @@ void TileWorld::initialize(bool empty) {
 	// create grid object
 	createGrid();
 
+	// build collision and bake visibility
+	buildCollision();
+	bakePVS();
+
 	// setup editor pointer
 	selectedRect.x = -1;
 	selectedRect.y = -1;
@@ -1400,11 +1402,8 @@ void TileWorld::initialize(bool empty) {
 	selectedRect.h = 0;
 
 	// initialize entities
-	for( Uint32 c=0; c<numBuckets; ++c ) {
-		for( Node<Entity*>* node = entities[c].getFirst(); node != nullptr; node = node->getNext() ) {
-			Entity* entity = node->getData();
-			entity->update();
-		}
+	for( auto entity : entities ) {
+		entity->update();
 	}
 }
 
@@ -1563,37 +1562,6 @@ void TileWorld::deselectGeometry() {
 	selectedRect.h = 0;
 }
 
-void TileWorld::findEntitiesInRadius( const Vector& origin, float radius, LinkedList<Entity*>& outList, bool flat ) {
-	if( radius <= 0 ) {
-		return;
-	}
-
-	Sint32 cX = origin.x / (Chunk::size * Tile::size);
-	Sint32 cY = origin.y / (Chunk::size * Tile::size);
-	Sint32 cW = max( 1, (Sint32)(width / Chunk::size) );
-	Sint32 cH = max( 1, (Sint32)(height / Chunk::size) );
-	Sint32 chunkRadius = floor((radius / Tile::size) / Chunk::size) + 1;
-	Sint32 startX = min( max( 0, cX - chunkRadius), cW - 1);
-	Sint32 startY = min( max( 0, cY - chunkRadius), cH - 1);
-	Sint32 endX = min( max( 0, cX + chunkRadius), cW - 1);
-	Sint32 endY = min( max( 0, cY + chunkRadius), cH - 1);
-
-	for( Sint32 x = startX; x <= endX; ++x ) {
-		for( Sint32 y = startY; y <= endY; ++y ) {
-			LinkedList<Entity*>& population = chunks[y + x * cH].getEPopulation();
-			for( auto entity : population ) {
-				Vector diff = origin - entity->getPos();
-				float dist = flat ?
-					sqrt( diff.x * diff.x + diff.y * diff.y ) :
-					sqrt( diff.x * diff.x + diff.y * diff.y + diff.z * diff.z );
-				if( dist <= radius ) {
-					outList.addNodeLast(entity);
-				}
-			}
-		}
-	}
-}
-
 void TileWorld::optimizeChunks() {
 	unsigned int w = calcChunksWidth();
 	unsigned int h = calcChunksHeight();
@@ -1663,28 +1631,22 @@ void TileWorld::serialize(FileInterface * file) {
 	else {
 		// write number of entities
 		Uint32 numEntities = 0;
-		for (Uint32 c = 0; c<numBuckets; ++c) {
-			for (Node<Entity*>* node = entities[c].getFirst(); node != nullptr; node = node->getNext()) {
-				Entity* entity = node->getData();
-				if (entity->isToBeDeleted() || !entity->isShouldSave()) {
-					continue;
-				}
-
-				++numEntities;
+		for( auto entity : entities ) {
+			if (entity->isToBeDeleted() || !entity->isShouldSave()) {
+				continue;
 			}
+
+			++numEntities;
 		}
 
 		file->beginArray(numEntities);
 
-		for (Uint32 c = 0; c<numBuckets; ++c) {
-			for (Node<Entity*>* node = entities[c].getFirst(); node != nullptr; node = node->getNext()) {
-				Entity* entity = node->getData();
-				if (entity->isToBeDeleted() || !entity->isShouldSave()) {
-					continue;
-				}
-
-				file->value(*entity);
+		for( auto entity : entities ) {
+			if (entity->isToBeDeleted() || !entity->isShouldSave()) {
+				continue;
 			}
+
+			file->value(*entity);
 		}
 
 		file->endArray();
@@ -1698,12 +1660,9 @@ void TileWorld::resize(int left, int right, int up, int down) {
 	}
 
 	// delete occlusion data for all entities
-	for( Uint32 c = 0; c < numBuckets; ++c ) {
-		for( Node<Entity*>* node = entities[c].getFirst(); node != nullptr; node = node->getNext() ) {
-			Entity* entity = node->getData();
-			entity->deleteAllVisMaps();
-			entity->clearAllChunkNodes();
-		}
+	for( auto entity : entities ) {
+		entity->deleteAllVisMaps();
+		entity->clearAllChunkNodes();
 	}
 
 	// create new tile array
@@ -1730,7 +1689,6 @@ void TileWorld::resize(int left, int right, int up, int down) {
 			tile.setWorld(*this);
 			tile.setX(x*Tile::size);
 			tile.setY(y*Tile::size);
-			tile.setDynamicsWorld(*bulletDynamicsWorld);
 
 			// assign chunks to tiles and vice versa
 			Uint32 cX = x/Chunk::size;
@@ -1810,7 +1768,6 @@ void TileWorld::resize(int left, int right, int up, int down) {
 				tile.compileUpperVertices(neighbor,Tile::SIDE_NORTH);
 			}
 			tile.buildBuffers();
-			tile.compileBulletPhysicsMesh();
 		}
 	}
 
@@ -1837,35 +1794,29 @@ void TileWorld::resize(int left, int right, int up, int down) {
 	}
 
 	// clear chunk pointers from lights
-	LinkedList<Light*> lights;
-	for( Uint32 c = 0; c < numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-			entity->findAllComponents<Light>(Component::COMPONENT_LIGHT, lights);
-		}
-	}
-	for (auto light : lights) {
-		light->getChunksLit().clear();
+	for (auto component : components[(int)Component::COMPONENT_LIGHT]) {
+		static_cast<Light*>(component)->getChunksLit().clear();
 	}
 
 	// move entities, if necessary
 	if( left || up ) {
-		for( int c=0; c<numBuckets; ++c ) {
-			for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-				Entity* entity = node->getData();
-
-				Vector pos = entity->getPos();
-				pos.x += left * Tile::size;
-				pos.y += up * Tile::size;
-				entity->setPos(pos);
-				entity->update();
-			}
+		for( auto entity : entities ) {
+			Vector pos = entity->getPos();
+			pos.x += left * Tile::size;
+			pos.y += up * Tile::size;
+			entity->setPos(pos);
+			entity->update();
 		}
 	}
 
 	// resize grid
 	destroyGrid();
 	createGrid();
+
+	// every tile moved, so rebuild collision, rebake visibility, and redo the path map
+	buildCollision();
+	bakePVS();
+	pathFinder.reset();
 }
 
 void TileWorld::drawGrid(Camera& camera, float z) {
@@ -2006,42 +1957,26 @@ void TileWorld::draw() {
 	Editor* editor = client->getEditor();
 
 	// build camera list
-	LinkedList<Camera*> cameras;
-	for( Uint32 c = 0; c < numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-			entity->findAllComponents<Camera>(Component::COMPONENT_CAMERA, cameras);
-		}
-	}
-
-	// build light list
-	LinkedList<Light*> lights;
-	for( Uint32 c = 0; c < numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-			entity->findAllComponents<Light>(Component::COMPONENT_LIGHT, lights);
-		}
-	}
-
-	// cull unselected cameras (editor)
-	if( editor && editor->isInitialized() ) {
-		Node<Camera*>* nextNode = nullptr;
-		for( Node<Camera*>* node=cameras.getFirst(); node!=nullptr; node=nextNode ) {
-			Camera* camera = node->getData();
-			nextNode = node->getNext();
+	ArrayList<Camera*> cameras;
+	for( auto component : components[(int)Component::COMPONENT_CAMERA] ) {
+		Camera* camera = static_cast<Camera*>(component);
 
-			// in editor, skip all but selected cams and the main cams
+		// in editor, skip all but selected cams and the main cams
+		if( editor && editor->isInitialized() ) {
 			if( camera != editor->getEditingCamera() && 
 				camera != editor->getMinimapCamera() &&
 				!camera->getEntity()->isSelected() ) {
-				cameras.removeNode(node);
+				continue;
 			}
 		}
+		cameras.push(camera);
 	}
+
+	// light list
+	SlotMap<Component*>& lights = components[(int)Component::COMPONENT_LIGHT];
 	
 	// iterate cameras
-	for( Node<Camera*>* node=cameras.getFirst(); node!=nullptr; node=node->getNext() ) {
-		Camera* camera = node->getData();
+	for( auto camera : cameras ) {
 
 		// skip deactivated cameras
 		if( !camera->getEntity()->isFlag(Entity::flag_t::FLAG_VISIBLE) || !camera->isEnabled() ) {
@@ -2067,7 +2002,7 @@ void TileWorld::draw() {
 		}
 
 		// occlusion test
-		if( !camera->getChunksVisible() ) {
+		if( !camera->hasVisMaps() ) {
 			camera->occlusionTest(camera->getClipFar(), cvar_renderCull.toInt());
 		}
 
@@ -2075,16 +2010,16 @@ void TileWorld::draw() {
 		Sint32 h = calcChunksHeight();
 		Sint32 chunkSize = Tile::size * Chunk::size;
 
-		ArrayList<Light*> cameraLightList;
+		cameraLightList.clearKeepCapacity();
 
 		// build relevant light list
 		// this could be done better
 		bool shadowsEnabled = (!client->isEditorActive() || !showTools) && !cvar_renderFullbright.toInt() && cvar_shadowsEnabled.toInt();
-		for( Node<Light*>* node=lights.getFirst(); node!=nullptr; node=node->getNext() ) {
-			Light* light = node->getData();
+		for( auto component : lights ) {
+			Light* light = static_cast<Light*>(component);
 
 			light->setChosen(false);
-			light->getChunksLit().clear();
+			light->getChunksLit().clearKeepCapacity();
 
 			// don't render invisible lights
 			if (!light->getEntity()->isFlag(Entity::flag_t::FLAG_VISIBLE) || light->getIntensity() <= 0.f || light->getRadius() <= 0.f || light->getArc() <= 0.f ) {
@@ -2096,7 +2031,7 @@ void TileWorld::draw() {
 				Sint32 chunkY = lightChunk->getTile(0)->getY() / chunkSize;
 
 				// add to list of lit chunks
-				if( camera->getChunksVisible()[chunkY + chunkX * h] ) {
+				if( camera->isChunkVisible(chunkY + chunkX * h) ) {
 					light->getChunksLit().push(lightChunk);
 					if( !light->isChosen() ) {
 						light->setChosen(true);
@@ -2232,11 +2167,11 @@ void TileWorld::draw() {
 		glScissor( 0, 0, xres, yres );
 		glEnable( GL_SCISSOR_TEST );
 		ShaderProgram::unmount();
-
-		cameraLightList.clear();
 	}
+	cameraLightList.clearKeepCapacity();
 
-	for (auto light : lights) {
+	for (auto component : lights) {
+		Light* light = static_cast<Light*>(component);
 		if (light->getShadowTicks() != light->getEntity()->getTicks()) {
 			light->deleteShadowMap();
 		}
@@ -2313,6 +2248,7 @@ void TileWorld::placeRoom(const TileWorld& world, Uint32 pickedExitIndex, Uint32
 			tile0.setLocked(true);
 		}
 	}
+	pathFinder.invalidate(Rect<int>(x, y, world.getWidth(), world.getHeight()));
 
 	// copy exits
 	for( const Node<exit_t>* node = world.getExits().getFirst(); node != nullptr; node = node->getNext() ) {
@@ -2329,22 +2265,52 @@ void TileWorld::placeRoom(const TileWorld& world, Uint32 pickedExitIndex, Uint32
 	}
 
 	// copy entities
-	for( int c=0; c<numBuckets; ++c ) {
-		for( const Node<Entity*>* node=world.getEntities(c).getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* src = node->getData();
+	for( auto src : world.getEntities() ) {
+		Entity* entity = src->copy(this);
 
-			Entity* entity = src->copy(this);
+		Vector pos = entity->getPos();
+		pos.x += x * Tile::size;
+		pos.y += y * Tile::size;
+		pos.z += (float)floorDiff;
+		entity->setPos(pos);
+		entity->setNewPos(pos);
+	}
+}
 
-			Vector pos = entity->getPos();
-			pos.x += x * Tile::size;
-			pos.y += y * Tile::size;
-			pos.z += (float)floorDiff;
-			entity->setPos(pos);
-			entity->setNewPos(pos);
-		}
+void TileWorld::buildCollision() {
+	auto start = std::chrono::steady_clock::now();
+	collision.build(*this);
+	std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+	if( !silent ) {
+		mainEngine->fmsg(Engine::MSG_INFO,"merged %u collision triangles into %u bodies (%u KB) in %.1f ms",
+			collision.getNumTriangles(), collision.getNumBodies(), collision.getMemoryUsage() / 1024, time.count());
 	}
 }
 
+void* TileWorld::findHitPointer(const btCollisionObject* object, int triangleIndex) {
+	Tile* tile = collision.findTile(object, triangleIndex);
+	if( tile ) {
+		return tile;
+	}
+	return World::findHitPointer(object, triangleIndex);
+}
+
+void TileWorld::bakePVS() {
+	auto start = std::chrono::steady_clock::now();
+	pvs.bake(*this);
+	vis.invalidate();
+	std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+	if( !silent && pvs.isBaked() ) {
+		mainEngine->fmsg(Engine::MSG_INFO,"baked visibility for %u tiles into %u sets (%u KB) in %.1f ms",
+			tiles.getSize(), pvs.getNumSets(), pvs.getMemoryUsage() / 1024, time.count());
+	}
+}
+
+void TileWorld::invalidateVisibility(const Rect<int>& rect) {
+	pvs.invalidate(*this, rect);
+	vis.invalidate();
+}
+
 void TileWorld::generateObstacleCache()
 {
 	//TODO:
@@ -2368,4 +2334,127 @@ void TileWorld::findRandomTile(float height, int& outX, int& outY) {
 	Sint32 rand = mainEngine->getRandom().getSint32() % validTiles.getSize();
 	outX = validTiles[rand]->getX() / Tile::size;
 	outY = validTiles[rand]->getY() / Tile::size;
-}
\ No newline at end of file
+}
+
+TileWorld* TileWorld::generateScratch(Game* game, const char* genPath, Uint32 seed, bool walkable, ArrayList<Uint32>& outOpen) {
+	Generator gen(false);
+	FileHelper::readObject(mainEngine->buildPath(genPath).get(), gen);
+	if( seed ) {
+		Generator::options_t options = gen.getOptions();
+		options.seed = seed;
+		gen.setOptions(options);
+	}
+	gen.createDungeon();
+	TileWorld* world = new TileWorld(game, UINT32_MAX, genPath, gen);
+	world->initialize(!world->isLoaded());
+
+	// the pathfinder's map is laid out the same way as the tiles
+	outOpen.clear();
+	if( walkable ) {
+		NavSnapshot grid = world->getPathFinder().getSnapshot();
+		for( Uint32 c = 0; c < grid->getSize(); ++c ) {
+			if( grid->isWalkable(c) ) {
+				outOpen.push(c);
+			}
+		}
+	} else {
+		for( Uint32 c = 0; c < world->tiles.getSize(); ++c ) {
+			if( world->tiles[c].hasVolume() ) {
+				outOpen.push(c);
+			}
+		}
+	}
+	if( outOpen.getSize() < 2 ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"'%s' generated no open tiles.",genPath);
+		delete world;
+		return nullptr;
+	}
+	return world;
+}
+
+static int console_arrayListBenchmark(int argc, const char** argv) {
+	Client* client = mainEngine->getLocalClient();
+	if( client == nullptr || client->getNumWorlds() == 0 || client->getWorld(0)->getType() != World::WORLD_TILES ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"arraylist.benchmark needs a tile world loaded on the local client.");
+		return 1;
+	}
+	TileWorld* world = static_cast<TileWorld*>(client->getWorld(0));
+
+	Uint32 rounds = 10;
+	if( argc >= 1 ) {
+		rounds = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+
+	// full chunk rebuilds, as happens after editing or loading
+	auto start = std::chrono::steady_clock::now();
+	for( Uint32 round = 0; round < rounds; ++round ) {
+		for( auto& chunk : world->getChunks() ) {
+			chunk.buildBuffers();
+		}
+	}
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+	mainEngine->fmsg(Engine::MSG_INFO,"%u chunks: %.3f ms per full rebuild",
+		world->getChunks().getSize(), buildTime.count() / rounds);
+
+	// the vertex buffer fill pattern alone: freeing the buffer every time vs keeping its storage
+	Uint32 totalVertices = 0;
+	for( auto& chunk : world->getChunks() ) {
+		totalVertices += chunk.calculateVertices();
+	}
+	for( int keep = 0; keep < 2; ++keep ) {
+		ArrayList<glm::vec3> buffer;
+		start = std::chrono::steady_clock::now();
+		for( Uint32 round = 0; round < rounds; ++round ) {
+			for( auto& chunk : world->getChunks() ) {
+				Uint32 numVertices = chunk.calculateVertices();
+				if( keep ) {
+					buffer.clearKeepCapacity();
+					buffer.reserve(numVertices);
+				} else {
+					buffer.clear();
+					buffer.alloc(numVertices);
+				}
+				for( Uint32 c = 0; c < numVertices; ++c ) {
+					buffer.push(glm::vec3((float)c, 0.f, 0.f));
+				}
+			}
+		}
+		std::chrono::duration<double, std::nano> fillTime = std::chrono::steady_clock::now() - start;
+		mainEngine->fmsg(Engine::MSG_INFO,"vertex buffer fill (%s): %.2f ns per vertex",
+			keep ? "clearKeepCapacity" : "clear", totalVertices ? fillTime.count() / ((double)totalVertices * rounds) : 0.0);
+	}
+
+	// the per-camera light list pattern from TileWorld::draw
+	SlotMap<Component*>& lights = world->getComponents(Component::COMPONENT_LIGHT);
+	for( int keep = 0; keep < 2; ++keep ) {
+		ArrayList<Light*> lightList;
+		ArrayList<Chunk*> chunksLit;
+		start = std::chrono::steady_clock::now();
+		for( Uint32 round = 0; round < rounds * 60; ++round ) {
+			if( keep ) {
+				lightList.clearKeepCapacity();
+			} else {
+				lightList.clear();
+			}
+			for( auto component : lights ) {
+				Light* light = static_cast<Light*>(component);
+				if( keep ) {
+					chunksLit.clearKeepCapacity();
+				} else {
+					chunksLit.clear();
+				}
+				for( auto chunk : light->getVisibleChunks() ) {
+					chunksLit.push(chunk);
+				}
+				lightList.push(light);
+			}
+		}
+		std::chrono::duration<double, std::micro> listTime = std::chrono::steady_clock::now() - start;
+		mainEngine->fmsg(Engine::MSG_INFO,"light lists for %u lights (%s): %.2f us per camera",
+			lights.getSize(), keep ? "clearKeepCapacity" : "clear", listTime.count() / (rounds * 60));
+	}
+
+	return 0;
+}
+
+static Ccmd ccmd_arrayListBenchmark("arraylist.benchmark","times chunk buffer builds and light list fills in the local client's world (arg: rounds)",&console_arrayListBenchmark);
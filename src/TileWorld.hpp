@@ -5,6 +5,10 @@
 #include "World.hpp"
 #include "Tile.hpp"
 #include "Rect.hpp"
+#include "TileCollision.hpp"
+#include "FlowField.hpp"
+#include "TilePVS.hpp"
+#include "TileVis.hpp"
 
 class Chunk;
 class Generator;
@@ -52,13 +56,6 @@ public:
 	// clears all geometry selection
 	virtual void deselectGeometry();
 
-	// finds all entities within a given radius of the provided point
-	// @param origin position to search from
-	// @param radius the radius to search in
-	// @param outList the list to populate
-	// @param flat if true, the search radius is 2-dimensional
-	virtual void findEntitiesInRadius( const Vector& origin, float radius, LinkedList<Entity*>& outList, bool flat = false );
-
 	// optimizes all the chunks in the world
 	void optimizeChunks();
 
@@ -99,12 +96,31 @@ public:
 	// @param chunkDrawList a list of chunks to draw
 	void drawSceneObjects(Camera& camera, const ArrayList<Light*>& lights, const ArrayList<Chunk*>& chunkDrawList);
 
+	// merges tile geometry into the collision bodies of the physics simulation
+	void buildCollision();
+
+	// bakes the potentially visible set of every tile
+	void bakePVS();
+
+	// updates visibility data after tiles were edited
+	// @param rect the changed tiles
+	void invalidateVisibility(const Rect<int>& rect);
+
 	// find a random traversible tile. if none are found, outX and outY remain unchanged
 	// @param outX x coordinate of random tile (in tiles)
 	// @param outY y coordinate of random tile (in tiles)
 	// @param height the minimum height of a traversible tile (floor to ceiling)
 	void findRandomTile(float height, int& outX, int& outY);
 
+	// generates a scratch dungeon that isn't part of the game, for the benchmark commands
+	// @param game the game that hosts the dungeon
+	// @param genPath the generator file to build the dungeon from
+	// @param seed the generator seed, or 0 to keep the one in the file
+	// @param walkable if true, only tiles the pathfinder can walk are open, otherwise any tile with volume
+	// @param outOpen filled with the index of every open tile
+	// @return the new dungeon, which the caller deletes, or nullptr if it has fewer than two open tiles
+	static TileWorld* generateScratch(Game* game, const char* genPath, Uint32 seed, bool walkable, ArrayList<Uint32>& outOpen);
+
 	// getters & setters
 	virtual const type_t		getType() const						{ return WORLD_TILES; }
 	const Uint32				getWidth() const					{ return width; }
@@ -112,6 +128,11 @@ public:
 	ArrayList<Tile>&			getTiles()							{ return tiles; }
 	const ArrayList<Tile>&		getTiles() const					{ return tiles; }
 	ArrayList<Chunk>&			getChunks()							{ return chunks; }
+	TileCollision&				getCollision()						{ return collision; }
+	PathFinder&					getPathFinder()						{ return pathFinder; }
+	FlowFields&					getFlowFields()						{ return flowFields; }
+	TilePVS&					getPVS()							{ return pvs; }
+	TileVis&					getVis()							{ return vis; }
 	const LinkedList<exit_t>&	getExits() const					{ return exits; }
 
 	// editing properties
@@ -123,6 +144,9 @@ public:
 
 	virtual std::future<PathFinder::Path*> findAPath(int startX, int startY, int endX, int endY) override;
 
+	// hits on tile geometry point to the tile that was hit
+	virtual void* findHitPointer(const btCollisionObject* object, int triangleIndex) override;
+
 protected:
 	// when a new world is spawned, it generates an obstacle map/cache of all static obstacles.
 	virtual void generateObstacleCache();
@@ -153,6 +177,21 @@ private:
 	ArrayList<Tile> tiles;
 	ArrayList<Chunk> chunks;
 
+	// tile geometry in the physics simulation
+	TileCollision collision;
+
+	// chunks visible from each tile, baked at load
+	TilePVS pvs;
+
+	// visibility results shared by viewers on the same tile
+	TileVis vis;
+
+	// direction fields shared by entities heading to the same tile
+	FlowFields flowFields;
+
+	// lights that touch the camera being drawn (storage is reused from frame to frame)
+	ArrayList<Light*> cameraLightList;
+
 	// editing variables
 	bool selecting=false;		// selecting tiles
 	Rect<int> selectedRect;		// tile selection rectangle
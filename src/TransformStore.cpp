@@ -0,0 +1,64 @@
+// TransformStore.cpp
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "Main.hpp"
+#include "TransformStore.hpp"
+
+TransformStore& TransformStore::getScratch() {
+	static thread_local TransformStore store;
+	return store;
+}
+
+glm::mat4 TransformStore::compose(const Vector& pos, const Angle& ang, const Vector& scale) {
+	const float cy = cosf(ang.radiansYaw()), sy = sinf(ang.radiansYaw());
+	const float cp = cosf(ang.radiansPitch()), sp = sinf(ang.radiansPitch());
+	const float cr = cosf(ang.radiansRoll()), sr = sinf(ang.radiansRoll());
+
+	// yaw about -Y, pitch about -Z, roll about +X (engine Z is up, GL Y is up)
+	glm::mat4 result;
+	result[0] = glm::vec4(cy * cp, -sp, sy * cp, 0.f) * scale.x;
+	result[1] = glm::vec4(cy * sp * cr - sy * sr, cp * cr, sy * sp * cr + cy * sr, 0.f) * scale.z;
+	result[2] = glm::vec4(-cy * sp * sr - sy * cr, -cp * sr, cy * cr - sy * sp * sr, 0.f) * scale.y;
+	result[3] = glm::vec4(pos.x, -pos.z, pos.y, 1.f);
+	return result;
+}
+
+Uint32 TransformStore::addRoot(const glm::mat4& global) {
+	Uint32 index = parents.getSize();
+	locals.push(global);
+	globals.push(global);
+	parents.push(nullIndex);
+	return index;
+}
+
+Uint32 TransformStore::addNode(Uint32 parent, const glm::mat4& local) {
+	assert(parent < parents.getSize());
+	Uint32 index = parents.getSize();
+	locals.push(local);
+	globals.push(local);
+	parents.push(parent);
+	return index;
+}
+
+void TransformStore::compute() {
+	const Uint32 size = parents.getSize();
+	if( size == 0 ) {
+		return;
+	}
+	const Uint32* parent = &parents[0];
+	const glm::mat4* local = &locals[0];
+	glm::mat4* global = &globals[0];
+	for( Uint32 c = 0; c < size; ++c ) {
+		if( parent[c] != nullIndex ) {
+			global[c] = global[parent[c]] * local[c];
+		}
+	}
+}
+
+void TransformStore::clear() {
+	locals.clearKeepCapacity();
+	globals.clearKeepCapacity();
+	parents.clearKeepCapacity();
+}
@@ -0,0 +1,63 @@
+// TransformStore.hpp
+// Flat arrays of local and global matrices for batched hierarchy updates
+
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/mat4x4.hpp>
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "Vector.hpp"
+#include "Angle.hpp"
+
+// the transform hierarchy (entity -> components -> sub-components) is gathered here one
+// dirty subtree at a time, in depth-first order so that every node comes after its parent.
+// the global matrices can then be worked out in a single forward pass over contiguous arrays
+// instead of by chasing pointers through the tree. storage is kept between batches.
+class TransformStore {
+public:
+	// parent index of a root node
+	static const Uint32 nullIndex = UINT32_MAX;
+
+	TransformStore() {}
+	~TransformStore() {}
+
+	// getters & setters
+	Uint32				getSize() const						{ return parents.getSize(); }
+	const glm::mat4&	getLocal(Uint32 index) const		{ return locals[index]; }
+	const glm::mat4&	getGlobal(Uint32 index) const		{ return globals[index]; }
+
+	// builds a matrix from a position, euler angles, and scale. this is the same matrix as
+	// translate * rotate(yaw) * rotate(pitch) * rotate(roll) * scale, written out directly
+	// @param pos the position
+	// @param ang the rotation
+	// @param scale the scale
+	// @return the composed matrix
+	static glm::mat4 compose(const Vector& pos, const Angle& ang, const Vector& scale);
+
+	// @return a store for scratch work on the calling thread (empty between batches)
+	static TransformStore& getScratch();
+
+	// adds a node whose global matrix is already known
+	// @param global the global matrix
+	// @return the node's index
+	Uint32 addRoot(const glm::mat4& global);
+
+	// adds a node below an earlier node
+	// @param parent the index of the parent node
+	// @param local the node's matrix relative to its parent
+	// @return the node's index
+	Uint32 addNode(Uint32 parent, const glm::mat4& local);
+
+	// works out every global matrix from the root matrices and local matrices
+	void compute();
+
+	// empties the store, keeping its memory
+	void clear();
+
+private:
+	ArrayList<glm::mat4> locals;
+	ArrayList<glm::mat4> globals;
+	ArrayList<Uint32> parents;
+};
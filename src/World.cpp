@@ -10,13 +10,19 @@
 #include "Shadow.hpp"
 #include "Entity.hpp"
 #include "BBox.hpp"
+#include "Model.hpp"
+#include "Light.hpp"
 #include "Generator.hpp"
+#include "TileWorld.hpp"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <chrono>
+#include <algorithm>
+
 const Uint32 World::nuid = UINT32_MAX;
 const char* World::fileExtensions[World::FILE_MAX] = {
 	"wlb",
@@ -26,6 +32,14 @@ const char* World::fileExtensions[World::FILE_MAX] = {
 
 Cvar cvar_showEdges("showedges", "highlight chunk silhouettes with visible lines", "0");
 Cvar cvar_showVerts("showverts", "highlight all triangle edges with visible lines", "0");
+static Cvar cvar_parallelProcess("world.parallel", "process entity movement and transforms on worker threads", "0");
+static Cvar cvar_parallelSlices("world.parallel.slices", "number of slices of entities to queue per worker thread", "4");
+
+// trace batches smaller than this aren't worth waking the worker threads for
+static const Uint32 minParallelTraces = 64;
+
+// traces vary a lot in cost, so batches are cut finer than the threads to even out the load
+static const Uint32 traceSlicesPerThread = 4;
 
 World::World(Game* _game)
 {
@@ -39,12 +53,11 @@ World::~World() {
 	}
 
 	// delete entities
-	for( Uint32 c=0; c<numBuckets; ++c ) {
-		while( entities[c].getFirst() ) {
-			delete entities[c].getFirst()->getData();
-			entities[c].removeNode(entities[c].getFirst());
-		}
+	for( auto entity : entities ) {
+		delete entity;
 	}
+	entities.clear();
+	entitiesByUID.clear();
 
 	// delete script engine
 	if( script ) {
@@ -86,17 +99,13 @@ void World::initialize(bool empty) {
 }
 
 void World::getSelectedEntities(LinkedList<Entity*>& outResult) {
-	for( int c=0; c<numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
+	for( auto entity : entities ) {
+		// skip editor entities
+		if( !entity->isShouldSave() )
+			continue;
 
-			// skip editor entities
-			if( !entity->isShouldSave() )
-				continue;
-
-			if( entity->isSelected() ) {
-				outResult.addNodeLast(entity);
-			}
+		if( entity->isSelected() ) {
+			outResult.addNodeLast(entity);
 		}
 	}
 }
@@ -186,14 +195,10 @@ const bool World::selectEntity(const Uint32 uid, const bool b) {
 }
 
 void World::selectEntities(const bool b) {
-	for( unsigned int c=0; c<numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-
-			if( entity->isSelected() ) {
-				entity->setSelected(b);
-				entity->setHighlighted(b);
-			}
+	for( auto entity : entities ) {
+		if( entity->isSelected() ) {
+			entity->setSelected(b);
+			entity->setHighlighted(b);
 		}
 	}
 
@@ -206,12 +211,16 @@ const World::hit_t World::convexSweep( const btConvexShape* shape, const Vector&
 	hit_t emptyResult;
 	emptyResult.pos = destPos;
 
-	LinkedList<hit_t> list;
-	convexSweepList(shape, originPos, originAng, destPos, destAng, list);
-
-	// return the first entry found
-	if( list.getSize() > 0 ) {
-		return list.getFirst()->getData();
+	static thread_local ArrayList<hit_t> hits;
+	hits.clearKeepCapacity();
+	sweep_t sweep;
+	sweep.shape = shape;
+	sweep.originPos = originPos;
+	sweep.originAng = originAng;
+	sweep.destPos = destPos;
+	sweep.destAng = destAng;
+	if( traceSweep(sweep, TRACE_CLOSEST, hits) ) {
+		return hits[0];
 	}
 
 	return emptyResult;
@@ -232,11 +241,13 @@ struct AllHitsConvexResultCallback : public btCollisionWorld::ConvexResultCallba
 	btAlignedObjectArray<btVector3> m_hitNormalWorld;
 	btAlignedObjectArray<btVector3> m_hitPointWorld;
 	btAlignedObjectArray<btScalar> m_hitFractions;
+	btAlignedObjectArray<int> m_triangleIndices;
 
 	virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
 	{
 		const btCollisionObject* collisionObject = convexResult.m_hitCollisionObject;
 		m_collisionObjects.push_back(collisionObject);
+		m_triangleIndices.push_back(convexResult.m_localShapeInfo ? convexResult.m_localShapeInfo->m_triangleIndex : -1);
 
 		btVector3 hitNormalWorld;
 		if (normalInWorldSpace) {
@@ -259,82 +270,346 @@ struct AllHitsConvexResultCallback : public btCollisionWorld::ConvexResultCallba
 	}
 };
 
-void World::convexSweepList( const btConvexShape* shape, const Vector& originPos, const Angle& originAng, const Vector& destPos, const Angle& destAng, LinkedList<hit_t>& outResult ) {
-	btVector3 btOriginPos(originPos);
+// records every ray hit along with the triangle that was hit, so mesh hits can be traced
+// back to whatever the triangle came from
+struct AllHitsTraceRayCallback : public btCollisionWorld::AllHitsRayResultCallback {
+	AllHitsTraceRayCallback(const btVector3& from, const btVector3& to) :
+		btCollisionWorld::AllHitsRayResultCallback(from, to)
+	{
+	}
+
+	btAlignedObjectArray<int> m_triangleIndices;
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace)
+	{
+		m_triangleIndices.push_back(rayResult.m_localShapeInfo ? rayResult.m_localShapeInfo->m_triangleIndex : -1);
+		return btCollisionWorld::AllHitsRayResultCallback::addSingleResult(rayResult, normalInWorldSpace);
+	}
+};
+
+// keeps only the nearest ray hit that the world doesn't skip. each accepted hit lowers the
+// closest fraction, so hits beyond it are thrown away without being classified or stored.
+// the broadphase still walks the whole ray, so farther objects are narrowphase-tested
+struct ClosestTraceRayCallback : public btCollisionWorld::RayResultCallback {
+	ClosestTraceRayCallback(World& _world, const btVector3& from, const btVector3& to) :
+		world(_world),
+		rayFromWorld(from),
+		rayToWorld(to)
+	{
+	}
+
+	World& world;
+	btVector3 rayFromWorld;
+	btVector3 rayToWorld;
+	World::hit_t hit;
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace)
+	{
+		const btCollisionObject* collisionObject = rayResult.m_collisionObject;
+		btVector3 hitNormalWorld;
+		if (normalInWorldSpace) {
+			hitNormalWorld = rayResult.m_hitNormalLocal;
+		} else {
+			hitNormalWorld = collisionObject->getWorldTransform().getBasis() * rayResult.m_hitNormalLocal;
+		}
+		btVector3 hitPointWorld;
+		hitPointWorld.setInterpolate3(rayFromWorld, rayToWorld, rayResult.m_hitFraction);
+		int triangleIndex = rayResult.m_localShapeInfo ? rayResult.m_localShapeInfo->m_triangleIndex : -1;
+
+		if (world.classifyHit(collisionObject, hitPointWorld, hitNormalWorld, false, triangleIndex, hit)) {
+			m_closestHitFraction = rayResult.m_hitFraction;
+			m_collisionObject = collisionObject;
+		}
+		return m_closestHitFraction;
+	}
+};
+
+// the convex sweep version of ClosestTraceRayCallback
+struct ClosestTraceConvexCallback : public btCollisionWorld::ConvexResultCallback {
+	ClosestTraceConvexCallback(World& _world, const btVector3& from, const btVector3& to) :
+		world(_world),
+		convexFromWorld(from),
+		convexToWorld(to)
+	{
+	}
+
+	World& world;
+	btVector3 convexFromWorld;
+	btVector3 convexToWorld;
+	World::hit_t hit;
+	bool found = false;
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
+	{
+		const btCollisionObject* collisionObject = convexResult.m_hitCollisionObject;
+		btVector3 hitNormalWorld;
+		if (normalInWorldSpace) {
+			hitNormalWorld = convexResult.m_hitNormalLocal;
+		} else {
+			hitNormalWorld = collisionObject->getWorldTransform().getBasis() * convexResult.m_hitNormalLocal;
+		}
+		btVector3 hitPointWorld;
+		hitPointWorld.setInterpolate3(convexFromWorld, convexToWorld, convexResult.m_hitFraction);
+		int triangleIndex = convexResult.m_localShapeInfo ? convexResult.m_localShapeInfo->m_triangleIndex : -1;
+
+		if (world.classifyHit(collisionObject, hitPointWorld, hitNormalWorld, true, triangleIndex, hit)) {
+			m_closestHitFraction = convexResult.m_hitFraction;
+			found = true;
+		}
+		return m_closestHitFraction;
+	}
+
+	virtual bool hasHit() const
+	{
+		return found;
+	}
+};
+
+// walks a broadphase tree along a ray. btCollisionWorld::rayTest() shares one traversal
+// stack inside the broadphase, so it can't run on several threads at once; btDbvt::rayTest()
+// keeps its stack local
+struct TraceRayCollider : public btDbvt::ICollide {
+	TraceRayCollider(const btTransform& from, const btTransform& to, btCollisionWorld::RayResultCallback& _callback) :
+		rayFromTrans(from),
+		rayToTrans(to),
+		callback(_callback)
+	{
+	}
+
+	const btTransform& rayFromTrans;
+	const btTransform& rayToTrans;
+	btCollisionWorld::RayResultCallback& callback;
+
+	void Process(const btDbvtNode* leaf)
+	{
+		if (callback.m_closestHitFraction == btScalar(0.f)) {
+			return;
+		}
+		btBroadphaseProxy* proxy = static_cast<btBroadphaseProxy*>(leaf->data);
+		if (!callback.needsCollision(proxy)) {
+			return;
+		}
+		btCollisionObject* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+		btCollisionWorld::rayTestSingle(rayFromTrans, rayToTrans, object, object->getCollisionShape(), object->getWorldTransform(), callback);
+	}
+};
+
+// walks a broadphase tree over the bounds of a sweep (see TraceRayCollider)
+struct TraceSweepCollider : public btDbvt::ICollide {
+	TraceSweepCollider(const btConvexShape* _shape, const btTransform& from, const btTransform& to, btCollisionWorld::ConvexResultCallback& _callback) :
+		shape(_shape),
+		convexFromTrans(from),
+		convexToTrans(to),
+		callback(_callback)
+	{
+	}
+
+	const btConvexShape* shape;
+	const btTransform& convexFromTrans;
+	const btTransform& convexToTrans;
+	btCollisionWorld::ConvexResultCallback& callback;
+
+	void Process(const btDbvtNode* leaf)
+	{
+		if (callback.m_closestHitFraction == btScalar(0.f)) {
+			return;
+		}
+		btBroadphaseProxy* proxy = static_cast<btBroadphaseProxy*>(leaf->data);
+		if (!callback.needsCollision(proxy)) {
+			return;
+		}
+		btCollisionObject* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+		btCollisionWorld::objectQuerySingle(shape, convexFromTrans, convexToTrans, object, object->getCollisionShape(), object->getWorldTransform(), callback, btScalar(0.f));
+	}
+};
+
+bool World::classifyHit( const btCollisionObject* object, const btVector3& point, const btVector3& normal, bool sweep, int triangleIndex, hit_t& outHit ) {
+	hit_t hit;
+
+	// determine properties of the hit
+	hit.pos = Vector(point.x(), point.y(), point.z());
+	glm::vec3 n = glm::normalize(glm::vec3(normal.x(), normal.y(), normal.z()));
+	hit.normal.x = n.x;
+	hit.normal.y = n.y;
+	hit.normal.z = n.z;
+	hit.index = object->getUserIndex();
+	hit.index2 = object->getUserIndex2();
+	hit.pointer = findHitPointer(object, triangleIndex);
+
+	// determine if we hit an entity or a tile
+	hit.hitEntity = false;
+	hit.hitTile = false;
+	if( hit.index <= uids ) {
+		hit.hitEntity = true;
+	} else if( hit.index2 != World::nuid ) {
+		hit.hitSectorVertex = true;
+	} else if( hit.index == World::nuid ) {
+		if( getType() == WORLD_TILES ) {
+			hit.hitTile = true;
+		} else if( getType() == WORLD_SECTORS ) {
+			hit.hitSector = true;
+		}
+	}
+
+	// skip invalid "hits"
+	if( !hit.hitEntity && !hit.hitTile && !hit.hitSector && !hit.hitSectorVertex ) {
+		return false;
+	}
+
+	// skip untraceable entities
+	if( hit.hitEntity ) {
+		Entity* entity;
+		if( (entity=uidToEntity(hit.index)) != nullptr ) {
+			if( sweep ) {
+				if( !entity->isShouldSave() ) {
+					return false;
+				}
+			} else {
+				if( !entity->isFlag(Entity::flag_t::FLAG_ALLOWTRACE) && (!mainEngine->isEditorRunning() || !entity->isShouldSave()) ) {
+					return false;
+				}
+			}
+			if( entity==shadowCamera ) {
+				return false;
+			}
+		}
+	}
+
+	outHit = hit;
+	return true;
+}
+
+// sorts the hits of one trace nearest to furthest. equal distances keep the order they were found in
+static void sortHits( World::hit_t* hits, Uint32 numHits, const Vector& origin ) {
+	std::stable_sort(hits, hits + numHits, [&origin](const World::hit_t& a, const World::hit_t& b) {
+		return (origin - a.pos).lengthSquared() < (origin - b.pos).lengthSquared();
+	});
+}
+
+Uint32 World::traceRay( const ray_t& ray, trace_t mode, ArrayList<hit_t>& outHits ) {
+	btVector3 btOrigin(ray.origin);
+	btVector3 btDest(ray.dest);
+	btTransform rayFromTrans;
+	rayFromTrans.setIdentity();
+	rayFromTrans.setOrigin(btOrigin);
+	btTransform rayToTrans;
+	rayToTrans.setIdentity();
+	rayToTrans.setOrigin(btDest);
+
+	btDbvtBroadphase* broadphase = static_cast<btDbvtBroadphase*>(bulletBroadphase);
+	if( mode == TRACE_CLOSEST ) {
+		ClosestTraceRayCallback callback(*this, btOrigin, btDest);
+		TraceRayCollider collider(rayFromTrans, rayToTrans, callback);
+		btDbvt::rayTest(broadphase->m_sets[0].m_root, btOrigin, btDest, collider);
+		btDbvt::rayTest(broadphase->m_sets[1].m_root, btOrigin, btDest, collider);
+		if( !callback.hasHit() ) {
+			return 0;
+		}
+		outHits.push(callback.hit);
+		return 1;
+	}
+
+	AllHitsTraceRayCallback callback(btOrigin, btDest);
+	TraceRayCollider collider(rayFromTrans, rayToTrans, callback);
+	btDbvt::rayTest(broadphase->m_sets[0].m_root, btOrigin, btDest, collider);
+	btDbvt::rayTest(broadphase->m_sets[1].m_root, btOrigin, btDest, collider);
+
+	Uint32 first = outHits.getSize();
+	for( int num = 0; num < callback.m_hitPointWorld.size(); ++num ) {
+		hit_t hit;
+		if( classifyHit(callback.m_collisionObjects[num], callback.m_hitPointWorld[num], callback.m_hitNormalWorld[num], false, callback.m_triangleIndices[num], hit) ) {
+			outHits.push(hit);
+		}
+	}
+	Uint32 numHits = outHits.getSize() - first;
+	sortHits(outHits.getArray() + first, numHits, ray.origin);
+	return numHits;
+}
+
+Uint32 World::traceSweep( const sweep_t& sweep, trace_t mode, ArrayList<hit_t>& outHits ) {
+	btVector3 btOriginPos(sweep.originPos);
 	btQuaternion btOriginQuat;
-	btOriginQuat.setEulerZYX(originAng.yaw, -originAng.pitch, -originAng.roll);
+	btOriginQuat.setEulerZYX(sweep.originAng.yaw, -sweep.originAng.pitch, -sweep.originAng.roll);
 	btTransform btOrigin(btOriginQuat, btOriginPos);
 
-	btVector3 btDestPos(destPos);
+	btVector3 btDestPos(sweep.destPos);
 	btQuaternion btDestQuat;
-	btDestQuat.setEulerZYX(destAng.yaw, -destAng.pitch, -destAng.roll);
+	btDestQuat.setEulerZYX(sweep.destAng.yaw, -sweep.destAng.pitch, -sweep.destAng.roll);
 	btTransform btDest(btDestQuat, btDestPos);
 
-	// perform raycast
-	AllHitsConvexResultCallback SweepCallback(btOriginPos, btDestPos);
-	bulletDynamicsWorld->convexSweepTest(shape, btOrigin, btDest, SweepCallback);
-
-	if( SweepCallback.hasHit() ) {
-		for( int num=0; num<SweepCallback.m_hitPointWorld.size(); ++num ) {
-			hit_t hit;
-
-			// determine properties of the hit
-			hit.pos = Vector(SweepCallback.m_hitPointWorld[num].x(),SweepCallback.m_hitPointWorld[num].y(),SweepCallback.m_hitPointWorld[num].z());
-			glm::vec3 normal = glm::normalize(glm::vec3(SweepCallback.m_hitNormalWorld[num].x(),SweepCallback.m_hitNormalWorld[num].y(),SweepCallback.m_hitNormalWorld[num].z()));
-			hit.normal.x = normal.x;
-			hit.normal.y = normal.y;
-			hit.normal.z = normal.z;
-			hit.index = SweepCallback.m_collisionObjects[num]->getUserIndex();
-			hit.index2 = SweepCallback.m_collisionObjects[num]->getUserIndex2();
-			hit.pointer = SweepCallback.m_collisionObjects[num]->getUserPointer();
-
-			// determine if we hit an entity or a tile
-			hit.hitEntity = false;
-			hit.hitTile = false;
-			if( hit.index <= uids ) {
-				hit.hitEntity = true;
-			} else if( hit.index2 != World::nuid ) {
-				hit.hitSectorVertex = true;
-			} else if( hit.index == World::nuid ) {
-				if( getType() == WORLD_TILES ) {
-					hit.hitTile = true;
-				} else if( getType() == WORLD_SECTORS ) {
-					hit.hitSector = true;
-				}
-			}
+	// the sweep covers the shape's bounds at both ends and everything in between
+	btVector3 minA, maxA, minB, maxB;
+	sweep.shape->getAabb(btOrigin, minA, maxA);
+	sweep.shape->getAabb(btDest, minB, maxB);
+	minA.setMin(minB);
+	maxA.setMax(maxB);
+	btDbvtVolume bounds = btDbvtVolume::FromMM(minA, maxA);
+
+	btDbvtBroadphase* broadphase = static_cast<btDbvtBroadphase*>(bulletBroadphase);
+	if( mode == TRACE_CLOSEST ) {
+		ClosestTraceConvexCallback callback(*this, btOriginPos, btDestPos);
+		TraceSweepCollider collider(sweep.shape, btOrigin, btDest, callback);
+		broadphase->m_sets[0].collideTV(broadphase->m_sets[0].m_root, bounds, collider);
+		broadphase->m_sets[1].collideTV(broadphase->m_sets[1].m_root, bounds, collider);
+		if( !callback.hasHit() ) {
+			return 0;
+		}
+		outHits.push(callback.hit);
+		return 1;
+	}
 
-			// skip invalid "hits"
-			if( !hit.hitEntity && !hit.hitTile && !hit.hitSector && !hit.hitSectorVertex ) {
-				continue;
-			}
+	AllHitsConvexResultCallback callback(btOriginPos, btDestPos);
+	TraceSweepCollider collider(sweep.shape, btOrigin, btDest, callback);
+	broadphase->m_sets[0].collideTV(broadphase->m_sets[0].m_root, bounds, collider);
+	broadphase->m_sets[1].collideTV(broadphase->m_sets[1].m_root, bounds, collider);
 
-			// skip untraceable entities
-			if( hit.hitEntity ) {
-				Entity* entity;
-				if( (entity=uidToEntity(hit.index)) != nullptr ) {
-					if( !entity->isShouldSave() ) {
-						continue;
-					}
-					if( entity==shadowCamera ) {
-						continue;
-					}
-				}
-			}
+	Uint32 first = outHits.getSize();
+	for( int num = 0; num < callback.m_hitPointWorld.size(); ++num ) {
+		hit_t hit;
+		if( classifyHit(callback.m_collisionObjects[num], callback.m_hitPointWorld[num], callback.m_hitNormalWorld[num], true, callback.m_triangleIndices[num], hit) ) {
+			outHits.push(hit);
+		}
+	}
+	Uint32 numHits = outHits.getSize() - first;
+	sortHits(outHits.getArray() + first, numHits, sweep.originPos);
+	return numHits;
+}
 
-			// sort and insert the hit entry into the list of results
-			int index = 0;
-			Node<hit_t>* node = nullptr;
-			for( node=outResult.getFirst(); node!=nullptr; node=node->getNext() ) {
-				hit_t& current = node->getData();
+void World::lineTraceBatch( const ray_t* rays, Uint32 numRays, trace_t mode, ArrayList<hit_t>& outHits, ArrayList<Uint32>& outOffsets ) {
+	mainEngine->getThreadPool().gather(numRays, minParallelTraces, traceSlicesPerThread, outHits, outOffsets, [&](Uint32 index, ArrayList<hit_t>& hits) {
+		return traceRay(rays[index], mode, hits);
+	});
+}
 
-				if( (originPos - hit.pos).lengthSquared() < (originPos - current.pos).lengthSquared() ) {
-					break;
-				}
+void World::convexSweepBatch( const sweep_t* sweeps, Uint32 numSweeps, trace_t mode, ArrayList<hit_t>& outHits, ArrayList<Uint32>& outOffsets ) {
+	mainEngine->getThreadPool().gather(numSweeps, minParallelTraces, traceSlicesPerThread, outHits, outOffsets, [&](Uint32 index, ArrayList<hit_t>& hits) {
+		return traceSweep(sweeps[index], mode, hits);
+	});
+}
 
-				++index;
+void World::convexSweepList( const btConvexShape* shape, const Vector& originPos, const Angle& originAng, const Vector& destPos, const Angle& destAng, LinkedList<hit_t>& outResult ) {
+	static thread_local ArrayList<hit_t> hits;
+	hits.clearKeepCapacity();
+	sweep_t sweep;
+	sweep.shape = shape;
+	sweep.originPos = originPos;
+	sweep.originAng = originAng;
+	sweep.destPos = destPos;
+	sweep.destAng = destAng;
+	traceSweep(sweep, TRACE_ALL, hits);
+
+	// merge into whatever the list already holds, keeping it sorted
+	Node<hit_t>* node = outResult.getFirst();
+	int index = 0;
+	for( auto& hit : hits ) {
+		float distSq = (originPos - hit.pos).lengthSquared();
+		for( ; node != nullptr; node = node->getNext(), ++index ) {
+			if( distSq < (originPos - node->getData().pos).lengthSquared() ) {
+				break;
 			}
-			outResult.addNode(index,hit);
 		}
+		outResult.addNode(index, hit);
+		++index;
 	}
 }
 
@@ -342,98 +617,53 @@ const World::hit_t World::lineTrace( const Vector& origin, const Vector& dest )
 	hit_t emptyResult;
 	emptyResult.pos = dest;
 
-	LinkedList<hit_t> list;
-	lineTraceList(origin, dest, list);
-
-	// return the first entry found
-	if( list.getSize() > 0 ) {
-		return list.getFirst()->getData();
+	static thread_local ArrayList<hit_t> hits;
+	hits.clearKeepCapacity();
+	ray_t ray;
+	ray.origin = origin;
+	ray.dest = dest;
+	if( traceRay(ray, TRACE_CLOSEST, hits) ) {
+		return hits[0];
 	}
 
 	return emptyResult;
 }
 
 void World::lineTraceList( const Vector& origin, const Vector& dest, LinkedList<World::hit_t>& outResult ) {
-	btVector3 btOrigin(origin);
-	btVector3 btDest(dest);
-
-	// perform raycast
-	btCollisionWorld::AllHitsRayResultCallback RayCallback(btOrigin, btDest);
-	bulletDynamicsWorld->rayTest(btOrigin, btDest, RayCallback);
-
-	if( RayCallback.hasHit() ) {
-		for( int num=0; num<RayCallback.m_hitPointWorld.size(); ++num ) {
-			hit_t hit;
-
-			// determine properties of the hit
-			hit.pos = Vector(RayCallback.m_hitPointWorld[num].x(),RayCallback.m_hitPointWorld[num].y(),RayCallback.m_hitPointWorld[num].z());
-			glm::vec3 normal = glm::normalize(glm::vec3(RayCallback.m_hitNormalWorld[num].x(),RayCallback.m_hitNormalWorld[num].y(),RayCallback.m_hitNormalWorld[num].z()));
-			hit.normal.x = normal.x;
-			hit.normal.y = normal.y;
-			hit.normal.z = normal.z;
-			hit.index = RayCallback.m_collisionObjects[num]->getUserIndex();
-			hit.index2 = RayCallback.m_collisionObjects[num]->getUserIndex2();
-			hit.pointer = RayCallback.m_collisionObjects[num]->getUserPointer();
-
-			// determine if we hit an entity or a tile
-			hit.hitEntity = false;
-			hit.hitTile = false;
-			if( hit.index <= uids ) {
-				hit.hitEntity = true;
-			} else if( hit.index2 != World::nuid ) {
-				hit.hitSectorVertex = true;
-			} else if( hit.index == World::nuid ) {
-				if( getType() == WORLD_TILES ) {
-					hit.hitTile = true;
-				} else if( getType() == WORLD_SECTORS ) {
-					hit.hitSector = true;
-				}
-			}
-
-			// skip invalid "hits"
-			if( !hit.hitEntity && !hit.hitTile && !hit.hitSector && !hit.hitSectorVertex ) {
-				continue;
-			}
-
-			// skip untraceable entities
-			if( hit.hitEntity ) {
-				Entity* entity;
-				if( (entity=uidToEntity(hit.index)) != nullptr ) {
-					if( !entity->isFlag(Entity::flag_t::FLAG_ALLOWTRACE) && (!mainEngine->isEditorRunning() || !entity->isShouldSave()) ) {
-						continue;
-					}
-					if( entity==shadowCamera ) {
-						continue;
-					}
-				}
-			}
-
-			// sort and insert the hit entry into the list of results
-			int index = 0;
-			Node<hit_t>* node = nullptr;
-			for( node=outResult.getFirst(); node!=nullptr; node=node->getNext() ) {
-				hit_t& current = node->getData();
-
-				if( (origin - hit.pos).lengthSquared() < (origin - current.pos).lengthSquared() ) {
-					break;
-				}
-
-				++index;
+	static thread_local ArrayList<hit_t> hits;
+	hits.clearKeepCapacity();
+	ray_t ray;
+	ray.origin = origin;
+	ray.dest = dest;
+	traceRay(ray, TRACE_ALL, hits);
+
+	// merge into whatever the list already holds, keeping it sorted
+	Node<hit_t>* node = outResult.getFirst();
+	int index = 0;
+	for( auto& hit : hits ) {
+		float distSq = (origin - hit.pos).lengthSquared();
+		for( ; node != nullptr; node = node->getNext(), ++index ) {
+			if( distSq < (origin - node->getData().pos).lengthSquared() ) {
+				break;
 			}
-			outResult.addNode(index,hit);
 		}
+		outResult.addNode(index, hit);
+		++index;
 	}
 }
 
 const World::hit_t World::lineTraceNoEntities( const Vector& origin, const Vector& dest ) {
 	hit_t emptyResult;
 
-	LinkedList<hit_t> list;
-	lineTraceList(origin, dest, list);
+	static thread_local ArrayList<hit_t> hits;
+	hits.clearKeepCapacity();
+	ray_t ray;
+	ray.origin = origin;
+	ray.dest = dest;
+	traceRay(ray, TRACE_ALL, hits);
 
 	// return the first non-entity found
-	for( Node<hit_t>* node = list.getFirst(); node != nullptr; node = node->getNext() ) {
-		hit_t& hit = node->getData();
+	for( auto& hit : hits ) {
 		if( hit.hitTile || hit.hitSector || hit.hitSectorVertex ) {
 			return hit;
 		}
@@ -447,11 +677,9 @@ ArrayList<Entity*> World::getEntitiesByName(const char* name) {
 		return ArrayList<Entity*>();
 	}
 	ArrayList<Entity*> result;
-	for (Uint32 c = 0; c < numBuckets; ++c) {
-		for (auto entity : entities[c]) {
-			if (entity->getName() == name) {
-				result.push(entity);
-			}
+	for (auto entity : entities) {
+		if (entity->getName() == name) {
+			result.push(entity);
 		}
 	}
 	return result;
@@ -461,34 +689,88 @@ Entity* World::uidToEntity(const Uint32 uid) {
 	if( uid==nuid ) {
 		return nullptr;
 	}
-	for( Node<Entity*>* node=entities[uid&(World::numBuckets-1)].getFirst(); node!=nullptr; node=node->getNext() ) {
-		Entity* entity = node->getData();
-		if( entity->getUID()==uid ) {
-			return entity;
-		}
+	Entity** entity = entitiesByUID.find(uid);
+	return entity ? *entity : nullptr;
+}
+
+Entity* World::handleToEntity(const SlotMap<Entity*>::handle_t& handle) {
+	Entity** entity = entities.find(handle);
+	return entity ? *entity : nullptr;
+}
+
+SlotMap<Entity*>::handle_t World::insertEntity(Entity* entity) {
+	entitiesByUID.insert(entity->getUID(), entity);
+	spatialHash.update(entity);
+	return entities.insert(entity);
+}
+
+void World::removeEntity(Entity* entity) {
+	Entity** slot = entities.find(entity->getHandle());
+	if( !slot || *slot != entity ) {
+		return;
+	}
+	entities.erase(entity->getHandle());
+	entitiesByUID.remove(entity->getUID());
+	spatialHash.remove(entity);
+}
+
+void World::findEntitiesInRadius( const Vector& origin, float radius, LinkedList<Entity*>& outList, bool flat ) {
+	static thread_local ArrayList<Entity*> found;
+	found.clearKeepCapacity();
+	spatialHash.queryRadius(origin, radius, found, flat);
+	for( auto entity : found ) {
+		outList.addNodeLast(entity);
 	}
-	return nullptr;
+}
+
+Uint32 World::findEntitiesInRadius( const Vector& origin, float radius, ArrayList<Entity*>& outList, bool flat ) const {
+	return spatialHash.queryRadius(origin, radius, outList, flat);
+}
+
+SlotMap<Component*>::handle_t World::registerComponent(Component* component) {
+	return components[(int)component->getType()].insert(component);
+}
+
+void World::unregisterComponent(Component::type_t type, const SlotMap<Component*>::handle_t& handle) {
+	components[(int)type].erase(handle);
+}
+
+void World::broadcast(Packet& packet) {
+	if( concurrent ) {
+		outbox.push(packet);
+		return;
+	}
+	Net* net = game ? game->getNet() : nullptr;
+	if( net ) {
+		net->signPacket(packet);
+		net->broadcastSafe(packet);
+	}
+}
+
+void World::merge() {
+	assert(!concurrent);
+	for( auto& packet : outbox ) {
+		broadcast(packet);
+	}
+	outbox.clearKeepCapacity();
+	for( auto entity : transfers ) {
+		entity->finishInsertIntoWorld();
+	}
+	transfers.clearKeepCapacity();
 }
 
 void World::findSelectedEntities(LinkedList<Entity*>& outList) {
 	outList.removeAll();
-	for( Uint32 c=0; c<World::numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
-
-			if( entity->isSelected() ) {
-				outList.addNodeLast(entity);
-			}
+	for( auto entity : entities ) {
+		if( entity->isSelected() ) {
+			outList.addNodeLast(entity);
 		}
 	}
 }
 
 void World::preProcess() {
-	for (Uint32 c = 0; c < World::numBuckets; ++c) {
-		for (Node<Entity*>* node = entities[c].getFirst(); node != nullptr; node = node->getNext()) {
-			Entity* entity = node->getData();
-			entity->preProcess();
-		}
+	for( auto entity : entities ) {
+		entity->preProcess();
 	}
 }
 
@@ -531,14 +813,8 @@ void World::process() {
 		float step = 1.f / (float)mainEngine->getTicksPerSecond();
 		bulletDynamicsWorld->stepSimulation(step, 1, step);
 
-		LinkedList<BBox*> bboxes;
-		for( Uint32 c = 0; c < numBuckets; ++c ) {
-			for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-				Entity* entity = node->getData();
-				entity->findAllComponents<BBox>(Component::COMPONENT_BBOX, bboxes);
-			}
-		}
-		for (auto bbox : bboxes) {
+		for (auto component : components[(int)Component::COMPONENT_BBOX]) {
+			BBox* bbox = static_cast<BBox*>(component);
 			if (!bbox->getParent() && bbox->getMass() != 0.f && strcmp(bbox->getName(), "physics") == 0) {
 				btTransform transform = bbox->getPhysicsTransform();
 
@@ -568,51 +844,85 @@ void World::process() {
 	}
 
 	// iterate through entities
-	for( Uint32 c=0; c<World::numBuckets; ++c ) {
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=node->getNext() ) {
-			Entity* entity = node->getData();
+	if( cvar_parallelProcess.toInt() ) {
+		processParallel();
+	} else {
+		for( auto entity : entities ) {
 			entity->process();
 		}
 	}
 
 	// delete entities marked for removal and transfer entities marked for level change
-	for( Uint32 c=0; c<World::numBuckets; ++c ) {
-		Node<Entity*>* nextnode = nullptr;
-		for( Node<Entity*>* node=entities[c].getFirst(); node!=nullptr; node=nextnode ) {
-			Entity* entity = node->getData();
-			nextnode = node->getNext();
-
-			if( entity->isToBeDeleted() ) {
-				bool updateNeeded = entity->isFlag(Entity::flag_t::FLAG_UPDATE) && !entity->isFlag(Entity::flag_t::FLAG_LOCAL);
-				Uint32 uid = entity->getUID();
-				entities[c].removeNode(node);
-				delete entity;
-
-				// inform clients of entity deletion
-				if( !clientObj && updateNeeded ) {
-					Server* server = mainEngine->getLocalServer();
-					if( server ) {
-						Packet packet;
-						packet.write32(uid);
-						packet.write32(id);
-						packet.write("ENTD");
-						server->getNet()->signPacket(packet);
-						server->getNet()->broadcastSafe(packet);
-					}
+	for( auto entity : entities ) {
+		if( entity->isToBeDeleted() ) {
+			bool updateNeeded = entity->isFlag(Entity::flag_t::FLAG_UPDATE) && !entity->isFlag(Entity::flag_t::FLAG_LOCAL);
+			Uint32 uid = entity->getUID();
+			removeEntity(entity);
+			delete entity;
+
+			// inform clients of entity deletion
+			if( !clientObj && updateNeeded ) {
+				Server* server = mainEngine->getLocalServer();
+				if( server ) {
+					Packet packet;
+					packet.write32(uid);
+					packet.write32(id);
+					packet.write("ENTD");
+					broadcast(packet);
 				}
-			} else {
-				entity->finishInsertIntoWorld();
 			}
+		} else if( concurrent ) {
+			// moving to another world touches that world too, so it waits for merge()
+			if( entity->getNewWorld() ) {
+				transfers.push(entity);
+			}
+		} else {
+			entity->finishInsertIntoWorld();
 		}
 	}
+
+	// squeeze out the slots of deleted and departed entities and components
+	entities.compact();
+	for( Uint32 c = 0; c < Component::COMPONENT_MAX; ++c ) {
+		components[c].compact();
+	}
 }
 
-void World::postProcess() {
-	for (Uint32 c = 0; c < World::numBuckets; ++c) {
-		for (Node<Entity*>* node = entities[c].getFirst(); node != nullptr; node = node->getNext()) {
-			Entity* entity = node->getData();
-			entity->postProcess();
+void World::processParallel() {
+	// phase 1: paths and scripts stay on this thread
+	processList.clearKeepCapacity();
+	for( auto entity : entities ) {
+		entity->processScript();
+		processList.push(entity);
+	}
+
+	// phase 2: movement, interpolation and transforms are split across workers.
+	// slices are fixed ranges of the entity table, so the buffers fill the same way
+	// no matter which thread runs which slice
+	ThreadPool& pool = mainEngine->getThreadPool();
+	Uint32 numSlices = std::max(1, cvar_parallelSlices.toInt()) * pool.getNumThreads();
+	if( commandBuffers.getSize() < numSlices ) {
+		commandBuffers.resize(numSlices);
+	}
+	pool.run(processList.getSize(), numSlices, [this](Uint32 slice, Uint32 begin, Uint32 end) {
+		CommandBuffer* previous = CommandBuffer::getCurrent();
+		CommandBuffer::setCurrent(&commandBuffers[slice]);
+		for( Uint32 c = begin; c < end; ++c ) {
+			processList[c]->processMotion();
 		}
+		CommandBuffer::setCurrent(previous);
+	});
+
+	// phase 3 (barrier): apply deferred work in entity order
+	for( Uint32 c = 0; c < numSlices; ++c ) {
+		commandBuffers[c].apply();
+	}
+	processList.clearKeepCapacity();
+}
+
+void World::postProcess() {
+	for( auto entity : entities ) {
+		entity->postProcess();
 	}
 }
 
@@ -626,4 +936,314 @@ World::laser_t& World::addLaser(const Vector& start, const Vector& end, const gl
 	laser.maxLife = life;
 	lasers.push(laser);
 	return lasers.peek();
-}
\ No newline at end of file
+}
+
+static int console_worldBenchmark(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr || server->getNumWorlds() == 0 ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"world.benchmark needs a running server with at least one world.");
+		return 1;
+	}
+	World* world = server->getWorld(0);
+
+	Uint32 numTicks = 60;
+	if( argc >= 1 ) {
+		numTicks = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+
+	const Uint32 counts[] = { 1000, 10000, 50000 };
+	for( auto count : counts ) {
+		ArrayList<Entity*> spawned;
+		spawned.alloc(count);
+		for( Uint32 c = 0; c < count; ++c ) {
+			spawned.push(new Entity(world));
+		}
+
+		// time full world ticks
+		auto start = std::chrono::steady_clock::now();
+		for( Uint32 tick = 0; tick < numTicks; ++tick ) {
+			world->preProcess();
+			world->process();
+			world->postProcess();
+		}
+		std::chrono::duration<double, std::milli> tickTime = std::chrono::steady_clock::now() - start;
+
+		// time uid lookups
+		Uint32 found = 0;
+		start = std::chrono::steady_clock::now();
+		for( auto entity : spawned ) {
+			if( world->uidToEntity(entity->getUID()) == entity ) {
+				++found;
+			}
+		}
+		std::chrono::duration<double, std::nano> lookupTime = std::chrono::steady_clock::now() - start;
+
+		// time deferred removal
+		for( auto entity : spawned ) {
+			entity->remove();
+		}
+		start = std::chrono::steady_clock::now();
+		world->process();
+		std::chrono::duration<double, std::milli> removeTime = std::chrono::steady_clock::now() - start;
+
+		mainEngine->fmsg(Engine::MSG_INFO,"%u entities: %.3f ms/tick, %.1f ns/lookup (%u/%u found), %.3f ms to remove",
+			count, tickTime.count() / numTicks, lookupTime.count() / count, found, count, removeTime.count());
+	}
+
+	return 0;
+}
+
+static Ccmd ccmd_worldBenchmark("world.benchmark","times world ticks with 1k/10k/50k entities on the local server (arg: tick count)",&console_worldBenchmark);
+
+// spawns a reproducible set of moving entities with nested components
+static void spawnDeterminismSet(World* world, Uint32 count, ArrayList<Entity*>& outList) {
+	Random rand;
+	rand.seedValue(1234);
+	outList.alloc(count);
+	for( Uint32 c = 0; c < count; ++c ) {
+		Entity* entity = new Entity(world);
+		entity->setPos(Vector(rand.getFloat() * 2048.f, rand.getFloat() * 2048.f, 0.f));
+		entity->setVel(Vector(rand.getFloat() * 8.f - 4.f, rand.getFloat() * 8.f - 4.f, 0.f));
+		entity->setRot(Angle(rand.getFloat() * .1f - .05f, 0.f, rand.getFloat() * .1f - .05f));
+		if( c % 2 ) {
+			entity->setFlag(static_cast<Uint32>(Entity::FLAG_OCCLUDE));
+		}
+		Component* component = entity->addComponent<Component>();
+		component->setLocalPos(Vector(rand.getFloat() * 16.f, 0.f, 8.f));
+		component->setLocalAng(Angle(rand.getFloat(), 0.f, 0.f));
+		Component* subComponent = component->addComponent<Component>();
+		subComponent->setLocalPos(Vector(0.f, rand.getFloat() * 16.f, 0.f));
+
+		// components that defer shared work to the command buffers
+		if( c % 4 == 0 ) {
+			component->addComponent<Model>()->setLocalPos(Vector(rand.getFloat() * 8.f, 0.f, 0.f));
+			component->addComponent<BBox>()->setLocalPos(Vector(0.f, rand.getFloat() * 8.f, 0.f));
+			component->addComponent<Light>()->setLocalPos(Vector(0.f, 0.f, rand.getFloat() * 8.f));
+		}
+		outList.push(entity);
+	}
+}
+
+// runs world ticks, removing some sub-components half way through (the plain one, and the
+// model, bbox and light, whose shared work would be queued for the tick they're purged in)
+static void tickDeterminismSet(World* world, ArrayList<Entity*>& list, Uint32 numTicks) {
+	for( Uint32 tick = 0; tick < numTicks; ++tick ) {
+		if( tick == numTicks / 2 ) {
+			for( Uint32 c = 0; c < list.getSize(); c += 3 ) {
+				for( auto subComponent : list[c]->getComponents()[0]->getComponents() ) {
+					subComponent->remove();
+				}
+			}
+		}
+		world->preProcess();
+		world->process();
+		world->postProcess();
+	}
+}
+
+// records the transforms, component counts, and chunk membership of a set of entities
+static void snapshotDeterminismSet(const ArrayList<Entity*>& list, ArrayList<float>& outState, ArrayList<const void*>& outChunks) {
+	for( auto entity : list ) {
+		const Vector& pos = entity->getPos();
+		const Angle& ang = entity->getAng();
+		const glm::mat4& mat = entity->getMat();
+		outState.push(pos.x); outState.push(pos.y); outState.push(pos.z);
+		outState.push(ang.yaw); outState.push(ang.pitch); outState.push(ang.roll);
+		for( int i = 0; i < 16; ++i ) {
+			outState.push(mat[i / 4][i % 4]);
+		}
+		outChunks.push(entity->getChunkNode().getList());
+		for( auto component : entity->getComponents() ) {
+			const glm::mat4& gMat = component->getGlobalMat();
+			for( int i = 0; i < 16; ++i ) {
+				outState.push(gMat[i / 4][i % 4]);
+			}
+			outState.push((float)component->getComponents().getSize());
+			for( auto subComponent : component->getComponents() ) {
+				const glm::mat4& subMat = subComponent->getGlobalMat();
+				for( int i = 0; i < 16; ++i ) {
+					outState.push(subMat[i / 4][i % 4]);
+				}
+			}
+			outChunks.push(component->getChunkNode().getList());
+		}
+	}
+}
+
+static int console_worldDeterminism(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr || server->getNumWorlds() == 0 ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"world.determinism needs a running server with at least one world.");
+		return 1;
+	}
+	World* world = server->getWorld(0);
+
+	Uint32 count = 2000;
+	Uint32 numTicks = 120;
+	if( argc >= 1 ) {
+		count = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		numTicks = std::max(2, (int)strtol(argv[1], nullptr, 10));
+	}
+	String oldParallel = cvar_parallelProcess.toStr();
+
+	// serial run
+	ArrayList<Entity*> serialList;
+	ArrayList<float> serialState;
+	ArrayList<const void*> serialChunks;
+	cvar_parallelProcess.set("0");
+	spawnDeterminismSet(world, count, serialList);
+	auto start = std::chrono::steady_clock::now();
+	tickDeterminismSet(world, serialList, numTicks);
+	std::chrono::duration<double, std::milli> serialTime = std::chrono::steady_clock::now() - start;
+	snapshotDeterminismSet(serialList, serialState, serialChunks);
+
+	// parallel run of an identical set
+	ArrayList<Entity*> parallelList;
+	ArrayList<float> parallelState;
+	ArrayList<const void*> parallelChunks;
+	cvar_parallelProcess.set("1");
+	spawnDeterminismSet(world, count, parallelList);
+	start = std::chrono::steady_clock::now();
+	tickDeterminismSet(world, parallelList, numTicks);
+	std::chrono::duration<double, std::milli> parallelTime = std::chrono::steady_clock::now() - start;
+	snapshotDeterminismSet(parallelList, parallelState, parallelChunks);
+	cvar_parallelProcess.set(oldParallel.get());
+
+	// compare bit for bit
+	Uint32 mismatches = 0;
+	if( serialState.getSize() != parallelState.getSize() || serialChunks.getSize() != parallelChunks.getSize() ) {
+		mismatches = UINT32_MAX;
+	} else {
+		for( Uint32 c = 0; c < serialState.getSize(); ++c ) {
+			if( memcmp(&serialState[c], &parallelState[c], sizeof(float)) ) {
+				++mismatches;
+			}
+		}
+		for( Uint32 c = 0; c < serialChunks.getSize(); ++c ) {
+			if( serialChunks[c] != parallelChunks[c] ) {
+				++mismatches;
+			}
+		}
+	}
+
+	// clean up
+	for( auto entity : serialList ) {
+		entity->remove();
+	}
+	for( auto entity : parallelList ) {
+		entity->remove();
+	}
+	world->process();
+
+	if( mismatches ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"world.determinism: FAILED, parallel run differs from serial run (%u mismatched values)", mismatches);
+		return 1;
+	}
+	mainEngine->fmsg(Engine::MSG_INFO,"world.determinism: passed (%u entities, %u ticks, %u threads, serial %.3f ms/tick, parallel %.3f ms/tick)",
+		count, numTicks, mainEngine->getThreadPool().getNumThreads(), serialTime.count() / numTicks, parallelTime.count() / numTicks);
+	return 0;
+}
+
+static Ccmd ccmd_worldDeterminism("world.determinism","checks that parallel entity processing matches serial processing (args: entity count, tick count)",&console_worldDeterminism);
+
+static int console_worldRayBenchmark(int argc, const char** argv) {
+	Server* server = mainEngine->getLocalServer();
+	if( server == nullptr ) {
+		mainEngine->fmsg(Engine::MSG_ERROR,"world.raybenchmark needs a running server.");
+		return 1;
+	}
+
+	Uint32 numRays = 10000;
+	Uint32 numTicks = 10;
+	const char* path = "maps/tilesets/template.json";
+	if( argc >= 1 ) {
+		numRays = std::max(1, (int)strtol(argv[0], nullptr, 10));
+	}
+	if( argc >= 2 ) {
+		numTicks = std::max(1, (int)strtol(argv[1], nullptr, 10));
+	}
+	if( argc >= 3 ) {
+		path = argv[2];
+	}
+
+	// generate a scratch dungeon that isn't part of the game
+	ArrayList<Uint32> open;
+	TileWorld* world = TileWorld::generateScratch(server, path, 0, false, open);
+	if( world == nullptr ) {
+		return 1;
+	}
+
+	// cast rays from the middle of open tiles toward random points in the dungeon
+	Random rand;
+	rand.seedValue(1234);
+	ArrayList<World::ray_t> rays;
+	rays.alloc(numRays);
+	auto tileCenter = [world](Uint32 index) {
+		const Tile& tile = world->getTiles()[index];
+		return Vector(
+			tile.getX() + Tile::size / 2.f,
+			tile.getY() + Tile::size / 2.f,
+			(tile.getFloorHeight() + tile.getCeilingHeight()) / 2.f);
+	};
+	for( Uint32 c = 0; c < numRays; ++c ) {
+		World::ray_t ray;
+		ray.origin = tileCenter(open[rand.getUint32() % open.getSize()]);
+		ray.dest = tileCenter(open[rand.getUint32() % open.getSize()]);
+		rays.push(ray);
+	}
+
+	// one ray at a time, the old way
+	LinkedList<World::hit_t> list;
+	Uint32 listHits = 0;
+	auto start = std::chrono::steady_clock::now();
+	for( Uint32 tick = 0; tick < numTicks; ++tick ) {
+		listHits = 0;
+		for( auto& ray : rays ) {
+			list.removeAll();
+			world->lineTraceList(ray.origin, ray.dest, list);
+			listHits += list.getSize();
+		}
+	}
+	std::chrono::duration<double, std::milli> listTime = std::chrono::steady_clock::now() - start;
+
+	// batched, every hit
+	ArrayList<World::hit_t> hits;
+	ArrayList<Uint32> offsets;
+	start = std::chrono::steady_clock::now();
+	for( Uint32 tick = 0; tick < numTicks; ++tick ) {
+		world->lineTraceBatch(rays.getArray(), numRays, World::TRACE_ALL, hits, offsets);
+	}
+	std::chrono::duration<double, std::milli> allTime = std::chrono::steady_clock::now() - start;
+	Uint32 allHits = hits.getSize();
+
+	// batched, nearest hit only
+	start = std::chrono::steady_clock::now();
+	for( Uint32 tick = 0; tick < numTicks; ++tick ) {
+		world->lineTraceBatch(rays.getArray(), numRays, World::TRACE_CLOSEST, hits, offsets);
+	}
+	std::chrono::duration<double, std::milli> closestTime = std::chrono::steady_clock::now() - start;
+
+	// the nearest hits must agree with single traces
+	Uint32 mismatches = 0;
+	for( Uint32 c = 0; c < numRays; ++c ) {
+		World::hit_t hit = world->lineTrace(rays[c].origin, rays[c].dest);
+		bool batchHit = offsets[c + 1] > offsets[c];
+		bool singleHit = hit.hitEntity || hit.hitTile || hit.hitSector || hit.hitSectorVertex;
+		if( batchHit != singleHit || (batchHit && (hits[offsets[c]].pos - hit.pos).lengthSquared() > 1.f) ) {
+			++mismatches;
+		}
+	}
+
+	mainEngine->fmsg(Engine::MSG_INFO,"%u rays x %u ticks over %u open tiles (%u worker threads):",
+		numRays, numTicks, open.getSize(), mainEngine->getThreadPool().getNumWorkers());
+	mainEngine->fmsg(Engine::MSG_INFO,"  lineTraceList:          %.3f ms/tick (%u hits)", listTime.count() / numTicks, listHits);
+	mainEngine->fmsg(Engine::MSG_INFO,"  lineTraceBatch all:     %.3f ms/tick (%u hits)", allTime.count() / numTicks, allHits);
+	mainEngine->fmsg(Engine::MSG_INFO,"  lineTraceBatch closest: %.3f ms/tick (%u hits, %u mismatches)", closestTime.count() / numTicks, hits.getSize(), mismatches);
+
+	delete world;
+	return mismatches == 0 ? 0 : 1;
+}
+
+static Ccmd ccmd_worldRayBenchmark("world.raybenchmark","times batched line traces against a generated dungeon (args: ray count, tick count, generator path)",&console_worldRayBenchmark);
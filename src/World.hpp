@@ -9,10 +9,16 @@
 
 #include "LinkedList.hpp"
 #include "Node.hpp"
+#include "SlotMap.hpp"
+#include "HashMap.hpp"
+#include "SpatialHash.hpp"
+#include "CommandBuffer.hpp"
+#include "Component.hpp"
 #include "Vector.hpp"
 #include "Console.hpp"
 #include "Path.hpp"
 #include "Shadow.hpp"
+#include "Packet.hpp"
 
 class Script;
 class Entity;
@@ -44,6 +50,27 @@ public:
 		bool hitSectorVertex = false;
 	};
 
+	// one ray in a batched trace
+	struct ray_t {
+		Vector origin;
+		Vector dest;
+	};
+
+	// one convex sweep in a batched trace
+	struct sweep_t {
+		const btConvexShape* shape = nullptr;
+		Vector originPos;
+		Angle originAng;
+		Vector destPos;
+		Angle destAng;
+	};
+
+	// what a trace reports
+	enum trace_t {
+		TRACE_ALL,			// every hit, sorted nearest to furthest
+		TRACE_CLOSEST		// only the nearest hit (cheaper: farther objects are culled as it goes)
+	};
+
 	// file type
 	enum filetype_t {
 		FILE_BINARY,
@@ -62,7 +89,6 @@ public:
 	};
 
 	// const variables
-	static const int numBuckets = 128;
 	static const char* fileExtensions[FILE_MAX];
 
 	// invalid uid for any entity
@@ -80,6 +106,41 @@ public:
 	// @return a pointer to the entity, or nullptr if the entity could not be found
 	Entity* uidToEntity(const Uint32 uid);
 
+	// finds the entity with the given handle in this world
+	// @param handle The handle of the entity to be found
+	// @return a pointer to the entity, or nullptr if the handle is stale
+	Entity* handleToEntity(const SlotMap<Entity*>::handle_t& handle);
+
+	// adds an entity to the world's entity table
+	// @param entity The entity to add
+	// @return the handle to the entity's slot
+	SlotMap<Entity*>::handle_t insertEntity(Entity* entity);
+
+	// removes an entity from the world's entity table without deleting it
+	// @param entity The entity to remove
+	void removeEntity(Entity* entity);
+
+	// signs a packet and sends it to every client through our game's net interface.
+	// while the world is processed concurrently with other worlds, the packet is held
+	// back until merge()
+	// @param packet The packet to send
+	void broadcast(Packet& packet);
+
+	// finishes work that was held back while the world was processed concurrently with
+	// other worlds: queued broadcasts, then entities moving to other worlds.
+	// must be called on the thread that owns the game
+	void merge();
+
+	// adds a component to the registry for its type
+	// @param component The component to add
+	// @return the handle to the component's slot
+	SlotMap<Component*>::handle_t registerComponent(Component* component);
+
+	// removes a component from the registry for its type
+	// @param type The type the component was registered under
+	// @param handle The handle returned by registerComponent()
+	void unregisterComponent(Component::type_t type, const SlotMap<Component*>::handle_t& handle);
+
 	// selects or deselects the entity with the given uid
 	// @param uid the uid of the entity to select
 	// @param b if true, the entity is selected; if false, it is deselected
@@ -111,6 +172,40 @@ public:
 	// @return a hit_t structure containing information on the hit object
 	const hit_t lineTraceNoEntities( const Vector& origin, const Vector& dest );
 
+	// perform many line tests at once. big batches are split across the engine's worker
+	// threads, so nothing may move or change in the world while this runs
+	// @param rays the rays to trace
+	// @param numRays the number of rays
+	// @param mode whether to report every hit or only the nearest one
+	// @param outHits receives the hits of every ray back to back
+	// @param outOffsets receives numRays + 1 offsets; the hits of ray i are in
+	// outHits[outOffsets[i]] to outHits[outOffsets[i + 1] - 1], nearest first
+	void lineTraceBatch( const ray_t* rays, Uint32 numRays, trace_t mode, ArrayList<hit_t>& outHits, ArrayList<Uint32>& outOffsets );
+
+	// perform many convex sweeps at once, with the same rules as lineTraceBatch()
+	// @param sweeps the sweeps to trace
+	// @param numSweeps the number of sweeps
+	// @param mode whether to report every hit or only the nearest one
+	// @param outHits receives the hits of every sweep back to back
+	// @param outOffsets receives numSweeps + 1 offsets into outHits
+	void convexSweepBatch( const sweep_t* sweeps, Uint32 numSweeps, trace_t mode, ArrayList<hit_t>& outHits, ArrayList<Uint32>& outOffsets );
+
+	// fills in a hit on the given object, or rejects it if traces should pass through
+	// @param object the object that was hit
+	// @param point where it was hit, in world space
+	// @param normal the surface normal at the hit, in world space
+	// @param sweep true for convex sweeps, false for rays (they skip different entities)
+	// @param triangleIndex the triangle that was hit on a mesh shape, or -1
+	// @param outHit the hit to fill in
+	// @return true if the hit counts, false if it should be skipped
+	bool classifyHit( const btCollisionObject* object, const btVector3& point, const btVector3& normal, bool sweep, int triangleIndex, hit_t& outHit );
+
+	// finds the thing a hit refers to (hit_t::pointer)
+	// @param object the object that was hit
+	// @param triangleIndex the triangle that was hit on a mesh shape, or -1
+	// @return the object's user pointer, unless the world knows better
+	virtual void* findHitPointer( const btCollisionObject* object, int triangleIndex ) { return object->getUserPointer(); }
+
 	// get a list of all the entities with the given name
 	// @param name The name of the entities
 	// @return a list of entities
@@ -139,7 +234,15 @@ public:
 	// @param radius the radius to search in
 	// @param outList the list to populate
 	// @param flat if true, the search radius is 2-dimensional
-	virtual void findEntitiesInRadius( const Vector& origin, float radius, LinkedList<Entity*>& outList, bool flat = false ) = 0;
+	void findEntitiesInRadius( const Vector& origin, float radius, LinkedList<Entity*>& outList, bool flat = false );
+
+	// finds all entities within a given radius of the provided point
+	// @param origin position to search from
+	// @param radius the radius to search in
+	// @param outList the list to append to
+	// @param flat if true, the search radius is 2-dimensional
+	// @return the number of entities found
+	Uint32 findEntitiesInRadius( const Vector& origin, float radius, ArrayList<Entity*>& outList, bool flat = false ) const;
 
 	// generates a tilemap using the dungeon generator
 	// @param filename The filename to the generator options json
@@ -191,11 +294,16 @@ public:
 	const String&				getFilename() const						{ return filename; }
 	const String&				getShortname() const					{ return shortname; }
 	const String&				getNameStr() const						{ return nameStr; }
-	LinkedList<Entity*>&		getEntities(const Uint32 index)			{ return entities[index]; }
-	const LinkedList<Entity*>&	getEntities(const Uint32 index) const	{ return entities[index]; }
+	SlotMap<Entity*>&			getEntities()							{ return entities; }
+	const SlotMap<Entity*>&		getEntities() const						{ return entities; }
+	Uint32						getNumEntities() const					{ return entities.getSize(); }
+	SlotMap<Component*>&		getComponents(Component::type_t type)	{ return components[(int)type]; }
+	SpatialHash&				getSpatialHash()						{ return spatialHash; }
+	const SpatialHash&			getSpatialHash() const					{ return spatialHash; }
 	btDiscreteDynamicsWorld*&	getBulletDynamicsWorld()				{ return bulletDynamicsWorld; }
 	const bool					isClientObj() const						{ return clientObj; }
 	const bool					isServerObj() const						{ return !clientObj; }
+	bool						isConcurrent() const					{ return concurrent; }
 	const String&				getZone() const							{ return zone; }
 	Uint32						getID() const							{ return id; }
 	const filetype_t			getFiletype() const						{ return filetype; }
@@ -218,6 +326,7 @@ public:
 	void	setShowTools(const bool _showTools)				{ showTools = _showTools; }
 	void	setNameStr(const char* _nameStr)				{ nameStr = _nameStr; }
 	void	setGridVisible(const bool _gridVisible)			{ gridVisible = _gridVisible; }
+	void	setConcurrent(const bool _concurrent)			{ concurrent = _concurrent; }
 
 	virtual std::future<PathFinder::Path*> findAPath(int startX, int startY, int endX, int endY) = 0;
 
@@ -241,7 +350,30 @@ protected:
 
 	// entities
 	Uint32 uids=0;
-	LinkedList<Entity*> entities[numBuckets];
+	SlotMap<Entity*> entities;			// dense entity table
+	HashMap<Uint32, Entity*> entitiesByUID;	// uid -> entity lookup
+	SpatialHash spatialHash;				// entity positions for proximity queries
+
+	// live components of every entity in the world, by type
+	SlotMap<Component*> components[Component::COMPONENT_MAX];
+
+	// parallel processing
+	ArrayList<Entity*> processList;				// entities being processed this tick
+	ArrayList<CommandBuffer> commandBuffers;	// deferred work, one buffer per slice
+
+	// concurrent worlds
+	bool concurrent = false;		// if true, we are being processed alongside other worlds
+	ArrayList<Packet> outbox;		// broadcasts held until merge()
+	ArrayList<Entity*> transfers;	// entities whose move to another world is held until merge()
+
+	// runs Entity::process() for every entity, in phases: scripts on this thread, then
+	// movement and transforms on worker threads, then deferred work back on this thread
+	void processParallel();
+
+	// traces one ray or sweep without touching shared state, so many may run at once
+	// @return the number of hits appended to outHits
+	Uint32 traceRay( const ray_t& ray, trace_t mode, ArrayList<hit_t>& outHits );
+	Uint32 traceSweep( const sweep_t& sweep, trace_t mode, ArrayList<hit_t>& outHits );
 
 	// lasers
 	ArrayList<laser_t> lasers;